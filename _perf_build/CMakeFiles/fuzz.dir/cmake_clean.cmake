@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/fuzz.dir/fuzz.c.o"
+  "CMakeFiles/fuzz.dir/fuzz.c.o.d"
+  "bin/fuzz"
+  "bin/fuzz.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/fuzz.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
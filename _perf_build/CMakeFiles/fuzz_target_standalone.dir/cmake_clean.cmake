@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/fuzz_target_standalone.dir/fuzz_target.c.o"
+  "CMakeFiles/fuzz_target_standalone.dir/fuzz_target.c.o.d"
+  "bin/fuzz_target_standalone"
+  "bin/fuzz_target_standalone.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/fuzz_target_standalone.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/log_bench_elided.dir/log_bench.c.o"
+  "CMakeFiles/log_bench_elided.dir/log_bench.c.o.d"
+  "CMakeFiles/log_bench_elided.dir/reliable.c.o"
+  "CMakeFiles/log_bench_elided.dir/reliable.c.o.d"
+  "bin/log_bench_elided"
+  "bin/log_bench_elided.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/log_bench_elided.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/loopback_bench.dir/loopback_bench.c.o"
+  "CMakeFiles/loopback_bench.dir/loopback_bench.c.o.d"
+  "bin/loopback_bench"
+  "bin/loopback_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/loopback_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/pgo_train.dir/pgo_train.c.o"
+  "CMakeFiles/pgo_train.dir/pgo_train.c.o.d"
+  "bin/pgo_train"
+  "bin/pgo_train.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/pgo_train.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
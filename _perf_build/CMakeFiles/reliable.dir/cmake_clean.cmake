@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable.dir/reliable.c.o"
+  "CMakeFiles/reliable.dir/reliable.c.o.d"
+  "libreliable.a"
+  "libreliable.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_bench.dir/reliable_bench.c.o"
+  "CMakeFiles/reliable_bench.dir/reliable_bench.c.o.d"
+  "bin/reliable_bench"
+  "bin/reliable_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_bench_single.dir/reliable_bench.c.o"
+  "CMakeFiles/reliable_bench_single.dir/reliable_bench.c.o.d"
+  "bin/reliable_bench_single"
+  "bin/reliable_bench_single.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable_bench_single.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
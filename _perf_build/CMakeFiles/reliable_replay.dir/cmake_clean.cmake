@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_replay.dir/reliable.c.o"
+  "CMakeFiles/reliable_replay.dir/reliable.c.o.d"
+  "CMakeFiles/reliable_replay.dir/reliable_replay.c.o"
+  "CMakeFiles/reliable_replay.dir/reliable_replay.c.o.d"
+  "bin/reliable_replay"
+  "bin/reliable_replay.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable_replay.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_server.dir/reliable_server.c.o"
+  "CMakeFiles/reliable_server.dir/reliable_server.c.o.d"
+  "libreliable_server.a"
+  "libreliable_server.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable_server.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_sim.dir/reliable_sim.c.o"
+  "CMakeFiles/reliable_sim.dir/reliable_sim.c.o.d"
+  "libreliable_sim.a"
+  "libreliable_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
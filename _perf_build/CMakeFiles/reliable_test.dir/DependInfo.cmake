@@ -0,0 +1,23 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/reliable.c" "CMakeFiles/reliable_test.dir/reliable.c.o" "gcc" "CMakeFiles/reliable_test.dir/reliable.c.o.d"
+  "/root/repo/reliable_server.c" "CMakeFiles/reliable_test.dir/reliable_server.c.o" "gcc" "CMakeFiles/reliable_test.dir/reliable_server.c.o.d"
+  "/root/repo/reliable_sim.c" "CMakeFiles/reliable_test.dir/reliable_sim.c.o" "gcc" "CMakeFiles/reliable_test.dir/reliable_sim.c.o.d"
+  "/root/repo/reliable_udp.c" "CMakeFiles/reliable_test.dir/reliable_udp.c.o" "gcc" "CMakeFiles/reliable_test.dir/reliable_udp.c.o.d"
+  "/root/repo/test.cpp" "CMakeFiles/reliable_test.dir/test.cpp.o" "gcc" "CMakeFiles/reliable_test.dir/test.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
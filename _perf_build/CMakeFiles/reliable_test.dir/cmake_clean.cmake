@@ -0,0 +1,19 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_test.dir/reliable.c.o"
+  "CMakeFiles/reliable_test.dir/reliable.c.o.d"
+  "CMakeFiles/reliable_test.dir/reliable_server.c.o"
+  "CMakeFiles/reliable_test.dir/reliable_server.c.o.d"
+  "CMakeFiles/reliable_test.dir/reliable_sim.c.o"
+  "CMakeFiles/reliable_test.dir/reliable_sim.c.o.d"
+  "CMakeFiles/reliable_test.dir/reliable_udp.c.o"
+  "CMakeFiles/reliable_test.dir/reliable_udp.c.o.d"
+  "CMakeFiles/reliable_test.dir/test.cpp.o"
+  "CMakeFiles/reliable_test.dir/test.cpp.o.d"
+  "bin/test"
+  "bin/test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C CXX)
+  include(CMakeFiles/reliable_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/reliable_udp.dir/reliable_udp.c.o"
+  "CMakeFiles/reliable_udp.dir/reliable_udp.c.o.d"
+  "libreliable_udp.a"
+  "libreliable_udp.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/reliable_udp.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/scaling_bench.dir/scaling_bench.c.o"
+  "CMakeFiles/scaling_bench.dir/scaling_bench.c.o.d"
+  "bin/scaling_bench"
+  "bin/scaling_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/scaling_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/server_bench.dir/server_bench.c.o"
+  "CMakeFiles/server_bench.dir/server_bench.c.o.d"
+  "bin/server_bench"
+  "bin/server_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/server_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
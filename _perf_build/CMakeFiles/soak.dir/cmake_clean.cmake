@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/soak.dir/soak.c.o"
+  "CMakeFiles/soak.dir/soak.c.o.d"
+  "bin/soak"
+  "bin/soak.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/soak.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
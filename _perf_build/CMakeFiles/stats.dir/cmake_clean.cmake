@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/stats.dir/stats.c.o"
+  "CMakeFiles/stats.dir/stats.c.o.d"
+  "bin/stats"
+  "bin/stats.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/stats.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
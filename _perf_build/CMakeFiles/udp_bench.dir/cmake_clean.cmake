@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/udp_bench.dir/udp_bench.c.o"
+  "CMakeFiles/udp_bench.dir/udp_bench.c.o.d"
+  "bin/udp_bench"
+  "bin/udp_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/udp_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
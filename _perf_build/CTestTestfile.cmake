@@ -0,0 +1,42 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_perf_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(test "/root/repo/_perf_build/bin/test")
+set_tests_properties(test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;278;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(fuzz "/root/repo/_perf_build/bin/fuzz" "20000" "12345")
+set_tests_properties(fuzz PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;279;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(soak "/root/repo/_perf_build/bin/soak" "8192" "--quiet")
+set_tests_properties(soak PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;280;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(soak_mtu "/root/repo/_perf_build/bin/soak" "8192" "--quiet" "--mtu" "1200")
+set_tests_properties(soak_mtu PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;281;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(soak_capture "/root/repo/_perf_build/bin/soak" "1000" "--quiet" "--capture" "soak_capture.bin")
+set_tests_properties(soak_capture PROPERTIES  FIXTURES_SETUP "capture" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;282;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(replay "/root/repo/_perf_build/bin/reliable_replay" "soak_capture.bin" "--repeat" "2")
+set_tests_properties(replay PROPERTIES  FIXTURES_REQUIRED "capture" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;283;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(soak_pcapng "/root/repo/_perf_build/bin/soak" "1000" "--quiet" "--pcapng" "soak_capture.pcapng")
+set_tests_properties(soak_pcapng PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;284;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(fuzz_target "/root/repo/_perf_build/bin/fuzz_target_standalone" "500" "12345")
+set_tests_properties(fuzz_target PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;287;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(server_bench "/root/repo/_perf_build/bin/server_bench" "64" "120" "4")
+set_tests_properties(server_bench PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;288;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(log_bench "/root/repo/_perf_build/bin/log_bench" "1000")
+set_tests_properties(log_bench PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;289;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(reliable_bench "/root/repo/_perf_build/bin/reliable_bench" "--quick")
+set_tests_properties(reliable_bench PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;290;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(reliable_bench_single "/root/repo/_perf_build/bin/reliable_bench_single" "--quick")
+set_tests_properties(reliable_bench_single PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;291;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(loopback_bench "/root/repo/_perf_build/bin/loopback_bench" "--frames" "50" "--lossy")
+set_tests_properties(loopback_bench PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;292;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(scaling_bench "/root/repo/_perf_build/bin/scaling_bench" "--max-endpoints" "100" "--frames" "5")
+set_tests_properties(scaling_bench PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;293;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(pgo_train "/root/repo/_perf_build/bin/pgo_train" "500")
+set_tests_properties(pgo_train PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;294;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(perf_check "/root/.pyenv/shims/python3" "/root/repo/tools/perf/check_perf.py" "--bench" "/root/repo/_perf_build/bin/reliable_bench")
+set_tests_properties(perf_check PROPERTIES  LABELS "perf" SKIP_RETURN_CODE "3" TIMEOUT "900" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;302;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(log_bench_elided "/root/repo/_perf_build/bin/log_bench_elided" "1000")
+set_tests_properties(log_bench_elided PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;306;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(udp_bench "/root/repo/_perf_build/bin/udp_bench" "--frames" "200")
+set_tests_properties(udp_bench PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;308;add_test;/root/repo/CMakeLists.txt;0;")
@@ -27,15 +27,16 @@
 // interesting parser and reassembly code), not just receive() of random bytes.
 //
 // On top of valid traffic it layers adversarial behaviour: packet loss,
-// reordering, duplication, single-bit corruption of otherwise-valid packets, and
-// injection of fully random packets. Run it under AddressSanitizer / UBSan to
+// reordering, duplication and single-bit corruption of otherwise-valid packets by
+// the simulated network in reliable_sim.h, and injection of fully random packets. Run it under AddressSanitizer / UBSan to
 // catch memory errors and undefined behaviour:
 //
-//     clang -g -O1 -fsanitize=address,undefined -DRELIABLE_DEBUG -I. reliable.c fuzz.c -o fuzz && ./fuzz 1000000 <seed>
+//     clang -g -O1 -fsanitize=address,undefined -DRELIABLE_DEBUG -I. reliable.c reliable_sim.c fuzz.c -o fuzz && ./fuzz 1000000 <seed>
 //
 // Usage: fuzz [num_iterations] [seed]   (num_iterations <= 0 runs until Ctrl-C)
 
 #include "reliable.h"
+#include "reliable_sim.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
@@ -65,85 +66,11 @@ int random_int( int a, int b )
 
 double global_time = 100.0;
 
-// Simulated network link: packets a transmit callback hands us are copied into a
-// bounded queue, then flushed (with reordering / loss / duplication / corruption)
-// into the destination endpoint once per iteration.
-
-#define MAX_QUEUE 8192
-
-struct queued_packet_t
-{
-    uint8_t * data;
-    int bytes;
-};
-
-struct link_t
-{
-    struct queued_packet_t packets[MAX_QUEUE];
-    int num_packets;
-};
-
-static void link_queue( struct link_t * link, uint8_t * data, int bytes )
-{
-    if ( link->num_packets == MAX_QUEUE || bytes <= 0 )
-        return;
-    uint8_t * copy = (uint8_t*) malloc( bytes );
-    assert( copy );
-    memcpy( copy, data, bytes );
-    link->packets[link->num_packets].data = copy;
-    link->packets[link->num_packets].bytes = bytes;
-    link->num_packets++;
-}
-
-static void link_clear( struct link_t * link )
-{
-    int i;
-    for ( i = 0; i < link->num_packets; ++i )
-        free( link->packets[i].data );
-    link->num_packets = 0;
-}
-
-// Flush the link into an endpoint, applying loss, reordering, duplication and
-// single-bit corruption so the parser sees plausible-but-broken packets.
-
-static void link_flush( struct link_t * link, struct reliable_endpoint_t * to )
-{
-    // fisher-yates shuffle for reordering
-    int i;
-    for ( i = link->num_packets - 1; i > 0; --i )
-    {
-        int j = rand() % ( i + 1 );
-        struct queued_packet_t tmp = link->packets[i];
-        link->packets[i] = link->packets[j];
-        link->packets[j] = tmp;
-    }
-
-    for ( i = 0; i < link->num_packets; ++i )
-    {
-        uint8_t * data = link->packets[i].data;
-        int bytes = link->packets[i].bytes;
-
-        if ( random_int( 0, 99 ) < 10 )                             // 10% packet loss
-            continue;
-
-        if ( random_int( 0, 99 ) < 20 )                            // 20% single-bit corruption
-            data[random_int( 0, bytes - 1 )] ^= (uint8_t) ( 1 << random_int( 0, 7 ) );
-
-        int copies = random_int( 0, 99 ) < 5 ? 2 : 1;              // 5% duplication
-        int c;
-        for ( c = 0; c < copies; ++c )
-            reliable_endpoint_receive_packet( to, data, bytes );
-    }
-
-    link_clear( link );
-}
-
 struct fuzz_context_t
 {
     struct reliable_endpoint_t * client;
     struct reliable_endpoint_t * server;
-    struct link_t client_to_server;
-    struct link_t server_to_client;
+    struct reliable_sim_t * sim;
 };
 
 static struct fuzz_context_t ctx;
@@ -152,10 +79,7 @@ void test_transmit_packet_function( void * context, uint64_t id, uint16_t sequen
 {
     (void) context;
     (void) sequence;
-    if ( id == 0 )
-        link_queue( &ctx.client_to_server, packet_data, packet_bytes );
-    else
-        link_queue( &ctx.server_to_client, packet_data, packet_bytes );
+    reliable_sim_send( ctx.sim, id == 0 ? 1 : 0, packet_data, packet_bytes );
 }
 
 int test_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
@@ -180,10 +104,24 @@ static struct reliable_endpoint_t * make_endpoint( uint64_t id, const char * nam
     return reliable_endpoint_create( &config, global_time );
 }
 
-void fuzz_initialize()
+void fuzz_initialize( unsigned int seed )
 {
     reliable_init();
     memset( &ctx, 0, sizeof( ctx ) );
+
+    // 10% packet loss, 20% single-bit corruption and 5% duplication. jitter of more than a frame reorders
+
+    struct reliable_sim_config_t sim_config;
+    reliable_sim_default_config( &sim_config );
+    sim_config.seed = seed;
+    sim_config.max_packets = 8192;
+    sim_config.latency = 0.1;
+    sim_config.jitter = 0.1;
+    sim_config.packet_loss = 10.0f;
+    sim_config.corrupt = 20.0f;
+    sim_config.duplicate = 5.0f;
+    ctx.sim = reliable_sim_create( &sim_config, global_time );
+
     ctx.client = make_endpoint( 0, "client" );
     ctx.server = make_endpoint( 1, "server" );
 }
@@ -191,10 +129,9 @@ void fuzz_initialize()
 void fuzz_shutdown()
 {
     printf( "\nshutdown\n" );
-    link_clear( &ctx.client_to_server );
-    link_clear( &ctx.server_to_client );
     reliable_endpoint_destroy( ctx.client );
     reliable_endpoint_destroy( ctx.server );
+    reliable_sim_destroy( ctx.sim );
     reliable_term();
 }
 
@@ -224,9 +161,13 @@ void fuzz_iteration( double time )
     send_random_packet( ctx.client );
     send_random_packet( ctx.server );
 
-    // deliver queued traffic across the lossy / reordering / corrupting link
-    link_flush( &ctx.client_to_server, ctx.server );
-    link_flush( &ctx.server_to_client, ctx.client );
+    // deliver whatever has made it across the lossy / reordering / corrupting network by now
+    reliable_sim_update( ctx.sim, time );
+    uint64_t to;
+    uint8_t * packet_data;
+    int packet_bytes;
+    while ( ( packet_data = reliable_sim_receive( ctx.sim, &to, &packet_bytes ) ) != NULL )
+        reliable_endpoint_receive_packet( to == 0 ? ctx.client : ctx.server, packet_data, packet_bytes );
 
     // inject fully random packets straight into receive (the classic fuzz path)
     inject_random_packet( ctx.client );
@@ -254,7 +195,7 @@ int main( int argc, char ** argv )
     printf( "seed = %u\n", seed );
     srand( seed );
 
-    fuzz_initialize();
+    fuzz_initialize( seed );
 
     signal( SIGINT, interrupt_handler );
 
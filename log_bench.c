@@ -0,0 +1,159 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// Measures what logging costs the send/receive path when it is switched off. Two endpoints talk over a lossless
+// in-process link: each iteration both send a small packet and a packet large enough for 4 fragments, then update
+// and clear acks, so every log site in send, receive, fragment reassembly and the ack loop is crossed.
+//
+// CMake builds this twice. log_bench uses the default build, where every log call is compiled in and filtered at
+// runtime. log_bench_elided compiles reliable.c with RELIABLE_COMPILE_TIME_LOG_LEVEL=RELIABLE_LOG_LEVEL_NONE, so the
+// calls are not there at all. Compare the two in a Release build.
+//
+// Usage: log_bench [num_iterations]
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define SMALL_PACKET_BYTES 100
+#define LARGE_PACKET_BYTES 4000
+
+static double bench_time()
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+static struct reliable_endpoint_t * endpoints[2];
+
+static void transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    reliable_endpoint_receive_packet( endpoints[id^1], packet_data, packet_bytes );
+}
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+int main( int argc, char ** argv )
+{
+    int num_iterations = 200000;
+
+    if ( argc >= 2 )
+        num_iterations = atoi( argv[1] );
+
+    if ( num_iterations <= 0 )
+    {
+        printf( "usage: log_bench [num_iterations]\n" );
+        return 1;
+    }
+
+    reliable_init();
+
+    double time = 100.0;
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.fragment_above = 1024;
+    config.fragment_size = 1024;
+    config.transmit_packet_function = transmit_packet_function;
+    config.process_packet_function = process_packet_function;
+
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        config.id = (uint64_t) i;
+        endpoints[i] = reliable_endpoint_create( &config, time );
+    }
+
+    static uint8_t packet_data[LARGE_PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    double start_time = bench_time();
+
+    for ( i = 0; i < num_iterations; ++i )
+    {
+        int j;
+        for ( j = 0; j < 2; ++j )
+        {
+            reliable_endpoint_send_packet( endpoints[j], packet_data, SMALL_PACKET_BYTES );
+            reliable_endpoint_send_packet( endpoints[j], packet_data, LARGE_PACKET_BYTES );
+        }
+
+        time += 0.01;
+
+        for ( j = 0; j < 2; ++j )
+        {
+            reliable_endpoint_update( endpoints[j], time );
+            reliable_endpoint_clear_acks( endpoints[j] );
+        }
+    }
+
+    double seconds = bench_time() - start_time;
+
+    uint64_t num_packets = reliable_endpoint_counters( endpoints[0] )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] +
+                           reliable_endpoint_counters( endpoints[1] )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED];
+
+    if ( num_packets != (uint64_t) num_iterations * 4 )
+    {
+        printf( "error: received %d packets, expected %d\n", (int) num_packets, num_iterations * 4 );
+        return 1;
+    }
+
+    printf( "[log_bench] %d iterations, %.3f seconds, %.1f ns/packet, %.0f packets/sec\n", 
+        num_iterations, seconds, seconds * 1000000000.0 / num_packets, num_packets / seconds );
+
+    reliable_endpoint_destroy( endpoints[0] );
+    reliable_endpoint_destroy( endpoints[1] );
+
+    reliable_term();
+
+    return 0;
+}
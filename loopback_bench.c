@@ -0,0 +1,460 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// End-to-end throughput and latency of two endpoints talking over an in-process link. Each frame both endpoints
+// send a burst of packets, the link delivers them, then both endpoints update and clear acks. That runs at several
+// payload sizes, and for each one this reports sustained packets/sec and payload bytes/sec, the cycles spent per
+// packet in send, receive and update, and p50/p99/p999 of the cycles taken by each individual call.
+//
+// The link is lossless by default. --lossy turns it into the same kind of link fuzz.c uses, minus the corruption:
+// 5% loss, 5% duplication and every burst shuffled. Everything is seeded, so runs are repeatable.
+//
+// Cycles come from the timestamp counter where there is one (rdtsc, cntvct_el0), otherwise they are nanoseconds.
+// See BUILDING.md before reading anything into the numbers.
+//
+// Usage: loopback_bench [--frames N] [--lossy] [--output file.json]
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+#endif
+
+#define MAX_PACKET_BYTES ( 16 * 1024 )
+#define PACKETS_PER_FRAME 16
+#define MAX_QUEUE 1024
+#define SEED 0x5EED1234u
+
+static double bench_time()
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+static uint64_t bench_cycles()
+{
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+    return __rdtsc();
+#elif defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#elif defined( __aarch64__ )
+    uint64_t value;
+    __asm__ volatile( "mrs %0, cntvct_el0" : "=r" ( value ) );
+    return value;
+#else
+    return (uint64_t) ( bench_time() * 1000000000.0 );
+#endif
+}
+
+static uint32_t random_state = SEED;
+
+static uint32_t random_uint32()
+{
+    uint32_t x = random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random_state = x;
+    return x;
+}
+
+// ---------------------------------------------------------------
+
+// per-call samples of one operation, in cycles
+
+struct samples_t
+{
+    uint64_t * values;
+    int count;
+    int capacity;
+    uint64_t total;
+};
+
+static void samples_add( struct samples_t * samples, uint64_t value )
+{
+    if ( samples->count == samples->capacity )
+    {
+        samples->capacity = samples->capacity ? samples->capacity * 2 : 4096;
+        samples->values = (uint64_t*) realloc( samples->values, samples->capacity * sizeof( uint64_t ) );
+        assert( samples->values );
+    }
+    samples->values[samples->count++] = value;
+    samples->total += value;
+}
+
+static int compare_uint64( const void * a, const void * b )
+{
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return x < y ? -1 : ( x > y ? 1 : 0 );
+}
+
+// call after all samples are in. sorts them
+
+static uint64_t samples_percentile( struct samples_t * samples, double percentile )
+{
+    if ( samples->count == 0 )
+        return 0;
+    int index = (int) ( percentile / 100.0 * samples->count );
+    if ( index >= samples->count )
+        index = samples->count - 1;
+    return samples->values[index];
+}
+
+static void samples_reset( struct samples_t * samples )
+{
+    samples->count = 0;
+    samples->total = 0;
+}
+
+// ---------------------------------------------------------------
+
+// datagrams in flight from one endpoint to the other. copied on transmit, delivered by link_flush
+
+struct link_t
+{
+    uint8_t * data[MAX_QUEUE];
+    int bytes[MAX_QUEUE];
+    int num_packets;
+};
+
+struct bench_t
+{
+    struct reliable_endpoint_t * endpoints[2];
+    struct link_t links[2];                     // links[i] carries datagrams sent by endpoints[i]
+    int lossy;
+    struct samples_t send;
+    struct samples_t receive;
+    struct samples_t update;
+    uint64_t num_packets_received;
+    uint64_t num_bytes_received;
+};
+
+static struct bench_t bench;
+
+static void transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+
+    struct link_t * link = bench.links + id;
+    if ( link->num_packets == MAX_QUEUE )
+        return;
+    uint8_t * copy = (uint8_t*) malloc( packet_bytes );
+    assert( copy );
+    memcpy( copy, packet_data, packet_bytes );
+    link->data[link->num_packets] = copy;
+    link->bytes[link->num_packets] = packet_bytes;
+    link->num_packets++;
+}
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    bench.num_packets_received++;
+    bench.num_bytes_received += packet_bytes;
+    return 1;
+}
+
+static void receive( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    uint64_t start = bench_cycles();
+    reliable_endpoint_receive_packet( endpoint, packet_data, packet_bytes );
+    samples_add( &bench.receive, bench_cycles() - start );
+}
+
+static void link_flush( struct link_t * link, struct reliable_endpoint_t * to )
+{
+    int i;
+
+    if ( bench.lossy )
+    {
+        for ( i = link->num_packets - 1; i > 0; --i )
+        {
+            int j = random_uint32() % ( i + 1 );
+            uint8_t * data = link->data[i];
+            int bytes = link->bytes[i];
+            link->data[i] = link->data[j];
+            link->bytes[i] = link->bytes[j];
+            link->data[j] = data;
+            link->bytes[j] = bytes;
+        }
+    }
+
+    for ( i = 0; i < link->num_packets; ++i )
+    {
+        if ( bench.lossy )
+        {
+            uint32_t r = random_uint32() % 100;
+            if ( r < 5 )
+            {
+                free( link->data[i] );
+                continue;
+            }
+            if ( r < 10 )
+                receive( to, link->data[i], link->bytes[i] );
+        }
+        receive( to, link->data[i], link->bytes[i] );
+        free( link->data[i] );
+    }
+
+    link->num_packets = 0;
+}
+
+// ---------------------------------------------------------------
+
+struct result_t
+{
+    int payload_bytes;
+    double seconds;
+    double packets_per_sec;
+    double bytes_per_sec;
+    double send_cycles_per_packet;
+    double receive_cycles_per_packet;
+    double update_cycles_per_packet;
+    uint64_t send_percentiles[3];
+    uint64_t receive_percentiles[3];
+    uint64_t update_percentiles[3];
+};
+
+static void run( int payload_bytes, int num_frames, struct result_t * result )
+{
+    random_state = SEED;
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = transmit_packet_function;
+    config.process_packet_function = process_packet_function;
+
+    double time = 100.0;
+
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        config.id = (uint64_t) i;
+        bench.endpoints[i] = reliable_endpoint_create( &config, time );
+    }
+
+    static uint8_t packet_data[MAX_PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    samples_reset( &bench.send );
+    samples_reset( &bench.receive );
+    samples_reset( &bench.update );
+    bench.num_packets_received = 0;
+    bench.num_bytes_received = 0;
+
+    double start_time = bench_time();
+
+    int frame;
+    for ( frame = 0; frame < num_frames; ++frame )
+    {
+        int j;
+        for ( j = 0; j < PACKETS_PER_FRAME; ++j )
+        {
+            for ( i = 0; i < 2; ++i )
+            {
+                uint64_t start = bench_cycles();
+                reliable_endpoint_send_packet( bench.endpoints[i], packet_data, payload_bytes );
+                samples_add( &bench.send, bench_cycles() - start );
+            }
+        }
+
+        link_flush( &bench.links[0], bench.endpoints[1] );
+        link_flush( &bench.links[1], bench.endpoints[0] );
+
+        time += 1.0 / 60.0;
+
+        for ( i = 0; i < 2; ++i )
+        {
+            uint64_t start = bench_cycles();
+            reliable_endpoint_update( bench.endpoints[i], time );
+            samples_add( &bench.update, bench_cycles() - start );
+            reliable_endpoint_clear_acks( bench.endpoints[i] );
+        }
+    }
+
+    double seconds = bench_time() - start_time;
+
+    uint64_t num_packets_sent = (uint64_t) num_frames * PACKETS_PER_FRAME * 2;
+
+    result->payload_bytes = payload_bytes;
+    result->seconds = seconds;
+    result->packets_per_sec = bench.num_packets_received / seconds;
+    result->bytes_per_sec = bench.num_bytes_received / seconds;
+    result->send_cycles_per_packet = (double) bench.send.total / num_packets_sent;
+    result->receive_cycles_per_packet = bench.num_packets_received ? (double) bench.receive.total / bench.num_packets_received : 0.0;
+    result->update_cycles_per_packet = (double) bench.update.total / num_packets_sent;
+
+    const double percentiles[3] = { 50.0, 99.0, 99.9 };
+    qsort( bench.send.values, bench.send.count, sizeof( uint64_t ), compare_uint64 );
+    qsort( bench.receive.values, bench.receive.count, sizeof( uint64_t ), compare_uint64 );
+    qsort( bench.update.values, bench.update.count, sizeof( uint64_t ), compare_uint64 );
+    for ( i = 0; i < 3; ++i )
+    {
+        result->send_percentiles[i] = samples_percentile( &bench.send, percentiles[i] );
+        result->receive_percentiles[i] = samples_percentile( &bench.receive, percentiles[i] );
+        result->update_percentiles[i] = samples_percentile( &bench.update, percentiles[i] );
+    }
+
+    if ( !bench.lossy && bench.num_packets_received != num_packets_sent )
+    {
+        printf( "error: sent %d packets over a lossless link, but %d were received\n", (int) num_packets_sent, (int) bench.num_packets_received );
+        exit( 1 );
+    }
+
+    reliable_endpoint_destroy( bench.endpoints[0] );
+    reliable_endpoint_destroy( bench.endpoints[1] );
+}
+
+// ticks of bench_cycles per nanosecond, so cycles can also be read as time
+
+static double cycles_per_ns()
+{
+    double start_time = bench_time();
+    uint64_t start_cycles = bench_cycles();
+    while ( bench_time() - start_time < 0.05 ) {}
+    return ( bench_cycles() - start_cycles ) / ( ( bench_time() - start_time ) * 1000000000.0 );
+}
+
+int main( int argc, char ** argv )
+{
+    int num_frames = 2000;
+    const char * output_filename = NULL;
+
+    int i;
+    for ( i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--frames" ) == 0 && i + 1 < argc )
+            num_frames = atoi( argv[++i] );
+        else if ( strcmp( argv[i], "--lossy" ) == 0 )
+            bench.lossy = 1;
+        else if ( strcmp( argv[i], "--output" ) == 0 && i + 1 < argc )
+            output_filename = argv[++i];
+        else
+            num_frames = 0;
+    }
+
+    if ( num_frames <= 0 )
+    {
+        printf( "usage: loopback_bench [--frames N] [--lossy] [--output file.json]\n" );
+        return 1;
+    }
+
+    reliable_init();
+
+    const int payload_sizes[] = { 64, 256, 1024, 4096, 16384 };
+    const int num_payload_sizes = (int) ( sizeof( payload_sizes ) / sizeof( payload_sizes[0] ) );
+
+    struct result_t results[sizeof( payload_sizes ) / sizeof( payload_sizes[0] )];
+
+    double cycles_per_nanosecond = cycles_per_ns();
+
+    printf( "[loopback_bench] %s link, %d frames, %d packets per frame each way, %.2f cycles/ns\n\n", 
+        bench.lossy ? "lossy" : "lossless", num_frames, PACKETS_PER_FRAME, cycles_per_nanosecond );
+    printf( "payload    packets/sec      MB/sec   cycles/packet (send recv update)       send p50/p99/p999      recv p50/p99/p999    update p50/p99/p999\n" );
+
+    for ( i = 0; i < num_payload_sizes; ++i )
+    {
+        struct result_t * r = results + i;
+        run( payload_sizes[i], num_frames, r );
+        printf( "%7d    %11.0f    %8.1f    %8.0f %8.0f %8.0f    %6d/%6d/%7d    %6d/%6d/%7d    %6d/%6d/%7d\n",
+            r->payload_bytes, r->packets_per_sec, r->bytes_per_sec / 1000000.0,
+            r->send_cycles_per_packet, r->receive_cycles_per_packet, r->update_cycles_per_packet,
+            (int) r->send_percentiles[0], (int) r->send_percentiles[1], (int) r->send_percentiles[2],
+            (int) r->receive_percentiles[0], (int) r->receive_percentiles[1], (int) r->receive_percentiles[2],
+            (int) r->update_percentiles[0], (int) r->update_percentiles[1], (int) r->update_percentiles[2] );
+    }
+
+    if ( output_filename )
+    {
+        FILE * output = fopen( output_filename, "w" );
+        if ( !output )
+        {
+            printf( "error: could not open %s\n", output_filename );
+            return 1;
+        }
+
+        fprintf( output, "{\n" );
+        fprintf( output, "    \"link\": \"%s\",\n", bench.lossy ? "lossy" : "lossless" );
+        fprintf( output, "    \"frames\": %d,\n", num_frames );
+        fprintf( output, "    \"packets_per_frame\": %d,\n", PACKETS_PER_FRAME );
+        fprintf( output, "    \"cycles_per_ns\": %.3f,\n", cycles_per_nanosecond );
+        fprintf( output, "    \"results\": [" );
+        for ( i = 0; i < num_payload_sizes; ++i )
+        {
+            struct result_t * r = results + i;
+            fprintf( output, "%s\n        {\n", i > 0 ? "," : "" );
+            fprintf( output, "            \"payload_bytes\": %d,\n", r->payload_bytes );
+            fprintf( output, "            \"packets_per_sec\": %.1f,\n", r->packets_per_sec );
+            fprintf( output, "            \"bytes_per_sec\": %.1f,\n", r->bytes_per_sec );
+            fprintf( output, "            \"send_cycles_per_packet\": %.1f,\n", r->send_cycles_per_packet );
+            fprintf( output, "            \"receive_cycles_per_packet\": %.1f,\n", r->receive_cycles_per_packet );
+            fprintf( output, "            \"update_cycles_per_packet\": %.1f,\n", r->update_cycles_per_packet );
+            fprintf( output, "            \"send_cycles_p50\": %d,\n", (int) r->send_percentiles[0] );
+            fprintf( output, "            \"send_cycles_p99\": %d,\n", (int) r->send_percentiles[1] );
+            fprintf( output, "            \"send_cycles_p999\": %d,\n", (int) r->send_percentiles[2] );
+            fprintf( output, "            \"receive_cycles_p50\": %d,\n", (int) r->receive_percentiles[0] );
+            fprintf( output, "            \"receive_cycles_p99\": %d,\n", (int) r->receive_percentiles[1] );
+            fprintf( output, "            \"receive_cycles_p999\": %d,\n", (int) r->receive_percentiles[2] );
+            fprintf( output, "            \"update_cycles_p50\": %d,\n", (int) r->update_percentiles[0] );
+            fprintf( output, "            \"update_cycles_p99\": %d,\n", (int) r->update_percentiles[1] );
+            fprintf( output, "            \"update_cycles_p999\": %d\n", (int) r->update_percentiles[2] );
+            fprintf( output, "        }" );
+        }
+        fprintf( output, "\n    ]\n}\n" );
+        fclose( output );
+    }
+
+    free( bench.send.values );
+    free( bench.receive.values );
+    free( bench.update.values );
+
+    reliable_term();
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// The training workload for profile guided builds (RELIABLE_PGO, see tools/pgo). Eight client/server pairs exchange
+// packets at 60HZ over the simulated network from reliable_sim.h, with latency, enough jitter to reorder, loss and
+// duplication. Most packets are small, some are around the mtu and some are large enough to fragment, so the profile
+// sees every path a game would take through send, receive, reassembly, acks and update, in roughly the right
+// proportions. Everything is seeded, so each training run produces the same profile.
+//
+// Every packet that arrives is checked, so this doubles as a test that the optimized build still works.
+//
+// Usage: pgo_train [num_frames]
+
+#include "reliable.h"
+#include "reliable_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define NUM_PAIRS 8
+#define NUM_ENDPOINTS ( NUM_PAIRS * 2 )
+#define MAX_PACKET_BYTES ( 16 * 1024 )
+#define SEED 0x5EED1234u
+
+// xorshift32. rand() differs between platforms, this doesn't
+
+static uint32_t random_state = SEED;
+
+static uint32_t random_uint32()
+{
+    uint32_t x = random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random_state = x;
+    return x;
+}
+
+struct train_context_t
+{
+    struct reliable_endpoint_t * endpoints[NUM_ENDPOINTS];
+    struct reliable_sim_t * sim;
+    uint64_t num_packets_received;
+    uint64_t num_fragmented_packets_received;
+    uint64_t num_acks;
+};
+
+static struct train_context_t context;
+
+static void train_fail( const char * error )
+{
+    printf( "error: %s\n", error );
+    exit( 1 );
+}
+
+// 70% small state updates, 20% around the mtu, 10% large enough to fragment
+
+static int train_packet_bytes()
+{
+    uint32_t r = random_uint32() % 100;
+    if ( r < 70 )
+        return 16 + random_uint32() % 300;
+    if ( r < 90 )
+        return 900 + random_uint32() % 124;
+    return 1025 + random_uint32() % ( MAX_PACKET_BYTES - 1024 );
+}
+
+// the first two bytes carry the sequence, so the receiver can check the rest
+
+static void train_generate_packet( uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    packet_data[0] = (uint8_t) ( sequence & 0xFF );
+    packet_data[1] = (uint8_t) ( sequence >> 8 );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
+        packet_data[i] = (uint8_t) ( i + sequence );
+}
+
+static void train_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+    struct train_context_t * train_context = (struct train_context_t*) _context;
+    reliable_sim_send( train_context->sim, id ^ 1, packet_data, packet_bytes );
+}
+
+static int train_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    struct train_context_t * train_context = (struct train_context_t*) _context;
+    if ( packet_bytes < 16 || packet_data[0] != (uint8_t) ( sequence & 0xFF ) || packet_data[1] != (uint8_t) ( sequence >> 8 ) )
+        train_fail( "received packet has the wrong sequence" );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
+    {
+        if ( packet_data[i] != (uint8_t) ( i + sequence ) )
+            train_fail( "received packet is corrupt" );
+    }
+    train_context->num_packets_received++;
+    if ( packet_bytes > 1024 )
+        train_context->num_fragmented_packets_received++;
+    return 1;
+}
+
+static void train_initialize()
+{
+    reliable_init();
+
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_sim_config_t sim_config;
+    reliable_sim_default_config( &sim_config );
+    sim_config.seed = SEED;
+    sim_config.max_packets = 16384;
+    sim_config.max_packet_bytes = 2048;
+    sim_config.latency = 0.05;
+    sim_config.jitter = 0.02;
+    sim_config.packet_loss = 2.0f;
+    sim_config.burst_enter = 0.5f;
+    sim_config.burst_exit = 20.0f;
+    sim_config.burst_loss = 50.0f;
+    sim_config.duplicate = 1.0f;
+    context.sim = reliable_sim_create( &sim_config, 0.0 );
+
+    int i;
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        snprintf( config.name, sizeof( config.name ), "%s %d", ( i & 1 ) ? "server" : "client", i / 2 );
+        config.context = &context;
+        config.id = (uint64_t) i;
+        config.transmit_packet_function = &train_transmit_packet_function;
+        config.process_packet_function = &train_process_packet_function;
+        context.endpoints[i] = reliable_endpoint_create( &config, 0.0 );
+    }
+}
+
+static void train_shutdown()
+{
+    int i;
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+        reliable_endpoint_destroy( context.endpoints[i] );
+
+    reliable_sim_destroy( context.sim );
+
+    reliable_term();
+}
+
+static void train_frame( double time )
+{
+    static uint8_t packet_data[MAX_PACKET_BYTES];
+
+    int i;
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        struct reliable_endpoint_t * endpoint = context.endpoints[i];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( endpoint );
+        int packet_bytes = train_packet_bytes();
+        train_generate_packet( sequence, packet_data, packet_bytes );
+        reliable_endpoint_send_packet( endpoint, packet_data, packet_bytes );
+    }
+
+    reliable_sim_update( context.sim, time );
+
+    uint64_t to;
+    int packet_bytes;
+    uint8_t * received_packet_data;
+    while ( ( received_packet_data = reliable_sim_receive( context.sim, &to, &packet_bytes ) ) != NULL )
+    {
+        reliable_endpoint_receive_packet( context.endpoints[to], received_packet_data, packet_bytes );
+    }
+
+    for ( i = 0; i < NUM_ENDPOINTS; ++i )
+    {
+        struct reliable_endpoint_t * endpoint = context.endpoints[i];
+        reliable_endpoint_update( endpoint, time );
+        int num_acks;
+        reliable_endpoint_get_acks( endpoint, &num_acks );
+        context.num_acks += (uint64_t) num_acks;
+        reliable_endpoint_clear_acks( endpoint );
+    }
+}
+
+int main( int argc, char ** argv )
+{
+    int num_frames = 20000;
+
+    if ( argc >= 2 )
+        num_frames = atoi( argv[1] );
+
+    printf( "[pgo_train]\n" );
+
+    train_initialize();
+
+    double time = 0.0;
+
+    int i;
+    for ( i = 0; i < num_frames; ++i )
+    {
+        time += 1.0 / 60.0;
+        train_frame( time );
+    }
+
+    uint64_t num_packets_sent = (uint64_t) num_frames * NUM_ENDPOINTS;
+
+    printf( "%d frames: %" PRIu64 " packets sent, %" PRIu64 " received, %" PRIu64 " fragmented, %" PRIu64 " acked\n", 
+        num_frames, num_packets_sent, context.num_packets_received, context.num_fragmented_packets_received, context.num_acks );
+
+    // the link loses a few percent of datagrams, and a fragmented packet needs all of its fragments, so most but not all arrive
+
+    if ( num_frames >= 100 && ( context.num_packets_received < num_packets_sent / 2 || context.num_fragmented_packets_received == 0 || context.num_acks < num_packets_sent / 2 ) )
+        train_fail( "too few packets got through" );
+
+    train_shutdown();
+
+    return 0;
+}
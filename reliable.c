@@ -40,9 +40,79 @@
 #define RELIABLE_ENABLE_LOGGING 1
 #endif // #ifndef RELIABLE_ENABLE_LOGGING
 
+#ifndef RELIABLE_ATOMIC_COUNTERS
+#define RELIABLE_ATOMIC_COUNTERS 0
+#endif // #ifndef RELIABLE_ATOMIC_COUNTERS
+
+// with RELIABLE_PROFILE=1 each endpoint times the phases of send, receive and update. see reliable_endpoint_profile
+
+#ifndef RELIABLE_PROFILE
+#define RELIABLE_PROFILE 0
+#endif // #ifndef RELIABLE_PROFILE
+
+// with RELIABLE_USDT=1 the packet path has linux usdt probes (provider "reliable") for perf and bpftrace. see tools/usdt
+
+#ifndef RELIABLE_USDT
+#define RELIABLE_USDT 0
+#endif // #ifndef RELIABLE_USDT
+
+// log calls above this level are compiled out, so they cost nothing at all. the level set with reliable_log_level
+// filters whatever is left at runtime. everything is compiled in by default
+
+#ifndef RELIABLE_COMPILE_TIME_LOG_LEVEL
+#define RELIABLE_COMPILE_TIME_LOG_LEVEL RELIABLE_LOG_LEVEL_DEBUG
+#endif // #ifndef RELIABLE_COMPILE_TIME_LOG_LEVEL
+
+#if defined( __GNUC__ )
+#define RELIABLE_LIKELY( x ) __builtin_expect( !!( x ), 1 )
+#define RELIABLE_UNLIKELY( x ) __builtin_expect( !!( x ), 0 )
+#define RELIABLE_HOT __attribute__(( hot ))
+#define RELIABLE_COLD __attribute__(( cold, noinline ))
+#elif defined( _MSC_VER )
+#define RELIABLE_LIKELY( x ) ( x )
+#define RELIABLE_UNLIKELY( x ) ( x )
+#define RELIABLE_HOT
+#define RELIABLE_COLD __declspec( noinline )
+#else
+#define RELIABLE_LIKELY( x ) ( x )
+#define RELIABLE_UNLIKELY( x ) ( x )
+#define RELIABLE_HOT
+#define RELIABLE_COLD
+#endif
+
+// functions that aren't in reliable.h. in the library they keep external linkage, so reliable_bench can reach them.
+// with RELIABLE_IMPLEMENTATION this file is compiled into the one including reliable.h, and they become static inline,
+// so the compiler can inline them into their callers there and drop whatever goes unused
+
+#if defined( RELIABLE_IMPLEMENTATION )
+#define RELIABLE_INTERNAL static inline
+#else // #if defined( RELIABLE_IMPLEMENTATION )
+#define RELIABLE_INTERNAL
+#endif // #if defined( RELIABLE_IMPLEMENTATION )
+
+#if RELIABLE_PROFILE
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#include <intrin.h>
+#elif defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif // #if RELIABLE_PROFILE
+
+// a usdt probe is a single nop until a tracer attaches, which patches it with a breakpoint. the arguments are only
+// described in an elf note, so the compiler keeps them wherever they already are and nothing is copied
+
+#if RELIABLE_USDT
+#include <sys/sdt.h>
+#define reliable_trace( probe, ... ) STAP_PROBEV( reliable, probe, __VA_ARGS__ )
+#else // #if RELIABLE_USDT
+#define reliable_trace( probe, ... ) do {} while(0)
+#endif // #if RELIABLE_USDT
+
 // ------------------------------------------------------------------
 
-static void default_assert_handler( RELIABLE_CONST char * condition, RELIABLE_CONST char * function, RELIABLE_CONST char * file, int line )
+static void reliable_default_assert_handler( RELIABLE_CONST char * condition, RELIABLE_CONST char * function, RELIABLE_CONST char * file, int line )
 {
     printf( "assert failed: ( %s ), function %s, file %s, line %d\n", condition, function, file, line );
     #if defined( __GNUC__ )
@@ -53,19 +123,26 @@ static void default_assert_handler( RELIABLE_CONST char * condition, RELIABLE_CO
     exit( 1 );
 }
 
-static int log_level = 0;
-static int (*printf_function)( RELIABLE_CONST char *, ... ) = ( int (*)( RELIABLE_CONST char *, ... ) ) printf;
-void (*reliable_assert_function)( RELIABLE_CONST char *, RELIABLE_CONST char *, RELIABLE_CONST char * file, int line ) = default_assert_handler;
+static int reliable_runtime_log_level = 0;
+static int reliable_runtime_log_mode = RELIABLE_LOG_MODE_PRINTF;
+static int (*reliable_printf_function)( RELIABLE_CONST char *, ... ) = ( int (*)( RELIABLE_CONST char *, ... ) ) printf;
+void (*reliable_assert_function)( RELIABLE_CONST char *, RELIABLE_CONST char *, RELIABLE_CONST char * file, int line ) = reliable_default_assert_handler;
 
 void reliable_log_level( int level )
 {
-    log_level = level;
+    reliable_runtime_log_level = level;
 }
 
 void reliable_set_printf_function( int (*function)( RELIABLE_CONST char *, ... ) )
 {
     reliable_assert( function );
-    printf_function = function;
+    reliable_printf_function = function;
+}
+
+void reliable_log_mode( int mode )
+{
+    reliable_assert( mode == RELIABLE_LOG_MODE_PRINTF || mode == RELIABLE_LOG_MODE_BINARY );
+    reliable_runtime_log_mode = mode;
 }
 
 void reliable_set_assert_function( void (*function)( RELIABLE_CONST char *, RELIABLE_CONST char *, RELIABLE_CONST char * file, int line ) )
@@ -75,21 +152,21 @@ void reliable_set_assert_function( void (*function)( RELIABLE_CONST char *, RELI
 
 #if RELIABLE_ENABLE_LOGGING
 
-void reliable_printf( int level, RELIABLE_CONST char * format, ... ) 
+static RELIABLE_COLD void reliable_printf( int level, RELIABLE_CONST char * format, ... ) 
 {
-    if ( level > log_level )
+    if ( level > reliable_runtime_log_level )
         return;
     va_list args;
     va_start( args, format );
     char buffer[4*1024];
     vsnprintf( buffer, sizeof(buffer), format, args );
-    printf_function( "%s", buffer );
+    reliable_printf_function( "%s", buffer );
     va_end( args );
 }
 
 #else // #if RELIABLE_ENABLE_LOGGING
 
-void reliable_printf( int level, RELIABLE_CONST char * format, ... ) 
+static void reliable_printf( int level, RELIABLE_CONST char * format, ... ) 
 {
     (void) level;
     (void) format;
@@ -97,13 +174,26 @@ void reliable_printf( int level, RELIABLE_CONST char * format, ... )
 
 #endif // #if RELIABLE_ENABLE_LOGGING
 
-void * reliable_default_allocate_function( void * context, size_t bytes )
+// the library logs through this rather than calling reliable_printf. calls the compile time level excludes are dead
+// code, and the rest test the runtime level inline, so the common case of logging being off never makes a call
+
+#define reliable_log( level, ... )                                                                          \
+do                                                                                                          \
+{                                                                                                           \
+    if ( RELIABLE_ENABLE_LOGGING && (level) <= RELIABLE_COMPILE_TIME_LOG_LEVEL &&                           \
+         RELIABLE_UNLIKELY( (level) <= reliable_runtime_log_level ) )                                       \
+    {                                                                                                       \
+        reliable_printf( (level), __VA_ARGS__ );                                                            \
+    }                                                                                                       \
+} while(0)
+
+RELIABLE_INTERNAL void * reliable_default_allocate_function( void * context, size_t bytes )
 {
     (void) context;
     return malloc( bytes );
 }
 
-void reliable_default_free_function( void * context, void * pointer )
+RELIABLE_INTERNAL void reliable_default_free_function( void * context, void * pointer )
 {
     (void) context;
     free( pointer );
@@ -111,1948 +201,5471 @@ void reliable_default_free_function( void * context, void * pointer )
 
 // ------------------------------------------------------------------
 
-int reliable_init(void)
+// just enough atomics for the parts of the library that other threads may touch. the rest of the library is
+// single threaded, so these map straight onto compiler intrinsics instead of pulling in C11 <stdatomic.h>
+
+#define RELIABLE_CACHE_LINE_BYTES 64
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+
+#include <intrin.h>
+
+static uint32_t reliable_atomic_load_relaxed_uint32( volatile uint32_t * p )
 {
-    return RELIABLE_OK;
+    return (uint32_t) __iso_volatile_load32( (volatile int*) p );
 }
 
-void reliable_term(void)
+static uint32_t reliable_atomic_load_acquire_uint32( volatile uint32_t * p )
 {
+    return (uint32_t) _InterlockedOr( (volatile long*) p, 0 );
 }
 
-// ---------------------------------------------------------------
-
-int reliable_sequence_greater_than( uint16_t s1, uint16_t s2 )
+static void reliable_atomic_store_release_uint32( volatile uint32_t * p, uint32_t value )
 {
-    return ( ( s1 > s2 ) && ( s1 - s2 <= 32768 ) ) || 
-           ( ( s1 < s2 ) && ( s2 - s1  > 32768 ) );
+    _InterlockedExchange( (volatile long*) p, (long) value );
 }
 
-int reliable_sequence_less_than( uint16_t s1, uint16_t s2 )
+static int reliable_atomic_compare_exchange_uint32( volatile uint32_t * p, uint32_t expected, uint32_t desired )
 {
-    return reliable_sequence_greater_than( s2, s1 );
+    return (uint32_t) _InterlockedCompareExchange( (volatile long*) p, (long) desired, (long) expected ) == expected;
 }
 
-// ---------------------------------------------------------------
-
-struct reliable_sequence_buffer_t
+static int reliable_atomic_compare_exchange_acquire_uint32( volatile uint32_t * p, uint32_t expected, uint32_t desired )
 {
-    void * allocator_context;
-    void * (*allocate_function)(void*,size_t);
-    void (*free_function)(void*,void*);
-    uint16_t sequence;
-    int num_entries;
-    int entry_stride;
-    uint32_t * entry_sequence;
-    uint8_t * entry_data;
-};
+    return (uint32_t) _InterlockedCompareExchange( (volatile long*) p, (long) desired, (long) expected ) == expected;
+}
 
-struct reliable_sequence_buffer_t * reliable_sequence_buffer_create( int num_entries, 
-                                                                     int entry_stride, 
-                                                                     void * allocator_context, 
-                                                                     void * (*allocate_function)(void*,size_t), 
-                                                                     void (*free_function)(void*,void*) )
+static void reliable_atomic_store_relaxed_uint32( volatile uint32_t * p, uint32_t value )
 {
-    reliable_assert( num_entries > 0 );
-    reliable_assert( entry_stride > 0 );
-
-    if ( allocate_function == NULL )
-    {
-        allocate_function = reliable_default_allocate_function;
-    }
-
-    if ( free_function == NULL )
-    {
-        free_function = reliable_default_free_function;
-    }
-
-    struct reliable_sequence_buffer_t * sequence_buffer = (struct reliable_sequence_buffer_t*)
-        allocate_function( allocator_context, sizeof( struct reliable_sequence_buffer_t ) );
-
-    reliable_assert( sequence_buffer );
-
-    sequence_buffer->allocator_context = allocator_context;
-    sequence_buffer->allocate_function = allocate_function;
-    sequence_buffer->free_function = free_function;
-    sequence_buffer->sequence = 0;
-    sequence_buffer->num_entries = num_entries;
-    sequence_buffer->entry_stride = entry_stride;
-    sequence_buffer->entry_sequence = (uint32_t*) allocate_function( allocator_context, num_entries * sizeof( uint32_t ) );
-    sequence_buffer->entry_data = (uint8_t*) allocate_function( allocator_context, num_entries * entry_stride );
-    reliable_assert( sequence_buffer->entry_sequence );
-    reliable_assert( sequence_buffer->entry_data );
-    memset( sequence_buffer->entry_sequence, 0xFF, sizeof( uint32_t) * sequence_buffer->num_entries );
-    memset( sequence_buffer->entry_data, 0, num_entries * entry_stride );
-
-    return sequence_buffer;
+    __iso_volatile_store32( (volatile int*) p, (int) value );
 }
 
-void reliable_sequence_buffer_destroy( struct reliable_sequence_buffer_t * sequence_buffer )
+static uint64_t reliable_atomic_load_relaxed_uint64( volatile uint64_t * p )
 {
-    reliable_assert( sequence_buffer );
-    sequence_buffer->free_function( sequence_buffer->allocator_context, sequence_buffer->entry_sequence );
-    sequence_buffer->free_function( sequence_buffer->allocator_context, sequence_buffer->entry_data );
-    sequence_buffer->free_function( sequence_buffer->allocator_context, sequence_buffer );
+    return (uint64_t) __iso_volatile_load64( (volatile __int64*) p );
 }
 
-void reliable_sequence_buffer_reset( struct reliable_sequence_buffer_t * sequence_buffer )
+static void reliable_atomic_store_relaxed_uint64( volatile uint64_t * p, uint64_t value )
 {
-    reliable_assert( sequence_buffer );
-    sequence_buffer->sequence = 0;
-    memset( sequence_buffer->entry_sequence, 0xFF, sizeof( uint32_t) * sequence_buffer->num_entries );
+    __iso_volatile_store64( (volatile __int64*) p, (__int64) value );
 }
 
-void reliable_sequence_buffer_remove_entries( struct reliable_sequence_buffer_t * sequence_buffer, 
-                                              int start_sequence, 
-                                              int finish_sequence, 
-                                              void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+static void reliable_atomic_fence_acquire()
 {
-    reliable_assert( sequence_buffer );
-    if ( finish_sequence < start_sequence ) 
-    {
-        finish_sequence += 65536;
-    }
-    if ( finish_sequence - start_sequence < sequence_buffer->num_entries )
-    {
-        int sequence;
-        for ( sequence = start_sequence; sequence <= finish_sequence; ++sequence )
-        {
-            if ( cleanup_function )
-            {
-                cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * ( sequence % sequence_buffer->num_entries ), 
-                                  sequence_buffer->allocator_context, 
-                                  sequence_buffer->free_function );
-            }
-            sequence_buffer->entry_sequence[ sequence % sequence_buffer->num_entries ] = 0xFFFFFFFF;
-        }
-    }
-    else
-    {
-        int i;
-        for ( i = 0; i < sequence_buffer->num_entries; ++i )
-        {
-            if ( cleanup_function )
-            {
-                cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * i, 
-                                  sequence_buffer->allocator_context, 
-                                  sequence_buffer->free_function );
-            }
-            sequence_buffer->entry_sequence[i] = 0xFFFFFFFF;
-        }
-    }
+#if defined( _M_ARM ) || defined( _M_ARM64 )
+    __dmb( 0xB );
+#else
+    _ReadWriteBarrier();
+#endif
 }
 
-int reliable_sequence_buffer_test_insert( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+static void reliable_atomic_fence_release()
 {
-    return reliable_sequence_less_than( sequence, sequence_buffer->sequence - ((uint16_t)sequence_buffer->num_entries) ) ? ((uint16_t)0) : ((uint16_t)1);
+#if defined( _M_ARM ) || defined( _M_ARM64 )
+    __dmb( 0xB );
+#else
+    _ReadWriteBarrier();
+#endif
 }
 
-void * reliable_sequence_buffer_insert( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+#else // #if defined( _MSC_VER ) && !defined( __clang__ )
+
+static uint32_t reliable_atomic_load_relaxed_uint32( volatile uint32_t * p )
 {
-    reliable_assert( sequence_buffer );
-    if ( reliable_sequence_less_than( sequence, sequence_buffer->sequence - ((uint16_t)sequence_buffer->num_entries) ) )
-    {
-        return NULL;
-    }
-    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
-    {
-        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, NULL );
-        sequence_buffer->sequence = sequence + 1;
-    }
-    int index = sequence % sequence_buffer->num_entries;
-    sequence_buffer->entry_sequence[index] = sequence;
-    return sequence_buffer->entry_data + index * sequence_buffer->entry_stride;
+    return __atomic_load_n( p, __ATOMIC_RELAXED );
 }
 
-void reliable_sequence_buffer_advance( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+static uint32_t reliable_atomic_load_acquire_uint32( volatile uint32_t * p )
 {
-    reliable_assert( sequence_buffer );
-    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
-    {
-        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, NULL );
-        sequence_buffer->sequence = sequence + 1;
-    }
+    return __atomic_load_n( p, __ATOMIC_ACQUIRE );
 }
 
-void * reliable_sequence_buffer_insert_with_cleanup( struct reliable_sequence_buffer_t * sequence_buffer, 
-                                                     uint16_t sequence, 
-                                                     void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+static void reliable_atomic_store_release_uint32( volatile uint32_t * p, uint32_t value )
 {
-    reliable_assert( sequence_buffer );
-    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
-    {
-        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, cleanup_function );
-        sequence_buffer->sequence = sequence + 1;
-    }
-    else if ( reliable_sequence_less_than( sequence, sequence_buffer->sequence - ((uint16_t)sequence_buffer->num_entries) ) )
-    {
-        return NULL;
-    }
-    int index = sequence % sequence_buffer->num_entries;
-    if ( sequence_buffer->entry_sequence[index] != 0xFFFFFFFF )
-    {
-        cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * ( sequence % sequence_buffer->num_entries ), 
-                          sequence_buffer->allocator_context, 
-                          sequence_buffer->free_function );
-    }
-    sequence_buffer->entry_sequence[index] = sequence;
-    return sequence_buffer->entry_data + index * sequence_buffer->entry_stride;
+    __atomic_store_n( p, value, __ATOMIC_RELEASE );
 }
 
-void reliable_sequence_buffer_advance_with_cleanup( struct reliable_sequence_buffer_t * sequence_buffer,
-                                                    uint16_t sequence,
-                                                    void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+static int reliable_atomic_compare_exchange_uint32( volatile uint32_t * p, uint32_t expected, uint32_t desired )
 {
-    reliable_assert( sequence_buffer );
-    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
-    {
-        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, cleanup_function );
-        sequence_buffer->sequence = sequence + 1;
-    }
+    return __atomic_compare_exchange_n( p, &expected, desired, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED );
 }
 
-void reliable_sequence_buffer_remove( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+static int reliable_atomic_compare_exchange_acquire_uint32( volatile uint32_t * p, uint32_t expected, uint32_t desired )
 {
-    reliable_assert( sequence_buffer );
-    sequence_buffer->entry_sequence[ sequence % sequence_buffer->num_entries ] = 0xFFFFFFFF;
+    return __atomic_compare_exchange_n( p, &expected, desired, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED );
 }
 
-void reliable_sequence_buffer_remove_with_cleanup( struct reliable_sequence_buffer_t * sequence_buffer, 
-                                                   uint16_t sequence, 
-                                                   void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+static void reliable_atomic_store_relaxed_uint32( volatile uint32_t * p, uint32_t value )
 {
-    reliable_assert( sequence_buffer );
-    int index = sequence % sequence_buffer->num_entries;
-    if ( sequence_buffer->entry_sequence[index] != 0xFFFFFFFF )
-    {
-        sequence_buffer->entry_sequence[index] = 0xFFFFFFFF;
-        cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * index, sequence_buffer->allocator_context, sequence_buffer->free_function );
-    }
+    __atomic_store_n( p, value, __ATOMIC_RELAXED );
 }
 
-int reliable_sequence_buffer_available( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+static uint64_t reliable_atomic_load_relaxed_uint64( volatile uint64_t * p )
 {
-    reliable_assert( sequence_buffer );
-    return sequence_buffer->entry_sequence[ sequence % sequence_buffer->num_entries ] == 0xFFFFFFFF;
+    return __atomic_load_n( p, __ATOMIC_RELAXED );
 }
 
-int reliable_sequence_buffer_exists( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+static void reliable_atomic_store_relaxed_uint64( volatile uint64_t * p, uint64_t value )
 {
-    reliable_assert( sequence_buffer );
-    return sequence_buffer->entry_sequence[ sequence % sequence_buffer->num_entries ] == (uint32_t) sequence;
+    __atomic_store_n( p, value, __ATOMIC_RELAXED );
 }
 
-void * reliable_sequence_buffer_find( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+static void reliable_atomic_fence_acquire()
 {
-    reliable_assert( sequence_buffer );
-    int index = sequence % sequence_buffer->num_entries;
-    return ( ( sequence_buffer->entry_sequence[index] == (uint32_t) sequence ) ) ? ( sequence_buffer->entry_data + index * sequence_buffer->entry_stride ) : NULL;
-
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
 }
 
-void * reliable_sequence_buffer_at_index( struct reliable_sequence_buffer_t * sequence_buffer, int index )
+static void reliable_atomic_fence_release()
 {
-    reliable_assert( sequence_buffer );
-    reliable_assert( index >= 0 );
-    reliable_assert( index < sequence_buffer->num_entries );
-    return sequence_buffer->entry_sequence[index] != 0xFFFFFFFF ? ( sequence_buffer->entry_data + index * sequence_buffer->entry_stride ) : NULL;
+    __atomic_thread_fence( __ATOMIC_RELEASE );
 }
 
-void reliable_sequence_buffer_generate_ack_bits( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t * ack, uint32_t * ack_bits )
+#endif // #if defined( _MSC_VER ) && !defined( __clang__ )
+
+// ------------------------------------------------------------------
+
+// binary logging. each thread that logs gets its own single-producer, single-consumer ring of fixed-size records, so
+// logging an event never formats, never locks and never touches memory shared with another writer. the consumer
+// formats records later. rings are chained in a list, which is only locked when a thread logs for the first time
+
+#define RELIABLE_LOG_RING_SIZE 4096
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#define RELIABLE_THREAD_LOCAL __declspec( thread )
+#else
+#define RELIABLE_THREAD_LOCAL __thread
+#endif
+
+struct reliable_log_event_t
 {
-    reliable_assert( sequence_buffer );
-    reliable_assert( ack );
-    reliable_assert( ack_bits );
-    *ack = sequence_buffer->sequence - 1;
-    *ack_bits = 0;
-    uint32_t mask = 1;
-    int i;
-    for ( i = 0; i < 32; ++i )
-    {
-        uint16_t sequence = *ack - ((uint16_t)i);
-        if ( reliable_sequence_buffer_exists( sequence_buffer, sequence ) )
-            *ack_bits |= mask;
-        mask <<= 1;
-    }
-}
+    RELIABLE_CONST char * format;
+    int has_sequence;
+};
 
-// ---------------------------------------------------------------
+// formats take the sequence first (if the event has one) and then the args, in order
 
-void reliable_write_uint8( uint8_t ** p, uint8_t value )
+static const struct reliable_log_event_t reliable_log_events[RELIABLE_LOG_NUM_EVENTS] = 
 {
-    **p = value;
-    ++(*p);
-}
+    { "packet too large to send. packet is %d bytes, maximum is %d", 0 },                                          // RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND
+    { "sending packet %d", 1 },                                                                                     // RELIABLE_LOG_EVENT_SEND_PACKET
+    { "sending packet %d without fragmentation", 1 },                                                               // RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED
+    { "sending packet %d as %d fragments", 1 },                                                                     // RELIABLE_LOG_EVENT_SEND_PACKET_FRAGMENTED
+    { "sending mtu probe %d (%d bytes)", 1 },                                                                       // RELIABLE_LOG_EVENT_SEND_MTU_PROBE
+    { "mtu probe %d acked (%d bytes)", 1 },                                                                         // RELIABLE_LOG_EVENT_MTU_PROBE_ACKED
+    { "mtu is now %d bytes", 0 },                                                                                   // RELIABLE_LOG_EVENT_MTU_CHANGED
+    { "mtu %d bytes no longer gets through. searching again from %d bytes", 0 },                                    // RELIABLE_LOG_EVENT_MTU_LOST
+    { "packet too large to receive. packet is at least %d bytes, maximum is %d", 0 },                               // RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_RECEIVE
+    { "packet %d too large to receive. packet is %d bytes, maximum is %d", 1 },                                     // RELIABLE_LOG_EVENT_PAYLOAD_TOO_LARGE_TO_RECEIVE
+    { "ignoring invalid packet. could not read packet header", 0 },                                                 // RELIABLE_LOG_EVENT_INVALID_PACKET
+    { "ignoring stale packet %d", 1 },                                                                              // RELIABLE_LOG_EVENT_STALE_PACKET
+    { "ignoring duplicate packet %d", 1 },                                                                          // RELIABLE_LOG_EVENT_DUPLICATE_PACKET
+    { "processing packet %d", 1 },                                                                                  // RELIABLE_LOG_EVENT_PROCESS_PACKET
+    { "processing mtu probe %d", 1 },                                                                               // RELIABLE_LOG_EVENT_PROCESS_MTU_PROBE
+    { "process packet %d successful", 1 },                                                                          // RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCESSFUL
+    { "process packet %d failed", 1 },                                                                              // RELIABLE_LOG_EVENT_PROCESS_PACKET_FAILED
+    { "acked packet %d", 1 },                                                                                       // RELIABLE_LOG_EVENT_PACKET_ACKED
+    { "ack buffer is full. dropped ack for packet %d. make sure you call reliable_endpoint_clear_acks", 1 },         // RELIABLE_LOG_EVENT_ACK_BUFFER_FULL
+    { "ignoring invalid fragment. could not read fragment header", 0 },                                             // RELIABLE_LOG_EVENT_INVALID_FRAGMENT
+    { "ignoring fragment of packet %d. packet already received (fragment %d)", 1 },                                 // RELIABLE_LOG_EVENT_FRAGMENT_OF_RECEIVED_PACKET
+    { "ignoring invalid fragment of packet %d. could not insert in reassembly buffer (stale)", 1 },                 // RELIABLE_LOG_EVENT_FRAGMENT_STALE
+    { "ignoring invalid fragment of packet %d. fragment count mismatch. expected %d, got %d", 1 },                  // RELIABLE_LOG_EVENT_FRAGMENT_COUNT_MISMATCH
+    { "ignoring fragment of packet %d. fragment %d already received", 1 },                                          // RELIABLE_LOG_EVENT_FRAGMENT_DUPLICATE
+    { "ignoring invalid fragment of packet %d. fragment %d is %d bytes, other fragments are %d bytes", 1 },         // RELIABLE_LOG_EVENT_FRAGMENT_SIZE_MISMATCH
+    { "ignoring invalid fragment. last fragment of packet %d is %d bytes, larger than the other fragments (%d bytes)", 1 },   // RELIABLE_LOG_EVENT_LAST_FRAGMENT_TOO_LARGE
+    { "received fragment of packet %d. fragment %d (%d/%d)", 1 },                                                   // RELIABLE_LOG_EVENT_FRAGMENT_RECEIVED
+    { "completed reassembly of packet %d", 1 },                                                                     // RELIABLE_LOG_EVENT_REASSEMBLY_COMPLETE
+};
 
-void reliable_write_uint16( uint8_t ** p, uint16_t value )
+struct reliable_log_ring_t
 {
-    (*p)[0] = value & 0xFF;
-    (*p)[1] = value >> 8;
-    *p += 2;
+    uint8_t padding_0[RELIABLE_CACHE_LINE_BYTES];
+    volatile uint32_t write_index;
+    volatile uint32_t num_dropped;
+    uint8_t padding_1[RELIABLE_CACHE_LINE_BYTES];
+    volatile uint32_t read_index;
+    uint32_t num_dropped_reported;
+    uint8_t padding_2[RELIABLE_CACHE_LINE_BYTES];
+    struct reliable_log_ring_t * next;
+    struct reliable_log_record_t records[RELIABLE_LOG_RING_SIZE];
+};
+
+static struct reliable_log_ring_t * reliable_log_rings = NULL;
+static volatile uint32_t reliable_log_rings_lock = 0;
+static uint32_t reliable_log_rings_generation = 1;
+
+static void reliable_log_lock()
+{
+    while ( !reliable_atomic_compare_exchange_acquire_uint32( &reliable_log_rings_lock, 0, 1 ) ) {}
 }
 
-void reliable_write_uint32( uint8_t ** p, uint32_t value )
+static void reliable_log_unlock()
 {
-    (*p)[0] = value & 0xFF;
-    (*p)[1] = ( value >> 8  ) & 0xFF;
-    (*p)[2] = ( value >> 16 ) & 0xFF;
-    (*p)[3] = value >> 24;
-    *p += 4;
+    reliable_atomic_store_release_uint32( &reliable_log_rings_lock, 0 );
 }
 
-void reliable_write_uint64( uint8_t ** p, uint64_t value )
+#if RELIABLE_ENABLE_LOGGING
+
+static RELIABLE_THREAD_LOCAL struct reliable_log_ring_t * reliable_log_thread_ring = NULL;
+static RELIABLE_THREAD_LOCAL uint32_t reliable_log_thread_ring_generation = 0;
+
+static void reliable_log_write( int level, int event, uint64_t endpoint_id, double time, uint16_t sequence, int a, int b, int c )
 {
-    (*p)[0] = value & 0xFF;
-    (*p)[1] = ( value >> 8  ) & 0xFF;
-    (*p)[2] = ( value >> 16 ) & 0xFF;
-    (*p)[3] = ( value >> 24 ) & 0xFF;
-    (*p)[4] = ( value >> 32 ) & 0xFF;
-    (*p)[5] = ( value >> 40 ) & 0xFF;
-    (*p)[6] = ( value >> 48 ) & 0xFF;
-    (*p)[7] = value >> 56;
-    *p += 8;
+    struct reliable_log_ring_t * ring = reliable_log_thread_ring;
+
+    if ( !ring || reliable_log_thread_ring_generation != reliable_log_rings_generation )
+    {
+        ring = (struct reliable_log_ring_t*) malloc( sizeof( struct reliable_log_ring_t ) );
+        if ( !ring )
+            return;
+        memset( ring, 0, sizeof( struct reliable_log_ring_t ) - sizeof( ring->records ) );
+        reliable_log_lock();
+        ring->next = reliable_log_rings;
+        reliable_log_rings = ring;
+        reliable_log_unlock();
+        reliable_log_thread_ring = ring;
+        reliable_log_thread_ring_generation = reliable_log_rings_generation;
+    }
+
+    uint32_t write_index = ring->write_index;
+
+    if ( write_index - reliable_atomic_load_acquire_uint32( &ring->read_index ) >= RELIABLE_LOG_RING_SIZE )
+    {
+        reliable_atomic_store_relaxed_uint32( &ring->num_dropped, ring->num_dropped + 1 );
+        return;
+    }
+
+    struct reliable_log_record_t * record = ring->records + ( write_index % RELIABLE_LOG_RING_SIZE );
+    record->time = time;
+    record->endpoint_id = endpoint_id;
+    record->event = (uint16_t) event;
+    record->sequence = sequence;
+    record->level = (uint8_t) level;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+
+    reliable_atomic_store_release_uint32( &ring->write_index, write_index + 1 );
 }
 
+#endif // #if RELIABLE_ENABLE_LOGGING
 
-uint8_t reliable_read_uint8( uint8_t ** p )
+static int reliable_log_format_event( int event, uint16_t sequence, RELIABLE_CONST int32_t * args, char * buffer, size_t buffer_size )
 {
-    uint8_t value = **p;
-    ++(*p);
-    return value;
+    reliable_assert( event >= 0 );
+    reliable_assert( event < RELIABLE_LOG_NUM_EVENTS );
+
+    if ( reliable_log_events[event].has_sequence )
+        return snprintf( buffer, buffer_size, reliable_log_events[event].format, (int) sequence, args[0], args[1], args[2] );
+    else
+        return snprintf( buffer, buffer_size, reliable_log_events[event].format, args[0], args[1], args[2] );
 }
 
-uint16_t reliable_read_uint16( uint8_t ** p )
+void reliable_log_format( RELIABLE_CONST struct reliable_log_record_t * record, char * buffer, size_t buffer_size )
 {
-    uint16_t value;
-    value = (*p)[0];
-    value |= ( ( (uint16_t)( (*p)[1] ) ) << 8 );
-    *p += 2;
-    return value;
+    reliable_assert( record );
+    reliable_assert( buffer );
+    reliable_assert( buffer_size > 0 );
+
+    int bytes = snprintf( buffer, buffer_size, "%.6f [%" PRIu64 "] ", record->time, record->endpoint_id );
+    if ( bytes < 0 || (size_t) bytes >= buffer_size )
+        return;
+
+    reliable_log_format_event( record->event, record->sequence, record->args, buffer + bytes, buffer_size - bytes );
 }
 
-uint32_t reliable_read_uint32( uint8_t ** p )
+int reliable_log_read( struct reliable_log_record_t * records, int max_records )
 {
-    uint32_t value;
-    value  = (*p)[0];
-    value |= ( ( (uint32_t)( (*p)[1] ) ) << 8 );
-    value |= ( ( (uint32_t)( (*p)[2] ) ) << 16 );
-    value |= ( ( (uint32_t)( (*p)[3] ) ) << 24 );
-    *p += 4;
-    return value;
-}
+    reliable_assert( records );
+    reliable_assert( max_records >= 0 );
 
-uint64_t reliable_read_uint64( uint8_t ** p )
-{
-    uint64_t value;
-    value  = (*p)[0];
-    value |= ( ( (uint64_t)( (*p)[1] ) ) << 8  );
-    value |= ( ( (uint64_t)( (*p)[2] ) ) << 16 );
-    value |= ( ( (uint64_t)( (*p)[3] ) ) << 24 );
-    value |= ( ( (uint64_t)( (*p)[4] ) ) << 32 );
-    value |= ( ( (uint64_t)( (*p)[5] ) ) << 40 );
-    value |= ( ( (uint64_t)( (*p)[6] ) ) << 48 );
-    value |= ( ( (uint64_t)( (*p)[7] ) ) << 56 );
-    *p += 8;
-    return value;
-}
+    int num_records = 0;
 
+    reliable_log_lock();
 
-// ---------------------------------------------------------------
+    struct reliable_log_ring_t * ring;
+    for ( ring = reliable_log_rings; ring && num_records < max_records; ring = ring->next )
+    {
+        uint32_t read_index = ring->read_index;
+        uint32_t write_index = reliable_atomic_load_acquire_uint32( &ring->write_index );
+        while ( read_index != write_index && num_records < max_records )
+        {
+            records[num_records++] = ring->records[read_index % RELIABLE_LOG_RING_SIZE];
+            read_index++;
+        }
+        reliable_atomic_store_release_uint32( &ring->read_index, read_index );
+    }
 
-struct reliable_fragment_reassembly_data_t
-{
-    uint16_t sequence;
-    uint16_t ack;
-    uint32_t ack_bits;
-    int num_fragments_received;
-    int num_fragments_total;
-    uint8_t * packet_data;
-    int packet_bytes;
-    int packet_header_bytes;
-    uint8_t fragment_received[256];
-};
+    reliable_log_unlock();
 
-void reliable_fragment_reassembly_data_cleanup( void * data, void * allocator_context, void (*free_function)(void*,void*) )
+    return num_records;
+}
 
+int reliable_log_flush(void)
 {
-    reliable_assert( free_function );
-    struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) data;
-    if ( reassembly_data->packet_data )
+    int num_records = 0;
+
+    struct reliable_log_record_t records[64];
+    int n;
+    while ( ( n = reliable_log_read( records, 64 ) ) > 0 )
     {
-        free_function( allocator_context, reassembly_data->packet_data );
-        reassembly_data->packet_data = NULL;
+        int i;
+        for ( i = 0; i < n; ++i )
+        {
+            char buffer[1024];
+            reliable_log_format( records + i, buffer, sizeof( buffer ) );
+            reliable_printf_function( "%s\n", buffer );
+        }
+        num_records += n;
     }
+
+    reliable_log_lock();
+
+    struct reliable_log_ring_t * ring;
+    for ( ring = reliable_log_rings; ring; ring = ring->next )
+    {
+        uint32_t num_dropped = reliable_atomic_load_relaxed_uint32( &ring->num_dropped );
+        if ( num_dropped != ring->num_dropped_reported )
+        {
+            reliable_printf_function( "[reliable] log ring full. dropped %u records\n", num_dropped - ring->num_dropped_reported );
+            ring->num_dropped_reported = num_dropped;
+        }
+    }
+
+    reliable_log_unlock();
+
+    return num_records;
 }
 
-// ---------------------------------------------------------------
+// ------------------------------------------------------------------
 
-struct reliable_endpoint_t
-{
-    void * allocator_context;
-    void * (*allocate_function)(void*,size_t);
-    void (*free_function)(void*,void*);
-    struct reliable_config_t config;
-    double time;
-    float rtt;
-    float rtt_min;
-    float rtt_max;
-    float rtt_avg;
-    float jitter_avg_vs_min_rtt;
-    float jitter_max_vs_min_rtt;
-    float jitter_stddev_vs_avg_rtt;
-    float packet_loss;
-    float sent_bandwidth_kbps;
-    float received_bandwidth_kbps;
-    float acked_bandwidth_kbps;
-    int num_acks;
-    uint16_t * acks;
-    uint16_t sequence;
-    float * rtt_history_buffer;
-    uint8_t * transmit_buffer;
-    struct reliable_sequence_buffer_t * sent_packets;
-    struct reliable_sequence_buffer_t * received_packets;
-    struct reliable_sequence_buffer_t * fragment_reassembly;
-    uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];
-};
+// packet capture. like binary logging, each thread that captures gets its own single-producer, single-consumer ring, of
+// bytes this time since records carry datagrams. records are encoded little-endian into the ring exactly as they go in
+// the file, so reliable_capture_flush writes each ring straight out with fwrite. a pcapng capture uses the same rings,
+// and the conversion to pcapng blocks is done by flush, off the send and receive path
 
-struct reliable_sent_packet_data_t
-{
-    double time;
-    uint32_t acked : 1;
-    uint32_t packet_bytes : 31;
-};
+#define RELIABLE_CAPTURE_RING_BYTES ( 1 << 20 )
+#define RELIABLE_CAPTURE_FILE_BUFFER_BYTES ( 64 * 1024 )
 
-struct reliable_received_packet_data_t
+#define RELIABLE_CAPTURE_FORMAT_NATIVE 0
+#define RELIABLE_CAPTURE_FORMAT_PCAPNG 1
+
+#define RELIABLE_PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define RELIABLE_PCAPNG_INTERFACE_BLOCK 1
+#define RELIABLE_PCAPNG_ENHANCED_PACKET_BLOCK 6
+#define RELIABLE_PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define RELIABLE_PCAPNG_LINKTYPE_RAW 101
+#define RELIABLE_PCAPNG_SECTION_HEADER_BYTES 28
+#define RELIABLE_PCAPNG_INTERFACE_BYTES 20
+#define RELIABLE_PCAPNG_PACKET_BLOCK_HEADER_BYTES 28
+#define RELIABLE_PCAPNG_IP_UDP_HEADER_BYTES 28
+
+struct reliable_capture_ring_t
 {
-    double time;
-    uint32_t packet_bytes;
+    uint8_t padding_0[RELIABLE_CACHE_LINE_BYTES];
+    volatile uint32_t write_index;
+    volatile uint32_t num_dropped;
+    uint8_t padding_1[RELIABLE_CACHE_LINE_BYTES];
+    volatile uint32_t read_index;
+    uint8_t padding_2[RELIABLE_CACHE_LINE_BYTES];
+    struct reliable_capture_ring_t * next;
+    uint8_t data[RELIABLE_CAPTURE_RING_BYTES];
 };
 
-void reliable_default_config( struct reliable_config_t * config )
+RELIABLE_INTERNAL void reliable_write_uint8( uint8_t ** p, uint8_t value );
+RELIABLE_INTERNAL void reliable_write_uint16( uint8_t ** p, uint16_t value );
+RELIABLE_INTERNAL void reliable_write_uint32( uint8_t ** p, uint32_t value );
+RELIABLE_INTERNAL void reliable_write_uint64( uint8_t ** p, uint64_t value );
+RELIABLE_INTERNAL uint8_t reliable_read_uint8( uint8_t ** p );
+RELIABLE_INTERNAL uint16_t reliable_read_uint16( uint8_t ** p );
+RELIABLE_INTERNAL uint32_t reliable_read_uint32( uint8_t ** p );
+RELIABLE_INTERNAL uint64_t reliable_read_uint64( uint8_t ** p );
+
+static struct reliable_capture_ring_t * reliable_capture_rings = NULL;
+static volatile uint32_t reliable_capture_rings_lock = 0;
+static uint32_t reliable_capture_rings_generation = 1;
+static volatile uint32_t reliable_capture_active = 0;
+static int reliable_capture_max_payload_bytes = 0;
+static int reliable_capture_format = RELIABLE_CAPTURE_FORMAT_NATIVE;
+static FILE * reliable_capture_file = NULL;
+
+static RELIABLE_THREAD_LOCAL struct reliable_capture_ring_t * reliable_capture_thread_ring = NULL;
+static RELIABLE_THREAD_LOCAL uint32_t reliable_capture_thread_ring_generation = 0;
+
+static void reliable_capture_lock()
 {
-    reliable_assert( config );
-    memset( config, 0, sizeof( struct reliable_config_t ) );
-    config->name[0] = 'e';
-    config->name[1] = 'n';
-    config->name[2] = 'd';
-    config->name[3] = 'p';
-    config->name[4] = 'o';
-    config->name[5] = 'i';
-    config->name[6] = 'n';
-    config->name[7] = 't';
-    config->name[8] = '\0';
-    config->max_packet_size = 16 * 1024;
-    config->fragment_above = 1024;
-    config->max_fragments = 16;
-    config->fragment_size = 1024;
-    config->ack_buffer_size = 256;
-    config->sent_packets_buffer_size = 256;
-    config->received_packets_buffer_size = 256;
-    config->fragment_reassembly_buffer_size = 64;
-    config->rtt_smoothing_factor = 0.0025f;
-    config->rtt_history_size = 512;
-    config->packet_loss_smoothing_factor = 0.1f;
-    config->bandwidth_smoothing_factor = 0.1f;
-    config->packet_header_size = 28;                    // note: UDP over IPv4 = 20 + 8 bytes, UDP over IPv6 = 40 + 8 bytes
+    while ( !reliable_atomic_compare_exchange_acquire_uint32( &reliable_capture_rings_lock, 0, 1 ) ) {}
 }
 
-struct reliable_endpoint_t * reliable_endpoint_create( struct reliable_config_t * config, double time )
+static void reliable_capture_unlock()
 {
-    reliable_assert( config );
-    reliable_assert( config->max_packet_size > 0 );
-    reliable_assert( config->fragment_above > 0 );
-    reliable_assert( config->max_fragments > 0 );
-    reliable_assert( config->max_fragments <= 256 );
-    reliable_assert( config->fragment_size > 0 );
-    reliable_assert( config->ack_buffer_size > 0 );
-    reliable_assert( config->sent_packets_buffer_size > 0 );
-    reliable_assert( config->received_packets_buffer_size > 0 );
-    reliable_assert( config->transmit_packet_function != NULL );
-    reliable_assert( config->process_packet_function != NULL );
-    reliable_assert( config->rtt_history_size > 0 );
-
-    void * allocator_context = config->allocator_context;
-    void * (*allocate_function)(void*,size_t) = config->allocate_function;
-    void (*free_function)(void*,void*) = config->free_function;
+    reliable_atomic_store_release_uint32( &reliable_capture_rings_lock, 0 );
+}
 
-    if ( allocate_function == NULL )
+static void reliable_capture_ring_copy( struct reliable_capture_ring_t * ring, uint32_t index, RELIABLE_CONST uint8_t * data, int bytes )
+{
+    uint32_t offset = index % RELIABLE_CAPTURE_RING_BYTES;
+    uint32_t first_bytes = RELIABLE_CAPTURE_RING_BYTES - offset;
+    if ( first_bytes >= (uint32_t) bytes )
     {
-        allocate_function = reliable_default_allocate_function;
+        memcpy( ring->data + offset, data, bytes );
+    }
+    else
+    {
+        memcpy( ring->data + offset, data, first_bytes );
+        memcpy( ring->data, data + first_bytes, bytes - first_bytes );
     }
+}
 
-    if ( free_function == NULL )
+static RELIABLE_COLD void reliable_capture_write( int type, uint64_t endpoint_id, double time, RELIABLE_CONST uint8_t * data, int packet_bytes, int data_bytes )
+{
+    struct reliable_capture_ring_t * ring = reliable_capture_thread_ring;
+
+    if ( !ring || reliable_capture_thread_ring_generation != reliable_capture_rings_generation )
     {
-        free_function = reliable_default_free_function;
+        ring = (struct reliable_capture_ring_t*) malloc( sizeof( struct reliable_capture_ring_t ) );
+        if ( !ring )
+            return;
+        memset( ring, 0, sizeof( struct reliable_capture_ring_t ) - sizeof( ring->data ) );
+        reliable_capture_lock();
+        ring->next = reliable_capture_rings;
+        reliable_capture_rings = ring;
+        reliable_capture_unlock();
+        reliable_capture_thread_ring = ring;
+        reliable_capture_thread_ring_generation = reliable_capture_rings_generation;
     }
 
-    struct reliable_endpoint_t * endpoint = (struct reliable_endpoint_t*) allocate_function( allocator_context, sizeof( struct reliable_endpoint_t ) );
+    uint32_t record_bytes = RELIABLE_CAPTURE_RECORD_HEADER_BYTES + data_bytes;
 
-    reliable_assert( endpoint );
+    uint32_t write_index = ring->write_index;
 
-    memset( endpoint, 0, sizeof( struct reliable_endpoint_t ) );
+    if ( write_index - reliable_atomic_load_acquire_uint32( &ring->read_index ) + record_bytes > RELIABLE_CAPTURE_RING_BYTES )
+    {
+        reliable_atomic_store_relaxed_uint32( &ring->num_dropped, ring->num_dropped + 1 );
+        return;
+    }
 
-    endpoint->allocator_context = allocator_context;
-    endpoint->allocate_function = allocate_function;
-    endpoint->free_function = free_function;
-    endpoint->config = *config;
-    endpoint->time = time;
+    union { double d; uint64_t u; } time_bits;
+    time_bits.d = time;
+
+    uint8_t header[RELIABLE_CAPTURE_RECORD_HEADER_BYTES];
+    uint8_t * p = header;
+    reliable_write_uint8( &p, (uint8_t) type );
+    reliable_write_uint8( &p, 0 );
+    reliable_write_uint16( &p, 0 );
+    reliable_write_uint64( &p, endpoint_id );
+    reliable_write_uint64( &p, time_bits.u );
+    reliable_write_uint32( &p, (uint32_t) packet_bytes );
+    reliable_write_uint32( &p, (uint32_t) data_bytes );
+
+    reliable_capture_ring_copy( ring, write_index, header, RELIABLE_CAPTURE_RECORD_HEADER_BYTES );
+    if ( data_bytes > 0 )
+    {
+        reliable_capture_ring_copy( ring, write_index + RELIABLE_CAPTURE_RECORD_HEADER_BYTES, data, data_bytes );
+    }
 
-    endpoint->acks = (uint16_t*) allocate_function( allocator_context, config->ack_buffer_size * sizeof(uint16_t) );
+    reliable_atomic_store_release_uint32( &ring->write_index, write_index + record_bytes );
+}
 
-    reliable_assert( endpoint->acks );
+static RELIABLE_COLD void reliable_capture_packet( int type, uint64_t endpoint_id, double time, RELIABLE_CONST uint8_t * packet_data, int packet_bytes )
+{
+    int data_bytes = packet_bytes;
+    if ( reliable_capture_max_payload_bytes >= 0 && data_bytes > reliable_capture_max_payload_bytes )
+    {
+        data_bytes = reliable_capture_max_payload_bytes;
+    }
+    reliable_capture_write( type, endpoint_id, time, packet_data, packet_bytes, data_bytes );
+}
 
+#define reliable_capturing() RELIABLE_UNLIKELY( reliable_atomic_load_relaxed_uint32( &reliable_capture_active ) )
 
-    endpoint->sent_packets = reliable_sequence_buffer_create( config->sent_packets_buffer_size, 
-                                                              sizeof( struct reliable_sent_packet_data_t ), 
-                                                              allocator_context, 
-                                                              allocate_function, 
-                                                              free_function );
+static int reliable_capture_open( RELIABLE_CONST char * filename, int max_payload_bytes, int format )
+{
+    reliable_assert( filename );
+    reliable_assert( max_payload_bytes >= -1 );
 
-    endpoint->received_packets = reliable_sequence_buffer_create( config->received_packets_buffer_size, 
-                                                                  sizeof( struct reliable_received_packet_data_t ), 
-                                                                  allocator_context, 
-                                                                  allocate_function, 
-                                                                  free_function );
-    
-    endpoint->fragment_reassembly = reliable_sequence_buffer_create( config->fragment_reassembly_buffer_size, 
-                                                                     sizeof( struct reliable_fragment_reassembly_data_t ), 
-                                                                     allocator_context, 
-                                                                     allocate_function, 
-                                                                     free_function );
+    if ( reliable_capture_file )
+        return RELIABLE_ERROR;
 
-    endpoint->rtt_history_buffer = (float*) allocate_function( allocator_context, config->rtt_history_size * sizeof(float) );
+    reliable_capture_file = fopen( filename, "wb" );
+    if ( !reliable_capture_file )
+        return RELIABLE_ERROR;
 
-    reliable_assert( endpoint->rtt_history_buffer );
+    // each flush writes many small pieces, so give stdio enough room to batch them into a few large writes
 
-    // scratch buffer for outgoing packets, so the send path doesn't allocate. sized for whichever is larger: a regular packet or a fragment
+    setvbuf( reliable_capture_file, NULL, _IOFBF, RELIABLE_CAPTURE_FILE_BUFFER_BYTES );
 
-    int transmit_buffer_size = config->max_packet_size + RELIABLE_MAX_PACKET_HEADER_BYTES;
-    int fragment_transmit_buffer_size = RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + config->fragment_size;
-    if ( fragment_transmit_buffer_size > transmit_buffer_size )
+    if ( format == RELIABLE_CAPTURE_FORMAT_PCAPNG )
     {
-        transmit_buffer_size = fragment_transmit_buffer_size;
+        // section header block, then one interface description block for raw ipv4. timestamps use the default microsecond resolution
+
+        uint8_t header[RELIABLE_PCAPNG_SECTION_HEADER_BYTES + RELIABLE_PCAPNG_INTERFACE_BYTES];
+        uint8_t * p = header;
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_SECTION_HEADER_BLOCK );
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_SECTION_HEADER_BYTES );
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_BYTE_ORDER_MAGIC );
+        reliable_write_uint16( &p, 1 );
+        reliable_write_uint16( &p, 0 );
+        reliable_write_uint64( &p, 0xFFFFFFFFFFFFFFFFULL );
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_SECTION_HEADER_BYTES );
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_INTERFACE_BLOCK );
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_INTERFACE_BYTES );
+        reliable_write_uint16( &p, RELIABLE_PCAPNG_LINKTYPE_RAW );
+        reliable_write_uint16( &p, 0 );
+        reliable_write_uint32( &p, 0 );
+        reliable_write_uint32( &p, RELIABLE_PCAPNG_INTERFACE_BYTES );
+        fwrite( header, 1, sizeof( header ), reliable_capture_file );
+    }
+    else
+    {
+        uint8_t header[RELIABLE_CAPTURE_FILE_HEADER_BYTES];
+        uint8_t * p = header;
+        reliable_write_uint32( &p, RELIABLE_CAPTURE_MAGIC );
+        reliable_write_uint32( &p, RELIABLE_CAPTURE_VERSION );
+        reliable_write_uint32( &p, (uint32_t) max_payload_bytes );
+        fwrite( header, 1, sizeof( header ), reliable_capture_file );
     }
 
-    endpoint->transmit_buffer = (uint8_t*) allocate_function( allocator_context, transmit_buffer_size );
+    reliable_capture_max_payload_bytes = max_payload_bytes;
+    reliable_capture_format = format;
 
-    reliable_assert( endpoint->transmit_buffer );
+    reliable_atomic_store_relaxed_uint32( &reliable_capture_active, 1 );
 
-    for ( int i = 0; i < config->rtt_history_size; i++ )
+    return RELIABLE_OK;
+}
+
+int reliable_capture_start( RELIABLE_CONST char * filename, int max_payload_bytes )
+{
+    return reliable_capture_open( filename, max_payload_bytes, RELIABLE_CAPTURE_FORMAT_NATIVE );
+}
+
+int reliable_capture_start_pcapng( RELIABLE_CONST char * filename, int max_payload_bytes )
+{
+    return reliable_capture_open( filename, max_payload_bytes, RELIABLE_CAPTURE_FORMAT_PCAPNG );
+}
+
+static void reliable_capture_ring_read( struct reliable_capture_ring_t * ring, uint32_t index, uint8_t * data, int bytes )
+{
+    uint32_t offset = index % RELIABLE_CAPTURE_RING_BYTES;
+    uint32_t first_bytes = RELIABLE_CAPTURE_RING_BYTES - offset;
+    if ( first_bytes >= (uint32_t) bytes )
     {
-        endpoint->rtt_history_buffer[i] = -1.0f;
+        memcpy( data, ring->data + offset, bytes );
+    }
+    else
+    {
+        memcpy( data, ring->data + offset, first_bytes );
+        memcpy( data + first_bytes, ring->data, bytes - first_bytes );
     }
+}
 
-    memset( endpoint->acks, 0, config->ack_buffer_size * sizeof(uint16_t) );
+static void reliable_capture_ring_fwrite( struct reliable_capture_ring_t * ring, uint32_t index, uint32_t bytes )
+{
+    uint32_t offset = index % RELIABLE_CAPTURE_RING_BYTES;
+    uint32_t first_bytes = RELIABLE_CAPTURE_RING_BYTES - offset;
+    if ( first_bytes >= bytes )
+    {
+        fwrite( ring->data + offset, 1, bytes, reliable_capture_file );
+    }
+    else
+    {
+        fwrite( ring->data + offset, 1, first_bytes, reliable_capture_file );
+        fwrite( ring->data, 1, bytes - first_bytes, reliable_capture_file );
+    }
+}
 
-    return endpoint;
+static void reliable_write_uint16_big_endian( uint8_t ** p, uint16_t value )
+{
+    (*p)[0] = (uint8_t) ( value >> 8 );
+    (*p)[1] = (uint8_t) ( value & 0xFF );
+    *p += 2;
 }
 
-void reliable_endpoint_destroy( struct reliable_endpoint_t * endpoint )
+static void reliable_write_uint32_big_endian( uint8_t ** p, uint32_t value )
 {
-    reliable_assert( endpoint );
-    reliable_assert( endpoint->acks );
-    reliable_assert( endpoint->sent_packets );
-    reliable_assert( endpoint->received_packets );
-    reliable_assert( endpoint->fragment_reassembly );
-    reliable_assert( endpoint->rtt_history_buffer );
-    reliable_assert( endpoint->transmit_buffer );
+    reliable_write_uint16_big_endian( p, (uint16_t) ( value >> 16 ) );
+    reliable_write_uint16_big_endian( p, (uint16_t) ( value & 0xFFFF ) );
+}
+
+// writes one send or receive record as an enhanced packet block, wrapping the datagram in made up ipv4 and udp headers
+// so wireshark can follow each endpoint as its own conversation. returns the number of bytes written
 
+static int reliable_capture_write_pcapng_packet( struct reliable_capture_ring_t * ring, uint32_t data_index, int type, uint64_t endpoint_id, double time, uint32_t packet_bytes, uint32_t data_bytes )
+{
+    uint32_t endpoint_address = RELIABLE_CAPTURE_PCAPNG_ENDPOINT_ADDRESS | (uint32_t) ( endpoint_id & 0xFFFFFF );
+    uint32_t source_address = type == RELIABLE_CAPTURE_SEND ? endpoint_address : RELIABLE_CAPTURE_PCAPNG_PEER_ADDRESS;
+    uint32_t destination_address = type == RELIABLE_CAPTURE_SEND ? RELIABLE_CAPTURE_PCAPNG_PEER_ADDRESS : endpoint_address;
+
+    uint32_t ip_bytes = RELIABLE_PCAPNG_IP_UDP_HEADER_BYTES + packet_bytes;
+    if ( ip_bytes > 0xFFFF )
+        ip_bytes = 0xFFFF;
+
+    uint8_t headers[RELIABLE_PCAPNG_PACKET_BLOCK_HEADER_BYTES + RELIABLE_PCAPNG_IP_UDP_HEADER_BYTES];
+    uint8_t * p = headers;
+
+    uint32_t captured_bytes = RELIABLE_PCAPNG_IP_UDP_HEADER_BYTES + data_bytes;
+    uint32_t padding_bytes = ( 4 - ( captured_bytes & 3 ) ) & 3;
+    uint32_t block_bytes = RELIABLE_PCAPNG_PACKET_BLOCK_HEADER_BYTES + captured_bytes + padding_bytes + 4;
+
+    uint64_t timestamp = time > 0.0 ? (uint64_t) ( time * 1000000.0 ) : 0;
+
+    reliable_write_uint32( &p, RELIABLE_PCAPNG_ENHANCED_PACKET_BLOCK );
+    reliable_write_uint32( &p, block_bytes );
+    reliable_write_uint32( &p, 0 );
+    reliable_write_uint32( &p, (uint32_t) ( timestamp >> 32 ) );
+    reliable_write_uint32( &p, (uint32_t) ( timestamp & 0xFFFFFFFF ) );
+    reliable_write_uint32( &p, captured_bytes );
+    reliable_write_uint32( &p, RELIABLE_PCAPNG_IP_UDP_HEADER_BYTES + packet_bytes );
+
+    uint8_t * ip_header = p;
+    reliable_write_uint8( &p, 0x45 );
+    reliable_write_uint8( &p, 0 );
+    reliable_write_uint16_big_endian( &p, (uint16_t) ip_bytes );
+    reliable_write_uint16_big_endian( &p, 0 );
+    reliable_write_uint16_big_endian( &p, 0 );
+    reliable_write_uint8( &p, 64 );
+    reliable_write_uint8( &p, 17 );
+    reliable_write_uint16_big_endian( &p, 0 );
+    reliable_write_uint32_big_endian( &p, source_address );
+    reliable_write_uint32_big_endian( &p, destination_address );
+
+    uint32_t checksum = 0;
     int i;
-    for ( i = 0; i < endpoint->config.fragment_reassembly_buffer_size; ++i )
+    for ( i = 0; i < 20; i += 2 )
     {
-        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
-            reliable_sequence_buffer_at_index( endpoint->fragment_reassembly, i );
-
-        if ( reassembly_data && reassembly_data->packet_data )
-        {
-            endpoint->free_function( endpoint->allocator_context, reassembly_data->packet_data );
-            reassembly_data->packet_data = NULL;
-        }
+        checksum += ( (uint32_t) ip_header[i] << 8 ) | ip_header[i+1];
     }
+    checksum = ( checksum & 0xFFFF ) + ( checksum >> 16 );
+    checksum = ( checksum & 0xFFFF ) + ( checksum >> 16 );
+    ip_header[10] = (uint8_t) ( ( ~checksum >> 8 ) & 0xFF );
+    ip_header[11] = (uint8_t) ( ~checksum & 0xFF );
 
-    endpoint->free_function( endpoint->allocator_context, endpoint->acks );
+    // udp checksum is left zero, which means "not computed" over ipv4
 
-    reliable_sequence_buffer_destroy( endpoint->sent_packets );
-    reliable_sequence_buffer_destroy( endpoint->received_packets );
-    reliable_sequence_buffer_destroy( endpoint->fragment_reassembly );
+    reliable_write_uint16_big_endian( &p, RELIABLE_CAPTURE_PCAPNG_PORT );
+    reliable_write_uint16_big_endian( &p, RELIABLE_CAPTURE_PCAPNG_PORT );
+    reliable_write_uint16_big_endian( &p, (uint16_t) ( ip_bytes - 20 ) );
+    reliable_write_uint16_big_endian( &p, 0 );
 
-    endpoint->free_function( endpoint->allocator_context, endpoint->rtt_history_buffer );
+    fwrite( headers, 1, sizeof( headers ), reliable_capture_file );
 
-    endpoint->free_function( endpoint->allocator_context, endpoint->transmit_buffer );
+    if ( data_bytes > 0 )
+    {
+        reliable_capture_ring_fwrite( ring, data_index, data_bytes );
+    }
 
-    endpoint->free_function( endpoint->allocator_context, endpoint );
+    uint8_t trailer[8];
+    memset( trailer, 0, sizeof( trailer ) );
+    p = trailer + padding_bytes;
+    reliable_write_uint32( &p, block_bytes );
+    fwrite( trailer, 1, padding_bytes + 4, reliable_capture_file );
+
+    return (int) block_bytes;
 }
 
-uint16_t reliable_endpoint_next_packet_sequence( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->sequence;
-}
-
-int reliable_write_packet_header( uint8_t * packet_data, uint16_t sequence, uint16_t ack, uint32_t ack_bits )
+int reliable_capture_flush(void)
 {
-    uint8_t * p = packet_data;
+    int bytes_written = 0;
 
-    uint8_t prefix_byte = 0;
+    reliable_capture_lock();
 
-    if ( ( ack_bits & 0x000000FF ) != 0x000000FF )
+    struct reliable_capture_ring_t * ring;
+    for ( ring = reliable_capture_rings; ring; ring = ring->next )
     {
-        prefix_byte |= (1<<1);
-    }
+        uint32_t read_index = ring->read_index;
+        uint32_t write_index = reliable_atomic_load_acquire_uint32( &ring->write_index );
+        uint32_t bytes = write_index - read_index;
+        if ( bytes == 0 )
+            continue;
 
-    if ( ( ack_bits & 0x0000FF00 ) != 0x0000FF00 )
-    {
-        prefix_byte |= (1<<2);
-    }
+        if ( reliable_capture_file && reliable_capture_format == RELIABLE_CAPTURE_FORMAT_PCAPNG )
+        {
+            // pcapng only has room for datagrams, so walk the records and convert sends and receives. creates and updates are skipped
 
-    if ( ( ack_bits & 0x00FF0000 ) != 0x00FF0000 )
-    {
-        prefix_byte |= (1<<3);
-    }
+            uint32_t index = read_index;
+            while ( index != write_index )
+            {
+                uint8_t header[RELIABLE_CAPTURE_RECORD_HEADER_BYTES];
+                reliable_capture_ring_read( ring, index, header, RELIABLE_CAPTURE_RECORD_HEADER_BYTES );
+                uint8_t * p = header;
+                int type = reliable_read_uint8( &p );
+                reliable_read_uint8( &p );
+                reliable_read_uint16( &p );
+                uint64_t endpoint_id = reliable_read_uint64( &p );
+                union { double d; uint64_t u; } time_bits;
+                time_bits.u = reliable_read_uint64( &p );
+                uint32_t packet_bytes = reliable_read_uint32( &p );
+                uint32_t data_bytes = reliable_read_uint32( &p );
+                if ( type == RELIABLE_CAPTURE_SEND || type == RELIABLE_CAPTURE_RECEIVE )
+                {
+                    bytes_written += reliable_capture_write_pcapng_packet( ring, index + RELIABLE_CAPTURE_RECORD_HEADER_BYTES, type, endpoint_id, time_bits.d, packet_bytes, data_bytes );
+                }
+                index += RELIABLE_CAPTURE_RECORD_HEADER_BYTES + data_bytes;
+            }
+        }
+        else if ( reliable_capture_file )
+        {
+            reliable_capture_ring_fwrite( ring, read_index, bytes );
+            bytes_written += (int) bytes;
+        }
 
-    if ( ( ack_bits & 0xFF000000 ) != 0xFF000000 )
-    {
-        prefix_byte |= (1<<4);
+        reliable_atomic_store_release_uint32( &ring->read_index, write_index );
     }
 
-    int sequence_difference = sequence - ack;
-    if ( sequence_difference < 0 )
-        sequence_difference += 65536;
-    if ( sequence_difference <= 255 )
-        prefix_byte |= (1<<5);
+    reliable_capture_unlock();
 
-    reliable_write_uint8( &p, prefix_byte );
+    return bytes_written;
+}
 
-    reliable_write_uint16( &p, sequence );
+int reliable_capture_stop(void)
+{
+    reliable_atomic_store_relaxed_uint32( &reliable_capture_active, 0 );
 
-    if ( sequence_difference <= 255 )
-    {
-        reliable_write_uint8( &p, (uint8_t) sequence_difference );
-    }
-    else
-    {
-        reliable_write_uint16( &p, ack );
-    }
+    reliable_capture_flush();
 
-    if ( ( ack_bits & 0x000000FF ) != 0x000000FF )
-    {
-        reliable_write_uint8( &p, (uint8_t) ( ack_bits & 0x000000FF ) );
-    }
+    int num_dropped = 0;
 
-    if ( ( ack_bits & 0x0000FF00 ) != 0x0000FF00 )
-    {
-        reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0x0000FF00 ) >> 8 ) );
-    }
+    // threads that capture again after this allocate a new ring, because the generation no longer matches
 
-    if ( ( ack_bits & 0x00FF0000 ) != 0x00FF0000 )
+    reliable_capture_lock();
+    while ( reliable_capture_rings )
     {
-        reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0x00FF0000 ) >> 16 ) );
+        struct reliable_capture_ring_t * next = reliable_capture_rings->next;
+        num_dropped += (int) reliable_capture_rings->num_dropped;
+        free( reliable_capture_rings );
+        reliable_capture_rings = next;
     }
+    reliable_capture_rings_generation++;
+    reliable_capture_unlock();
 
-    if ( ( ack_bits & 0xFF000000 ) != 0xFF000000 )
+    if ( reliable_capture_file )
     {
-        reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0xFF000000 ) >> 24 ) );
+        fclose( reliable_capture_file );
+        reliable_capture_file = NULL;
     }
 
-    reliable_assert( p - packet_data <= RELIABLE_MAX_PACKET_HEADER_BYTES );
-
-    return (int) ( p - packet_data );
+    return num_dropped;
 }
 
-void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
-{
-    reliable_assert( endpoint );
-    reliable_assert( packet_data );
-    reliable_assert( packet_bytes > 0 );
-
-    if ( packet_bytes > endpoint->config.max_packet_size )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too large to send. packet is %d bytes, maximum is %d\n", 
-            endpoint->config.name, packet_bytes, endpoint->config.max_packet_size );
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_SEND]++;
-        return;
-    }
-
-    uint16_t sequence = endpoint->sequence++;
-    uint16_t ack;
-    uint32_t ack_bits;
-
-    reliable_sequence_buffer_generate_ack_bits( endpoint->received_packets, &ack, &ack_bits );
+// ------------------------------------------------------------------
 
-    reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] sending packet %d\n", endpoint->config.name, sequence );
+// simd kernels for the rtt statistics in reliable_endpoint_update and for reliable_sequence_buffer_generate_ack_bits.
+// the library is built for a baseline cpu, so each kernel is compiled per instruction set with a target attribute, and
+// reliable_init points reliable_simd at the best set the cpu reports. set RELIABLE_ENABLE_SIMD=0 for scalar only
 
-    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_insert( endpoint->sent_packets, sequence );
+#ifndef RELIABLE_ENABLE_SIMD
+#define RELIABLE_ENABLE_SIMD 1
+#endif // #ifndef RELIABLE_ENABLE_SIMD
 
-    reliable_assert( sent_packet_data );
+#if RELIABLE_ENABLE_SIMD && ( defined( __x86_64__ ) || defined( _M_X64 ) ) && ( defined( __GNUC__ ) || defined( _MSC_VER ) )
+#define RELIABLE_SIMD_X86 1
+#else
+#define RELIABLE_SIMD_X86 0
+#endif
 
-    sent_packet_data->time = endpoint->time;
-    sent_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
-    sent_packet_data->acked = 0;
+#if RELIABLE_ENABLE_SIMD && defined( __aarch64__ ) && defined( __ARM_NEON )
+#define RELIABLE_SIMD_NEON 1
+#else
+#define RELIABLE_SIMD_NEON 0
+#endif
 
-    if ( packet_bytes <= endpoint->config.fragment_above )
-    {
-        // regular packet
+#if RELIABLE_SIMD_X86
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define RELIABLE_TARGET( isa )
+#else // #if defined( _MSC_VER )
+#define RELIABLE_TARGET( isa ) __attribute__(( target( isa ) ))
+#endif // #if defined( _MSC_VER )
+#endif // #if RELIABLE_SIMD_X86
+
+#if RELIABLE_SIMD_NEON
+#include <arm_neon.h>
+#if defined( __linux__ )
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif // #if defined( __linux__ )
+#endif // #if RELIABLE_SIMD_NEON
+
+struct reliable_simd_kernels_t
+{
+    RELIABLE_CONST char * name;
+    int (*supported)(void);
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] sending packet %d without fragmentation\n", endpoint->config.name, sequence );
+    // min, max, sum and count of the rtt samples that are >= 0. min starts at 10000 and max at 0, like the scalar loop
+    void (*rtt_stats)( RELIABLE_CONST float * rtt, int n, float * min, float * max, float * sum, int * count );
 
-        uint8_t * transmit_packet_data = endpoint->transmit_buffer;
+    // sum of ( rtt - mean )^2 over the rtt samples that are >= 0
+    float (*rtt_squared_deviation)( RELIABLE_CONST float * rtt, int n, float mean );
 
-        int packet_header_bytes = reliable_write_packet_header( transmit_packet_data, sequence, ack, ack_bits );
+    // ack bits for 32 consecutive entries of a sequence buffer, where entry_sequence[31] is the slot of ack.
+    // bit i is set when the slot of ack - i holds ack - i
+    uint32_t (*ack_bits)( RELIABLE_CONST uint32_t * entry_sequence, uint16_t ack );
+};
 
-        memcpy( transmit_packet_data + packet_header_bytes, packet_data, packet_bytes );
+static int reliable_simd_always_supported(void)
+{
+    return 1;
+}
 
-        endpoint->config.transmit_packet_function( endpoint->config.context, endpoint->config.id, sequence, transmit_packet_data, packet_header_bytes + packet_bytes );
-    }
-    else
+static void reliable_rtt_stats_scalar( RELIABLE_CONST float * rtt, int n, float * min, float * max, float * sum, int * count )
+{
+    float min_rtt = 10000.0f;
+    float max_rtt = 0.0f;
+    float sum_rtt = 0.0f;
+    int num_valid = 0;
+    int i;
+    for ( i = 0; i < n; i++ )
     {
-        // fragmented packet
-
-        uint8_t packet_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
-
-        memset( packet_header, 0, RELIABLE_MAX_PACKET_HEADER_BYTES );
+        if ( rtt[i] >= 0.0f )
+        {
+            if ( rtt[i] < min_rtt )
+            {
+                min_rtt = rtt[i];
+            }
+            if ( rtt[i] > max_rtt )
+            {
+                max_rtt = rtt[i];
+            }
+            sum_rtt += rtt[i];
+            num_valid++;
+        }
+    }
+    *min = min_rtt;
+    *max = max_rtt;
+    *sum = sum_rtt;
+    *count = num_valid;
+}
 
-        int packet_header_bytes = reliable_write_packet_header( packet_header, sequence, ack, ack_bits );        
+static float reliable_rtt_squared_deviation_scalar( RELIABLE_CONST float * rtt, int n, float mean )
+{
+    float sum = 0.0f;
+    int i;
+    for ( i = 0; i < n; i++ )
+    {
+        if ( rtt[i] >= 0.0f )
+        {
+            float deviation = rtt[i] - mean;
+            sum += deviation * deviation;
+        }
+    }
+    return sum;
+}
 
-        int num_fragments = ( packet_bytes / endpoint->config.fragment_size ) + ( ( packet_bytes % endpoint->config.fragment_size ) != 0 ? 1 : 0 );
+static uint32_t reliable_ack_bits_scalar( RELIABLE_CONST uint32_t * entry_sequence, uint16_t ack )
+{
+    uint32_t ack_bits = 0;
+    int i;
+    for ( i = 0; i < 32; ++i )
+    {
+        if ( entry_sequence[31-i] == (uint32_t) (uint16_t) ( ack - i ) )
+        {
+            ack_bits |= 1U << i;
+        }
+    }
+    return ack_bits;
+}
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] sending packet %d as %d fragments\n", endpoint->config.name, sequence, num_fragments );
+#if RELIABLE_SIMD_X86 || RELIABLE_SIMD_NEON
 
-        reliable_assert( num_fragments >= 1 );
-        reliable_assert( num_fragments <= endpoint->config.max_fragments );
+// the vector kernels compare entries in ascending order, so bit j of their mask is ack - 31 + j. ack bits want it reversed
 
-        uint8_t * fragment_packet_data = endpoint->transmit_buffer;
+static uint32_t reliable_reverse_bits( uint32_t x )
+{
+    x = ( ( x >> 1 ) & 0x55555555U ) | ( ( x & 0x55555555U ) << 1 );
+    x = ( ( x >> 2 ) & 0x33333333U ) | ( ( x & 0x33333333U ) << 2 );
+    x = ( ( x >> 4 ) & 0x0F0F0F0FU ) | ( ( x & 0x0F0F0F0FU ) << 4 );
+    x = ( ( x >> 8 ) & 0x00FF00FFU ) | ( ( x & 0x00FF00FFU ) << 8 );
+    return ( x >> 16 ) | ( x << 16 );
+}
 
-        uint8_t * q = packet_data;
+static int reliable_count_bits( uint32_t x )
+{
+    x = x - ( ( x >> 1 ) & 0x55555555U );
+    x = ( x & 0x33333333U ) + ( ( x >> 2 ) & 0x33333333U );
+    x = ( x + ( x >> 4 ) ) & 0x0F0F0F0FU;
+    return (int) ( ( x * 0x01010101U ) >> 24 );
+}
 
-        uint8_t * end = q + packet_bytes;
+#endif // #if RELIABLE_SIMD_X86 || RELIABLE_SIMD_NEON
 
-        int fragment_id;
-        for ( fragment_id = 0; fragment_id < num_fragments; ++fragment_id )
-        {
-            uint8_t * p = fragment_packet_data;
+#if RELIABLE_SIMD_X86
 
-            reliable_write_uint8( &p, 1 );
-            reliable_write_uint16( &p, sequence );
-            reliable_write_uint8( &p, (uint8_t) fragment_id );
-            reliable_write_uint8( &p, (uint8_t) ( num_fragments - 1 ) );
+static int reliable_cpu_sse42(void)
+{
+#if defined( _MSC_VER )
+    int info[4];
+    __cpuid( info, 1 );
+    return ( info[2] & ( 1 << 20 ) ) != 0;
+#else // #if defined( _MSC_VER )
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "sse4.2" );
+#endif // #if defined( _MSC_VER )
+}
 
-            if ( fragment_id == 0 )
-            {
-                memcpy( p, packet_header, packet_header_bytes );
-                p += packet_header_bytes;
-            }
+#if defined( _MSC_VER )
 
-            int bytes_to_copy = endpoint->config.fragment_size;
-            if ( q + bytes_to_copy > end )
-            {
-                bytes_to_copy = (int) ( end - q );
-            }
+// cpuid says what the cpu has, xgetbv says whether the os saves the wider registers on a context switch
 
-            memcpy( p, q, bytes_to_copy );
+static int reliable_cpu_os_saves( unsigned long long xcr0_bits )
+{
+    int info[4];
+    __cpuid( info, 1 );
+    if ( ( info[2] & ( 1 << 27 ) ) == 0 )
+        return 0;
+    return ( _xgetbv( 0 ) & xcr0_bits ) == xcr0_bits;
+}
 
-            p += bytes_to_copy;
-            q += bytes_to_copy;
+#endif // #if defined( _MSC_VER )
 
-            int fragment_packet_bytes = (int) ( p - fragment_packet_data );
+static int reliable_cpu_avx2(void)
+{
+#if defined( _MSC_VER )
+    int info[4];
+    __cpuidex( info, 7, 0 );
+    return ( info[1] & ( 1 << 5 ) ) != 0 && reliable_cpu_os_saves( 0x6 );
+#else // #if defined( _MSC_VER )
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" );
+#endif // #if defined( _MSC_VER )
+}
 
-            endpoint->config.transmit_packet_function( endpoint->config.context, endpoint->config.id, sequence, fragment_packet_data, fragment_packet_bytes );
+static int reliable_cpu_avx512(void)
+{
+#if defined( _MSC_VER )
+    int info[4];
+    __cpuidex( info, 7, 0 );
+    return ( info[1] & ( 1 << 16 ) ) != 0 && reliable_cpu_os_saves( 0xE6 );
+#else // #if defined( _MSC_VER )
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx512f" );
+#endif // #if defined( _MSC_VER )
+}
 
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_SENT]++;
-        }
+RELIABLE_TARGET( "sse4.2" ) static void reliable_rtt_stats_sse42( RELIABLE_CONST float * rtt, int n, float * min, float * max, float * sum, int * count )
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 initial_min = _mm_set1_ps( 10000.0f );
+    __m128 min_rtt = initial_min;
+    __m128 max_rtt = zero;
+    __m128 sum_rtt = zero;
+    int num_valid = 0;
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 )
+    {
+        __m128 value = _mm_loadu_ps( rtt + i );
+        __m128 valid = _mm_cmpge_ps( value, zero );
+        min_rtt = _mm_min_ps( min_rtt, _mm_blendv_ps( initial_min, value, valid ) );
+        max_rtt = _mm_max_ps( max_rtt, _mm_and_ps( value, valid ) );
+        sum_rtt = _mm_add_ps( sum_rtt, _mm_and_ps( value, valid ) );
+        num_valid += reliable_count_bits( (uint32_t) _mm_movemask_ps( valid ) );
     }
-
-    endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT]++;
+    float lanes_min[4], lanes_max[4], lanes_sum[4];
+    _mm_storeu_ps( lanes_min, min_rtt );
+    _mm_storeu_ps( lanes_max, max_rtt );
+    _mm_storeu_ps( lanes_sum, sum_rtt );
+    float tail_min, tail_max, tail_sum;
+    int tail_count;
+    reliable_rtt_stats_scalar( rtt + i, n - i, &tail_min, &tail_max, &tail_sum, &tail_count );
+    int j;
+    for ( j = 0; j < 4; ++j )
+    {
+        tail_min = lanes_min[j] < tail_min ? lanes_min[j] : tail_min;
+        tail_max = lanes_max[j] > tail_max ? lanes_max[j] : tail_max;
+        tail_sum += lanes_sum[j];
+    }
+    *min = tail_min;
+    *max = tail_max;
+    *sum = tail_sum;
+    *count = num_valid + tail_count;
 }
 
-int reliable_read_packet_header( RELIABLE_CONST char * name, uint8_t * packet_data, int packet_bytes, uint16_t * sequence, uint16_t * ack, uint32_t * ack_bits )
+RELIABLE_TARGET( "sse4.2" ) static float reliable_rtt_squared_deviation_sse42( RELIABLE_CONST float * rtt, int n, float mean )
 {
-    if ( packet_bytes < 3 )
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 vector_mean = _mm_set1_ps( mean );
+    __m128 sum = zero;
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (1)\n", name );
-        return -1;
+        __m128 value = _mm_loadu_ps( rtt + i );
+        __m128 deviation = _mm_and_ps( _mm_sub_ps( value, vector_mean ), _mm_cmpge_ps( value, zero ) );
+        sum = _mm_add_ps( sum, _mm_mul_ps( deviation, deviation ) );
     }
+    float lanes[4];
+    _mm_storeu_ps( lanes, sum );
+    return reliable_rtt_squared_deviation_scalar( rtt + i, n - i, mean ) + ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] );
+}
 
-    uint8_t * p = packet_data;
-
-    uint8_t prefix_byte = reliable_read_uint8( &p );
-
-    if ( ( prefix_byte & 1 ) != 0 )
+RELIABLE_TARGET( "sse4.2" ) static uint32_t reliable_ack_bits_sse42( RELIABLE_CONST uint32_t * entry_sequence, uint16_t ack )
+{
+    const __m128i low_bits = _mm_set1_epi32( 0xFFFF );
+    __m128i expected = _mm_add_epi32( _mm_set1_epi32( (uint16_t) ( ack - 31 ) ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+    uint32_t mask = 0;
+    int j;
+    for ( j = 0; j < 32; j += 4 )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] prefix byte does not indicate a regular packet\n", name );
-        return -1;
+        __m128i entries = _mm_loadu_si128( (const __m128i*) ( entry_sequence + j ) );
+        __m128i equal = _mm_cmpeq_epi32( entries, _mm_and_si128( expected, low_bits ) );
+        mask |= (uint32_t) _mm_movemask_ps( _mm_castsi128_ps( equal ) ) << j;
+        expected = _mm_add_epi32( expected, _mm_set1_epi32( 4 ) );
     }
+    return reliable_reverse_bits( mask );
+}
 
-    *sequence = reliable_read_uint16( &p );
-
-    if ( prefix_byte & (1<<5) )
+RELIABLE_TARGET( "avx2" ) static void reliable_rtt_stats_avx2( RELIABLE_CONST float * rtt, int n, float * min, float * max, float * sum, int * count )
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 initial_min = _mm256_set1_ps( 10000.0f );
+    __m256 min_rtt = initial_min;
+    __m256 max_rtt = zero;
+    __m256 sum_rtt = zero;
+    int num_valid = 0;
+    int i = 0;
+    for ( ; i + 8 <= n; i += 8 )
     {
-        if ( packet_bytes < 3 + 1 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (2)\n", name );
-            return -1;
-        }
-        uint8_t sequence_difference = reliable_read_uint8( &p );
-        *ack = *sequence - sequence_difference;
+        __m256 value = _mm256_loadu_ps( rtt + i );
+        __m256 valid = _mm256_cmp_ps( value, zero, _CMP_GE_OQ );
+        min_rtt = _mm256_min_ps( min_rtt, _mm256_blendv_ps( initial_min, value, valid ) );
+        max_rtt = _mm256_max_ps( max_rtt, _mm256_and_ps( value, valid ) );
+        sum_rtt = _mm256_add_ps( sum_rtt, _mm256_and_ps( value, valid ) );
+        num_valid += reliable_count_bits( (uint32_t) _mm256_movemask_ps( valid ) );
     }
-    else
+    float lanes_min[8], lanes_max[8], lanes_sum[8];
+    _mm256_storeu_ps( lanes_min, min_rtt );
+    _mm256_storeu_ps( lanes_max, max_rtt );
+    _mm256_storeu_ps( lanes_sum, sum_rtt );
+    float tail_min, tail_max, tail_sum;
+    int tail_count;
+    reliable_rtt_stats_scalar( rtt + i, n - i, &tail_min, &tail_max, &tail_sum, &tail_count );
+    int j;
+    for ( j = 0; j < 8; ++j )
     {
-        if ( packet_bytes < 3 + 2 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (3)\n", name );
-            return -1;
-        }
-        *ack = reliable_read_uint16( &p );
+        tail_min = lanes_min[j] < tail_min ? lanes_min[j] : tail_min;
+        tail_max = lanes_max[j] > tail_max ? lanes_max[j] : tail_max;
+        tail_sum += lanes_sum[j];
     }
+    *min = tail_min;
+    *max = tail_max;
+    *sum = tail_sum;
+    *count = num_valid + tail_count;
+}
 
-    int expected_bytes = 0;
-    int i;
-    for ( i = 1; i <= 4; ++i )
+RELIABLE_TARGET( "avx2" ) static float reliable_rtt_squared_deviation_avx2( RELIABLE_CONST float * rtt, int n, float mean )
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 vector_mean = _mm256_set1_ps( mean );
+    __m256 sum = zero;
+    int i = 0;
+    for ( ; i + 8 <= n; i += 8 )
     {
-        if ( prefix_byte & (1<<i) )
-        {
-            expected_bytes++;
-        }
+        __m256 value = _mm256_loadu_ps( rtt + i );
+        __m256 deviation = _mm256_and_ps( _mm256_sub_ps( value, vector_mean ), _mm256_cmp_ps( value, zero, _CMP_GE_OQ ) );
+        sum = _mm256_add_ps( sum, _mm256_mul_ps( deviation, deviation ) );
     }
-    if ( packet_bytes < ( p - packet_data ) + expected_bytes )
+    float lanes[8];
+    _mm256_storeu_ps( lanes, sum );
+    float total = reliable_rtt_squared_deviation_scalar( rtt + i, n - i, mean );
+    int j;
+    for ( j = 0; j < 8; ++j )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (4)\n", name );
-        return -1;
+        total += lanes[j];
     }
+    return total;
+}
 
-    *ack_bits = 0xFFFFFFFF;
-
-    if ( prefix_byte & (1<<1) )
+RELIABLE_TARGET( "avx2" ) static uint32_t reliable_ack_bits_avx2( RELIABLE_CONST uint32_t * entry_sequence, uint16_t ack )
+{
+    const __m256i low_bits = _mm256_set1_epi32( 0xFFFF );
+    __m256i expected = _mm256_add_epi32( _mm256_set1_epi32( (uint16_t) ( ack - 31 ) ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+    uint32_t mask = 0;
+    int j;
+    for ( j = 0; j < 32; j += 8 )
     {
-        *ack_bits &= 0xFFFFFF00;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) );
+        __m256i entries = _mm256_loadu_si256( (const __m256i*) ( entry_sequence + j ) );
+        __m256i equal = _mm256_cmpeq_epi32( entries, _mm256_and_si256( expected, low_bits ) );
+        mask |= (uint32_t) _mm256_movemask_ps( _mm256_castsi256_ps( equal ) ) << j;
+        expected = _mm256_add_epi32( expected, _mm256_set1_epi32( 8 ) );
     }
+    return reliable_reverse_bits( mask );
+}
 
-    if ( prefix_byte & (1<<2) )
-    {
-        *ack_bits &= 0xFFFF00FF;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 8;
-    }
+// with avx-512 the tail is a masked load, so there is no scalar loop after the vector one
 
-    if ( prefix_byte & (1<<3) )
+RELIABLE_TARGET( "avx512f" ) static void reliable_rtt_stats_avx512( RELIABLE_CONST float * rtt, int n, float * min, float * max, float * sum, int * count )
+{
+    const __m512 zero = _mm512_setzero_ps();
+    __m512 min_rtt = _mm512_set1_ps( 10000.0f );
+    __m512 max_rtt = zero;
+    __m512 sum_rtt = zero;
+    int num_valid = 0;
+    int i;
+    for ( i = 0; i < n; i += 16 )
     {
-        *ack_bits &= 0xFF00FFFF;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 16;
+        __mmask16 lanes = n - i >= 16 ? (__mmask16) 0xFFFF : (__mmask16) ( ( 1U << ( n - i ) ) - 1 );
+        __m512 value = _mm512_maskz_loadu_ps( lanes, rtt + i );
+        __mmask16 valid = _mm512_mask_cmp_ps_mask( lanes, value, zero, _CMP_GE_OQ );
+        min_rtt = _mm512_mask_min_ps( min_rtt, valid, min_rtt, value );
+        max_rtt = _mm512_mask_max_ps( max_rtt, valid, max_rtt, value );
+        sum_rtt = _mm512_mask_add_ps( sum_rtt, valid, sum_rtt, value );
+        num_valid += reliable_count_bits( (uint32_t) valid );
     }
+    *min = _mm512_reduce_min_ps( min_rtt );
+    *max = _mm512_reduce_max_ps( max_rtt );
+    *sum = _mm512_reduce_add_ps( sum_rtt );
+    *count = num_valid;
+}
 
-    if ( prefix_byte & (1<<4) )
+RELIABLE_TARGET( "avx512f" ) static float reliable_rtt_squared_deviation_avx512( RELIABLE_CONST float * rtt, int n, float mean )
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 vector_mean = _mm512_set1_ps( mean );
+    __m512 sum = zero;
+    int i;
+    for ( i = 0; i < n; i += 16 )
     {
-        *ack_bits &= 0x00FFFFFF;
-        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 24;
+        __mmask16 lanes = n - i >= 16 ? (__mmask16) 0xFFFF : (__mmask16) ( ( 1U << ( n - i ) ) - 1 );
+        __m512 value = _mm512_maskz_loadu_ps( lanes, rtt + i );
+        __mmask16 valid = _mm512_mask_cmp_ps_mask( lanes, value, zero, _CMP_GE_OQ );
+        __m512 deviation = _mm512_sub_ps( value, vector_mean );
+        sum = _mm512_mask3_fmadd_ps( deviation, deviation, sum, valid );
     }
+    return _mm512_reduce_add_ps( sum );
+}
 
-    return (int) ( p - packet_data );
+RELIABLE_TARGET( "avx512f" ) static uint32_t reliable_ack_bits_avx512( RELIABLE_CONST uint32_t * entry_sequence, uint16_t ack )
+{
+    const __m512i low_bits = _mm512_set1_epi32( 0xFFFF );
+    const __m512i first = _mm512_add_epi32( _mm512_set1_epi32( (uint16_t) ( ack - 31 ) ), _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ) );
+    const __m512i second = _mm512_add_epi32( first, _mm512_set1_epi32( 16 ) );
+    uint32_t low = _mm512_cmpeq_epi32_mask( _mm512_loadu_si512( entry_sequence ), _mm512_and_si512( first, low_bits ) );
+    uint32_t high = _mm512_cmpeq_epi32_mask( _mm512_loadu_si512( entry_sequence + 16 ), _mm512_and_si512( second, low_bits ) );
+    return reliable_reverse_bits( low | ( high << 16 ) );
 }
 
-int reliable_read_fragment_header( char * name, 
-                                   uint8_t * packet_data, 
-                                   int packet_bytes, 
-                                   int max_fragments, 
-                                   int fragment_size, 
-                                   int * fragment_id, 
-                                   int * num_fragments, 
-                                   int * fragment_bytes, 
-                                   uint16_t * sequence, 
-                                   uint16_t * ack, 
-                                   uint32_t * ack_bits )
+#endif // #if RELIABLE_SIMD_X86
+
+#if RELIABLE_SIMD_NEON
+
+static int reliable_cpu_neon(void)
 {
-    if ( packet_bytes < RELIABLE_FRAGMENT_HEADER_BYTES )
+#if defined( __linux__ ) && defined( HWCAP_ASIMD )
+    return ( getauxval( AT_HWCAP ) & HWCAP_ASIMD ) != 0;
+#else // #if defined( __linux__ ) && defined( HWCAP_ASIMD )
+    // advanced simd is mandatory on aarch64, so anywhere we can't ask it's there
+    return 1;
+#endif // #if defined( __linux__ ) && defined( HWCAP_ASIMD )
+}
+
+static void reliable_rtt_stats_neon( RELIABLE_CONST float * rtt, int n, float * min, float * max, float * sum, int * count )
+{
+    const float32x4_t zero = vdupq_n_f32( 0.0f );
+    const float32x4_t initial_min = vdupq_n_f32( 10000.0f );
+    float32x4_t min_rtt = initial_min;
+    float32x4_t max_rtt = zero;
+    float32x4_t sum_rtt = zero;
+    uint32x4_t num_valid = vdupq_n_u32( 0 );
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet is too small to read fragment header\n", name );
-        return -1;
+        float32x4_t value = vld1q_f32( rtt + i );
+        uint32x4_t valid = vcgeq_f32( value, zero );
+        float32x4_t valid_value = vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( value ), valid ) );
+        min_rtt = vminq_f32( min_rtt, vbslq_f32( valid, value, initial_min ) );
+        max_rtt = vmaxq_f32( max_rtt, valid_value );
+        sum_rtt = vaddq_f32( sum_rtt, valid_value );
+        num_valid = vsubq_u32( num_valid, valid );
     }
+    float tail_min, tail_max, tail_sum;
+    int tail_count;
+    reliable_rtt_stats_scalar( rtt + i, n - i, &tail_min, &tail_max, &tail_sum, &tail_count );
+    float vector_min = vminvq_f32( min_rtt );
+    float vector_max = vmaxvq_f32( max_rtt );
+    *min = vector_min < tail_min ? vector_min : tail_min;
+    *max = vector_max > tail_max ? vector_max : tail_max;
+    *sum = vaddvq_f32( sum_rtt ) + tail_sum;
+    *count = (int) vaddvq_u32( num_valid ) + tail_count;
+}
 
-    uint8_t * p = packet_data;
-
-    uint8_t prefix_byte = reliable_read_uint8( &p );
-    if ( prefix_byte != 1 )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] prefix byte is not a fragment\n", name );
-        return -1;
-    }
-    
-    *sequence = reliable_read_uint16( &p );
-    *fragment_id = (int) reliable_read_uint8( &p );
-    *num_fragments = ( (int) reliable_read_uint8( &p ) ) + 1;
-
-    if ( *num_fragments > max_fragments )
+static float reliable_rtt_squared_deviation_neon( RELIABLE_CONST float * rtt, int n, float mean )
+{
+    const float32x4_t zero = vdupq_n_f32( 0.0f );
+    const float32x4_t vector_mean = vdupq_n_f32( mean );
+    float32x4_t sum = zero;
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] num fragments %d outside of range of max fragments %d\n", name, *num_fragments, max_fragments );
-        return -1;
+        float32x4_t value = vld1q_f32( rtt + i );
+        uint32x4_t valid = vcgeq_f32( value, zero );
+        float32x4_t deviation = vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( vsubq_f32( value, vector_mean ) ), valid ) );
+        sum = vmlaq_f32( sum, deviation, deviation );
     }
+    return vaddvq_f32( sum ) + reliable_rtt_squared_deviation_scalar( rtt + i, n - i, mean );
+}
 
-    if ( *fragment_id >= *num_fragments )
+static uint32_t reliable_ack_bits_neon( RELIABLE_CONST uint32_t * entry_sequence, uint16_t ack )
+{
+    static const uint32_t lane_offsets[4] = { 0, 1, 2, 3 };
+    static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+    const uint32x4_t low_bits = vdupq_n_u32( 0xFFFF );
+    const uint32x4_t bits = vld1q_u32( lane_bits );
+    uint32x4_t expected = vaddq_u32( vdupq_n_u32( (uint16_t) ( ack - 31 ) ), vld1q_u32( lane_offsets ) );
+    uint32_t mask = 0;
+    int j;
+    for ( j = 0; j < 32; j += 4 )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment id %d outside of range of num fragments %d\n", name, *fragment_id, *num_fragments );
-        return -1;
+        uint32x4_t equal = vceqq_u32( vld1q_u32( entry_sequence + j ), vandq_u32( expected, low_bits ) );
+        mask |= vaddvq_u32( vandq_u32( equal, bits ) ) << j;
+        expected = vaddq_u32( expected, vdupq_n_u32( 4 ) );
     }
+    return reliable_reverse_bits( mask );
+}
 
-    *fragment_bytes = packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
+#endif // #if RELIABLE_SIMD_NEON
 
-    uint16_t packet_sequence = 0;
-    uint16_t packet_ack = 0;
-    uint32_t packet_ack_bits = 0;
+// ordered from slowest to fastest. reliable_init takes the last one the cpu supports
 
-    if ( *fragment_id == 0 )
-    {
-        int packet_header_bytes = reliable_read_packet_header( name,
-                                                               packet_data + RELIABLE_FRAGMENT_HEADER_BYTES,
-                                                               packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES,
-                                                               &packet_sequence,
-                                                               &packet_ack, 
-                                                               &packet_ack_bits );
+static const struct reliable_simd_kernels_t reliable_simd_kernels[] =
+{
+    { "scalar", reliable_simd_always_supported, reliable_rtt_stats_scalar, reliable_rtt_squared_deviation_scalar, reliable_ack_bits_scalar },
+#if RELIABLE_SIMD_X86
+    { "sse4.2", reliable_cpu_sse42, reliable_rtt_stats_sse42, reliable_rtt_squared_deviation_sse42, reliable_ack_bits_sse42 },
+    { "avx2", reliable_cpu_avx2, reliable_rtt_stats_avx2, reliable_rtt_squared_deviation_avx2, reliable_ack_bits_avx2 },
+    { "avx512", reliable_cpu_avx512, reliable_rtt_stats_avx512, reliable_rtt_squared_deviation_avx512, reliable_ack_bits_avx512 },
+#endif // #if RELIABLE_SIMD_X86
+#if RELIABLE_SIMD_NEON
+    { "neon", reliable_cpu_neon, reliable_rtt_stats_neon, reliable_rtt_squared_deviation_neon, reliable_ack_bits_neon },
+#endif // #if RELIABLE_SIMD_NEON
+};
 
-        if ( packet_header_bytes < 0 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] bad packet header in fragment\n", name );
-            return -1;
-        }
+#define RELIABLE_NUM_SIMD_KERNELS ( (int) ( sizeof( reliable_simd_kernels ) / sizeof( reliable_simd_kernels[0] ) ) )
 
-        if ( packet_sequence != *sequence )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] bad packet sequence in fragment. expected %d, got %d\n", name, *sequence, packet_sequence );
-            return -1;
-        }
+// scalar until reliable_init runs, so endpoints work without it
 
-        // the packet header is re-encoded canonically during reassembly, so a non-canonical
-        // header would shift where the fragment payload lands. reject it here instead.
+static const struct reliable_simd_kernels_t * reliable_simd = &reliable_simd_kernels[0];
 
-        uint8_t canonical_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
-        int canonical_header_bytes = reliable_write_packet_header( canonical_header, packet_sequence, packet_ack, packet_ack_bits );
-        if ( canonical_header_bytes != packet_header_bytes || memcmp( canonical_header, packet_data + RELIABLE_FRAGMENT_HEADER_BYTES, canonical_header_bytes ) != 0 )
+int reliable_simd_set( RELIABLE_CONST char * name )
+{
+    reliable_assert( name );
+    int i;
+    for ( i = 0; i < RELIABLE_NUM_SIMD_KERNELS; ++i )
+    {
+        if ( strcmp( reliable_simd_kernels[i].name, name ) == 0 )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] non-canonical packet header in fragment\n", name );
-            return -1;
+            if ( !reliable_simd_kernels[i].supported() )
+                return RELIABLE_ERROR;
+            reliable_simd = &reliable_simd_kernels[i];
+            return RELIABLE_OK;
         }
-
-        *fragment_bytes = packet_bytes - packet_header_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
     }
+    return RELIABLE_ERROR;
+}
 
-    *ack = packet_ack;
-    *ack_bits = packet_ack_bits;
+RELIABLE_CONST char * reliable_simd_name(void)
+{
+    return reliable_simd->name;
+}
 
-    if ( *fragment_bytes > fragment_size )
+static void reliable_simd_init(void)
+{
+    RELIABLE_CONST char * name = getenv( "RELIABLE_SIMD" );
+    if ( name && name[0] != '\0' )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment bytes %d > fragment size %d\n", name, *fragment_bytes, fragment_size );
-        return - 1;
+        if ( reliable_simd_set( name ) == RELIABLE_OK )
+            return;
+        reliable_log( RELIABLE_LOG_LEVEL_ERROR, "[reliable] RELIABLE_SIMD=%s is unknown or not supported by this cpu\n", name );
     }
-
-    if ( *fragment_id != *num_fragments - 1 && *fragment_bytes != fragment_size )
+    int i;
+    for ( i = RELIABLE_NUM_SIMD_KERNELS - 1; i > 0; --i )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment %d is %d bytes, which is not the expected fragment size %d\n", 
-            name, *fragment_id, *fragment_bytes, fragment_size );
-        return -1;
+        if ( reliable_simd_kernels[i].supported() )
+            break;
     }
+    reliable_simd = &reliable_simd_kernels[i];
+}
 
-    return (int) ( p - packet_data );
+// ------------------------------------------------------------------
+
+int reliable_init(void)
+{
+    reliable_simd_init();
+    return RELIABLE_OK;
 }
 
-void reliable_store_fragment_data( struct reliable_fragment_reassembly_data_t * reassembly_data, 
-                                   uint16_t sequence, 
-                                   uint16_t ack, 
-                                   uint32_t ack_bits, 
-                                   int fragment_id, 
-                                   int fragment_size, 
-                                   uint8_t * fragment_data, 
-                                   int fragment_bytes )
+void reliable_term(void)
 {
-    if ( fragment_id == 0 )
+    // threads that log again after this allocate a new ring, because the generation no longer matches
+
+    reliable_log_lock();
+    while ( reliable_log_rings )
     {
-        uint8_t packet_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
+        struct reliable_log_ring_t * next = reliable_log_rings->next;
+        free( reliable_log_rings );
+        reliable_log_rings = next;
+    }
+    reliable_log_rings_generation++;
+    reliable_log_unlock();
 
-        memset( packet_header, 0, RELIABLE_MAX_PACKET_HEADER_BYTES );
+    if ( reliable_capture_file )
+    {
+        reliable_capture_stop();
+    }
+}
 
-        reassembly_data->packet_header_bytes = reliable_write_packet_header( packet_header, sequence, ack, ack_bits );
+// ---------------------------------------------------------------
 
-        memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
-                packet_header, 
-                reassembly_data->packet_header_bytes );
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_sequence_greater_than( uint16_t s1, uint16_t s2 )
+{
+    return ( ( s1 > s2 ) && ( s1 - s2 <= 32768 ) ) || 
+           ( ( s1 < s2 ) && ( s2 - s1  > 32768 ) );
+}
 
-        fragment_data += reassembly_data->packet_header_bytes;
-        fragment_bytes -= reassembly_data->packet_header_bytes;
-    }
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_sequence_less_than( uint16_t s1, uint16_t s2 )
+{
+    return reliable_sequence_greater_than( s2, s1 );
+}
 
-    if ( fragment_id == reassembly_data->num_fragments_total - 1 )
-    {
-        reassembly_data->packet_bytes = ( reassembly_data->num_fragments_total - 1 ) * fragment_size + fragment_bytes;
-    }
+// ---------------------------------------------------------------
 
-    size_t offset = RELIABLE_MAX_PACKET_HEADER_BYTES + fragment_id * fragment_size;
-    size_t end_offset = offset + fragment_bytes;
-    size_t max_size = RELIABLE_MAX_PACKET_HEADER_BYTES +
-                      reassembly_data->num_fragments_total * fragment_size;
-    
-    if ( fragment_bytes < 0 || end_offset > max_size )
-    {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG,
-            "[reliable] invalid fragment size %d (would write past %zu/%zu)\n",
-            fragment_bytes, end_offset, max_size );
-        return;
-    }
-    
-    memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES + fragment_id * fragment_size, fragment_data, fragment_bytes );
+struct reliable_sequence_buffer_t
+{
+    void * allocator_context;
+    void * (*allocate_function)(void*,size_t);
+    void (*free_function)(void*,void*);
+    uint16_t sequence;
+    int num_entries;
+    uint32_t index_mask;
+    int entry_stride;
+    uint32_t * entry_sequence;
+    uint8_t * entry_data;
+};
+
+// buffer sizes are usually a power of two, and then the index is a mask rather than a divide
+
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_sequence_buffer_index( struct reliable_sequence_buffer_t * sequence_buffer, uint32_t sequence )
+{
+    if ( sequence_buffer->index_mask )
+        return (int) ( sequence & sequence_buffer->index_mask );
+    return (int) ( sequence % (uint32_t) sequence_buffer->num_entries );
 }
 
-void reliable_endpoint_receive_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+RELIABLE_INTERNAL struct reliable_sequence_buffer_t * reliable_sequence_buffer_create( int num_entries, 
+                                                                     int entry_stride, 
+                                                                     void * allocator_context, 
+                                                                     void * (*allocate_function)(void*,size_t), 
+                                                                     void (*free_function)(void*,void*) )
 {
-    reliable_assert( endpoint );
-    reliable_assert( packet_data );
-    reliable_assert( packet_bytes > 0 );
+    reliable_assert( num_entries > 0 );
+    reliable_assert( entry_stride > 0 );
 
-    if ( packet_bytes > endpoint->config.max_packet_size + RELIABLE_MAX_PACKET_HEADER_BYTES + RELIABLE_FRAGMENT_HEADER_BYTES )
+    if ( allocate_function == NULL )
     {
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too large to receive. packet is at least %d bytes, maximum is %d\n",
-            endpoint->config.name, packet_bytes - ( RELIABLE_MAX_PACKET_HEADER_BYTES + RELIABLE_FRAGMENT_HEADER_BYTES ), endpoint->config.max_packet_size );
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE]++;
-        return;
+        allocate_function = reliable_default_allocate_function;
     }
 
-    uint8_t prefix_byte = packet_data[0];
-
-    if ( ( prefix_byte & 1 ) == 0 )
+    if ( free_function == NULL )
     {
-        // regular packet
+        free_function = reliable_default_free_function;
+    }
 
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED]++;
+    struct reliable_sequence_buffer_t * sequence_buffer = (struct reliable_sequence_buffer_t*)
+        allocate_function( allocator_context, sizeof( struct reliable_sequence_buffer_t ) );
 
-        uint16_t sequence;
-        uint16_t ack;
-        uint32_t ack_bits;
+    reliable_assert( sequence_buffer );
 
-        int packet_header_bytes = reliable_read_packet_header( endpoint->config.name, packet_data, packet_bytes, &sequence, &ack, &ack_bits );
-        if ( packet_header_bytes < 0 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] ignoring invalid packet. could not read packet header\n", endpoint->config.name );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_INVALID]++;
-            return;
-        }
+    sequence_buffer->allocator_context = allocator_context;
+    sequence_buffer->allocate_function = allocate_function;
+    sequence_buffer->free_function = free_function;
+    sequence_buffer->sequence = 0;
+    sequence_buffer->num_entries = num_entries;
+    sequence_buffer->index_mask = ( num_entries & ( num_entries - 1 ) ) == 0 ? (uint32_t) num_entries - 1 : 0;
+    sequence_buffer->entry_stride = entry_stride;
+    sequence_buffer->entry_sequence = (uint32_t*) allocate_function( allocator_context, num_entries * sizeof( uint32_t ) );
+    sequence_buffer->entry_data = (uint8_t*) allocate_function( allocator_context, num_entries * entry_stride );
+    reliable_assert( sequence_buffer->entry_sequence );
+    reliable_assert( sequence_buffer->entry_data );
+    memset( sequence_buffer->entry_sequence, 0xFF, sizeof( uint32_t) * sequence_buffer->num_entries );
+    memset( sequence_buffer->entry_data, 0, num_entries * entry_stride );
 
-        reliable_assert( packet_header_bytes <= packet_bytes );
+    return sequence_buffer;
+}
 
-        int packet_payload_bytes = packet_bytes - packet_header_bytes;
+RELIABLE_INTERNAL void reliable_sequence_buffer_destroy( struct reliable_sequence_buffer_t * sequence_buffer )
+{
+    reliable_assert( sequence_buffer );
+    sequence_buffer->free_function( sequence_buffer->allocator_context, sequence_buffer->entry_sequence );
+    sequence_buffer->free_function( sequence_buffer->allocator_context, sequence_buffer->entry_data );
+    sequence_buffer->free_function( sequence_buffer->allocator_context, sequence_buffer );
+}
 
-        if ( packet_payload_bytes > endpoint->config.max_packet_size )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] packet too large to receive. packet is at %d bytes, maximum is %d\n",
-                endpoint->config.name, packet_payload_bytes, endpoint->config.max_packet_size );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE]++;
-            return;
-        }
+RELIABLE_INTERNAL void reliable_sequence_buffer_reset( struct reliable_sequence_buffer_t * sequence_buffer )
+{
+    reliable_assert( sequence_buffer );
+    sequence_buffer->sequence = 0;
+    memset( sequence_buffer->entry_sequence, 0xFF, sizeof( uint32_t) * sequence_buffer->num_entries );
+}
 
-        if ( !reliable_sequence_buffer_test_insert( endpoint->received_packets, sequence ) )
+RELIABLE_INTERNAL RELIABLE_HOT void reliable_sequence_buffer_remove_entries( struct reliable_sequence_buffer_t * sequence_buffer, 
+                                              int start_sequence, 
+                                              int finish_sequence, 
+                                              void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+{
+    reliable_assert( sequence_buffer );
+    if ( finish_sequence < start_sequence ) 
+    {
+        finish_sequence += 65536;
+    }
+    if ( finish_sequence - start_sequence < sequence_buffer->num_entries )
+    {
+        int sequence;
+        for ( sequence = start_sequence; sequence <= finish_sequence; ++sequence )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] ignoring stale packet %d\n", endpoint->config.name, sequence );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE]++;
-            return;
+            if ( cleanup_function )
+            {
+                cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * reliable_sequence_buffer_index( sequence_buffer, sequence ), 
+                                  sequence_buffer->allocator_context, 
+                                  sequence_buffer->free_function );
+            }
+            sequence_buffer->entry_sequence[ reliable_sequence_buffer_index( sequence_buffer, sequence ) ] = 0xFFFFFFFF;
         }
-
-        if ( reliable_sequence_buffer_exists( endpoint->received_packets, sequence ) )
+    }
+    else
+    {
+        int i;
+        for ( i = 0; i < sequence_buffer->num_entries; ++i )
         {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] ignoring duplicate packet %d\n", endpoint->config.name, sequence );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_DUPLICATE]++;
-            return;
+            if ( cleanup_function )
+            {
+                cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * i, 
+                                  sequence_buffer->allocator_context, 
+                                  sequence_buffer->free_function );
+            }
+            sequence_buffer->entry_sequence[i] = 0xFFFFFFFF;
         }
+    }
+}
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] processing packet %d\n", endpoint->config.name, sequence );
-
-        if ( endpoint->config.process_packet_function( endpoint->config.context, 
-                                                       endpoint->config.id, 
-                                                       sequence, 
-                                                       packet_data + packet_header_bytes, 
-                                                       packet_bytes - packet_header_bytes ) )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] process packet %d successful\n", endpoint->config.name, sequence );
-
-            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
-                reliable_sequence_buffer_insert( endpoint->received_packets, sequence );
-
-            reliable_sequence_buffer_advance_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+RELIABLE_INTERNAL int reliable_sequence_buffer_test_insert( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    return reliable_sequence_less_than( sequence, sequence_buffer->sequence - ((uint16_t)sequence_buffer->num_entries) ) ? ((uint16_t)0) : ((uint16_t)1);
+}
 
-            reliable_assert( received_packet_data );
+RELIABLE_INTERNAL RELIABLE_HOT void * reliable_sequence_buffer_insert( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    reliable_assert( sequence_buffer );
+    if ( reliable_sequence_less_than( sequence, sequence_buffer->sequence - ((uint16_t)sequence_buffer->num_entries) ) )
+    {
+        return NULL;
+    }
+    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
+    {
+        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, NULL );
+        sequence_buffer->sequence = sequence + 1;
+    }
+    int index = reliable_sequence_buffer_index( sequence_buffer, sequence );
+    sequence_buffer->entry_sequence[index] = sequence;
+    return sequence_buffer->entry_data + index * sequence_buffer->entry_stride;
+}
 
-            received_packet_data->time = endpoint->time;
-            received_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
-
-            int i;
-            for ( i = 0; i < 32; ++i )
-            {
-                if ( ack_bits & 1 )
-                {                    
-                    uint16_t ack_sequence = ack - ((uint16_t)i);
-                    
-                    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                        reliable_sequence_buffer_find( endpoint->sent_packets, ack_sequence );
-
-                    if ( sent_packet_data && !sent_packet_data->acked )
-                    {
-                        if ( endpoint->num_acks < endpoint->config.ack_buffer_size )
-                        {
-                            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] acked packet %d\n", endpoint->config.name, ack_sequence );
-                            endpoint->acks[endpoint->num_acks++] = ack_sequence;
-                            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED]++;
-                            sent_packet_data->acked = 1;
-
-                            const float rtt = (float) ( endpoint->time - sent_packet_data->time ) * 1000.0f;
-
-                            reliable_assert( rtt >= 0.0 );
-
-                            int index = ack_sequence % endpoint->config.rtt_history_size;
-
-                            endpoint->rtt_history_buffer[index] = rtt;
+RELIABLE_INTERNAL void reliable_sequence_buffer_advance( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    reliable_assert( sequence_buffer );
+    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
+    {
+        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, NULL );
+        sequence_buffer->sequence = sequence + 1;
+    }
+}
 
-                            if ( ( endpoint->rtt == 0.0f && rtt > 0.0f ) || fabs( endpoint->rtt - rtt ) < 0.00001 )
-                            {
-                                endpoint->rtt = rtt;
-                            }
-                            else
-                            {
-                                endpoint->rtt += ( rtt - endpoint->rtt ) * endpoint->config.rtt_smoothing_factor;
-                            }
-                        }
-                        else
-                        {
-                            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ack buffer is full. dropped ack for packet %d. make sure you call reliable_endpoint_clear_acks\n",
-                                endpoint->config.name, ack_sequence );
-                        }
-                    }
-                }
-                ack_bits >>= 1;
-            }
-        }
-        else
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] process packet failed\n", endpoint->config.name );
-        }
+RELIABLE_INTERNAL void * reliable_sequence_buffer_insert_with_cleanup( struct reliable_sequence_buffer_t * sequence_buffer, 
+                                                     uint16_t sequence, 
+                                                     void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+{
+    reliable_assert( sequence_buffer );
+    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
+    {
+        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, cleanup_function );
+        sequence_buffer->sequence = sequence + 1;
     }
-    else
+    else if ( reliable_sequence_less_than( sequence, sequence_buffer->sequence - ((uint16_t)sequence_buffer->num_entries) ) )
     {
-        // fragment packet
-
-        int fragment_id;
-        int num_fragments;
-        int fragment_bytes;
-
-        uint16_t sequence;
-        uint16_t ack;
-        uint32_t ack_bits;
-
-        int fragment_header_bytes = reliable_read_fragment_header( endpoint->config.name, 
-                                                                   packet_data, 
-                                                                   packet_bytes, 
-                                                                   endpoint->config.max_fragments, 
-                                                                   endpoint->config.fragment_size,
-                                                                   &fragment_id, 
-                                                                   &num_fragments, 
-                                                                   &fragment_bytes, 
-                                                                   &sequence, 
-                                                                   &ack, 
-                                                                   &ack_bits );
-
-        if ( fragment_header_bytes < 0 )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] ignoring invalid fragment. could not read fragment header\n", endpoint->config.name );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
-            return;
-        }
-
-        if ( reliable_sequence_buffer_exists( endpoint->received_packets, sequence ) )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] ignoring fragment %d of packet %d. packet already received\n",
-                endpoint->config.name, fragment_id, sequence );
-            return;
-        }
-
-        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*)
-            reliable_sequence_buffer_find( endpoint->fragment_reassembly, sequence );
-
-        if ( !reassembly_data )
-        {
-            reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
-                reliable_sequence_buffer_insert_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
-
-            if ( !reassembly_data )
-            {
-                reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring invalid fragment. could not insert in reassembly buffer (stale)\n", endpoint->config.name );
-                endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
-                return;
-            }
+        return NULL;
+    }
+    int index = reliable_sequence_buffer_index( sequence_buffer, sequence );
+    if ( sequence_buffer->entry_sequence[index] != 0xFFFFFFFF )
+    {
+        cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * reliable_sequence_buffer_index( sequence_buffer, sequence ), 
+                          sequence_buffer->allocator_context, 
+                          sequence_buffer->free_function );
+    }
+    sequence_buffer->entry_sequence[index] = sequence;
+    return sequence_buffer->entry_data + index * sequence_buffer->entry_stride;
+}
 
-            reliable_sequence_buffer_advance( endpoint->received_packets, sequence );
+RELIABLE_INTERNAL void reliable_sequence_buffer_advance_with_cleanup( struct reliable_sequence_buffer_t * sequence_buffer,
+                                                    uint16_t sequence,
+                                                    void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+{
+    reliable_assert( sequence_buffer );
+    if ( reliable_sequence_greater_than( sequence + 1, sequence_buffer->sequence ) )
+    {
+        reliable_sequence_buffer_remove_entries( sequence_buffer, sequence_buffer->sequence, sequence, cleanup_function );
+        sequence_buffer->sequence = sequence + 1;
+    }
+}
 
-            size_t packet_buffer_size = (size_t) RELIABLE_MAX_PACKET_HEADER_BYTES + (size_t) num_fragments * (size_t) endpoint->config.fragment_size;
+RELIABLE_INTERNAL void reliable_sequence_buffer_remove( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    reliable_assert( sequence_buffer );
+    sequence_buffer->entry_sequence[ reliable_sequence_buffer_index( sequence_buffer, sequence ) ] = 0xFFFFFFFF;
+}
 
-            reassembly_data->sequence = sequence;
-            reassembly_data->ack = 0;
-            reassembly_data->ack_bits = 0;
-            reassembly_data->num_fragments_received = 0;
-            reassembly_data->num_fragments_total = num_fragments;
-            reassembly_data->packet_data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, packet_buffer_size );
-            reliable_assert( reassembly_data->packet_data );
-            reassembly_data->packet_bytes = 0;
-            reassembly_data->packet_header_bytes = 0;
-            memset( reassembly_data->fragment_received, 0, sizeof( reassembly_data->fragment_received ) );
-        }
+RELIABLE_INTERNAL void reliable_sequence_buffer_remove_with_cleanup( struct reliable_sequence_buffer_t * sequence_buffer, 
+                                                   uint16_t sequence, 
+                                                   void (*cleanup_function)(void*,void*,void(*free_function)(void*,void*)) )
+{
+    reliable_assert( sequence_buffer );
+    int index = reliable_sequence_buffer_index( sequence_buffer, sequence );
+    if ( sequence_buffer->entry_sequence[index] != 0xFFFFFFFF )
+    {
+        sequence_buffer->entry_sequence[index] = 0xFFFFFFFF;
+        cleanup_function( sequence_buffer->entry_data + sequence_buffer->entry_stride * index, sequence_buffer->allocator_context, sequence_buffer->free_function );
+    }
+}
 
-        if ( num_fragments != (int) reassembly_data->num_fragments_total )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring invalid fragment. fragment count mismatch. expected %d, got %d\n", 
-                endpoint->config.name, (int) reassembly_data->num_fragments_total, num_fragments );
-            endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID]++;
-            return;
-        }
+RELIABLE_INTERNAL int reliable_sequence_buffer_available( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    reliable_assert( sequence_buffer );
+    return sequence_buffer->entry_sequence[ reliable_sequence_buffer_index( sequence_buffer, sequence ) ] == 0xFFFFFFFF;
+}
 
-        if ( reassembly_data->fragment_received[fragment_id] )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_ERROR, "[%s] ignoring fragment %d of packet %d. fragment already received\n", 
-                endpoint->config.name, fragment_id, sequence );
-            return;
-        }
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_sequence_buffer_exists( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    reliable_assert( sequence_buffer );
+    return sequence_buffer->entry_sequence[ reliable_sequence_buffer_index( sequence_buffer, sequence ) ] == (uint32_t) sequence;
+}
 
-        reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] received fragment %d of packet %d (%d/%d)\n", 
-            endpoint->config.name, fragment_id, sequence, reassembly_data->num_fragments_received+1, num_fragments );
+RELIABLE_INTERNAL RELIABLE_HOT void * reliable_sequence_buffer_find( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence )
+{
+    reliable_assert( sequence_buffer );
+    int index = reliable_sequence_buffer_index( sequence_buffer, sequence );
+    return ( ( sequence_buffer->entry_sequence[index] == (uint32_t) sequence ) ) ? ( sequence_buffer->entry_data + index * sequence_buffer->entry_stride ) : NULL;
 
-        reassembly_data->num_fragments_received++;
-        reassembly_data->fragment_received[fragment_id] = 1;
+}
 
-        reliable_store_fragment_data( reassembly_data, 
-                                      sequence, 
-                                      ack, 
-                                      ack_bits, 
-                                      fragment_id, 
-                                      endpoint->config.fragment_size, 
-                                      packet_data + fragment_header_bytes, 
-                                      packet_bytes - fragment_header_bytes );
+RELIABLE_INTERNAL void * reliable_sequence_buffer_at_index( struct reliable_sequence_buffer_t * sequence_buffer, int index )
+{
+    reliable_assert( sequence_buffer );
+    reliable_assert( index >= 0 );
+    reliable_assert( index < sequence_buffer->num_entries );
+    return sequence_buffer->entry_sequence[index] != 0xFFFFFFFF ? ( sequence_buffer->entry_data + index * sequence_buffer->entry_stride ) : NULL;
+}
 
-        if ( reassembly_data->num_fragments_received == reassembly_data->num_fragments_total )
-        {
-            reliable_printf( RELIABLE_LOG_LEVEL_DEBUG, "[%s] completed reassembly of packet %d\n", endpoint->config.name, sequence );
+RELIABLE_INTERNAL RELIABLE_HOT void reliable_sequence_buffer_generate_ack_bits( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t * ack, uint32_t * ack_bits )
+{
+    reliable_assert( sequence_buffer );
+    reliable_assert( ack );
+    reliable_assert( ack_bits );
+    *ack = sequence_buffer->sequence - 1;
 
-            reliable_endpoint_receive_packet( endpoint, 
-                                              reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
-                                              reassembly_data->packet_header_bytes + reassembly_data->packet_bytes );
+    // with a mask index the 32 slots before ack are contiguous unless they wrap, so the simd kernel can take them in one go
 
-            reliable_sequence_buffer_remove_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
-        }
+    int index = reliable_sequence_buffer_index( sequence_buffer, *ack );
+    if ( sequence_buffer->index_mask != 0 && index >= 31 )
+    {
+        *ack_bits = reliable_simd->ack_bits( sequence_buffer->entry_sequence + index - 31, *ack );
+        return;
+    }
 
-        endpoint->counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED]++;
+    *ack_bits = 0;
+    uint32_t mask = 1;
+    int i;
+    for ( i = 0; i < 32; ++i )
+    {
+        uint16_t sequence = *ack - ((uint16_t)i);
+        if ( reliable_sequence_buffer_exists( sequence_buffer, sequence ) )
+            *ack_bits |= mask;
+        mask <<= 1;
     }
 }
 
-void reliable_endpoint_free_packet( struct reliable_endpoint_t * endpoint, void * packet )
+// ---------------------------------------------------------------
+
+RELIABLE_INTERNAL void reliable_write_uint8( uint8_t ** p, uint8_t value )
 {
-    reliable_assert( endpoint );
-    reliable_assert( packet );
-    endpoint->free_function( endpoint->allocator_context, packet );
+    **p = value;
+    ++(*p);
 }
 
-uint16_t * reliable_endpoint_get_acks( struct reliable_endpoint_t * endpoint, int * num_acks )
+RELIABLE_INTERNAL void reliable_write_uint16( uint8_t ** p, uint16_t value )
 {
-    reliable_assert( endpoint );
-    reliable_assert( num_acks );
-    *num_acks = endpoint->num_acks;
-    return endpoint->acks;
+    (*p)[0] = value & 0xFF;
+    (*p)[1] = value >> 8;
+    *p += 2;
 }
 
-void reliable_endpoint_clear_acks( struct reliable_endpoint_t * endpoint )
+RELIABLE_INTERNAL void reliable_write_uint32( uint8_t ** p, uint32_t value )
 {
-    reliable_assert( endpoint );
-    endpoint->num_acks = 0;
+    (*p)[0] = value & 0xFF;
+    (*p)[1] = ( value >> 8  ) & 0xFF;
+    (*p)[2] = ( value >> 16 ) & 0xFF;
+    (*p)[3] = value >> 24;
+    *p += 4;
 }
 
-void reliable_endpoint_reset( struct reliable_endpoint_t * endpoint )
+RELIABLE_INTERNAL void reliable_write_uint64( uint8_t ** p, uint64_t value )
 {
-    reliable_assert( endpoint );
+    (*p)[0] = value & 0xFF;
+    (*p)[1] = ( value >> 8  ) & 0xFF;
+    (*p)[2] = ( value >> 16 ) & 0xFF;
+    (*p)[3] = ( value >> 24 ) & 0xFF;
+    (*p)[4] = ( value >> 32 ) & 0xFF;
+    (*p)[5] = ( value >> 40 ) & 0xFF;
+    (*p)[6] = ( value >> 48 ) & 0xFF;
+    (*p)[7] = value >> 56;
+    *p += 8;
+}
 
-    endpoint->num_acks = 0;
-    endpoint->sequence = 0;
 
-    memset( endpoint->acks, 0, endpoint->config.ack_buffer_size * sizeof( uint16_t ) );
-    memset( endpoint->counters, 0, RELIABLE_ENDPOINT_NUM_COUNTERS * sizeof( uint64_t ) );
+RELIABLE_INTERNAL uint8_t reliable_read_uint8( uint8_t ** p )
+{
+    uint8_t value = **p;
+    ++(*p);
+    return value;
+}
 
-    int i;
-    for ( i = 0; i < endpoint->config.fragment_reassembly_buffer_size; ++i )
-    {
-        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
-            reliable_sequence_buffer_at_index( endpoint->fragment_reassembly, i );
+RELIABLE_INTERNAL uint16_t reliable_read_uint16( uint8_t ** p )
+{
+    uint16_t value;
+    value = (*p)[0];
+    value |= ( ( (uint16_t)( (*p)[1] ) ) << 8 );
+    *p += 2;
+    return value;
+}
 
-        if ( reassembly_data && reassembly_data->packet_data )
+RELIABLE_INTERNAL uint32_t reliable_read_uint32( uint8_t ** p )
+{
+    uint32_t value;
+    value  = (*p)[0];
+    value |= ( ( (uint32_t)( (*p)[1] ) ) << 8 );
+    value |= ( ( (uint32_t)( (*p)[2] ) ) << 16 );
+    value |= ( ( (uint32_t)( (*p)[3] ) ) << 24 );
+    *p += 4;
+    return value;
+}
+
+RELIABLE_INTERNAL uint64_t reliable_read_uint64( uint8_t ** p )
+{
+    uint64_t value;
+    value  = (*p)[0];
+    value |= ( ( (uint64_t)( (*p)[1] ) ) << 8  );
+    value |= ( ( (uint64_t)( (*p)[2] ) ) << 16 );
+    value |= ( ( (uint64_t)( (*p)[3] ) ) << 24 );
+    value |= ( ( (uint64_t)( (*p)[4] ) ) << 32 );
+    value |= ( ( (uint64_t)( (*p)[5] ) ) << 40 );
+    value |= ( ( (uint64_t)( (*p)[6] ) ) << 48 );
+    value |= ( ( (uint64_t)( (*p)[7] ) ) << 56 );
+    *p += 8;
+    return value;
+}
+
+
+// ---------------------------------------------------------------
+
+struct reliable_fragment_reassembly_data_t
+{
+#if RELIABLE_USDT
+    uint64_t endpoint_id;
+#endif // #if RELIABLE_USDT
+    uint16_t sequence;
+    uint16_t ack;
+    uint32_t ack_bits;
+    int num_fragments_received;
+    int num_fragments_total;
+    uint8_t * packet_data;
+    int packet_bytes;
+    int packet_header_bytes;
+    int fragment_size;
+    int last_fragment_bytes;
+    uint8_t fragment_received[256];
+};
+
+RELIABLE_INTERNAL void reliable_fragment_reassembly_data_cleanup( void * data, void * allocator_context, void (*free_function)(void*,void*) )
+
+{
+    reliable_assert( free_function );
+    struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) data;
+    if ( reassembly_data->packet_data )
+    {
+        // complete packets are removed after they are received. anything else cleaned up here is being evicted by newer packets
+
+#if RELIABLE_USDT
+        if ( reassembly_data->num_fragments_received < reassembly_data->num_fragments_total )
         {
-            endpoint->free_function( endpoint->allocator_context, reassembly_data->packet_data );
-            reassembly_data->packet_data = NULL;
+            reliable_trace( reassembly_evict, reassembly_data->endpoint_id, reassembly_data->sequence, reassembly_data->num_fragments_received, reassembly_data->num_fragments_total );
         }
+#endif // #if RELIABLE_USDT
+        free_function( allocator_context, reassembly_data->packet_data );
+        reassembly_data->packet_data = NULL;
     }
+}
 
-    reliable_sequence_buffer_reset( endpoint->sent_packets );
-    reliable_sequence_buffer_reset( endpoint->received_packets );
-    reliable_sequence_buffer_reset( endpoint->fragment_reassembly );
+// ---------------------------------------------------------------
+
+// bounded multi-producer, single-consumer queue of packets waiting to be sent (dmitry vyukov's design).
+// each entry has its own sequence number, so producers only contend on the enqueue index and never take a lock
+
+struct reliable_send_queue_entry_t
+{
+    volatile uint32_t sequence;
+    int packet_bytes;
+    uint8_t * packet_data;
+};
+
+struct reliable_send_queue_t
+{
+    uint8_t padding_0[RELIABLE_CACHE_LINE_BYTES];
+    volatile uint32_t enqueue_index;
+    uint8_t padding_1[RELIABLE_CACHE_LINE_BYTES - sizeof(uint32_t)];
+    uint32_t dequeue_index;
+    uint8_t padding_2[RELIABLE_CACHE_LINE_BYTES - sizeof(uint32_t)];
+    uint32_t mask;
+    struct reliable_send_queue_entry_t * entries;
+};
+
+RELIABLE_INTERNAL struct reliable_send_queue_t * reliable_send_queue_create( int num_entries, void * allocator_context, void * (*allocate_function)(void*,size_t) )
+{
+    reliable_assert( num_entries > 0 );
+    reliable_assert( ( num_entries & ( num_entries - 1 ) ) == 0 );
+    reliable_assert( allocate_function );
+
+    struct reliable_send_queue_t * queue = (struct reliable_send_queue_t*) 
+        allocate_function( allocator_context, sizeof( struct reliable_send_queue_t ) + num_entries * sizeof( struct reliable_send_queue_entry_t ) );
+
+    reliable_assert( queue );
+
+    memset( queue, 0, sizeof( struct reliable_send_queue_t ) );
+
+    queue->mask = (uint32_t) num_entries - 1;
+    queue->entries = (struct reliable_send_queue_entry_t*) ( queue + 1 );
+
+    int i;
+    for ( i = 0; i < num_entries; ++i )
+    {
+        queue->entries[i].sequence = (uint32_t) i;
+        queue->entries[i].packet_bytes = 0;
+        queue->entries[i].packet_data = NULL;
+    }
+
+    return queue;
 }
 
-void reliable_endpoint_update( struct reliable_endpoint_t * endpoint, double time )
+RELIABLE_INTERNAL int reliable_send_queue_push( struct reliable_send_queue_t * queue, uint8_t * packet_data, int packet_bytes )
 {
-    reliable_assert( endpoint );
+    reliable_assert( queue );
 
-    endpoint->time = time;
+    uint32_t index = reliable_atomic_load_relaxed_uint32( &queue->enqueue_index );
 
-    // calculate min and max rtt
+    while ( 1 )
     {
-        float min_rtt = 10000.0f;
-        float max_rtt = 0.0f;
-        float sum_rtt = 0.0f;
-        int count = 0;
-        for ( int i = 0; i < endpoint->config.rtt_history_size; i++ )
+        struct reliable_send_queue_entry_t * entry = queue->entries + ( index & queue->mask );
+
+        uint32_t sequence = reliable_atomic_load_acquire_uint32( &entry->sequence );
+
+        int32_t difference = (int32_t) ( sequence - index );
+
+        if ( difference == 0 )
         {
-            const float rtt = endpoint->rtt_history_buffer[i];
-            if ( rtt >= 0.0f )
+            if ( reliable_atomic_compare_exchange_uint32( &queue->enqueue_index, index, index + 1 ) )
             {
-                if ( rtt < min_rtt )
-                {
-                    min_rtt = rtt;
-                }
-                if ( rtt > max_rtt )
-                {
-                    max_rtt = rtt;
-                }
-                sum_rtt += rtt;
-                count++;
+                entry->packet_data = packet_data;
+                entry->packet_bytes = packet_bytes;
+                reliable_atomic_store_release_uint32( &entry->sequence, index + 1 );
+                return RELIABLE_OK;
             }
         }
-        if ( min_rtt == 10000.0f )
-        {
-            min_rtt = 0.0f;
-        }
-        endpoint->rtt_min = min_rtt;
-        endpoint->rtt_max = max_rtt;
-        if ( count > 0 )
-        {
-            endpoint->rtt_avg = sum_rtt / (float)count;
-        }
-        else
+        else if ( difference < 0 )
         {
-            endpoint->rtt_avg = 0.0f;
+            // full
+            return RELIABLE_ERROR;
         }
+
+        index = reliable_atomic_load_relaxed_uint32( &queue->enqueue_index );
     }
+}
+
+RELIABLE_INTERNAL uint8_t * reliable_send_queue_pop( struct reliable_send_queue_t * queue, int * packet_bytes )
+{
+    reliable_assert( queue );
+    reliable_assert( packet_bytes );
 
-    // calculate average jitter vs. min rtt
+    struct reliable_send_queue_entry_t * entry = queue->entries + ( queue->dequeue_index & queue->mask );
+
+    if ( reliable_atomic_load_acquire_uint32( &entry->sequence ) != queue->dequeue_index + 1 )
     {
-        float sum = 0.0f;
-        int count = 0;
-        for ( int i = 0; i < endpoint->config.rtt_history_size; i++ )
-        {
-            if ( endpoint->rtt_history_buffer[i] >= 0.0f )
-            {
-                sum += ( endpoint->rtt_history_buffer[i] - endpoint->rtt_min );
-                count++;
-            }
-        }
-        if ( count > 0 )
-        {
-            endpoint->jitter_avg_vs_min_rtt = sum / (float)count;
-        }
-        else
-        {
-            endpoint->jitter_avg_vs_min_rtt = 0.0f;
-        }
+        return NULL;
     }
 
-    // calculate max jitter vs. min rtt
+    uint8_t * packet_data = entry->packet_data;
+
+    *packet_bytes = entry->packet_bytes;
+
+    reliable_atomic_store_release_uint32( &entry->sequence, queue->dequeue_index + queue->mask + 1 );
+
+    queue->dequeue_index++;
+
+    return packet_data;
+}
+
+// ---------------------------------------------------------------
+
+// log-linear histogram in the style of hdr histogram. values are microseconds. below 32 every value has its own bucket,
+// above that each power of two is split into 16 linear buckets, so a bucket is never wider than 1/16 of its lower bound.
+// anything past the top bucket (about 16.7 seconds) lands in it
+
+#define RELIABLE_HISTOGRAM_SUB_BUCKET_BITS  4
+#define RELIABLE_HISTOGRAM_SUB_BUCKETS      ( 1 << RELIABLE_HISTOGRAM_SUB_BUCKET_BITS )
+#define RELIABLE_HISTOGRAM_MAX_VALUE        ( ( 1U << 24 ) - 1 )
+
+static int reliable_histogram_msb( uint32_t value )
+{
+    reliable_assert( value != 0 );
+#if defined( __GNUC__ )
+    return 31 - __builtin_clz( value );
+#else // #if defined( __GNUC__ )
+    int msb = 0;
+    while ( value >>= 1 )
     {
-        float max = 0.0f;
-        for ( int i = 0; i < endpoint->config.rtt_history_size; i++ )
-        {
-            if ( endpoint->rtt_history_buffer[i] >= 0.0f )
-            {
-                float difference = ( endpoint->rtt_history_buffer[i] - endpoint->rtt_min );
-                if ( difference > max )
-                {
-                    max = difference;
-                }
-            }
-        }
-        endpoint->jitter_max_vs_min_rtt = max;
+        msb++;
     }
+    return msb;
+#endif // #if defined( __GNUC__ )
+}
 
-    // calculate stddev jitter vs. avg rtt
+static int reliable_histogram_bucket( uint32_t value )
+{
+    if ( value > RELIABLE_HISTOGRAM_MAX_VALUE )
     {
-        float sum = 0.0f;
-        int count = 0;
-        for ( int i = 0; i < endpoint->config.rtt_history_size; i++ )
-        {
-            if ( endpoint->rtt_history_buffer[i] >= 0.0f )
-            {
-                float deviation = ( endpoint->rtt_history_buffer[i] - endpoint->rtt_avg );
-                sum += deviation * deviation;
-                count++;
-            }
-        }
-        if ( count > 0 )
-        {
-            endpoint->jitter_stddev_vs_avg_rtt = (float) pow( sum / (float)count, 0.5f );
-        }
-        else
-        {
-            endpoint->jitter_stddev_vs_avg_rtt = 0.0f;
-        }
+        value = RELIABLE_HISTOGRAM_MAX_VALUE;
     }
 
-    // calculate packet loss
+    if ( value < 2 * RELIABLE_HISTOGRAM_SUB_BUCKETS )
     {
-        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int num_sent = 0;
-        int num_dropped = 0;
-        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
-        {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
-            if ( sent_packet_data )
-            {
-                num_sent++;
-                if ( !sent_packet_data->acked )
-                {
-                    num_dropped++;
-                }
-            }
-        }
-        if ( num_sent > 0 )
-        {
-            float packet_loss = ( (float) num_dropped ) / ( (float) num_sent ) * 100.0f;
-            if ( fabs( endpoint->packet_loss - packet_loss ) > 0.00001 )
-            {
-                endpoint->packet_loss += ( packet_loss - endpoint->packet_loss ) * endpoint->config.packet_loss_smoothing_factor;
-            }
-            else
-            {
-                endpoint->packet_loss = packet_loss;
-            }
-        }
-        else
-        {
-            endpoint->packet_loss = 0.0f;
-        }
+        return (int) value;
     }
 
-    // calculate sent bandwidth
+    int msb = reliable_histogram_msb( value );
+    int shift = msb - RELIABLE_HISTOGRAM_SUB_BUCKET_BITS;
+    return ( shift * RELIABLE_HISTOGRAM_SUB_BUCKETS ) + (int) ( value >> shift );
+}
+
+static void reliable_histogram_bucket_range( int bucket, uint32_t * lower, uint32_t * width )
+{
+    if ( bucket < 2 * RELIABLE_HISTOGRAM_SUB_BUCKETS )
     {
-        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int bytes_sent = 0;
-        double start_time = FLT_MAX;
-        double finish_time = 0.0;
-        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
-        {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
-            if ( !sent_packet_data )
-            {
-                continue;
-            }
-            bytes_sent += sent_packet_data->packet_bytes;
-            if ( sent_packet_data->time < start_time )
-            {
-                start_time = sent_packet_data->time;
-            }
-            if ( sent_packet_data->time > finish_time )
-            {
-                finish_time = sent_packet_data->time;
-            }
-        }
-        if ( start_time != FLT_MAX && finish_time > start_time )
-        {
-            float sent_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
-            if ( fabs( endpoint->sent_bandwidth_kbps - sent_bandwidth_kbps ) > 0.00001 )
-            {
-                endpoint->sent_bandwidth_kbps += ( sent_bandwidth_kbps - endpoint->sent_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
-            }
-            else
-            {
-                endpoint->sent_bandwidth_kbps = sent_bandwidth_kbps;
-            }
-        }
+        *lower = (uint32_t) bucket;
+        *width = 1;
+        return;
     }
 
-    // calculate received bandwidth
+    int shift = bucket / RELIABLE_HISTOGRAM_SUB_BUCKETS - 1;
+    uint32_t sub_bucket = (uint32_t) ( bucket % RELIABLE_HISTOGRAM_SUB_BUCKETS + RELIABLE_HISTOGRAM_SUB_BUCKETS );
+    *lower = sub_bucket << shift;
+    *width = 1U << shift;
+}
+
+void reliable_histogram_reset( struct reliable_histogram_t * histogram )
+{
+    reliable_assert( histogram );
+    memset( histogram, 0, sizeof( struct reliable_histogram_t ) );
+}
+
+static int reliable_histogram_bucket_milliseconds( float milliseconds )
+{
+    reliable_assert( milliseconds >= 0.0f );
+
+    float microseconds = milliseconds * 1000.0f + 0.5f;
+
+    return reliable_histogram_bucket( microseconds < (float) RELIABLE_HISTOGRAM_MAX_VALUE ? (uint32_t) microseconds : RELIABLE_HISTOGRAM_MAX_VALUE );
+}
+
+void reliable_histogram_add( struct reliable_histogram_t * histogram, float milliseconds )
+{
+    reliable_assert( histogram );
+
+    histogram->buckets[reliable_histogram_bucket_milliseconds( milliseconds )]++;
+    histogram->count++;
+}
+
+void reliable_histogram_merge( struct reliable_histogram_t * histogram, RELIABLE_CONST struct reliable_histogram_t * other )
+{
+    reliable_assert( histogram );
+    reliable_assert( other );
+
+    int i;
+    for ( i = 0; i < RELIABLE_HISTOGRAM_NUM_BUCKETS; ++i )
     {
-        uint32_t base_sequence = ( endpoint->received_packets->sequence - endpoint->config.received_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int bytes_sent = 0;
-        double start_time = FLT_MAX;
-        double finish_time = 0.0;
-        int num_samples = endpoint->config.received_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
-        {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->received_packets, sequence );
-            if ( !received_packet_data )
-            {
-                continue;
-            }
-            bytes_sent += received_packet_data->packet_bytes;
-            if ( received_packet_data->time < start_time )
-            {
-                start_time = received_packet_data->time;
-            }
-            if ( received_packet_data->time > finish_time )
-            {
-                finish_time = received_packet_data->time;
-            }
-        }
-        if ( start_time != FLT_MAX && finish_time > start_time )
-        {
-            float received_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
-            if ( fabs( endpoint->received_bandwidth_kbps - received_bandwidth_kbps ) > 0.00001 )
-            {
-                endpoint->received_bandwidth_kbps += ( received_bandwidth_kbps - endpoint->received_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
-            }
-            else
-            {
-                endpoint->received_bandwidth_kbps = received_bandwidth_kbps;
-            }
-        }
+        histogram->buckets[i] += other->buckets[i];
     }
+    histogram->count += other->count;
+}
+
+float reliable_histogram_percentile( RELIABLE_CONST struct reliable_histogram_t * histogram, float percentile )
+{
+    reliable_assert( histogram );
+    reliable_assert( percentile >= 0.0f );
+    reliable_assert( percentile <= 100.0f );
+
+    if ( histogram->count == 0 )
+        return 0.0f;
 
-    // calculate acked bandwidth
+    // the smallest value with at least percentile% of the samples at or below it
+
+    double exact = (double) percentile / 100.0 * (double) histogram->count;
+    uint64_t target = (uint64_t) exact;
+    if ( (double) target < exact )
     {
-        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
-        int i;
-        int bytes_sent = 0;
-        double start_time = FLT_MAX;
-        double finish_time = 0.0;
-        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
-        for ( i = 0; i < num_samples; ++i )
+        target++;
+    }
+    if ( target == 0 )
+    {
+        target = 1;
+    }
+
+    uint64_t total = 0;
+    int i;
+    for ( i = 0; i < RELIABLE_HISTOGRAM_NUM_BUCKETS; ++i )
+    {
+        total += histogram->buckets[i];
+        if ( total >= target )
+            break;
+    }
+
+    reliable_assert( i < RELIABLE_HISTOGRAM_NUM_BUCKETS );
+
+    // the middle of the bucket, so the error is at most half a bucket either way
+
+    uint32_t lower, width;
+    reliable_histogram_bucket_range( i, &lower, &width );
+    double microseconds = (double) lower + ( (double) width - 1.0 ) * 0.5;
+    return (float) ( microseconds / 1000.0 );
+}
+
+// ---------------------------------------------------------------
+
+// each shard of a stats aggregator is only written by the thread that owns its endpoints, with relaxed atomic stores
+// like RELIABLE_ATOMIC_COUNTERS, so reading the totals from another thread is race free and never slows the writers down.
+// shards are padded so two threads never write the same cache line
+
+struct reliable_stats_shard_t
+{
+    uint64_t num_endpoints;
+    uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t bytes_acked;
+    struct reliable_histogram_t rtt_histogram;
+    uint64_t packet_loss[RELIABLE_STATS_PACKET_LOSS_BUCKETS];
+    uint8_t padding[RELIABLE_CACHE_LINE_BYTES];
+};
+
+struct reliable_stats_aggregator_t
+{
+    void * allocator_context;
+    void (*free_function)(void*,void*);
+    int num_shards;
+    struct reliable_stats_shard_t * shards;
+};
+
+static void reliable_stats_add( uint64_t * value, uint64_t amount )
+{
+    reliable_atomic_store_relaxed_uint64( value, *value + amount );
+}
+
+static void reliable_stats_subtract( uint64_t * value, uint64_t amount )
+{
+    reliable_assert( *value >= amount );
+    reliable_atomic_store_relaxed_uint64( value, *value - amount );
+}
+
+static int reliable_stats_packet_loss_bucket( float packet_loss )
+{
+    int bucket = (int) packet_loss;
+    if ( bucket < 0 )
+    {
+        bucket = 0;
+    }
+    if ( bucket > RELIABLE_STATS_PACKET_LOSS_BUCKETS - 1 )
+    {
+        bucket = RELIABLE_STATS_PACKET_LOSS_BUCKETS - 1;
+    }
+    return bucket;
+}
+
+struct reliable_stats_aggregator_t * reliable_stats_aggregator_create( int num_shards, 
+                                                                       void * allocator_context, 
+                                                                       void * (*allocate_function)(void*,size_t), 
+                                                                       void (*free_function)(void*,void*) )
+{
+    reliable_assert( num_shards > 0 );
+
+    if ( allocate_function == NULL )
+    {
+        allocate_function = reliable_default_allocate_function;
+    }
+
+    if ( free_function == NULL )
+    {
+        free_function = reliable_default_free_function;
+    }
+
+    struct reliable_stats_aggregator_t * aggregator = (struct reliable_stats_aggregator_t*) 
+        allocate_function( allocator_context, sizeof( struct reliable_stats_aggregator_t ) );
+    if ( !aggregator )
+        return NULL;
+
+    aggregator->allocator_context = allocator_context;
+    aggregator->free_function = free_function;
+    aggregator->num_shards = num_shards;
+    aggregator->shards = (struct reliable_stats_shard_t*) allocate_function( allocator_context, num_shards * sizeof( struct reliable_stats_shard_t ) );
+    if ( !aggregator->shards )
+    {
+        free_function( allocator_context, aggregator );
+        return NULL;
+    }
+
+    memset( aggregator->shards, 0, num_shards * sizeof( struct reliable_stats_shard_t ) );
+
+    return aggregator;
+}
+
+void reliable_stats_aggregator_destroy( struct reliable_stats_aggregator_t * aggregator )
+{
+    reliable_assert( aggregator );
+
+    int i;
+    for ( i = 0; i < aggregator->num_shards; ++i )
+    {
+        reliable_assert( aggregator->shards[i].num_endpoints == 0 );
+    }
+
+    aggregator->free_function( aggregator->allocator_context, aggregator->shards );
+    aggregator->free_function( aggregator->allocator_context, aggregator );
+}
+
+void reliable_stats_aggregator_read( struct reliable_stats_aggregator_t * aggregator, struct reliable_stats_t * stats )
+{
+    reliable_assert( aggregator );
+    reliable_assert( stats );
+
+    memset( stats, 0, sizeof( struct reliable_stats_t ) );
+
+    int i, j;
+    for ( i = 0; i < aggregator->num_shards; ++i )
+    {
+        struct reliable_stats_shard_t * shard = aggregator->shards + i;
+
+        stats->num_endpoints += reliable_atomic_load_relaxed_uint64( &shard->num_endpoints );
+
+        for ( j = 0; j < RELIABLE_ENDPOINT_NUM_COUNTERS; ++j )
         {
-            uint16_t sequence = (uint16_t) ( base_sequence + i );
-            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
-                reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
-            if ( !sent_packet_data || !sent_packet_data->acked )
-            {
-                continue;
-            }
-            bytes_sent += sent_packet_data->packet_bytes;
-            if ( sent_packet_data->time < start_time )
-            {
-                start_time = sent_packet_data->time;
-            }
-            if ( sent_packet_data->time > finish_time )
-            {
-                finish_time = sent_packet_data->time;
-            }
+            stats->counters[j] += reliable_atomic_load_relaxed_uint64( shard->counters + j );
         }
-        if ( start_time != FLT_MAX && finish_time > start_time )
+
+        stats->bytes_sent += reliable_atomic_load_relaxed_uint64( &shard->bytes_sent );
+        stats->bytes_received += reliable_atomic_load_relaxed_uint64( &shard->bytes_received );
+        stats->bytes_acked += reliable_atomic_load_relaxed_uint64( &shard->bytes_acked );
+
+        stats->rtt_histogram.count += reliable_atomic_load_relaxed_uint64( &shard->rtt_histogram.count );
+        for ( j = 0; j < RELIABLE_HISTOGRAM_NUM_BUCKETS; ++j )
         {
-            float acked_bandwidth_kbps = (float) ( ( (double) bytes_sent ) / ( finish_time - start_time ) * 8.0f / 1000.0f );
-            if ( fabs( endpoint->acked_bandwidth_kbps - acked_bandwidth_kbps ) > 0.00001 )
-            {
-                endpoint->acked_bandwidth_kbps += ( acked_bandwidth_kbps - endpoint->acked_bandwidth_kbps ) * endpoint->config.bandwidth_smoothing_factor;
-            }
-            else
+            stats->rtt_histogram.buckets[j] += reliable_atomic_load_relaxed_uint64( shard->rtt_histogram.buckets + j );
+        }
+
+        for ( j = 0; j < RELIABLE_STATS_PACKET_LOSS_BUCKETS; ++j )
+        {
+            stats->packet_loss[j] += reliable_atomic_load_relaxed_uint64( shard->packet_loss + j );
+        }
+    }
+}
+
+// ---------------------------------------------------------------
+
+// bandwidth is measured over a fixed window of wall clock time, split into buckets so each packet is O(1) to account for.
+// the window slides a whole bucket at a time, and the rate divides by exactly the time the live buckets cover
+
+struct reliable_bandwidth_bucket_t
+{
+    uint32_t sent_bytes;
+    uint32_t received_bytes;
+    uint32_t acked_bytes;
+};
+
+struct reliable_bandwidth_window_t
+{
+    int num_buckets;
+    uint64_t newest_bucket;
+    double start_time;
+    uint64_t sent_bytes;
+    uint64_t received_bytes;
+    uint64_t acked_bytes;
+    struct reliable_bandwidth_bucket_t * buckets;
+};
+
+static void reliable_bandwidth_window_reset( struct reliable_bandwidth_window_t * window, double time )
+{
+    reliable_assert( window );
+    reliable_assert( time >= 0.0 );
+
+    window->newest_bucket = (uint64_t) ( time / RELIABLE_BANDWIDTH_BUCKET_TIME );
+    window->start_time = time;
+    window->sent_bytes = 0;
+    window->received_bytes = 0;
+    window->acked_bytes = 0;
+
+    memset( window->buckets, 0, window->num_buckets * sizeof( struct reliable_bandwidth_bucket_t ) );
+}
+
+// slides the window forward to the bucket containing time, dropping whatever falls off the back.
+// time going backwards is ignored, and bytes go into the newest bucket
+
+static struct reliable_bandwidth_bucket_t * reliable_bandwidth_window_advance( struct reliable_bandwidth_window_t * window, double time )
+{
+    uint64_t bucket = (uint64_t) ( time / RELIABLE_BANDWIDTH_BUCKET_TIME );
+
+    if ( bucket > window->newest_bucket )
+    {
+        uint64_t num_expired = bucket - window->newest_bucket;
+        if ( num_expired >= (uint64_t) window->num_buckets )
+        {
+            window->sent_bytes = 0;
+            window->received_bytes = 0;
+            window->acked_bytes = 0;
+            memset( window->buckets, 0, window->num_buckets * sizeof( struct reliable_bandwidth_bucket_t ) );
+        }
+        else
+        {
+            uint64_t i;
+            for ( i = 1; i <= num_expired; ++i )
             {
-                endpoint->acked_bandwidth_kbps = acked_bandwidth_kbps;
+                struct reliable_bandwidth_bucket_t * expired = window->buckets + ( window->newest_bucket + i ) % window->num_buckets;
+                window->sent_bytes -= expired->sent_bytes;
+                window->received_bytes -= expired->received_bytes;
+                window->acked_bytes -= expired->acked_bytes;
+                memset( expired, 0, sizeof( struct reliable_bandwidth_bucket_t ) );
             }
         }
+        window->newest_bucket = bucket;
+    }
+
+    return window->buckets + window->newest_bucket % window->num_buckets;
+}
+
+static void reliable_bandwidth_window_sent( struct reliable_bandwidth_window_t * window, double time, int bytes )
+{
+    reliable_bandwidth_window_advance( window, time )->sent_bytes += bytes;
+    window->sent_bytes += bytes;
+}
+
+static void reliable_bandwidth_window_received( struct reliable_bandwidth_window_t * window, double time, int bytes )
+{
+    reliable_bandwidth_window_advance( window, time )->received_bytes += bytes;
+    window->received_bytes += bytes;
+}
+
+static void reliable_bandwidth_window_acked( struct reliable_bandwidth_window_t * window, double time, int bytes )
+{
+    reliable_bandwidth_window_advance( window, time )->acked_bytes += bytes;
+    window->acked_bytes += bytes;
+}
+
+static float reliable_bandwidth_window_kbps( uint64_t bytes, double duration )
+{
+    return (float) ( ( (double) bytes ) / duration * 8.0 / 1000.0 );
+}
+
+// ---------------------------------------------------------------
+
+// mtu probes are regular packets with bit 6 of the prefix byte set, padded out to the size being probed.
+// the receiver acks them like any other packet but never passes them to the process packet callback
+
+#define RELIABLE_PROBE_PACKET_FLAG                  (1<<6)
+
+#define RELIABLE_MTU_PROBE_MAX_ATTEMPTS             3
+#define RELIABLE_MTU_PROBE_MIN_TIMEOUT              0.25
+#define RELIABLE_MTU_SEARCH_GRANULARITY             16
+#define RELIABLE_MTU_RAISE_INTERVAL                 30.0
+
+// the snapshot is published as 32 bit words so that readers can copy it with plain relaxed atomic loads
+
+#define RELIABLE_ENDPOINT_SNAPSHOT_WORDS ( ( sizeof( struct reliable_endpoint_snapshot_t ) + 3 ) / 4 )
+
+struct reliable_endpoint_t
+{
+    void * allocator_context;
+    void * (*allocate_function)(void*,size_t);
+    void (*free_function)(void*,void*);
+    struct reliable_config_t config;
+    double time;
+    float rtt;
+    float rtt_min;
+    float rtt_max;
+    float rtt_avg;
+    float jitter_avg_vs_min_rtt;
+    float jitter_max_vs_min_rtt;
+    float jitter_stddev_vs_avg_rtt;
+    float packet_loss;
+    float sent_bandwidth_kbps;
+    float received_bandwidth_kbps;
+    float acked_bandwidth_kbps;
+    int num_acks;
+    uint16_t * acks;
+    uint16_t sequence;
+    float * rtt_history_buffer;
+    uint8_t * transmit_buffer;
+    struct reliable_sequence_buffer_t * sent_packets;
+    struct reliable_sequence_buffer_t * received_packets;
+    struct reliable_sequence_buffer_t * fragment_reassembly;
+    int fragment_above;
+    int fragment_size;
+    int mtu;
+    int mtu_floor;
+    int mtu_ceiling;
+    int mtu_search_high;
+    int mtu_probe_bytes;
+    int mtu_probe_in_flight;
+    int mtu_probe_attempts;
+    uint16_t mtu_probe_sequence;
+    double mtu_probe_time;
+    double mtu_next_probe_time;
+    struct reliable_send_queue_t * send_queue;
+    struct reliable_bandwidth_window_t bandwidth_window;
+    float rtt_last;
+    struct reliable_histogram_t rtt_histogram;
+    struct reliable_histogram_t jitter_histogram;
+    struct reliable_stats_shard_t * stats_shard;
+    int stats_packet_loss_bucket;
+#if RELIABLE_ATOMIC_COUNTERS
+    uint8_t counters_padding_0[RELIABLE_CACHE_LINE_BYTES];
+#endif // #if RELIABLE_ATOMIC_COUNTERS
+    uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];
+#if RELIABLE_PROFILE
+    struct reliable_profile_phase_t profile[RELIABLE_PROFILE_NUM_PHASES];
+#endif // #if RELIABLE_PROFILE
+    uint8_t snapshot_padding_0[RELIABLE_CACHE_LINE_BYTES];
+    volatile uint32_t snapshot_sequence;
+    volatile uint32_t snapshot_data[RELIABLE_ENDPOINT_SNAPSHOT_WORDS];
+    uint8_t snapshot_padding_1[RELIABLE_CACHE_LINE_BYTES];
+};
+
+// the counters are only ever written by the thread that owns the endpoint, so with RELIABLE_ATOMIC_COUNTERS a relaxed load and store
+// is enough for other threads to read them without a data race. no read-modify-write, so no lock prefix on the packet path
+
+static void reliable_endpoint_increment_counter( struct reliable_endpoint_t * endpoint, int counter )
+{
+#if RELIABLE_ATOMIC_COUNTERS
+    reliable_atomic_store_relaxed_uint64( endpoint->counters + counter, endpoint->counters[counter] + 1 );
+#else // #if RELIABLE_ATOMIC_COUNTERS
+    endpoint->counters[counter]++;
+#endif // #if RELIABLE_ATOMIC_COUNTERS
+
+    if ( endpoint->stats_shard )
+    {
+        reliable_stats_add( endpoint->stats_shard->counters + counter, 1 );
+    }
+}
+
+static void reliable_endpoint_leave_stats( struct reliable_endpoint_t * endpoint )
+{
+    if ( !endpoint->stats_shard )
+        return;
+
+    reliable_stats_subtract( &endpoint->stats_shard->num_endpoints, 1 );
+    reliable_stats_subtract( endpoint->stats_shard->packet_loss + endpoint->stats_packet_loss_bucket, 1 );
+
+    endpoint->stats_shard = NULL;
+}
+
+// every log message about an endpoint goes through here. in binary mode that is all that happens on the calling thread
+
+static RELIABLE_COLD void reliable_endpoint_log_event( struct reliable_endpoint_t * endpoint, int level, int event, uint16_t sequence, int a, int b, int c )
+{
+#if RELIABLE_ENABLE_LOGGING
+    if ( reliable_runtime_log_mode == RELIABLE_LOG_MODE_BINARY )
+    {
+        reliable_log_write( level, event, endpoint->config.id, endpoint->time, sequence, a, b, c );
+        return;
+    }
+
+    int32_t args[3] = { a, b, c };
+    char buffer[1024];
+    reliable_log_format_event( event, sequence, args, buffer, sizeof( buffer ) );
+    reliable_printf_function( "[%s] %s\n", endpoint->config.name, buffer );
+#else // #if RELIABLE_ENABLE_LOGGING
+    (void) endpoint;
+    (void) level;
+    (void) event;
+    (void) sequence;
+    (void) a;
+    (void) b;
+    (void) c;
+#endif // #if RELIABLE_ENABLE_LOGGING
+}
+
+#define reliable_endpoint_log( endpoint, level, event, sequence, a, b, c )                                  \
+do                                                                                                          \
+{                                                                                                           \
+    if ( RELIABLE_ENABLE_LOGGING && (level) <= RELIABLE_COMPILE_TIME_LOG_LEVEL &&                           \
+         RELIABLE_UNLIKELY( (level) <= reliable_runtime_log_level ) )                                       \
+    {                                                                                                       \
+        reliable_endpoint_log_event( (endpoint), (level), (event), (sequence), (a), (b), (c) );             \
+    }                                                                                                       \
+} while(0)
+
+// the profile clock is the cpu timestamp counter where there is one, so reading it costs a few cycles and doesn't
+// enter the kernel. elsewhere it falls back to a monotonic clock in nanoseconds
+
+#if RELIABLE_PROFILE
+
+static uint64_t reliable_profile_cycles()
+{
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+    return __rdtsc();
+#elif defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#elif defined( __aarch64__ )
+    uint64_t value;
+    __asm__ volatile( "mrs %0, cntvct_el0" : "=r" ( value ) );
+    return value;
+#elif defined( CLOCK_MONOTONIC )
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#else
+    return (uint64_t) clock();
+#endif
+}
+
+// phases are timed back to back: each one ends where the previous one did, so marking a phase is one clock read
+
+static void reliable_endpoint_profile_phase( struct reliable_endpoint_t * endpoint, int phase, uint64_t * start )
+{
+    uint64_t now = reliable_profile_cycles();
+    uint64_t cycles = now - *start;
+    struct reliable_profile_phase_t * profile = endpoint->profile + phase;
+    profile->count++;
+    profile->total_cycles += cycles;
+    if ( cycles > profile->max_cycles )
+    {
+        profile->max_cycles = cycles;
     }
+    *start = now;
 }
 
-float reliable_endpoint_rtt( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->rtt;
-}
+#define reliable_profile_start( start ) uint64_t start = reliable_profile_cycles()
+#define reliable_profile_phase( endpoint, phase, start ) reliable_endpoint_profile_phase( (endpoint), (phase), &(start) )
+
+#else // #if RELIABLE_PROFILE
+
+#define reliable_profile_start( start ) do {} while(0)
+#define reliable_profile_phase( endpoint, phase, start ) do {} while(0)
+
+#endif // #if RELIABLE_PROFILE
+
+// seqlock writer. the sequence is odd while the snapshot is being written, and readers retry if they see it odd or see it change.
+// only the owning thread writes, so this never waits on readers
+
+static void reliable_endpoint_publish_snapshot( struct reliable_endpoint_t * endpoint )
+{
+    struct reliable_endpoint_snapshot_t snapshot;
+    memset( &snapshot, 0, sizeof( snapshot ) );
+    memcpy( snapshot.counters, endpoint->counters, sizeof( snapshot.counters ) );
+    snapshot.time = endpoint->time;
+    snapshot.rtt = endpoint->rtt;
+    snapshot.rtt_min = endpoint->rtt_min;
+    snapshot.rtt_max = endpoint->rtt_max;
+    snapshot.rtt_avg = endpoint->rtt_avg;
+    snapshot.jitter_avg_vs_min_rtt = endpoint->jitter_avg_vs_min_rtt;
+    snapshot.jitter_max_vs_min_rtt = endpoint->jitter_max_vs_min_rtt;
+    snapshot.jitter_stddev_vs_avg_rtt = endpoint->jitter_stddev_vs_avg_rtt;
+    snapshot.packet_loss = endpoint->packet_loss;
+    snapshot.sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
+    snapshot.received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
+    snapshot.acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+    snapshot.mtu = endpoint->mtu;
+
+    uint32_t words[RELIABLE_ENDPOINT_SNAPSHOT_WORDS];
+    memset( words, 0, sizeof( words ) );
+    memcpy( words, &snapshot, sizeof( snapshot ) );
+
+    uint32_t sequence = endpoint->snapshot_sequence;
+
+    reliable_atomic_store_relaxed_uint32( &endpoint->snapshot_sequence, sequence + 1 );
+
+    reliable_atomic_fence_release();
+
+    int i;
+    for ( i = 0; i < (int) RELIABLE_ENDPOINT_SNAPSHOT_WORDS; ++i )
+    {
+        reliable_atomic_store_relaxed_uint32( endpoint->snapshot_data + i, words[i] );
+    }
+
+    reliable_atomic_store_release_uint32( &endpoint->snapshot_sequence, sequence + 2 );
+}
+
+struct reliable_sent_packet_data_t
+{
+    double time;
+    uint32_t acked : 1;
+    uint32_t probe : 1;
+    uint32_t packet_bytes : 30;
+};
+
+struct reliable_received_packet_data_t
+{
+    double time;
+    uint32_t packet_bytes;
+};
+
+void reliable_default_config( struct reliable_config_t * config )
+{
+    reliable_assert( config );
+    memset( config, 0, sizeof( struct reliable_config_t ) );
+    config->name[0] = 'e';
+    config->name[1] = 'n';
+    config->name[2] = 'd';
+    config->name[3] = 'p';
+    config->name[4] = 'o';
+    config->name[5] = 'i';
+    config->name[6] = 'n';
+    config->name[7] = 't';
+    config->name[8] = '\0';
+    config->max_packet_size = 16 * 1024;
+    config->fragment_above = 1024;
+    config->max_fragments = 16;
+    config->fragment_size = 1024;
+    config->ack_buffer_size = 256;
+    config->sent_packets_buffer_size = 256;
+    config->received_packets_buffer_size = 256;
+    config->fragment_reassembly_buffer_size = 64;
+    config->rtt_smoothing_factor = 0.0025f;
+    config->rtt_history_size = 512;
+    config->packet_loss_smoothing_factor = 0.1f;
+    config->bandwidth_smoothing_factor = 0.1f;
+    config->bandwidth_window = 1.0f;
+    config->packet_header_size = 28;                    // note: UDP over IPv4 = 20 + 8 bytes, UDP over IPv6 = 40 + 8 bytes
+    config->mtu_probing = 0;
+    config->mtu_min = 548;                              // note: 576 byte minimum IPv4 datagram, less IPv4 + UDP headers
+    config->mtu_max = 0;
+    config->mtu_probe_interval = 0.25f;
+    config->send_queue_size = 0;
+}
+
+static void reliable_endpoint_set_mtu( struct reliable_endpoint_t * endpoint, int mtu )
+{
+    endpoint->mtu = mtu;
+
+    endpoint->fragment_size = mtu - RELIABLE_FRAGMENT_HEADER_BYTES - RELIABLE_MAX_PACKET_HEADER_BYTES;
+    if ( endpoint->fragment_size > endpoint->config.fragment_size )
+    {
+        endpoint->fragment_size = endpoint->config.fragment_size;
+    }
+
+    endpoint->fragment_above = mtu - RELIABLE_MAX_PACKET_HEADER_BYTES;
+    if ( endpoint->fragment_above > endpoint->config.fragment_above )
+    {
+        endpoint->fragment_above = endpoint->config.fragment_above;
+    }
+}
+
+static void reliable_endpoint_reset_mtu( struct reliable_endpoint_t * endpoint )
+{
+    // the largest datagram the config can produce is either a full fragment or the largest unfragmented packet
+
+    int max_mtu = RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + endpoint->config.fragment_size;
+    int max_unfragmented_packet_bytes = endpoint->config.fragment_above < endpoint->config.max_packet_size ? endpoint->config.fragment_above : endpoint->config.max_packet_size;
+    if ( RELIABLE_MAX_PACKET_HEADER_BYTES + max_unfragmented_packet_bytes > max_mtu )
+    {
+        max_mtu = RELIABLE_MAX_PACKET_HEADER_BYTES + max_unfragmented_packet_bytes;
+    }
+
+    endpoint->mtu_probe_bytes = 0;
+    endpoint->mtu_probe_in_flight = 0;
+    endpoint->mtu_probe_attempts = 0;
+    endpoint->mtu_probe_sequence = 0;
+    endpoint->mtu_probe_time = 0.0;
+    endpoint->mtu_next_probe_time = endpoint->time;
+
+    if ( !endpoint->config.mtu_probing )
+    {
+        endpoint->mtu_floor = max_mtu;
+        endpoint->mtu_ceiling = max_mtu;
+        endpoint->mtu_search_high = max_mtu;
+        endpoint->fragment_above = endpoint->config.fragment_above;
+        endpoint->fragment_size = endpoint->config.fragment_size;
+        endpoint->mtu = max_mtu;
+        return;
+    }
+
+    if ( endpoint->config.mtu_max > 0 && endpoint->config.mtu_max < max_mtu )
+    {
+        max_mtu = endpoint->config.mtu_max;
+    }
+
+    // fragments can't get so small that a max size packet needs more than max_fragments of them
+
+    int min_fragment_size = ( endpoint->config.max_packet_size + endpoint->config.max_fragments - 1 ) / endpoint->config.max_fragments;
+
+    int min_mtu = RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + min_fragment_size;
+    if ( endpoint->config.mtu_min > min_mtu )
+    {
+        min_mtu = endpoint->config.mtu_min;
+    }
+    if ( min_mtu > max_mtu )
+    {
+        min_mtu = max_mtu;
+    }
+
+    endpoint->mtu_floor = min_mtu;
+    endpoint->mtu_ceiling = max_mtu;
+    endpoint->mtu_search_high = max_mtu;
+
+    reliable_endpoint_set_mtu( endpoint, min_mtu );
+}
+
+// the config values reliable_replay needs to create an endpoint that behaves the same way
+
+static RELIABLE_COLD void reliable_endpoint_capture_create( struct reliable_endpoint_t * endpoint )
+{
+    int32_t values[RELIABLE_CAPTURE_NUM_CONFIG_VALUES];
+    values[RELIABLE_CAPTURE_CONFIG_MAX_PACKET_SIZE] = endpoint->config.max_packet_size;
+    values[RELIABLE_CAPTURE_CONFIG_FRAGMENT_ABOVE] = endpoint->config.fragment_above;
+    values[RELIABLE_CAPTURE_CONFIG_MAX_FRAGMENTS] = endpoint->config.max_fragments;
+    values[RELIABLE_CAPTURE_CONFIG_FRAGMENT_SIZE] = endpoint->config.fragment_size;
+    values[RELIABLE_CAPTURE_CONFIG_ACK_BUFFER_SIZE] = endpoint->config.ack_buffer_size;
+    values[RELIABLE_CAPTURE_CONFIG_SENT_PACKETS_BUFFER_SIZE] = endpoint->config.sent_packets_buffer_size;
+    values[RELIABLE_CAPTURE_CONFIG_RECEIVED_PACKETS_BUFFER_SIZE] = endpoint->config.received_packets_buffer_size;
+    values[RELIABLE_CAPTURE_CONFIG_FRAGMENT_REASSEMBLY_BUFFER_SIZE] = endpoint->config.fragment_reassembly_buffer_size;
+    values[RELIABLE_CAPTURE_CONFIG_RTT_HISTORY_SIZE] = endpoint->config.rtt_history_size;
+    values[RELIABLE_CAPTURE_CONFIG_PACKET_HEADER_SIZE] = endpoint->config.packet_header_size;
+    values[RELIABLE_CAPTURE_CONFIG_MTU_PROBING] = endpoint->config.mtu_probing;
+    values[RELIABLE_CAPTURE_CONFIG_MTU_MIN] = endpoint->config.mtu_min;
+    values[RELIABLE_CAPTURE_CONFIG_MTU_MAX] = endpoint->config.mtu_max;
+
+    uint8_t data[RELIABLE_CAPTURE_NUM_CONFIG_VALUES * 4];
+    uint8_t * p = data;
+    int i;
+    for ( i = 0; i < RELIABLE_CAPTURE_NUM_CONFIG_VALUES; ++i )
+    {
+        reliable_write_uint32( &p, (uint32_t) values[i] );
+    }
+
+    reliable_capture_write( RELIABLE_CAPTURE_CREATE, endpoint->config.id, endpoint->time, data, 0, sizeof( data ) );
+}
+
+// reliable.hpp sizes an endpoint's memory at compile time from these bounds in reliable.h. the sequence buffer and send queue
+// headers are part of the endpoint's state, and every entry also has its 32 bit sequence in the sequence buffer
+
+typedef char reliable_endpoint_state_bytes_check[ ( sizeof( struct reliable_endpoint_t ) + 3 * sizeof( struct reliable_sequence_buffer_t ) + sizeof( struct reliable_send_queue_t ) <= RELIABLE_ENDPOINT_STATE_BYTES ) ? 1 : -1 ];
+typedef char reliable_sent_packet_entry_bytes_check[ ( sizeof( struct reliable_sent_packet_data_t ) + sizeof( uint32_t ) <= RELIABLE_PACKET_ENTRY_BYTES ) ? 1 : -1 ];
+typedef char reliable_received_packet_entry_bytes_check[ ( sizeof( struct reliable_received_packet_data_t ) + sizeof( uint32_t ) <= RELIABLE_PACKET_ENTRY_BYTES ) ? 1 : -1 ];
+typedef char reliable_bandwidth_bucket_bytes_check[ ( sizeof( struct reliable_bandwidth_bucket_t ) <= RELIABLE_PACKET_ENTRY_BYTES ) ? 1 : -1 ];
+typedef char reliable_send_queue_entry_bytes_check[ ( sizeof( struct reliable_send_queue_entry_t ) <= RELIABLE_PACKET_ENTRY_BYTES ) ? 1 : -1 ];
+typedef char reliable_reassembly_entry_bytes_check[ ( sizeof( struct reliable_fragment_reassembly_data_t ) + sizeof( uint32_t ) <= RELIABLE_REASSEMBLY_ENTRY_BYTES ) ? 1 : -1 ];
+
+struct reliable_endpoint_t * reliable_endpoint_create( struct reliable_config_t * config, double time )
+{
+    reliable_assert( config );
+    reliable_assert( config->max_packet_size > 0 );
+    reliable_assert( config->fragment_above > 0 );
+    reliable_assert( config->max_fragments > 0 );
+    reliable_assert( config->max_fragments <= 256 );
+    reliable_assert( config->fragment_size > 0 );
+    reliable_assert( config->ack_buffer_size > 0 );
+    reliable_assert( config->sent_packets_buffer_size > 0 );
+    reliable_assert( config->received_packets_buffer_size > 0 );
+    reliable_assert( config->transmit_packet_function != NULL );
+    reliable_assert( config->process_packet_function != NULL );
+    reliable_assert( config->rtt_history_size > 0 );
+    reliable_assert( config->bandwidth_window >= RELIABLE_BANDWIDTH_BUCKET_TIME );
+    reliable_assert( !config->mtu_probing || config->mtu_min > RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES );
+    reliable_assert( !config->mtu_probing || config->mtu_probe_interval > 0.0f );
+    reliable_assert( config->send_queue_size >= 0 );
+    reliable_assert( ( config->send_queue_size & ( config->send_queue_size - 1 ) ) == 0 );
+
+    void * allocator_context = config->allocator_context;
+    void * (*allocate_function)(void*,size_t) = config->allocate_function;
+    void (*free_function)(void*,void*) = config->free_function;
+
+    if ( allocate_function == NULL )
+    {
+        allocate_function = reliable_default_allocate_function;
+    }
+
+    if ( free_function == NULL )
+    {
+        free_function = reliable_default_free_function;
+    }
+
+    struct reliable_endpoint_t * endpoint = (struct reliable_endpoint_t*) allocate_function( allocator_context, sizeof( struct reliable_endpoint_t ) );
+
+    reliable_assert( endpoint );
+
+    memset( endpoint, 0, sizeof( struct reliable_endpoint_t ) );
+
+    endpoint->allocator_context = allocator_context;
+    endpoint->allocate_function = allocate_function;
+    endpoint->free_function = free_function;
+    endpoint->config = *config;
+    endpoint->time = time;
+
+    endpoint->acks = (uint16_t*) allocate_function( allocator_context, config->ack_buffer_size * sizeof(uint16_t) );
+
+    reliable_assert( endpoint->acks );
+
+
+    endpoint->sent_packets = reliable_sequence_buffer_create( config->sent_packets_buffer_size, 
+                                                              sizeof( struct reliable_sent_packet_data_t ), 
+                                                              allocator_context, 
+                                                              allocate_function, 
+                                                              free_function );
+
+    endpoint->received_packets = reliable_sequence_buffer_create( config->received_packets_buffer_size, 
+                                                                  sizeof( struct reliable_received_packet_data_t ), 
+                                                                  allocator_context, 
+                                                                  allocate_function, 
+                                                                  free_function );
+    
+    endpoint->fragment_reassembly = reliable_sequence_buffer_create( config->fragment_reassembly_buffer_size, 
+                                                                     sizeof( struct reliable_fragment_reassembly_data_t ), 
+                                                                     allocator_context, 
+                                                                     allocate_function, 
+                                                                     free_function );
+
+    endpoint->rtt_history_buffer = (float*) allocate_function( allocator_context, config->rtt_history_size * sizeof(float) );
+
+    reliable_assert( endpoint->rtt_history_buffer );
+
+    // the assert above is compiled out of release builds. a window under one bucket, including the 0 left by filling the
+    // config without reliable_default_config, still gets one bucket there, so the bucket ring never takes a modulo by zero
+
+    endpoint->bandwidth_window.num_buckets = config->bandwidth_window > RELIABLE_BANDWIDTH_BUCKET_TIME ? (int) ( config->bandwidth_window / RELIABLE_BANDWIDTH_BUCKET_TIME + 0.5 ) : 1;
+
+    endpoint->bandwidth_window.buckets = (struct reliable_bandwidth_bucket_t*) allocate_function( allocator_context, endpoint->bandwidth_window.num_buckets * sizeof( struct reliable_bandwidth_bucket_t ) );
+
+    reliable_assert( endpoint->bandwidth_window.buckets );
+
+    reliable_bandwidth_window_reset( &endpoint->bandwidth_window, time );
+
+    // scratch buffer for outgoing packets, so the send path doesn't allocate. sized for whichever is larger: a regular packet or a fragment,
+    // or with transmit_fragments_function, every fragment after the first back to back
+
+    int transmit_buffer_size = config->max_packet_size + RELIABLE_MAX_PACKET_HEADER_BYTES;
+    int fragment_transmit_buffer_size = RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + config->fragment_size;
+    if ( config->transmit_fragments_function )
+    {
+        int fragments_transmit_buffer_size = ( config->max_fragments - 1 ) * ( RELIABLE_FRAGMENT_HEADER_BYTES + config->fragment_size );
+        if ( fragments_transmit_buffer_size > fragment_transmit_buffer_size )
+        {
+            fragment_transmit_buffer_size = fragments_transmit_buffer_size;
+        }
+    }
+    if ( fragment_transmit_buffer_size > transmit_buffer_size )
+    {
+        transmit_buffer_size = fragment_transmit_buffer_size;
+    }
+
+    endpoint->transmit_buffer = (uint8_t*) allocate_function( allocator_context, transmit_buffer_size );
+
+    reliable_assert( endpoint->transmit_buffer );
+
+    for ( int i = 0; i < config->rtt_history_size; i++ )
+    {
+        endpoint->rtt_history_buffer[i] = -1.0f;
+    }
+
+    memset( endpoint->acks, 0, config->ack_buffer_size * sizeof(uint16_t) );
+
+    if ( config->send_queue_size > 0 )
+    {
+        endpoint->send_queue = reliable_send_queue_create( config->send_queue_size, allocator_context, allocate_function );
+    }
+
+    reliable_endpoint_reset_mtu( endpoint );
+
+    // fragments can't shrink below max_packet_size / max_fragments. when that is already the largest fragment the
+    // config allows, the floor meets the ceiling and probing never moves the mtu. the defaults are like this
+
+    if ( config->mtu_probing && endpoint->mtu_floor == endpoint->mtu_ceiling )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_ERROR, "[%s] mtu probing has no room to probe: max_packet_size / max_fragments is not below the largest fragment. raise max_fragments\n", config->name );
+    }
+
+    reliable_endpoint_publish_snapshot( endpoint );
+
+    if ( reliable_capturing() )
+    {
+        reliable_endpoint_capture_create( endpoint );
+    }
+
+    return endpoint;
+}
+
+static void reliable_endpoint_clear_send_queue( struct reliable_endpoint_t * endpoint )
+{
+    if ( !endpoint->send_queue )
+        return;
+
+    uint8_t * packet_data;
+    int packet_bytes;
+    while ( ( packet_data = reliable_send_queue_pop( endpoint->send_queue, &packet_bytes ) ) != NULL )
+    {
+        endpoint->free_function( endpoint->allocator_context, packet_data );
+    }
+}
+
+void reliable_endpoint_destroy( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    reliable_assert( endpoint->acks );
+    reliable_assert( endpoint->sent_packets );
+    reliable_assert( endpoint->received_packets );
+    reliable_assert( endpoint->fragment_reassembly );
+    reliable_assert( endpoint->rtt_history_buffer );
+    reliable_assert( endpoint->bandwidth_window.buckets );
+    reliable_assert( endpoint->transmit_buffer );
+
+    reliable_endpoint_leave_stats( endpoint );
+
+    int i;
+    for ( i = 0; i < endpoint->config.fragment_reassembly_buffer_size; ++i )
+    {
+        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
+            reliable_sequence_buffer_at_index( endpoint->fragment_reassembly, i );
+
+        if ( reassembly_data && reassembly_data->packet_data )
+        {
+            endpoint->free_function( endpoint->allocator_context, reassembly_data->packet_data );
+            reassembly_data->packet_data = NULL;
+        }
+    }
+
+    endpoint->free_function( endpoint->allocator_context, endpoint->acks );
+
+    reliable_sequence_buffer_destroy( endpoint->sent_packets );
+    reliable_sequence_buffer_destroy( endpoint->received_packets );
+    reliable_sequence_buffer_destroy( endpoint->fragment_reassembly );
+
+    endpoint->free_function( endpoint->allocator_context, endpoint->rtt_history_buffer );
+
+    endpoint->free_function( endpoint->allocator_context, endpoint->bandwidth_window.buckets );
+
+    endpoint->free_function( endpoint->allocator_context, endpoint->transmit_buffer );
+
+    if ( endpoint->send_queue )
+    {
+        reliable_endpoint_clear_send_queue( endpoint );
+        endpoint->free_function( endpoint->allocator_context, endpoint->send_queue );
+    }
+
+    endpoint->free_function( endpoint->allocator_context, endpoint );
+}
+
+// every datagram the endpoint sends goes out through here
+
+static void reliable_endpoint_transmit( struct reliable_endpoint_t * endpoint, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    if ( reliable_capturing() )
+    {
+        reliable_capture_packet( RELIABLE_CAPTURE_SEND, endpoint->config.id, endpoint->time, packet_data, packet_bytes );
+    }
+
+    endpoint->config.transmit_packet_function( endpoint->config.context, endpoint->config.id, sequence, packet_data, packet_bytes );
+}
+
+// fragments after the first, back to back and stride bytes apart. captured one datagram at a time so captures look the same either way
+
+static void reliable_endpoint_transmit_fragments( struct reliable_endpoint_t * endpoint, uint16_t sequence, uint8_t * fragment_data, int fragment_bytes, int stride )
+{
+    if ( reliable_capturing() )
+    {
+        int offset;
+        for ( offset = 0; offset < fragment_bytes; offset += stride )
+        {
+            int bytes = fragment_bytes - offset < stride ? fragment_bytes - offset : stride;
+            reliable_capture_packet( RELIABLE_CAPTURE_SEND, endpoint->config.id, endpoint->time, fragment_data + offset, bytes );
+        }
+    }
+
+    endpoint->config.transmit_fragments_function( endpoint->config.context, endpoint->config.id, sequence, fragment_data, fragment_bytes, stride );
+}
+
+uint16_t reliable_endpoint_next_packet_sequence( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->sequence;
+}
+
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_write_packet_header( uint8_t * packet_data, uint16_t sequence, uint16_t ack, uint32_t ack_bits )
+{
+    uint8_t * p = packet_data;
+
+    uint8_t prefix_byte = 0;
+
+    if ( ( ack_bits & 0x000000FF ) != 0x000000FF )
+    {
+        prefix_byte |= (1<<1);
+    }
+
+    if ( ( ack_bits & 0x0000FF00 ) != 0x0000FF00 )
+    {
+        prefix_byte |= (1<<2);
+    }
+
+    if ( ( ack_bits & 0x00FF0000 ) != 0x00FF0000 )
+    {
+        prefix_byte |= (1<<3);
+    }
+
+    if ( ( ack_bits & 0xFF000000 ) != 0xFF000000 )
+    {
+        prefix_byte |= (1<<4);
+    }
+
+    int sequence_difference = sequence - ack;
+    if ( sequence_difference < 0 )
+        sequence_difference += 65536;
+    if ( sequence_difference <= 255 )
+        prefix_byte |= (1<<5);
+
+    reliable_write_uint8( &p, prefix_byte );
+
+    reliable_write_uint16( &p, sequence );
+
+    if ( sequence_difference <= 255 )
+    {
+        reliable_write_uint8( &p, (uint8_t) sequence_difference );
+    }
+    else
+    {
+        reliable_write_uint16( &p, ack );
+    }
+
+    if ( ( ack_bits & 0x000000FF ) != 0x000000FF )
+    {
+        reliable_write_uint8( &p, (uint8_t) ( ack_bits & 0x000000FF ) );
+    }
+
+    if ( ( ack_bits & 0x0000FF00 ) != 0x0000FF00 )
+    {
+        reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0x0000FF00 ) >> 8 ) );
+    }
+
+    if ( ( ack_bits & 0x00FF0000 ) != 0x00FF0000 )
+    {
+        reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0x00FF0000 ) >> 16 ) );
+    }
+
+    if ( ( ack_bits & 0xFF000000 ) != 0xFF000000 )
+    {
+        reliable_write_uint8( &p, (uint8_t) ( ( ack_bits & 0xFF000000 ) >> 24 ) );
+    }
+
+    reliable_assert( p - packet_data <= RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+    return (int) ( p - packet_data );
+}
+
+RELIABLE_HOT void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    reliable_profile_start( profile_start );
+
+    if ( packet_bytes > endpoint->config.max_packet_size )
+    {
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND, 0, packet_bytes, endpoint->config.max_packet_size, 0 );
+        reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_SEND );
+        reliable_trace( send_too_large, endpoint->config.id, 0, packet_bytes );
+        return;
+    }
+
+    uint16_t sequence = endpoint->sequence++;
+    uint16_t ack;
+    uint32_t ack_bits;
+
+    reliable_sequence_buffer_generate_ack_bits( endpoint->received_packets, &ack, &ack_bits );
+
+    reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_PACKET, sequence, 0, 0, 0 );
+
+    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_insert( endpoint->sent_packets, sequence );
+
+    reliable_assert( sent_packet_data );
+
+    sent_packet_data->time = endpoint->time;
+    sent_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
+    sent_packet_data->acked = 0;
+    sent_packet_data->probe = 0;
+
+    reliable_bandwidth_window_sent( &endpoint->bandwidth_window, endpoint->time, sent_packet_data->packet_bytes );
+
+    reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_SEND_PREPARE, profile_start );
+
+    if ( packet_bytes <= endpoint->fragment_above )
+    {
+        // regular packet
+
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED, sequence, 0, 0, 0 );
+
+        uint8_t * transmit_packet_data = endpoint->transmit_buffer;
+
+        int packet_header_bytes = reliable_write_packet_header( transmit_packet_data, sequence, ack, ack_bits );
+
+        memcpy( transmit_packet_data + packet_header_bytes, packet_data, packet_bytes );
+
+        reliable_endpoint_transmit( endpoint, sequence, transmit_packet_data, packet_header_bytes + packet_bytes );
+    }
+    else
+    {
+        // fragmented packet
+
+        uint8_t packet_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
+
+        memset( packet_header, 0, RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+        int packet_header_bytes = reliable_write_packet_header( packet_header, sequence, ack, ack_bits );        
+
+        int fragment_size = endpoint->fragment_size;
+
+        int num_fragments = ( packet_bytes / fragment_size ) + ( ( packet_bytes % fragment_size ) != 0 ? 1 : 0 );
+
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_PACKET_FRAGMENTED, sequence, num_fragments, 0, 0 );
+
+        reliable_assert( num_fragments >= 1 );
+        reliable_assert( num_fragments <= endpoint->config.max_fragments );
+
+        uint8_t * fragment_packet_data = endpoint->transmit_buffer;
+
+        uint8_t * q = packet_data;
+
+        uint8_t * end = q + packet_bytes;
+
+        int fragment_id;
+        for ( fragment_id = 0; fragment_id < num_fragments; ++fragment_id )
+        {
+            uint8_t * p = fragment_packet_data;
+
+            reliable_write_uint8( &p, 1 );
+            reliable_write_uint16( &p, sequence );
+            reliable_write_uint8( &p, (uint8_t) fragment_id );
+            reliable_write_uint8( &p, (uint8_t) ( num_fragments - 1 ) );
+
+            if ( fragment_id == 0 )
+            {
+                memcpy( p, packet_header, packet_header_bytes );
+                p += packet_header_bytes;
+            }
+
+            int bytes_to_copy = fragment_size;
+            if ( q + bytes_to_copy > end )
+            {
+                bytes_to_copy = (int) ( end - q );
+            }
+
+            memcpy( p, q, bytes_to_copy );
+
+            p += bytes_to_copy;
+            q += bytes_to_copy;
+
+            int fragment_packet_bytes = (int) ( p - fragment_packet_data );
+
+            if ( fragment_id == 0 || !endpoint->config.transmit_fragments_function )
+            {
+                reliable_endpoint_transmit( endpoint, sequence, fragment_packet_data, fragment_packet_bytes );
+            }
+            else
+            {
+                // the next fragment goes straight after this one. they are all sent together below
+
+                fragment_packet_data = p;
+            }
+
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_SENT );
+
+            reliable_trace( fragment_sent, endpoint->config.id, sequence, fragment_id, fragment_packet_bytes );
+        }
+
+        if ( endpoint->config.transmit_fragments_function && num_fragments > 1 )
+        {
+            reliable_endpoint_transmit_fragments( endpoint, sequence, endpoint->transmit_buffer, (int) ( fragment_packet_data - endpoint->transmit_buffer ), RELIABLE_FRAGMENT_HEADER_BYTES + fragment_size );
+        }
+    }
+
+    reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_SEND_TRANSMIT, profile_start );
+
+    reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT );
+
+    if ( endpoint->stats_shard )
+    {
+        reliable_stats_add( &endpoint->stats_shard->bytes_sent, sent_packet_data->packet_bytes );
+    }
+
+    reliable_trace( packet_sent, endpoint->config.id, sequence, packet_bytes );
+}
+
+void * reliable_endpoint_allocate_packet( struct reliable_endpoint_t * endpoint, size_t bytes )
+{
+    reliable_assert( endpoint );
+    return endpoint->allocate_function( endpoint->allocator_context, bytes );
+}
+
+int reliable_endpoint_queue_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( endpoint->send_queue );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    // called from other threads. only the send queue may be touched here
+
+    return reliable_send_queue_push( endpoint->send_queue, packet_data, packet_bytes );
+}
+
+int reliable_endpoint_pump( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+
+    if ( !endpoint->send_queue )
+        return 0;
+
+    // bounded, so producers that keep queueing can't keep the pump going forever
+
+    int max_packets = (int) endpoint->send_queue->mask + 1;
+
+    int num_packets_sent = 0;
+
+    while ( num_packets_sent < max_packets )
+    {
+        int packet_bytes;
+        uint8_t * packet_data = reliable_send_queue_pop( endpoint->send_queue, &packet_bytes );
+        if ( !packet_data )
+            break;
+
+        reliable_endpoint_send_packet( endpoint, packet_data, packet_bytes );
+
+        endpoint->free_function( endpoint->allocator_context, packet_data );
+
+        num_packets_sent++;
+    }
+
+    return num_packets_sent;
+}
+
+static void reliable_endpoint_send_mtu_probe( struct reliable_endpoint_t * endpoint, int probe_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( probe_bytes > RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+    uint16_t sequence = endpoint->sequence++;
+    uint16_t ack;
+    uint32_t ack_bits;
+
+    reliable_sequence_buffer_generate_ack_bits( endpoint->received_packets, &ack, &ack_bits );
+
+    reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_SEND_MTU_PROBE, sequence, probe_bytes, 0, 0 );
+
+    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_insert( endpoint->sent_packets, sequence );
+
+    reliable_assert( sent_packet_data );
+
+    sent_packet_data->time = endpoint->time;
+    sent_packet_data->packet_bytes = endpoint->config.packet_header_size + probe_bytes;
+    sent_packet_data->acked = 0;
+    sent_packet_data->probe = 1;
+
+    reliable_bandwidth_window_sent( &endpoint->bandwidth_window, endpoint->time, sent_packet_data->packet_bytes );
+
+    uint8_t * transmit_packet_data = endpoint->transmit_buffer;
+
+    int packet_header_bytes = reliable_write_packet_header( transmit_packet_data, sequence, ack, ack_bits );
+
+    transmit_packet_data[0] |= RELIABLE_PROBE_PACKET_FLAG;
+
+    memset( transmit_packet_data + packet_header_bytes, 0, probe_bytes - packet_header_bytes );
+
+    endpoint->mtu_probe_in_flight = 1;
+    endpoint->mtu_probe_sequence = sequence;
+    endpoint->mtu_probe_time = endpoint->time;
+
+    reliable_endpoint_transmit( endpoint, sequence, transmit_packet_data, probe_bytes );
+
+    reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_MTU_PROBES_SENT );
+}
+
+static void reliable_endpoint_mtu_probe_acked( struct reliable_endpoint_t * endpoint, uint16_t sequence, int probe_bytes )
+{
+    reliable_assert( endpoint );
+
+    reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_MTU_PROBE_ACKED, sequence, probe_bytes, 0, 0 );
+
+    // a late ack for an earlier probe still proves that size gets through
+
+    if ( probe_bytes > endpoint->mtu )
+    {
+        reliable_endpoint_set_mtu( endpoint, probe_bytes );
+
+        if ( endpoint->mtu_search_high < probe_bytes )
+        {
+            endpoint->mtu_search_high = probe_bytes;
+        }
+
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_INFO, RELIABLE_LOG_EVENT_MTU_CHANGED, 0, endpoint->mtu, 0, 0 );
+
+        if ( endpoint->mtu_probe_bytes != 0 && endpoint->mtu_probe_bytes <= endpoint->mtu && sequence != endpoint->mtu_probe_sequence )
+        {
+            // whatever size we were probing is already known to get through now
+
+            endpoint->mtu_probe_in_flight = 0;
+            endpoint->mtu_probe_attempts = 0;
+            endpoint->mtu_probe_bytes = 0;
+        }
+    }
+
+    if ( endpoint->mtu_probe_in_flight && sequence == endpoint->mtu_probe_sequence )
+    {
+        endpoint->mtu_probe_in_flight = 0;
+        endpoint->mtu_probe_attempts = 0;
+        endpoint->mtu_probe_bytes = 0;
+        endpoint->mtu_next_probe_time = endpoint->time + endpoint->config.mtu_probe_interval;
+    }
+}
+
+static void reliable_endpoint_update_mtu( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+
+    // binary search between the largest size known to get through and the smallest size known not to.
+    // one probe is in flight at a time, and a size is only ruled out after several probes of it are lost
+
+    if ( endpoint->mtu_probe_in_flight )
+    {
+        double timeout = 3.0 * endpoint->rtt / 1000.0;
+        if ( timeout < RELIABLE_MTU_PROBE_MIN_TIMEOUT )
+        {
+            timeout = RELIABLE_MTU_PROBE_MIN_TIMEOUT;
+        }
+
+        if ( endpoint->time - endpoint->mtu_probe_time < timeout )
+            return;
+
+        endpoint->mtu_probe_in_flight = 0;
+        endpoint->mtu_probe_attempts++;
+        endpoint->mtu_next_probe_time = endpoint->time + endpoint->config.mtu_probe_interval;
+
+        if ( endpoint->mtu_probe_attempts >= RELIABLE_MTU_PROBE_MAX_ATTEMPTS )
+        {
+            if ( endpoint->mtu_probe_bytes <= endpoint->mtu )
+            {
+                // the current mtu no longer gets through. the path changed under us, so start again from the bottom
+
+                reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_INFO, RELIABLE_LOG_EVENT_MTU_LOST, 0, endpoint->mtu, endpoint->mtu_floor, 0 );
+
+                reliable_endpoint_set_mtu( endpoint, endpoint->mtu_floor );
+            }
+            else
+            {
+                endpoint->mtu_search_high = endpoint->mtu_probe_bytes - 1;
+            }
+
+            endpoint->mtu_probe_attempts = 0;
+            endpoint->mtu_probe_bytes = 0;
+        }
+    }
+
+    if ( endpoint->time < endpoint->mtu_next_probe_time )
+        return;
+
+    if ( endpoint->mtu_probe_bytes == 0 )
+    {
+        if ( endpoint->mtu_search_high - endpoint->mtu < RELIABLE_MTU_SEARCH_GRANULARITY )
+        {
+            // search is done. after a while, confirm the mtu still gets through and then look for a larger one
+
+            endpoint->mtu_search_high = endpoint->mtu_ceiling;
+            endpoint->mtu_probe_bytes = endpoint->mtu;
+            endpoint->mtu_next_probe_time = endpoint->time + RELIABLE_MTU_RAISE_INTERVAL;
+            return;
+        }
+
+        endpoint->mtu_probe_bytes = endpoint->mtu + ( endpoint->mtu_search_high - endpoint->mtu + 1 ) / 2;
+    }
+
+    reliable_endpoint_send_mtu_probe( endpoint, endpoint->mtu_probe_bytes );
+}
+
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_read_packet_header( RELIABLE_CONST char * name, uint8_t * packet_data, int packet_bytes, uint16_t * sequence, uint16_t * ack, uint32_t * ack_bits )
+{
+    if ( packet_bytes < 3 )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (1)\n", name );
+        return -1;
+    }
+
+    uint8_t * p = packet_data;
+
+    uint8_t prefix_byte = reliable_read_uint8( &p );
+
+    if ( ( prefix_byte & 1 ) != 0 )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] prefix byte does not indicate a regular packet\n", name );
+        return -1;
+    }
+
+    *sequence = reliable_read_uint16( &p );
+
+    if ( prefix_byte & (1<<5) )
+    {
+        if ( packet_bytes < 3 + 1 )
+        {
+            reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (2)\n", name );
+            return -1;
+        }
+        uint8_t sequence_difference = reliable_read_uint8( &p );
+        *ack = *sequence - sequence_difference;
+    }
+    else
+    {
+        if ( packet_bytes < 3 + 2 )
+        {
+            reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (3)\n", name );
+            return -1;
+        }
+        *ack = reliable_read_uint16( &p );
+    }
+
+    int expected_bytes = 0;
+    int i;
+    for ( i = 1; i <= 4; ++i )
+    {
+        if ( prefix_byte & (1<<i) )
+        {
+            expected_bytes++;
+        }
+    }
+    if ( packet_bytes < ( p - packet_data ) + expected_bytes )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet too small for packet header (4)\n", name );
+        return -1;
+    }
+
+    *ack_bits = 0xFFFFFFFF;
+
+    if ( prefix_byte & (1<<1) )
+    {
+        *ack_bits &= 0xFFFFFF00;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) );
+    }
+
+    if ( prefix_byte & (1<<2) )
+    {
+        *ack_bits &= 0xFFFF00FF;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 8;
+    }
+
+    if ( prefix_byte & (1<<3) )
+    {
+        *ack_bits &= 0xFF00FFFF;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 16;
+    }
+
+    if ( prefix_byte & (1<<4) )
+    {
+        *ack_bits &= 0x00FFFFFF;
+        *ack_bits |= (uint32_t) ( reliable_read_uint8( &p ) ) << 24;
+    }
+
+    return (int) ( p - packet_data );
+}
+
+RELIABLE_INTERNAL RELIABLE_HOT int reliable_read_fragment_header( char * name, 
+                                   uint8_t * packet_data, 
+                                   int packet_bytes, 
+                                   int max_fragments, 
+                                   int fragment_size, 
+                                   int * fragment_id, 
+                                   int * num_fragments, 
+                                   int * fragment_bytes, 
+                                   uint16_t * sequence, 
+                                   uint16_t * ack, 
+                                   uint32_t * ack_bits )
+{
+    if ( packet_bytes < RELIABLE_FRAGMENT_HEADER_BYTES )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] packet is too small to read fragment header\n", name );
+        return -1;
+    }
+
+    uint8_t * p = packet_data;
+
+    uint8_t prefix_byte = reliable_read_uint8( &p );
+    if ( prefix_byte != 1 )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] prefix byte is not a fragment\n", name );
+        return -1;
+    }
+    
+    *sequence = reliable_read_uint16( &p );
+    *fragment_id = (int) reliable_read_uint8( &p );
+    *num_fragments = ( (int) reliable_read_uint8( &p ) ) + 1;
+
+    if ( *num_fragments > max_fragments )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] num fragments %d outside of range of max fragments %d\n", name, *num_fragments, max_fragments );
+        return -1;
+    }
+
+    if ( *fragment_id >= *num_fragments )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment id %d outside of range of num fragments %d\n", name, *fragment_id, *num_fragments );
+        return -1;
+    }
+
+    *fragment_bytes = packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
+
+    uint16_t packet_sequence = 0;
+    uint16_t packet_ack = 0;
+    uint32_t packet_ack_bits = 0;
+
+    if ( *fragment_id == 0 )
+    {
+        int packet_header_bytes = reliable_read_packet_header( name,
+                                                               packet_data + RELIABLE_FRAGMENT_HEADER_BYTES,
+                                                               packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES,
+                                                               &packet_sequence,
+                                                               &packet_ack, 
+                                                               &packet_ack_bits );
+
+        if ( packet_header_bytes < 0 )
+        {
+            reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] bad packet header in fragment\n", name );
+            return -1;
+        }
+
+        if ( packet_sequence != *sequence )
+        {
+            reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] bad packet sequence in fragment. expected %d, got %d\n", name, *sequence, packet_sequence );
+            return -1;
+        }
+
+        // the packet header is re-encoded canonically during reassembly, so a non-canonical
+        // header would shift where the fragment payload lands. reject it here instead.
+
+        uint8_t canonical_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
+        int canonical_header_bytes = reliable_write_packet_header( canonical_header, packet_sequence, packet_ack, packet_ack_bits );
+        if ( canonical_header_bytes != packet_header_bytes || memcmp( canonical_header, packet_data + RELIABLE_FRAGMENT_HEADER_BYTES, canonical_header_bytes ) != 0 )
+        {
+            reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] non-canonical packet header in fragment\n", name );
+            return -1;
+        }
+
+        *fragment_bytes = packet_bytes - packet_header_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
+    }
+
+    *ack = packet_ack;
+    *ack_bits = packet_ack_bits;
+
+    if ( *fragment_bytes > fragment_size )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment bytes %d > fragment size %d\n", name, *fragment_bytes, fragment_size );
+        return - 1;
+    }
+
+    if ( *fragment_id != *num_fragments - 1 && *fragment_bytes <= 0 )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG, "[%s] fragment %d is empty, but only the last fragment may be\n", name, *fragment_id );
+        return -1;
+    }
+
+    return (int) ( p - packet_data );
+}
+
+RELIABLE_INTERNAL int reliable_fragment_reassembly_set_fragment_size( struct reliable_fragment_reassembly_data_t * reassembly_data, int fragment_size, int max_fragment_size )
+{
+    if ( reassembly_data->fragment_size != 0 )
+    {
+        return fragment_size == reassembly_data->fragment_size;
+    }
+
+    int last_fragment_id = reassembly_data->num_fragments_total - 1;
+
+    if ( reassembly_data->fragment_received[last_fragment_id] )
+    {
+        // the last fragment arrived first and is parked at the end of the buffer. now we know where it goes, move it there
+
+        if ( reassembly_data->last_fragment_bytes > fragment_size )
+        {
+            return 0;
+        }
+
+        uint8_t * parked = reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES + 
+                           reassembly_data->num_fragments_total * max_fragment_size - reassembly_data->last_fragment_bytes;
+
+        memmove( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES + last_fragment_id * fragment_size, 
+                 parked, 
+                 reassembly_data->last_fragment_bytes );
+    }
+
+    reassembly_data->fragment_size = fragment_size;
+
+    return 1;
+}
+
+RELIABLE_INTERNAL RELIABLE_HOT void reliable_store_fragment_data( struct reliable_fragment_reassembly_data_t * reassembly_data, 
+                                   uint16_t sequence, 
+                                   uint16_t ack, 
+                                   uint32_t ack_bits, 
+                                   int fragment_id, 
+                                   int max_fragment_size, 
+                                   uint8_t * fragment_data, 
+                                   int fragment_bytes )
+{
+    if ( fragment_id == 0 )
+    {
+        uint8_t packet_header[RELIABLE_MAX_PACKET_HEADER_BYTES];
+
+        memset( packet_header, 0, RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+        reassembly_data->packet_header_bytes = reliable_write_packet_header( packet_header, sequence, ack, ack_bits );
+
+        memcpy( reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
+                packet_header, 
+                reassembly_data->packet_header_bytes );
+
+        fragment_data += reassembly_data->packet_header_bytes;
+        fragment_bytes -= reassembly_data->packet_header_bytes;
+    }
+
+    size_t max_size = RELIABLE_MAX_PACKET_HEADER_BYTES +
+                      reassembly_data->num_fragments_total * max_fragment_size;
+
+    size_t offset;
+
+    if ( fragment_id == reassembly_data->num_fragments_total - 1 )
+    {
+        reassembly_data->last_fragment_bytes = fragment_bytes;
+
+        if ( fragment_id == 0 || reassembly_data->fragment_size > 0 )
+        {
+            offset = RELIABLE_MAX_PACKET_HEADER_BYTES + fragment_id * reassembly_data->fragment_size;
+        }
+        else
+        {
+            // we don't know the fragment size yet, so we don't know where the last fragment goes. park it at the end of the buffer for now
+
+            offset = max_size - ( fragment_bytes > 0 ? fragment_bytes : 0 );
+        }
+    }
+    else
+    {
+        offset = RELIABLE_MAX_PACKET_HEADER_BYTES + fragment_id * reassembly_data->fragment_size;
+    }
+
+    size_t end_offset = offset + fragment_bytes;
+    
+    if ( fragment_bytes < 0 || end_offset > max_size )
+    {
+        reliable_log( RELIABLE_LOG_LEVEL_DEBUG,
+            "[reliable] invalid fragment size %d (would write past %zu/%zu)\n",
+            fragment_bytes, end_offset, max_size );
+        return;
+    }
+    
+    memcpy( reassembly_data->packet_data + offset, fragment_data, fragment_bytes );
+}
+
+// receives a datagram from the network, or a packet just reassembled from fragments
+
+static void reliable_endpoint_receive_datagram( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    reliable_profile_start( profile_start );
+
+    if ( packet_bytes > endpoint->config.max_packet_size + RELIABLE_MAX_PACKET_HEADER_BYTES + RELIABLE_FRAGMENT_HEADER_BYTES )
+    {
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_RECEIVE, 0, 
+            packet_bytes - ( RELIABLE_MAX_PACKET_HEADER_BYTES + RELIABLE_FRAGMENT_HEADER_BYTES ), endpoint->config.max_packet_size, 0 );
+        reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE );
+        reliable_trace( receive_too_large, endpoint->config.id, 0, packet_bytes );
+        return;
+    }
+
+    uint8_t prefix_byte = packet_data[0];
+
+    if ( ( prefix_byte & 1 ) == 0 )
+    {
+        // regular packet
+
+        int probe = ( prefix_byte & RELIABLE_PROBE_PACKET_FLAG ) != 0;
+
+        if ( probe )
+        {
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_MTU_PROBES_RECEIVED );
+        }
+        else
+        {
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED );
+        }
+
+        uint16_t sequence;
+        uint16_t ack;
+        uint32_t ack_bits;
+
+        int packet_header_bytes = reliable_read_packet_header( endpoint->config.name, packet_data, packet_bytes, &sequence, &ack, &ack_bits );
+
+        reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_RECEIVE_HEADER, profile_start );
+
+        if ( packet_header_bytes < 0 )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_INVALID_PACKET, 0, 0, 0, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_INVALID );
+            reliable_trace( packet_invalid, endpoint->config.id, 0, packet_bytes );
+            return;
+        }
+
+        reliable_trace( packet_received, endpoint->config.id, sequence, packet_bytes, probe );
+
+        reliable_assert( packet_header_bytes <= packet_bytes );
+
+        int packet_payload_bytes = packet_bytes - packet_header_bytes;
+
+        if ( packet_payload_bytes > endpoint->config.max_packet_size )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PAYLOAD_TOO_LARGE_TO_RECEIVE, sequence, packet_payload_bytes, endpoint->config.max_packet_size, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE );
+            reliable_trace( receive_too_large, endpoint->config.id, sequence, packet_bytes );
+            return;
+        }
+
+        if ( !reliable_sequence_buffer_test_insert( endpoint->received_packets, sequence ) )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_STALE_PACKET, sequence, 0, 0, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE );
+            reliable_trace( packet_stale, endpoint->config.id, sequence, packet_bytes );
+            return;
+        }
+
+        if ( reliable_sequence_buffer_exists( endpoint->received_packets, sequence ) )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_DUPLICATE_PACKET, sequence, 0, 0, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_DUPLICATE );
+            reliable_trace( packet_duplicate, endpoint->config.id, sequence, packet_bytes );
+            return;
+        }
+
+        reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_RECEIVE_CHECKS, profile_start );
+
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, probe ? RELIABLE_LOG_EVENT_PROCESS_MTU_PROBE : RELIABLE_LOG_EVENT_PROCESS_PACKET, sequence, 0, 0, 0 );
+
+        // mtu probes are only padding. they're acked so the sender learns the probe got through, but there is nothing to process
+
+        int processed = probe || endpoint->config.process_packet_function( endpoint->config.context, 
+                                                                           endpoint->config.id, 
+                                                                           sequence, 
+                                                                           packet_data + packet_header_bytes, 
+                                                                           packet_bytes - packet_header_bytes );
+
+        reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_RECEIVE_PROCESS, profile_start );
+
+        if ( processed )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCESSFUL, sequence, 0, 0, 0 );
+
+            struct reliable_received_packet_data_t * received_packet_data = (struct reliable_received_packet_data_t*) 
+                reliable_sequence_buffer_insert( endpoint->received_packets, sequence );
+
+            reliable_sequence_buffer_advance_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+
+            reliable_assert( received_packet_data );
+
+            received_packet_data->time = endpoint->time;
+            received_packet_data->packet_bytes = endpoint->config.packet_header_size + packet_bytes;
+
+            reliable_bandwidth_window_received( &endpoint->bandwidth_window, endpoint->time, received_packet_data->packet_bytes );
+
+            if ( endpoint->stats_shard )
+            {
+                reliable_stats_add( &endpoint->stats_shard->bytes_received, received_packet_data->packet_bytes );
+            }
+
+            int i;
+            for ( i = 0; i < 32; ++i )
+            {
+                if ( ack_bits & 1 )
+                {                    
+                    uint16_t ack_sequence = ack - ((uint16_t)i);
+                    
+                    struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) 
+                        reliable_sequence_buffer_find( endpoint->sent_packets, ack_sequence );
+
+                    if ( sent_packet_data && !sent_packet_data->acked && sent_packet_data->probe )
+                    {
+                        // mtu probes are internal, so they don't go in the ack buffer the user sees
+
+                        sent_packet_data->acked = 1;
+
+                        reliable_bandwidth_window_acked( &endpoint->bandwidth_window, endpoint->time, sent_packet_data->packet_bytes );
+
+                        reliable_endpoint_mtu_probe_acked( endpoint, ack_sequence, sent_packet_data->packet_bytes - endpoint->config.packet_header_size );
+                    }
+                    else if ( sent_packet_data && !sent_packet_data->acked )
+                    {
+                        if ( endpoint->num_acks < endpoint->config.ack_buffer_size )
+                        {
+                            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_PACKET_ACKED, ack_sequence, 0, 0, 0 );
+                            endpoint->acks[endpoint->num_acks++] = ack_sequence;
+                            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED );
+                            sent_packet_data->acked = 1;
+
+                            reliable_bandwidth_window_acked( &endpoint->bandwidth_window, endpoint->time, sent_packet_data->packet_bytes );
+
+                            const float rtt = (float) ( endpoint->time - sent_packet_data->time ) * 1000.0f;
+
+                            reliable_assert( rtt >= 0.0 );
+
+                            reliable_trace( packet_acked, endpoint->config.id, ack_sequence, (uint32_t) ( rtt * 1000.0f ), sent_packet_data->packet_bytes );
+
+                            int index = ack_sequence % endpoint->config.rtt_history_size;
+
+                            endpoint->rtt_history_buffer[index] = rtt;
+
+                            // jitter here is how much each rtt sample differs from the one before, as in rfc 3550
+
+                            if ( endpoint->rtt_histogram.count > 0 )
+                            {
+                                reliable_histogram_add( &endpoint->jitter_histogram, (float) fabs( rtt - endpoint->rtt_last ) );
+                            }
+
+                            reliable_histogram_add( &endpoint->rtt_histogram, rtt );
+
+                            if ( endpoint->stats_shard )
+                            {
+                                struct reliable_stats_shard_t * shard = endpoint->stats_shard;
+                                reliable_stats_add( &shard->bytes_acked, sent_packet_data->packet_bytes );
+                                reliable_stats_add( shard->rtt_histogram.buckets + reliable_histogram_bucket_milliseconds( rtt ), 1 );
+                                reliable_stats_add( &shard->rtt_histogram.count, 1 );
+                            }
+
+                            endpoint->rtt_last = rtt;
+
+                            if ( ( endpoint->rtt == 0.0f && rtt > 0.0f ) || fabs( endpoint->rtt - rtt ) < 0.00001 )
+                            {
+                                endpoint->rtt = rtt;
+                            }
+                            else
+                            {
+                                endpoint->rtt += ( rtt - endpoint->rtt ) * endpoint->config.rtt_smoothing_factor;
+                            }
+                        }
+                        else
+                        {
+                            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_ACK_BUFFER_FULL, ack_sequence, 0, 0, 0 );
+                        }
+                    }
+                }
+                ack_bits >>= 1;
+            }
+
+            reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_RECEIVE_ACKS, profile_start );
+        }
+        else
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_PROCESS_PACKET_FAILED, sequence, 0, 0, 0 );
+        }
+    }
+    else
+    {
+        // fragment packet
+
+        int fragment_id;
+        int num_fragments;
+        int fragment_bytes;
+
+        uint16_t sequence;
+        uint16_t ack;
+        uint32_t ack_bits;
+
+        int fragment_header_bytes = reliable_read_fragment_header( endpoint->config.name, 
+                                                                   packet_data, 
+                                                                   packet_bytes, 
+                                                                   endpoint->config.max_fragments, 
+                                                                   endpoint->config.fragment_size,
+                                                                   &fragment_id, 
+                                                                   &num_fragments, 
+                                                                   &fragment_bytes, 
+                                                                   &sequence, 
+                                                                   &ack, 
+                                                                   &ack_bits );
+
+        reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_RECEIVE_HEADER, profile_start );
+
+        if ( fragment_header_bytes < 0 )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_INVALID_FRAGMENT, 0, 0, 0, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID );
+            reliable_trace( fragment_invalid, endpoint->config.id, 0, packet_bytes );
+            return;
+        }
+
+        if ( reliable_sequence_buffer_exists( endpoint->received_packets, sequence ) )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_FRAGMENT_OF_RECEIVED_PACKET, sequence, fragment_id, 0, 0 );
+            return;
+        }
+
+        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*)
+            reliable_sequence_buffer_find( endpoint->fragment_reassembly, sequence );
+
+        if ( !reassembly_data )
+        {
+            reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
+                reliable_sequence_buffer_insert_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+
+            if ( !reassembly_data )
+            {
+                reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_FRAGMENT_STALE, sequence, 0, 0, 0 );
+                reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID );
+                reliable_trace( fragment_invalid, endpoint->config.id, sequence, packet_bytes );
+                return;
+            }
+
+            reliable_sequence_buffer_advance( endpoint->received_packets, sequence );
+
+            size_t packet_buffer_size = (size_t) RELIABLE_MAX_PACKET_HEADER_BYTES + (size_t) num_fragments * (size_t) endpoint->config.fragment_size;
+
+#if RELIABLE_USDT
+            reassembly_data->endpoint_id = endpoint->config.id;
+#endif // #if RELIABLE_USDT
+            reassembly_data->sequence = sequence;
+            reassembly_data->ack = 0;
+            reassembly_data->ack_bits = 0;
+            reassembly_data->num_fragments_received = 0;
+            reassembly_data->num_fragments_total = num_fragments;
+            reassembly_data->packet_data = (uint8_t*) endpoint->allocate_function( endpoint->allocator_context, packet_buffer_size );
+            reliable_assert( reassembly_data->packet_data );
+            reassembly_data->packet_bytes = 0;
+            reassembly_data->packet_header_bytes = 0;
+            reassembly_data->fragment_size = 0;
+            reassembly_data->last_fragment_bytes = 0;
+            memset( reassembly_data->fragment_received, 0, sizeof( reassembly_data->fragment_received ) );
+
+            reliable_trace( reassembly_start, endpoint->config.id, sequence, num_fragments );
+        }
+
+        if ( num_fragments != (int) reassembly_data->num_fragments_total )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_FRAGMENT_COUNT_MISMATCH, sequence, (int) reassembly_data->num_fragments_total, num_fragments, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID );
+            reliable_trace( fragment_invalid, endpoint->config.id, sequence, packet_bytes );
+            return;
+        }
+
+        if ( reassembly_data->fragment_received[fragment_id] )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_FRAGMENT_DUPLICATE, sequence, fragment_id, 0, 0 );
+            return;
+        }
+
+        // the sender may have lowered its fragment size to fit the path mtu, so every fragment but the last just has to agree with the others
+
+        if ( fragment_id != num_fragments - 1 && !reliable_fragment_reassembly_set_fragment_size( reassembly_data, fragment_bytes, endpoint->config.fragment_size ) )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_FRAGMENT_SIZE_MISMATCH, sequence, fragment_id, fragment_bytes, reassembly_data->fragment_size );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID );
+            reliable_trace( fragment_invalid, endpoint->config.id, sequence, packet_bytes );
+            return;
+        }
+
+        if ( fragment_id == num_fragments - 1 && num_fragments > 1 && reassembly_data->fragment_size > 0 && fragment_bytes > reassembly_data->fragment_size )
+        {
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_ERROR, RELIABLE_LOG_EVENT_LAST_FRAGMENT_TOO_LARGE, sequence, fragment_bytes, reassembly_data->fragment_size, 0 );
+            reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID );
+            reliable_trace( fragment_invalid, endpoint->config.id, sequence, packet_bytes );
+            return;
+        }
+
+        reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_FRAGMENT_RECEIVED, sequence, fragment_id, reassembly_data->num_fragments_received+1, num_fragments );
+
+        reassembly_data->num_fragments_received++;
+        reassembly_data->fragment_received[fragment_id] = 1;
+
+        reliable_trace( fragment_received, endpoint->config.id, sequence, fragment_id, packet_bytes );
+
+        reliable_store_fragment_data( reassembly_data, 
+                                      sequence, 
+                                      ack, 
+                                      ack_bits, 
+                                      fragment_id, 
+                                      endpoint->config.fragment_size, 
+                                      packet_data + fragment_header_bytes, 
+                                      packet_bytes - fragment_header_bytes );
+
+        reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_RECEIVE_REASSEMBLY, profile_start );
+
+        if ( reassembly_data->num_fragments_received == reassembly_data->num_fragments_total )
+        {
+            reassembly_data->packet_bytes = ( reassembly_data->num_fragments_total - 1 ) * reassembly_data->fragment_size + reassembly_data->last_fragment_bytes;
+
+            reliable_endpoint_log( endpoint, RELIABLE_LOG_LEVEL_DEBUG, RELIABLE_LOG_EVENT_REASSEMBLY_COMPLETE, sequence, 0, 0, 0 );
+
+            reliable_trace( reassembly_complete, endpoint->config.id, sequence, reassembly_data->packet_bytes );
+
+            reliable_endpoint_receive_datagram( endpoint, 
+                                                reassembly_data->packet_data + RELIABLE_MAX_PACKET_HEADER_BYTES - reassembly_data->packet_header_bytes, 
+                                                reassembly_data->packet_header_bytes + reassembly_data->packet_bytes );
+
+            reliable_sequence_buffer_remove_with_cleanup( endpoint->fragment_reassembly, sequence, reliable_fragment_reassembly_data_cleanup );
+        }
+
+        reliable_endpoint_increment_counter( endpoint, RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED );
+    }
+}
+
+RELIABLE_HOT void reliable_endpoint_receive_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( endpoint );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    if ( reliable_capturing() )
+    {
+        reliable_capture_packet( RELIABLE_CAPTURE_RECEIVE, endpoint->config.id, endpoint->time, packet_data, packet_bytes );
+    }
+
+    reliable_endpoint_receive_datagram( endpoint, packet_data, packet_bytes );
+}
+
+void reliable_endpoint_free_packet( struct reliable_endpoint_t * endpoint, void * packet )
+{
+    reliable_assert( endpoint );
+    reliable_assert( packet );
+    endpoint->free_function( endpoint->allocator_context, packet );
+}
+
+uint16_t * reliable_endpoint_get_acks( struct reliable_endpoint_t * endpoint, int * num_acks )
+{
+    reliable_assert( endpoint );
+    reliable_assert( num_acks );
+    *num_acks = endpoint->num_acks;
+    return endpoint->acks;
+}
+
+void reliable_endpoint_clear_acks( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    endpoint->num_acks = 0;
+}
+
+void reliable_endpoint_reset( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+
+    endpoint->num_acks = 0;
+    endpoint->sequence = 0;
+
+    memset( endpoint->acks, 0, endpoint->config.ack_buffer_size * sizeof( uint16_t ) );
+    int i;
+    for ( i = 0; i < RELIABLE_ENDPOINT_NUM_COUNTERS; ++i )
+    {
+        reliable_atomic_store_relaxed_uint64( endpoint->counters + i, 0 );
+    }
+
+    for ( i = 0; i < endpoint->config.fragment_reassembly_buffer_size; ++i )
+    {
+        struct reliable_fragment_reassembly_data_t * reassembly_data = (struct reliable_fragment_reassembly_data_t*) 
+            reliable_sequence_buffer_at_index( endpoint->fragment_reassembly, i );
+
+        if ( reassembly_data && reassembly_data->packet_data )
+        {
+            endpoint->free_function( endpoint->allocator_context, reassembly_data->packet_data );
+            reassembly_data->packet_data = NULL;
+        }
+    }
+
+    reliable_sequence_buffer_reset( endpoint->sent_packets );
+    reliable_sequence_buffer_reset( endpoint->received_packets );
+    reliable_sequence_buffer_reset( endpoint->fragment_reassembly );
+
+    reliable_endpoint_clear_send_queue( endpoint );
+
+    reliable_endpoint_reset_mtu( endpoint );
+
+    reliable_bandwidth_window_reset( &endpoint->bandwidth_window, endpoint->time );
+
+    reliable_endpoint_reset_profile( endpoint );
+
+    reliable_endpoint_reset_histograms( endpoint );
+
+    reliable_endpoint_publish_snapshot( endpoint );
+}
+
+RELIABLE_HOT void reliable_endpoint_update( struct reliable_endpoint_t * endpoint, double time )
+{
+    reliable_assert( endpoint );
+
+    if ( reliable_capturing() )
+    {
+        reliable_capture_write( RELIABLE_CAPTURE_UPDATE, endpoint->config.id, time, NULL, 0, 0 );
+    }
+
+    reliable_profile_start( profile_start );
+
+    endpoint->time = time;
+
+    // calculate rtt min, max and avg, and jitter vs. min and avg rtt. the loops over the history are simd kernels
+
+    {
+        float min_rtt, max_rtt, sum_rtt;
+        int count;
+        reliable_simd->rtt_stats( endpoint->rtt_history_buffer, endpoint->config.rtt_history_size, &min_rtt, &max_rtt, &sum_rtt, &count );
+        if ( min_rtt == 10000.0f )
+        {
+            min_rtt = 0.0f;
+        }
+        endpoint->rtt_min = min_rtt;
+        endpoint->rtt_max = max_rtt;
+        if ( count > 0 )
+        {
+            // every sample is at least min, so the jitter vs. min is the avg and max less the min
+
+            endpoint->rtt_avg = sum_rtt / (float)count;
+            endpoint->jitter_avg_vs_min_rtt = endpoint->rtt_avg > min_rtt ? endpoint->rtt_avg - min_rtt : 0.0f;
+            endpoint->jitter_max_vs_min_rtt = max_rtt > min_rtt ? max_rtt - min_rtt : 0.0f;
+            float sum = reliable_simd->rtt_squared_deviation( endpoint->rtt_history_buffer, endpoint->config.rtt_history_size, endpoint->rtt_avg );
+            endpoint->jitter_stddev_vs_avg_rtt = (float) pow( sum / (float)count, 0.5f );
+        }
+        else
+        {
+            endpoint->rtt_avg = 0.0f;
+            endpoint->jitter_avg_vs_min_rtt = 0.0f;
+            endpoint->jitter_max_vs_min_rtt = 0.0f;
+            endpoint->jitter_stddev_vs_avg_rtt = 0.0f;
+        }
+    }
+
+    reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_UPDATE_RTT, profile_start );
+
+    // calculate packet loss
+    {
+        uint32_t base_sequence = ( endpoint->sent_packets->sequence - endpoint->config.sent_packets_buffer_size + 1 ) + 0xFFFF;
+        int i;
+        int num_sent = 0;
+        int num_dropped = 0;
+        int num_samples = endpoint->config.sent_packets_buffer_size / 2;
+        for ( i = 0; i < num_samples; ++i )
+        {
+            uint16_t sequence = (uint16_t) ( base_sequence + i );
+            struct reliable_sent_packet_data_t * sent_packet_data = (struct reliable_sent_packet_data_t*) reliable_sequence_buffer_find( endpoint->sent_packets, sequence );
+            if ( sent_packet_data && !sent_packet_data->probe )
+            {
+                num_sent++;
+                if ( !sent_packet_data->acked )
+                {
+                    num_dropped++;
+                }
+            }
+        }
+        if ( num_sent > 0 )
+        {
+            float packet_loss = ( (float) num_dropped ) / ( (float) num_sent ) * 100.0f;
+            if ( fabs( endpoint->packet_loss - packet_loss ) > 0.00001 )
+            {
+                endpoint->packet_loss += ( packet_loss - endpoint->packet_loss ) * endpoint->config.packet_loss_smoothing_factor;
+            }
+            else
+            {
+                endpoint->packet_loss = packet_loss;
+            }
+        }
+        else
+        {
+            endpoint->packet_loss = 0.0f;
+        }
+    }
+
+    // the aggregator's loss distribution holds each endpoint's current loss, so move this one to its new bucket
+
+    if ( endpoint->stats_shard )
+    {
+        int bucket = reliable_stats_packet_loss_bucket( endpoint->packet_loss );
+        if ( bucket != endpoint->stats_packet_loss_bucket )
+        {
+            reliable_stats_subtract( endpoint->stats_shard->packet_loss + endpoint->stats_packet_loss_bucket, 1 );
+            reliable_stats_add( endpoint->stats_shard->packet_loss + bucket, 1 );
+            endpoint->stats_packet_loss_bucket = bucket;
+        }
+    }
+
+    reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_UPDATE_PACKET_LOSS, profile_start );
+
+    // calculate sent, received and acked bandwidth over the window
+
+    {
+        struct reliable_bandwidth_window_t * window = &endpoint->bandwidth_window;
+
+        reliable_bandwidth_window_advance( window, time );
+
+        double window_start = ( (double) window->newest_bucket - ( window->num_buckets - 1 ) ) * RELIABLE_BANDWIDTH_BUCKET_TIME;
+        if ( window_start < window->start_time )
+        {
+            window_start = window->start_time;
+        }
+
+        if ( time > window_start )
+        {
+            endpoint->sent_bandwidth_kbps = reliable_bandwidth_window_kbps( window->sent_bytes, time - window_start );
+            endpoint->received_bandwidth_kbps = reliable_bandwidth_window_kbps( window->received_bytes, time - window_start );
+            endpoint->acked_bandwidth_kbps = reliable_bandwidth_window_kbps( window->acked_bytes, time - window_start );
+        }
+    }
+
+    reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_UPDATE_BANDWIDTH, profile_start );
+
+    if ( endpoint->config.mtu_probing )
+    {
+        reliable_endpoint_update_mtu( endpoint );
+
+        reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_UPDATE_MTU, profile_start );
+    }
+
+    reliable_endpoint_publish_snapshot( endpoint );
+
+    reliable_profile_phase( endpoint, RELIABLE_PROFILE_PHASE_UPDATE_SNAPSHOT, profile_start );
+}
+
+float reliable_endpoint_rtt( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->rtt;
+}
+
+float reliable_endpoint_rtt_min( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->rtt_min;
+}
+
+float reliable_endpoint_rtt_max( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->rtt_max;
+}
+
+float reliable_endpoint_rtt_avg( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->rtt_avg;
+}
+
+float reliable_endpoint_jitter_avg_vs_min_rtt( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->jitter_avg_vs_min_rtt;
+}
+
+float reliable_endpoint_jitter_max_vs_min_rtt( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->jitter_max_vs_min_rtt;
+}
+
+
+float reliable_endpoint_jitter_stddev_vs_avg_rtt( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->jitter_stddev_vs_avg_rtt;
+}
+
+float reliable_endpoint_packet_loss( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->packet_loss;
+}
+
+void reliable_endpoint_bandwidth( struct reliable_endpoint_t * endpoint, float * sent_bandwidth_kbps, float * received_bandwidth_kbps, float * acked_bandwidth_kbps )
+{
+    reliable_assert( endpoint );
+    reliable_assert( sent_bandwidth_kbps );
+    reliable_assert( acked_bandwidth_kbps );
+    reliable_assert( received_bandwidth_kbps );
+    *sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
+    *received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
+    *acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+}
+
+int reliable_endpoint_mtu( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->mtu;
+}
+
+RELIABLE_CONST struct reliable_histogram_t * reliable_endpoint_rtt_histogram( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return &endpoint->rtt_histogram;
+}
+
+RELIABLE_CONST struct reliable_histogram_t * reliable_endpoint_jitter_histogram( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return &endpoint->jitter_histogram;
+}
+
+float reliable_endpoint_rtt_percentile( struct reliable_endpoint_t * endpoint, float percentile )
+{
+    reliable_assert( endpoint );
+    return reliable_histogram_percentile( &endpoint->rtt_histogram, percentile );
+}
+
+float reliable_endpoint_jitter_percentile( struct reliable_endpoint_t * endpoint, float percentile )
+{
+    reliable_assert( endpoint );
+    return reliable_histogram_percentile( &endpoint->jitter_histogram, percentile );
+}
+
+void reliable_endpoint_reset_histograms( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    reliable_histogram_reset( &endpoint->rtt_histogram );
+    reliable_histogram_reset( &endpoint->jitter_histogram );
+    endpoint->rtt_last = 0.0f;
+}
+
+void reliable_stats_aggregator_add_endpoint( struct reliable_stats_aggregator_t * aggregator, int shard, struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( aggregator );
+    reliable_assert( shard >= 0 );
+    reliable_assert( shard < aggregator->num_shards );
+    reliable_assert( endpoint );
+    reliable_assert( endpoint->stats_shard == NULL );
+
+    endpoint->stats_shard = aggregator->shards + shard;
+    endpoint->stats_packet_loss_bucket = reliable_stats_packet_loss_bucket( endpoint->packet_loss );
+
+    reliable_stats_add( &endpoint->stats_shard->num_endpoints, 1 );
+    reliable_stats_add( endpoint->stats_shard->packet_loss + endpoint->stats_packet_loss_bucket, 1 );
+}
+
+void reliable_stats_aggregator_remove_endpoint( struct reliable_stats_aggregator_t * aggregator, struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( aggregator );
+    reliable_assert( endpoint );
+    reliable_assert( endpoint->stats_shard >= aggregator->shards && endpoint->stats_shard < aggregator->shards + aggregator->num_shards );
+    (void) aggregator;
+    reliable_endpoint_leave_stats( endpoint );
+}
+
+RELIABLE_CONST uint64_t * reliable_endpoint_counters( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+    return endpoint->counters;
+}
+
+uint64_t reliable_endpoint_counter( struct reliable_endpoint_t * endpoint, int counter )
+{
+    reliable_assert( endpoint );
+    reliable_assert( counter >= 0 );
+    reliable_assert( counter < RELIABLE_ENDPOINT_NUM_COUNTERS );
+    return reliable_atomic_load_relaxed_uint64( endpoint->counters + counter );
+}
+
+void reliable_endpoint_snapshot( struct reliable_endpoint_t * endpoint, struct reliable_endpoint_snapshot_t * snapshot )
+{
+    reliable_assert( endpoint );
+    reliable_assert( snapshot );
+
+    uint32_t words[RELIABLE_ENDPOINT_SNAPSHOT_WORDS];
+
+    while ( 1 )
+    {
+        uint32_t sequence = reliable_atomic_load_acquire_uint32( &endpoint->snapshot_sequence );
+        if ( sequence & 1 )
+            continue;
+
+        int i;
+        for ( i = 0; i < (int) RELIABLE_ENDPOINT_SNAPSHOT_WORDS; ++i )
+        {
+            words[i] = reliable_atomic_load_relaxed_uint32( endpoint->snapshot_data + i );
+        }
+
+        reliable_atomic_fence_acquire();
+
+        if ( reliable_atomic_load_relaxed_uint32( &endpoint->snapshot_sequence ) == sequence )
+            break;
+    }
+
+    memcpy( snapshot, words, sizeof( struct reliable_endpoint_snapshot_t ) );
+}
+
+static RELIABLE_CONST char * reliable_profile_phase_names[RELIABLE_PROFILE_NUM_PHASES] =
+{
+    "send_prepare",
+    "send_transmit",
+    "receive_header",
+    "receive_checks",
+    "receive_process",
+    "receive_acks",
+    "receive_reassembly",
+    "update_rtt",
+    "update_packet_loss",
+    "update_bandwidth",
+    "update_mtu",
+    "update_snapshot",
+};
+
+RELIABLE_CONST char * reliable_profile_phase_name( int phase )
+{
+    reliable_assert( phase >= 0 );
+    reliable_assert( phase < RELIABLE_PROFILE_NUM_PHASES );
+    return reliable_profile_phase_names[phase];
+}
+
+void reliable_endpoint_profile( struct reliable_endpoint_t * endpoint, struct reliable_profile_phase_t * phases )
+{
+    reliable_assert( endpoint );
+    reliable_assert( phases );
+#if RELIABLE_PROFILE
+    memcpy( phases, endpoint->profile, sizeof( endpoint->profile ) );
+#else // #if RELIABLE_PROFILE
+    (void) endpoint;
+    memset( phases, 0, sizeof( struct reliable_profile_phase_t ) * RELIABLE_PROFILE_NUM_PHASES );
+#endif // #if RELIABLE_PROFILE
+}
+
+void reliable_endpoint_reset_profile( struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( endpoint );
+#if RELIABLE_PROFILE
+    memset( endpoint->profile, 0, sizeof( endpoint->profile ) );
+#else // #if RELIABLE_PROFILE
+    (void) endpoint;
+#endif // #if RELIABLE_PROFILE
+}
+
+void reliable_copy_string( char * dest, RELIABLE_CONST char * source, size_t dest_size )
+{
+    reliable_assert( dest );
+    reliable_assert( source );
+    reliable_assert( dest_size >= 1 );
+    memset( dest, 0, dest_size );
+    for ( size_t i = 0; i < dest_size - 1; i++ )
+    {
+        if ( source[i] == '\0' )
+            break;
+        dest[i] = source[i];
+    }
+}
+
+// ---------------------------------------------------------------
+
+#if RELIABLE_ENABLE_TESTS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+static void check_handler( RELIABLE_CONST char * condition, 
+                           RELIABLE_CONST char * function,
+                           RELIABLE_CONST char * file,
+                           int line )
+{
+    printf( "check failed: ( %s ), function %s, file %s, line %d\n", condition, function, file, line );
+#ifdef RELIABLE_DEBUG
+    #if defined( __GNUC__ )
+        __builtin_trap();
+    #elif defined( _MSC_VER )
+        __debugbreak();
+    #endif
+#endif
+    exit( 1 );
+}
+
+#define check( condition )                                                                                      \
+do                                                                                                              \
+{                                                                                                               \
+    if ( !(condition) )                                                                                         \
+    {                                                                                                           \
+        check_handler( #condition, (RELIABLE_CONST char*) __FUNCTION__, __FILE__, __LINE__ );                   \
+    }                                                                                                           \
+} while(0)
+
+static void test_endian()
+{
+    uint32_t value = 0x11223344;
+
+    char * bytes = (char*) &value;
+
+#if RELIABLE_LITTLE_ENDIAN
+
+    check( bytes[0] == 0x44 );
+    check( bytes[1] == 0x33 );
+    check( bytes[2] == 0x22 );
+    check( bytes[3] == 0x11 );
+
+#else // #if RELIABLE_LITTLE_ENDIAN
+
+    check( bytes[3] == 0x44 );
+    check( bytes[2] == 0x33 );
+    check( bytes[1] == 0x22 );
+    check( bytes[0] == 0x11 );
+
+#endif // #if RELIABLE_LITTLE_ENDIAN
+}
+
+struct test_sequence_data_t
+{
+    uint16_t sequence;
+};
+
+#define TEST_SEQUENCE_BUFFER_SIZE 256
+
+static void test_sequence_buffer()
+{
+    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
+                                                                                           sizeof( struct test_sequence_data_t ), 
+                                                                                           NULL, 
+                                                                                           NULL, 
+                                                                                           NULL );
+
+    check( sequence_buffer );
+    check( sequence_buffer->sequence == 0 );
+    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
+    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+
+    int i;
+    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        check( reliable_sequence_buffer_find( sequence_buffer, ((uint16_t)i) ) == NULL );
+    }                                                                      
+
+    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE*4; ++i )
+    {
+        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
+        check( entry );
+        entry->sequence = (uint16_t) i;
+        check( sequence_buffer->sequence == i + 1 );
+    }
+
+    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
+        check( entry == NULL );
+    }    
+
+    int index = TEST_SEQUENCE_BUFFER_SIZE * 4;
+    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_find( sequence_buffer, (uint16_t) index );
+        check( entry );
+        check( entry->sequence == (uint32_t) index );
+        index--;
+    }
+
+    reliable_sequence_buffer_reset( sequence_buffer );
+
+    check( sequence_buffer );
+    check( sequence_buffer->sequence == 0 );
+    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
+    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+
+    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        check( reliable_sequence_buffer_find( sequence_buffer, (uint16_t) i ) == NULL );
+    }
+
+    reliable_sequence_buffer_destroy( sequence_buffer );
+}
+
+static void test_sequence_buffer_index()
+{
+    // a power of two size indexes with a mask, anything else with a modulo. both must agree with the modulo across the 16 bit wrap
+
+    int sizes[] = { 1, 100, 256, 1000, 1024 };
+    int i;
+    for ( i = 0; i < (int) ( sizeof( sizes ) / sizeof( sizes[0] ) ); ++i )
+    {
+        struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( sizes[i], 
+                                                                                               sizeof( struct test_sequence_data_t ), 
+                                                                                               NULL, 
+                                                                                               NULL, 
+                                                                                               NULL );
+
+        check( ( sequence_buffer->index_mask != 0 ) == ( sizes[i] > 1 && ( sizes[i] & ( sizes[i] - 1 ) ) == 0 ) );
+
+        uint32_t sequence;
+        for ( sequence = 0; sequence < 65536 + 2048; ++sequence )
+        {
+            check( reliable_sequence_buffer_index( sequence_buffer, sequence ) == (int) ( sequence % (uint32_t) sizes[i] ) );
+        }
+
+        sequence_buffer->sequence = 65500;
+        uint16_t s = 65500;
+        int j;
+        for ( j = 0; j < 200; ++j, ++s )
+        {
+            struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, s );
+            check( entry );
+            entry->sequence = s;
+        }
+
+        s = (uint16_t) ( 65500 + 200 - 1 );
+        for ( j = 0; j < sizes[i] && j < 200; ++j, --s )
+        {
+            struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_find( sequence_buffer, s );
+            check( entry );
+            check( entry->sequence == s );
+        }
+
+        reliable_sequence_buffer_destroy( sequence_buffer );
+    }
+}
+
+static void test_generate_ack_bits()
+{
+    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
+                                                                                           sizeof( struct test_sequence_data_t ), 
+                                                                                           NULL, 
+                                                                                           NULL, 
+                                                                                           NULL );
+
+    uint16_t ack = 0;
+    uint32_t ack_bits = 0xFFFFFFFF;
+
+    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+    check( ack == 0xFFFF );
+    check( ack_bits == 0 );
+
+    int i;
+    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    {
+        reliable_sequence_buffer_insert( sequence_buffer, (uint16_t) i );
+    }
+
+    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+    check( ack == TEST_SEQUENCE_BUFFER_SIZE );
+    check( ack_bits == 0xFFFFFFFF );
+
+    reliable_sequence_buffer_reset( sequence_buffer );
+
+    uint16_t input_acks[] = { 1, 5, 9, 11 };
+    int input_num_acks = sizeof( input_acks ) / sizeof( uint16_t );
+    for ( i = 0; i < input_num_acks; ++i )
+    {
+        reliable_sequence_buffer_insert( sequence_buffer, input_acks[i] );
+    }
+
+    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+
+    check( ack == 11 );
+    check( ack_bits == ( 1 | (1<<(11-9)) | (1<<(11-5)) | (1<<(11-1)) ) );
+
+    reliable_sequence_buffer_destroy( sequence_buffer );
+}
+
+static void test_simd_kernels()
+{
+    // every kernel the cpu supports must agree with the scalar one. min, max and count exactly, sums to rounding
+
+    const struct reliable_simd_kernels_t * scalar = &reliable_simd_kernels[0];
+    RELIABLE_CONST char * previous = reliable_simd_name();
+
+    check( reliable_simd_set( "scalar" ) == RELIABLE_OK );
+    check( strcmp( reliable_simd_name(), "scalar" ) == 0 );
+    check( reliable_simd_set( "not a kernel" ) == RELIABLE_ERROR );
+    check( strcmp( reliable_simd_name(), "scalar" ) == 0 );
+
+    uint32_t seed = 12345;
+    float rtt[515];
+    uint32_t entry_sequence[32];
+
+    int k;
+    for ( k = 0; k < RELIABLE_NUM_SIMD_KERNELS; ++k )
+    {
+        const struct reliable_simd_kernels_t * kernels = &reliable_simd_kernels[k];
+        if ( !kernels->supported() )
+            continue;
+
+        check( reliable_simd_set( kernels->name ) == RELIABLE_OK );
+        check( strcmp( reliable_simd_name(), kernels->name ) == 0 );
+
+        int iteration;
+        for ( iteration = 0; iteration < 1000; ++iteration )
+        {
+            int n = iteration < 70 ? iteration : 70 + (int) ( ( seed >> 16 ) % 446 );
+            int invalid_percent = iteration % 4 == 0 ? 100 : (int) ( iteration % 5 ) * 20;
+            int i;
+            for ( i = 0; i < n; ++i )
+            {
+                seed = seed * 1664525U + 1013904223U;
+                if ( (int) ( ( seed >> 8 ) % 100 ) < invalid_percent )
+                    rtt[i] = -1.0f;
+                else
+                    rtt[i] = (float) ( ( seed >> 12 ) % 20000 ) * 0.05f;
+            }
+
+            float expected_min, expected_max, expected_sum, min, max, sum;
+            int expected_count, count;
+            scalar->rtt_stats( rtt, n, &expected_min, &expected_max, &expected_sum, &expected_count );
+            kernels->rtt_stats( rtt, n, &min, &max, &sum, &count );
+            check( min == expected_min );
+            check( max == expected_max );
+            check( count == expected_count );
+            check( fabs( sum - expected_sum ) <= 1.0e-4 * expected_sum + 1.0e-3 );
+
+            float mean = count > 0 ? sum / (float) count : 0.0f;
+            float expected_deviation = scalar->rtt_squared_deviation( rtt, n, mean );
+            float deviation = kernels->rtt_squared_deviation( rtt, n, mean );
+            check( fabs( deviation - expected_deviation ) <= 1.0e-3 * expected_deviation + 1.0e-3 );
+        }
+
+        for ( iteration = 0; iteration < 1000; ++iteration )
+        {
+            seed = seed * 1664525U + 1013904223U;
+            uint16_t ack = (uint16_t) ( iteration < 64 ? (uint32_t) ( 65536 - 32 + iteration ) : seed >> 16 );
+            int i;
+            for ( i = 0; i < 32; ++i )
+            {
+                seed = seed * 1664525U + 1013904223U;
+                uint32_t choice = ( seed >> 16 ) % 4;
+                uint16_t sequence = (uint16_t) ( ack - 31 + i );
+                entry_sequence[i] = choice == 0 ? 0xFFFFFFFF : ( choice == 1 ? (uint32_t) (uint16_t) ( sequence - 32 ) : sequence );
+            }
+            check( kernels->ack_bits( entry_sequence, ack ) == scalar->ack_bits( entry_sequence, ack ) );
+        }
+
+        // through a sequence buffer, with ack in every slot, so the wrap falls back to the scalar loop
+
+        struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( 64, 
+                                                                                               sizeof( struct test_sequence_data_t ), 
+                                                                                               NULL, 
+                                                                                               NULL, 
+                                                                                               NULL );
+        uint16_t sequence = 65400;
+        sequence_buffer->sequence = sequence;
+        for ( iteration = 0; iteration < 300; ++iteration, ++sequence )
+        {
+            seed = seed * 1664525U + 1013904223U;
+            if ( ( seed >> 16 ) % 3 != 0 )
+                reliable_sequence_buffer_insert( sequence_buffer, sequence );
+            else
+                reliable_sequence_buffer_advance( sequence_buffer, sequence );
+
+            uint16_t ack;
+            uint32_t ack_bits;
+            reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+            check( ack == sequence );
+            uint32_t expected_ack_bits = 0;
+            int i;
+            for ( i = 0; i < 32; ++i )
+            {
+                if ( reliable_sequence_buffer_exists( sequence_buffer, (uint16_t) ( ack - i ) ) )
+                    expected_ack_bits |= 1U << i;
+            }
+            check( ack_bits == expected_ack_bits );
+        }
+        reliable_sequence_buffer_destroy( sequence_buffer );
+    }
+
+    check( reliable_simd_set( previous ) == RELIABLE_OK );
+}
+
+static void test_packet_header()
+{
+    uint16_t write_sequence;
+    uint16_t write_ack;
+    uint32_t write_ack_bits;
+
+    uint16_t read_sequence;
+    uint16_t read_ack;
+    uint32_t read_ack_bits;
+
+    uint8_t packet_data[RELIABLE_MAX_PACKET_HEADER_BYTES];
+
+    // worst case, sequence and ack are far apart, no packets acked.
+
+    write_sequence = 10000;
+    write_ack = 100;
+    write_ack_bits = 0;
+
+    int bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == RELIABLE_MAX_PACKET_HEADER_BYTES );
+
+    int bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // rare case. sequence and ack are far apart, significant # of acks are missing
+
+    write_sequence = 10000;
+    write_ack = 100;
+    write_ack_bits = 0xFEFEFFFE;
+
+    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == 1 + 2 + 2 + 3 );
+
+    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // common case under packet loss. sequence and ack are close together, some acks are missing
+
+    write_sequence = 200;
+    write_ack = 100;
+    write_ack_bits = 0xFFFEFFFF;
+
+    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == 1 + 2 + 1 + 1 );
+
+    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+
+    // ideal case. no packet loss.
+
+    write_sequence = 200;
+    write_ack = 100;
+    write_ack_bits = 0xFFFFFFFF;
+
+    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+
+    check( bytes_written == 1 + 2 + 1 );
+
+    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+
+    check( bytes_read == bytes_written );
+
+    check( read_sequence == write_sequence );
+    check( read_ack == write_ack );
+    check( read_ack_bits == write_ack_bits );
+}
+
+struct test_context_t
+{
+    int drop;
+    int allow_packets;
+    struct reliable_endpoint_t * sender;
+    struct reliable_endpoint_t * receiver;
+};
+
+void test_default_context( struct test_context_t * context )
+{
+    memset( context, 0, sizeof( *context ) );
+    context->allow_packets = -1;
+}
+
+static void test_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    if ( context->drop )
+    {
+        return;
+    }
+
+    if ( context->allow_packets >= 0 )
+    {
+        if ( context->allow_packets == 0 )
+        {
+            return;
+        }
+
+        context->allow_packets--;
+    }
+
+    if ( id == 0 )
+    {
+        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+    }
+    else if ( id == 1 )
+    {
+        reliable_endpoint_receive_packet( context->sender, packet_data, packet_bytes );
+    }
+}
+
+static int test_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+
+    return 1;
+}
+
+#define TEST_ACKS_NUM_ITERATIONS 256
+
+static void test_acks()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    double delta_time = 0.01;
+
+    int i;
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        time += delta_time;
+    }
+
+    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
+    int sender_num_acks;
+    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
+    for ( i = 0; i < sender_num_acks; ++i )
+    {
+        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+        {
+            sender_acked_packet[sender_acks[i]] = 1;
+        }
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( sender_acked_packet[i] == 1 );
+    }
+
+    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
+    int receiver_num_acks;
+    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.receiver, &receiver_num_acks );
+    for ( i = 0; i < receiver_num_acks; ++i )
+    {
+        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+            receiver_acked_packet[receiver_acks[i]] = 1;
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( receiver_acked_packet[i] == 1 );
+    }
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+static void test_acks_packet_loss()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    const double delta_time = 0.1f;
+
+    int i;
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+        context.drop = ( i % 2 );
+
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        time += delta_time;
+    }
+
+    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
+    int sender_num_acks;
+    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
+    for ( i = 0; i < sender_num_acks; ++i )
+    {
+        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+        {
+            sender_acked_packet[sender_acks[i]] = 1;
+        }
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( sender_acked_packet[i] == (i+1) % 2 );
+    }
+
+    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
+    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
+    int receiver_num_acks;
+    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.receiver, &receiver_num_acks );
+    for ( i = 0; i < receiver_num_acks; ++i )
+    {
+        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
+        {
+            receiver_acked_packet[receiver_acks[i]] = 1;
+        }
+    }
+    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    {
+        check( receiver_acked_packet[i] == (i+1) % 2 );
+    }
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+static int test_duplicate_packets_num_processed = 0;
+
+static void test_duplicate_packets_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    if ( id == 0 )
+    {
+        // deliver each packet to the receiver twice, simulating duplication on the network
+        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+    }
+}
+
+static int test_duplicate_packets_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+
+    test_duplicate_packets_num_processed++;
+
+    return 1;
+}
+
+#define TEST_DUPLICATE_PACKETS_NUM_ITERATIONS 16
+
+static void test_duplicate_packets()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_duplicate_packets_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_duplicate_packets_transmit_packet_function;
+    receiver_config.process_packet_function = &test_duplicate_packets_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    test_duplicate_packets_num_processed = 0;
+
+    int i;
+    for ( i = 0; i < TEST_DUPLICATE_PACKETS_NUM_ITERATIONS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+    }
+
+    check( test_duplicate_packets_num_processed == TEST_DUPLICATE_PACKETS_NUM_ITERATIONS );
+
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 2 * TEST_DUPLICATE_PACKETS_NUM_ITERATIONS );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_DUPLICATE] == TEST_DUPLICATE_PACKETS_NUM_ITERATIONS );
+
+    // duplicate fragments arriving after their packet was delivered must not restart reassembly
+
+    uint16_t fragmented_sequence = reliable_endpoint_next_packet_sequence( context.sender );
+
+    uint8_t large_packet[2048];
+    memset( large_packet, 0, sizeof( large_packet ) );
+    reliable_endpoint_send_packet( context.sender, large_packet, sizeof( large_packet ) );
+
+    check( test_duplicate_packets_num_processed == TEST_DUPLICATE_PACKETS_NUM_ITERATIONS + 1 );
+    check( !reliable_sequence_buffer_exists( context.receiver->fragment_reassembly, fragmented_sequence ) );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+static uint8_t test_stale_packets_first_packet[64];
+static int test_stale_packets_first_packet_bytes = 0;
+static int test_stale_packets_num_processed = 0;
+
+static void test_stale_packets_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    struct test_context_t * context = (struct test_context_t*) _context;
+
+    if ( id == 0 )
+    {
+        if ( sequence == 0 && test_stale_packets_first_packet_bytes == 0 )
+        {
+            reliable_assert( packet_bytes <= (int) sizeof( test_stale_packets_first_packet ) );
+            memcpy( test_stale_packets_first_packet, packet_data, packet_bytes );
+            test_stale_packets_first_packet_bytes = packet_bytes;
+        }
+
+        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+    }
+}
+
+static int test_stale_packets_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+
+    test_stale_packets_num_processed++;
+
+    return 1;
+}
+
+#define TEST_STALE_PACKETS_NUM_ITERATIONS 300
+
+static void test_stale_packets()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_stale_packets_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_stale_packets_transmit_packet_function;
+    receiver_config.process_packet_function = &test_stale_packets_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    test_stale_packets_first_packet_bytes = 0;
+    test_stale_packets_num_processed = 0;
+
+    // send enough packets that sequence 0 falls out of the receive window (256 entries)
+
+    int i;
+    for ( i = 0; i < TEST_STALE_PACKETS_NUM_ITERATIONS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+    }
+
+    check( test_stale_packets_num_processed == TEST_STALE_PACKETS_NUM_ITERATIONS );
+    check( test_stale_packets_first_packet_bytes > 0 );
+
+    // replaying the first packet must be rejected as stale, not processed
+
+    reliable_endpoint_receive_packet( context.receiver, test_stale_packets_first_packet, test_stale_packets_first_packet_bytes );
+
+    check( test_stale_packets_num_processed == TEST_STALE_PACKETS_NUM_ITERATIONS );
+
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE] == 1 );
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+#define TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS 32
+#define TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE 16
+
+static void test_ack_buffer_overflow()
+{
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    // undersized ack buffer on the sender, so a single received packet acking 32 sent packets overflows it
+
+    sender_config.ack_buffer_size = TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE;
+
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    int i;
+    for ( i = 0; i < TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS; ++i )
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+    }
+
+    // one packet back from the receiver acks all 32, but only 16 fit in the ack buffer. the rest are dropped
+
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+    }
 
-float reliable_endpoint_rtt_min( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->rtt_min;
-}
+    int num_acks;
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE );
 
-float reliable_endpoint_rtt_max( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->rtt_max;
-}
+    RELIABLE_CONST uint64_t * sender_counters = reliable_endpoint_counters( context.sender );
+    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE );
 
-float reliable_endpoint_rtt_avg( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->rtt_avg;
-}
+    // once the caller clears acks, the dropped acks are reported on the next packet that covers them
 
-float reliable_endpoint_jitter_avg_vs_min_rtt( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->jitter_avg_vs_min_rtt;
-}
+    reliable_endpoint_clear_acks( context.sender );
 
-float reliable_endpoint_jitter_max_vs_min_rtt( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->jitter_max_vs_min_rtt;
-}
+    {
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+    }
 
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS - TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE );
+    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS );
 
-float reliable_endpoint_jitter_stddev_vs_avg_rtt( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->jitter_stddev_vs_avg_rtt;
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
-float reliable_endpoint_packet_loss( struct reliable_endpoint_t * endpoint )
-{
-    reliable_assert( endpoint );
-    return endpoint->packet_loss;
-}
+#define TEST_MAX_PACKET_BYTES (4*1024)
 
-void reliable_endpoint_bandwidth( struct reliable_endpoint_t * endpoint, float * sent_bandwidth_kbps, float * received_bandwidth_kbps, float * acked_bandwidth_kbps )
+static void generate_packet_data_with_size( uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    reliable_assert( endpoint );
-    reliable_assert( sent_bandwidth_kbps );
-    reliable_assert( acked_bandwidth_kbps );
-    reliable_assert( received_bandwidth_kbps );
-    *sent_bandwidth_kbps = endpoint->sent_bandwidth_kbps;
-    *received_bandwidth_kbps = endpoint->received_bandwidth_kbps;
-    *acked_bandwidth_kbps = endpoint->acked_bandwidth_kbps;
+    reliable_assert( packet_bytes >= 2 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+
+    packet_data[0] = (uint8_t) ( sequence & 0xFF );
+    packet_data[1] = (uint8_t) ( (sequence>>8) & 0xFF );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
+    {
+        packet_data[i] = (uint8_t) ( ( (int)i + sequence ) % 256 );
+    }
 }
 
-RELIABLE_CONST uint64_t * reliable_endpoint_counters( struct reliable_endpoint_t * endpoint )
+static int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
 {
-    reliable_assert( endpoint );
-    return endpoint->counters;
+    int packet_bytes = ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2;
+    generate_packet_data_with_size( sequence, packet_data, packet_bytes );
+    return packet_bytes;
 }
 
-void reliable_copy_string( char * dest, RELIABLE_CONST char * source, size_t dest_size )
+static void validate_packet_data( uint8_t * packet_data, int packet_bytes )
 {
-    reliable_assert( dest );
-    reliable_assert( source );
-    reliable_assert( dest_size >= 1 );
-    memset( dest, 0, dest_size );
-    for ( size_t i = 0; i < dest_size - 1; i++ )
+    reliable_assert( packet_bytes >= 2 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    uint16_t sequence = 0;
+    sequence |= (uint16_t) packet_data[0];
+    sequence |= ( (uint16_t) packet_data[1] ) << 8;
+    check( packet_bytes == ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2 );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
     {
-        if ( source[i] == '\0' )
-            break;
-        dest[i] = source[i];
+        check( packet_data[i] == (uint8_t) ( ( (int)i + sequence ) % 256 ) );
     }
 }
 
-// ---------------------------------------------------------------
-
-#if RELIABLE_ENABLE_TESTS
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <memory.h>
-
-static void check_handler( RELIABLE_CONST char * condition, 
-                           RELIABLE_CONST char * function,
-                           RELIABLE_CONST char * file,
-                           int line )
-{
-    printf( "check failed: ( %s ), function %s, file %s, line %d\n", condition, function, file, line );
-#ifdef RELIABLE_DEBUG
-    #if defined( __GNUC__ )
-        __builtin_trap();
-    #elif defined( _MSC_VER )
-        __debugbreak();
-    #endif
-#endif
-    exit( 1 );
-}
-
-#define check( condition )                                                                                      \
-do                                                                                                              \
-{                                                                                                               \
-    if ( !(condition) )                                                                                         \
-    {                                                                                                           \
-        check_handler( #condition, (RELIABLE_CONST char*) __FUNCTION__, __FILE__, __LINE__ );                   \
-    }                                                                                                           \
-} while(0)
-
-static void test_endian()
+static int test_process_packet_function_validate( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    uint32_t value = 0x11223344;
-
-    char * bytes = (char*) &value;
-
-#if RELIABLE_LITTLE_ENDIAN
-
-    check( bytes[0] == 0x44 );
-    check( bytes[1] == 0x33 );
-    check( bytes[2] == 0x22 );
-    check( bytes[3] == 0x11 );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
 
-#else // #if RELIABLE_LITTLE_ENDIAN
+    (void) context;
+    (void) id;
+    (void) sequence;
 
-    check( bytes[3] == 0x44 );
-    check( bytes[2] == 0x33 );
-    check( bytes[1] == 0x22 );
-    check( bytes[0] == 0x11 );
+    validate_packet_data( packet_data, packet_bytes );
 
-#endif // #if RELIABLE_LITTLE_ENDIAN
+    return 1;
 }
 
-struct test_sequence_data_t
+static int generate_packet_data_large( uint8_t* packet_data )
 {
-    uint16_t sequence;
-};
+    int data_bytes = TEST_MAX_PACKET_BYTES - 2;
+    reliable_assert( data_bytes >= 2) ;
+    reliable_assert( data_bytes <= (1 << 16) );
 
-#define TEST_SEQUENCE_BUFFER_SIZE 256
+    packet_data[0] = (uint8_t) (data_bytes & 0xFF);
+    packet_data[1] = (uint8_t) ( (data_bytes >> 8) & 0xFF );
+    int i;
+    for ( i = 2; i < data_bytes; ++i )
+    {
+        packet_data[i] = (uint8_t) ( i % 256 );
+    }
+    return data_bytes + 2;
+}
 
-static void test_sequence_buffer()
+static int test_process_packet_function_validate_large( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
-                                                                                           sizeof( struct test_sequence_data_t ), 
-                                                                                           NULL, 
-                                                                                           NULL, 
-                                                                                           NULL );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes >= 2 );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
 
-    check( sequence_buffer );
-    check( sequence_buffer->sequence == 0 );
-    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
-    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+    (void) context;
+    (void) id;
+    (void) sequence;
 
+    uint16_t data_bytes = 0;
+    data_bytes |= (uint16_t) packet_data[0];
+    data_bytes |= ( (uint16_t) packet_data[1] ) << 8;
+    check( packet_bytes == data_bytes + 2 );
     int i;
-    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
-    {
-        check( reliable_sequence_buffer_find( sequence_buffer, ((uint16_t)i) ) == NULL );
-    }                                                                      
-
-    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE*4; ++i )
+    for ( i = 2; i < data_bytes; ++i )
     {
-        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
-        check( entry );
-        entry->sequence = (uint16_t) i;
-        check( sequence_buffer->sequence == i + 1 );
+        check( packet_data[i] == (uint8_t) ( i  % 256 ) );
     }
 
-    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
-    {
-        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_insert( sequence_buffer, ((uint16_t)i) );
-        check( entry == NULL );
-    }    
+    return 1;
+}
 
-    int index = TEST_SEQUENCE_BUFFER_SIZE * 4;
-    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
-    {
-        struct test_sequence_data_t * entry = (struct test_sequence_data_t*) reliable_sequence_buffer_find( sequence_buffer, (uint16_t) index );
-        check( entry );
-        check( entry->sequence == (uint32_t) index );
-        index--;
-    }
+void test_packets()
+{
+    double time = 100.0;
 
-    reliable_sequence_buffer_reset( sequence_buffer );
+    struct test_context_t context;
+    test_default_context( &context );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
 
-    check( sequence_buffer );
-    check( sequence_buffer->sequence == 0 );
-    check( sequence_buffer->num_entries == TEST_SEQUENCE_BUFFER_SIZE );
-    check( sequence_buffer->entry_stride == sizeof( struct test_sequence_data_t ) );
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
 
-    for ( i = 0; i < TEST_SEQUENCE_BUFFER_SIZE; ++i )
-    {
-        check( reliable_sequence_buffer_find( sequence_buffer, (uint16_t) i ) == NULL );
-    }
+    sender_config.fragment_above = 500;
+    receiver_config.fragment_above = 500;
 
-    reliable_sequence_buffer_destroy( sequence_buffer );
-}
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function_validate;
 
-static void test_generate_ack_bits()
-{
-    struct reliable_sequence_buffer_t * sequence_buffer = reliable_sequence_buffer_create( TEST_SEQUENCE_BUFFER_SIZE, 
-                                                                                           sizeof( struct test_sequence_data_t ), 
-                                                                                           NULL, 
-                                                                                           NULL, 
-                                                                                           NULL );
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function_validate;
 
-    uint16_t ack = 0;
-    uint32_t ack_bits = 0xFFFFFFFF;
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
-    check( ack == 0xFFFF );
-    check( ack_bits == 0 );
+    double delta_time = 0.1;
 
     int i;
-    for ( i = 0; i <= TEST_SEQUENCE_BUFFER_SIZE; ++i )
+    for ( i = 0; i < 16; ++i )
     {
-        reliable_sequence_buffer_insert( sequence_buffer, (uint16_t) i );
-    }
-
-    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
-    check( ack == TEST_SEQUENCE_BUFFER_SIZE );
-    check( ack_bits == 0xFFFFFFFF );
+        {
+            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+            int packet_bytes = generate_packet_data( sequence, packet_data );
+            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        }
 
-    reliable_sequence_buffer_reset( sequence_buffer );
+        {
+            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+            int packet_bytes = generate_packet_data( sequence, packet_data );
+            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        }
 
-    uint16_t input_acks[] = { 1, 5, 9, 11 };
-    int input_num_acks = sizeof( input_acks ) / sizeof( uint16_t );
-    for ( i = 0; i < input_num_acks; ++i )
-    {
-        reliable_sequence_buffer_insert( sequence_buffer, input_acks[i] );
-    }
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
 
-    reliable_sequence_buffer_generate_ack_bits( sequence_buffer, &ack, &ack_bits );
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
 
-    check( ack == 11 );
-    check( ack_bits == ( 1 | (1<<(11-9)) | (1<<(11-5)) | (1<<(11-1)) ) );
+        time += delta_time;
+    }
 
-    reliable_sequence_buffer_destroy( sequence_buffer );
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
-static void test_packet_header()
+void test_large_packets()
 {
-    uint16_t write_sequence;
-    uint16_t write_ack;
-    uint32_t write_ack_bits;
-
-    uint16_t read_sequence;
-    uint16_t read_ack;
-    uint32_t read_ack_bits;
-
-    uint8_t packet_data[RELIABLE_MAX_PACKET_HEADER_BYTES];
-
-    // worst case, sequence and ack are far apart, no packets acked.
+    double time = 100.0;
 
-    write_sequence = 10000;
-    write_ack = 100;
-    write_ack_bits = 0;
+    struct test_context_t context;
+    test_default_context( &context );
 
-    int bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
 
-    check( bytes_written == RELIABLE_MAX_PACKET_HEADER_BYTES );
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
 
-    int bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    sender_config.max_packet_size = TEST_MAX_PACKET_BYTES;
+    receiver_config.max_packet_size = TEST_MAX_PACKET_BYTES;
 
-    check( bytes_read == bytes_written );
+    sender_config.fragment_above = TEST_MAX_PACKET_BYTES;
+    receiver_config.fragment_above = TEST_MAX_PACKET_BYTES;
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function_validate_large;
 
-    // rare case. sequence and ack are far apart, significant # of acks are missing
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function_validate_large;
 
-    write_sequence = 10000;
-    write_ack = 100;
-    write_ack_bits = 0xFEFEFFFE;
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+    {
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        int packet_bytes = generate_packet_data_large( packet_data );
+        check( packet_bytes == TEST_MAX_PACKET_BYTES );
+        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+    }
 
-    check( bytes_written == 1 + 2 + 2 + 3 );
+    reliable_endpoint_update( context.sender, time );
+    reliable_endpoint_update( context.receiver, time );
 
-    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    reliable_endpoint_clear_acks( context.sender );
+    reliable_endpoint_clear_acks( context.receiver );
 
-    check( bytes_read == bytes_written );
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE] == 0 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 1 );
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+}
 
-    // common case under packet loss. sequence and ack are close together, some acks are missing
+void test_sequence_buffer_rollover()
+{
+    double time = 100.0;
 
-    write_sequence = 200;
-    write_ack = 100;
-    write_ack_bits = 0xFFFEFFFF;
+    struct test_context_t context;
+    test_default_context( &context );
+    
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
 
-    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
 
-    check( bytes_written == 1 + 2 + 1 + 1 );
+    sender_config.fragment_above = 500;
+    receiver_config.fragment_above = 500;
 
-    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
 
-    check( bytes_read == bytes_written );
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    // ideal case. no packet loss.
+    uint8_t packet_data[TEST_MAX_PACKET_BYTES] = {0};
 
-    write_sequence = 200;
-    write_ack = 100;
-    write_ack_bits = 0xFFFFFFFF;
+    int num_packets_sent = 0;
+    int i;
+    for (i = 0; i <= 32767; ++i)
+    {
+        uint8_t packet_data[16] = {0};
+        int packet_bytes = sizeof( packet_data ) / sizeof( uint8_t );
+        reliable_endpoint_next_packet_sequence( context.sender );
+        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
 
-    bytes_written = reliable_write_packet_header( packet_data, write_sequence, write_ack, write_ack_bits );
+        ++num_packets_sent;
+    }
 
-    check( bytes_written == 1 + 2 + 1 );
+    int packet_bytes = sizeof( packet_data ) / sizeof( uint8_t );
+    reliable_endpoint_next_packet_sequence( context.sender );
+    reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+    ++num_packets_sent;
 
-    bytes_read = reliable_read_packet_header( "test_packet_header", packet_data, bytes_written, &read_sequence, &read_ack, &read_ack_bits );
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
 
-    check( bytes_read == bytes_written );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == (uint16_t) num_packets_sent );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
 
-    check( read_sequence == write_sequence );
-    check( read_ack == write_ack );
-    check( read_ack_bits == write_ack_bits );
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
-struct test_context_t
-{
-    int drop;
-    int allow_packets;
-    struct reliable_endpoint_t * sender;
-    struct reliable_endpoint_t * receiver;
-};
+#define ARRAY_LENGTH(x) (sizeof(x) / sizeof((x)[0]))
 
-void test_default_context( struct test_context_t * context )
+struct test_tracking_allocate_context_t
 {
-    memset( context, 0, sizeof( *context ) );
-    context->allow_packets = -1;
-}
+    void* active_allocations[1024];
+};
 
-static void test_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+void * test_tracking_allocate_function( void * context, size_t bytes )
 {
-    (void) sequence;
-
-    struct test_context_t * context = (struct test_context_t*) _context;
-
-    if ( context->drop )
-    {
-        return;
-    }
-
-    if ( context->allow_packets >= 0 )
+    struct test_tracking_allocate_context_t* tracking_context = (struct test_tracking_allocate_context_t*)context;
+    void * allocation = malloc( bytes );
+    int tracking_index;
+    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations); ++tracking_index )
     {
-        if ( context->allow_packets == 0 )
+        if ( tracking_context->active_allocations[tracking_index] == NULL )
         {
-            return;
+            break;
         }
-
-        context->allow_packets--;
     }
 
-    if ( id == 0 )
-    {
-        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
-    }
-    else if ( id == 1 )
+    reliable_assert(tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations));
+    tracking_context->active_allocations[tracking_index] = allocation;
+    return allocation;
+}
+
+void test_tracking_free_function( void * context, void * pointer )
+{
+    struct test_tracking_allocate_context_t* tracking_context = (struct test_tracking_allocate_context_t*)context;
+    int tracking_index;
+    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations); ++tracking_index )
     {
-        reliable_endpoint_receive_packet( context->sender, packet_data, packet_bytes );
+        if ( tracking_context->active_allocations[tracking_index] == pointer )
+        {
+            break;
+        }
     }
-}
-
-static int test_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
-{
-    struct test_context_t * context = (struct test_context_t*) _context;
 
-    (void) context;
-    (void) id;
-    (void) sequence;
-    (void) packet_data;
-    (void) packet_bytes;
-
-    return 1;
+    reliable_assert( tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations) );
+    tracking_context->active_allocations[tracking_index] = NULL;
+    free( pointer );
 }
 
-#define TEST_ACKS_NUM_ITERATIONS 256
-
-static void test_acks()
+void test_fragment_cleanup()
 {
     double time = 100.0;
 
     struct test_context_t context;
     test_default_context( &context );
+
+    struct test_tracking_allocate_context_t tracking_alloc_context;
+    memset( &tracking_alloc_context, 0, sizeof( tracking_alloc_context ) );
     
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
@@ -2060,11 +5673,18 @@ static void test_acks()
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
+    receiver_config.allocator_context = &tracking_alloc_context;
+    receiver_config.allocate_function = &test_tracking_allocate_function;
+    receiver_config.free_function = &test_tracking_free_function;
+    receiver_config.fragment_reassembly_buffer_size = 4;
+
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
     sender_config.process_packet_function = &test_process_packet_function;
 
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
@@ -2073,75 +5693,82 @@ static void test_acks()
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    double delta_time = 0.01;
+    double delta_time = 0.1;
+
+    int packet_sizes[] = {
+        sender_config.fragment_size + sender_config.fragment_size/2,
+        10,
+        10,
+        10,
+        10,
+    };
+
+    // Make sure we're sending more than receiver_config.fragment_reassembly_buffer_size packets, so the buffer wraps around.
+    reliable_assert( (int) ARRAY_LENGTH( packet_sizes ) > receiver_config.fragment_reassembly_buffer_size );
 
     int i;
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    for ( i = 0; i < (int) ARRAY_LENGTH( packet_sizes ); ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        // Only allow one packet per transmit, so that our fragmented packets are only partially
+        // delivered.
+        context.allow_packets = 1;
+        {
+            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+            generate_packet_data_with_size( sequence, packet_data, packet_sizes[i] );
+            reliable_endpoint_send_packet( context.sender, packet_data, packet_sizes[i]);
+        }
 
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
 
-        time += delta_time;
-    }
-
-    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
-    int sender_num_acks;
-    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
-    for ( i = 0; i < sender_num_acks; ++i )
-    {
-        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-        {
-            sender_acked_packet[sender_acks[i]] = 1;
-        }
-    }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
-    {
-        check( sender_acked_packet[i] == 1 );
-    }
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
 
-    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
-    int receiver_num_acks;
-    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.receiver, &receiver_num_acks );
-    for ( i = 0; i < receiver_num_acks; ++i )
-    {
-        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-            receiver_acked_packet[receiver_acks[i]] = 1;
-    }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
-    {
-        check( receiver_acked_packet[i] == 1 );
+        time += delta_time;
     }
 
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
+    
+    // Make sure that there is no memory that hasn't been freed.
+    int tracking_index;
+    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH(tracking_alloc_context.active_allocations); ++tracking_index )
+    {
+        check( tracking_alloc_context.active_allocations[tracking_index] == NULL );
+    }
 }
 
-static void test_acks_packet_loss()
+static void test_endpoint_reset()
 {
     double time = 100.0;
 
     struct test_context_t context;
     test_default_context( &context );
-    
+
+    struct test_tracking_allocate_context_t tracking_alloc_context;
+    memset( &tracking_alloc_context, 0, sizeof( tracking_alloc_context ) );
+
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
 
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
+    sender_config.fragment_above = 500;
+    receiver_config.fragment_above = 500;
+
+    receiver_config.allocator_context = &tracking_alloc_context;
+    receiver_config.allocate_function = &test_tracking_allocate_function;
+    receiver_config.free_function = &test_tracking_free_function;
+
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
     sender_config.process_packet_function = &test_process_packet_function;
 
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
@@ -2150,93 +5777,155 @@ static void test_acks_packet_loss()
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    const double delta_time = 0.1f;
+    // exchange packets both ways so acks and counters accumulate
 
     int i;
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS; ++i )
+    for ( i = 0; i < 8; ++i )
     {
         uint8_t dummy_packet[8];
         memset( dummy_packet, 0, sizeof( dummy_packet ) );
 
-        context.drop = ( i % 2 );
-
         reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
         reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
 
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
 
-        time += delta_time;
+        time += 0.01;
     }
 
-    uint8_t sender_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( sender_acked_packet, 0, sizeof( sender_acked_packet ) );
-    int sender_num_acks;
-    uint16_t * sender_acks = reliable_endpoint_get_acks( context.sender, &sender_num_acks );
-    for ( i = 0; i < sender_num_acks; ++i )
-    {
-        if ( sender_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-        {
-            sender_acked_packet[sender_acks[i]] = 1;
-        }
-    }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+    int num_acks;
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks > 0 );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] > 0 );
+
+    // leave a fragment reassembly in progress on the receiver by delivering only the first fragment of a large packet
+
+    context.allow_packets = 1;
     {
-        check( sender_acked_packet[i] == (i+1) % 2 );
+        uint8_t large_packet[1500];
+        memset( large_packet, 0, sizeof( large_packet ) );
+        reliable_endpoint_send_packet( context.sender, large_packet, sizeof( large_packet ) );
     }
+    context.allow_packets = -1;
 
-    uint8_t receiver_acked_packet[TEST_ACKS_NUM_ITERATIONS];
-    memset( receiver_acked_packet, 0, sizeof( receiver_acked_packet ) );
-    int receiver_num_acks;
-    uint16_t * receiver_acks = reliable_endpoint_get_acks( context.receiver, &receiver_num_acks );
-    for ( i = 0; i < receiver_num_acks; ++i )
+    reliable_endpoint_reset( context.sender );
+    reliable_endpoint_reset( context.receiver );
+
+    check( reliable_endpoint_next_packet_sequence( context.sender ) == 0 );
+    check( reliable_endpoint_next_packet_sequence( context.receiver ) == 0 );
+
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks == 0 );
+
+    for ( i = 0; i < RELIABLE_ENDPOINT_NUM_COUNTERS; ++i )
     {
-        if ( receiver_acks[i] < TEST_ACKS_NUM_ITERATIONS )
-        {
-            receiver_acked_packet[receiver_acks[i]] = 1;
-        }
+        check( reliable_endpoint_counters( context.sender )[i] == 0 );
+        check( reliable_endpoint_counters( context.receiver )[i] == 0 );
     }
-    for ( i = 0; i < TEST_ACKS_NUM_ITERATIONS / 2; ++i )
+
+    // the endpoints must work normally after reset
+
+    for ( i = 0; i < 8; ++i )
     {
-        check( receiver_acked_packet[i] == (i+1) % 2 );
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        time += 0.01;
     }
 
+    reliable_endpoint_get_acks( context.sender, &num_acks );
+    check( num_acks > 0 );
+    check( reliable_endpoint_counters( context.receiver )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] > 0 );
+
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
-}
 
-static int test_duplicate_packets_num_processed = 0;
+    // reset must have freed the in-progress reassembly buffer, and destroy must not double-free it
 
-static void test_duplicate_packets_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+    int tracking_index;
+    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH( tracking_alloc_context.active_allocations ); ++tracking_index )
+    {
+        check( tracking_alloc_context.active_allocations[tracking_index] == NULL );
+    }
+}
+
+static void test_rtt()
 {
-    (void) sequence;
+    double time = 100.0;
+    double delta_time = 0.01;
 
-    struct test_context_t * context = (struct test_context_t*) _context;
+    struct test_context_t context;
+    test_default_context(&context);
 
-    if ( id == 0 )
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config(&sender_config);
+    reliable_default_config(&receiver_config);
+
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create(&sender_config, time);
+    context.receiver = reliable_endpoint_create(&receiver_config, time);
+
+    int i;
+    for (i = 0; i < 1000; ++i)
     {
-        // deliver each packet to the receiver twice, simulating duplication on the network
-        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
-        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+        uint8_t dummy_packet[8];
+        memset(dummy_packet, 0, sizeof(dummy_packet));
+
+        reliable_endpoint_send_packet(context.sender, dummy_packet, sizeof(dummy_packet));
+        reliable_endpoint_send_packet(context.receiver, dummy_packet, sizeof(dummy_packet));
+
+        reliable_endpoint_update(context.sender, time);
+        reliable_endpoint_update(context.receiver, time);
+
+        time += delta_time;
     }
+
+    float rtt = reliable_endpoint_rtt(context.sender);
+    float rtt_min = reliable_endpoint_rtt_min(context.sender);
+    float rtt_max = reliable_endpoint_rtt_max(context.sender);
+    float rtt_avg = reliable_endpoint_rtt_avg(context.sender);
+
+    check(rtt == rtt && rtt >= 0); // Check rtt is finite and non-negative
+    check(rtt_min >= 0 && rtt_min <= rtt_avg && rtt_avg <= rtt_max);
+    check(rtt_max < 1000.0); // Assume RTT is in milliseconds
+
+    reliable_endpoint_destroy(context.sender);
+    reliable_endpoint_destroy(context.receiver);
 }
 
-static int test_duplicate_packets_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+#define TEST_MTU_CLAMP 1200
+
+static void test_mtu_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    (void) context;
-    (void) id;
     (void) sequence;
-    (void) packet_data;
-    (void) packet_bytes;
 
-    test_duplicate_packets_num_processed++;
+    // simulates a path that silently drops anything larger than its mtu
 
-    return 1;
-}
+    if ( packet_bytes > TEST_MTU_CLAMP )
+        return;
 
-#define TEST_DUPLICATE_PACKETS_NUM_ITERATIONS 16
+    test_transmit_packet_function( _context, id, sequence, packet_data, packet_bytes );
+}
 
-static void test_duplicate_packets()
+static void test_mtu_probing()
 {
     double time = 100.0;
 
@@ -2249,95 +5938,119 @@ static void test_duplicate_packets()
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
+    // only the sender probes. the receiver has the default config, so this also checks that it
+    // reassembles fragments smaller than its own fragment_size
+
+    sender_config.fragment_above = 1400;
+    sender_config.fragment_size = 1400;
+    sender_config.max_fragments = 32;
+    sender_config.mtu_probing = 1;
+
     reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
-    sender_config.transmit_packet_function = &test_duplicate_packets_transmit_packet_function;
+    sender_config.transmit_packet_function = &test_mtu_transmit_packet_function;
     sender_config.process_packet_function = &test_process_packet_function;
 
+    receiver_config.fragment_size = 1400;
+    receiver_config.max_fragments = 32;
+
     reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
-    receiver_config.transmit_packet_function = &test_duplicate_packets_transmit_packet_function;
-    receiver_config.process_packet_function = &test_duplicate_packets_process_packet_function;
+    receiver_config.transmit_packet_function = &test_mtu_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function_validate;
 
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    test_duplicate_packets_num_processed = 0;
+    check( reliable_endpoint_mtu( context.sender ) == sender_config.mtu_min );
+    check( reliable_endpoint_mtu( context.receiver ) == RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + 1400 );
+    check( context.sender->mtu_floor < context.sender->mtu_ceiling );
 
     int i;
-    for ( i = 0; i < TEST_DUPLICATE_PACKETS_NUM_ITERATIONS; ++i )
+    for ( i = 0; i < 1000; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-    }
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
 
-    check( test_duplicate_packets_num_processed == TEST_DUPLICATE_PACKETS_NUM_ITERATIONS );
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
+        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
 
-    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+        sequence = reliable_endpoint_next_packet_sequence( context.receiver );
+        generate_packet_data_with_size( sequence, packet_data, 32 );
+        reliable_endpoint_send_packet( context.receiver, packet_data, 32 );
 
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 2 * TEST_DUPLICATE_PACKETS_NUM_ITERATIONS );
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_DUPLICATE] == TEST_DUPLICATE_PACKETS_NUM_ITERATIONS );
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
 
-    // duplicate fragments arriving after their packet was delivered must not restart reassembly
+        int num_acks;
+        uint16_t * acks = reliable_endpoint_get_acks( context.sender, &num_acks );
+        int j;
+        for ( j = 0; j < num_acks; ++j )
+        {
+            // probes are never reported as acks
 
-    uint16_t fragmented_sequence = reliable_endpoint_next_packet_sequence( context.sender );
+            check( reliable_sequence_greater_than( reliable_endpoint_next_packet_sequence( context.sender ), acks[j] ) );
+        }
 
-    uint8_t large_packet[2048];
-    memset( large_packet, 0, sizeof( large_packet ) );
-    reliable_endpoint_send_packet( context.sender, large_packet, sizeof( large_packet ) );
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
 
-    check( test_duplicate_packets_num_processed == TEST_DUPLICATE_PACKETS_NUM_ITERATIONS + 1 );
-    check( !reliable_sequence_buffer_exists( context.receiver->fragment_reassembly, fragmented_sequence ) );
+        time += 0.1;
+    }
+
+    int mtu = reliable_endpoint_mtu( context.sender );
+
+    check( mtu <= TEST_MTU_CLAMP );
+    check( mtu > TEST_MTU_CLAMP - RELIABLE_MTU_SEARCH_GRANULARITY );
+
+    RELIABLE_CONST uint64_t * sender_counters = reliable_endpoint_counters( context.sender );
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+
+    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_MTU_PROBES_SENT] > 0 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_MTU_PROBES_RECEIVED] > 0 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] >= 990 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
+
+    // lost probes aren't packet loss
+
+    check( reliable_endpoint_packet_loss( context.sender ) < 1.0f );
 
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
 }
 
-static uint8_t test_stale_packets_first_packet[64];
-static int test_stale_packets_first_packet_bytes = 0;
-static int test_stale_packets_num_processed = 0;
+#define TEST_REORDER_MAX_DATAGRAMS 64
 
-static void test_stale_packets_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+struct test_reorder_context_t
 {
-    struct test_context_t * context = (struct test_context_t*) _context;
-
-    if ( id == 0 )
-    {
-        if ( sequence == 0 && test_stale_packets_first_packet_bytes == 0 )
-        {
-            reliable_assert( packet_bytes <= (int) sizeof( test_stale_packets_first_packet ) );
-            memcpy( test_stale_packets_first_packet, packet_data, packet_bytes );
-            test_stale_packets_first_packet_bytes = packet_bytes;
-        }
-
-        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
-    }
-}
+    int num_datagrams;
+    int datagram_bytes[TEST_REORDER_MAX_DATAGRAMS];
+    uint8_t datagram_data[TEST_REORDER_MAX_DATAGRAMS][TEST_MAX_PACKET_BYTES];
+};
 
-static int test_stale_packets_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+static void test_reorder_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    (void) context;
     (void) id;
     (void) sequence;
-    (void) packet_data;
-    (void) packet_bytes;
 
-    test_stale_packets_num_processed++;
+    struct test_reorder_context_t * context = (struct test_reorder_context_t*) _context;
 
-    return 1;
-}
+    reliable_assert( context->num_datagrams < TEST_REORDER_MAX_DATAGRAMS );
+    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
 
-#define TEST_STALE_PACKETS_NUM_ITERATIONS 300
+    memcpy( context->datagram_data[context->num_datagrams], packet_data, packet_bytes );
+    context->datagram_bytes[context->num_datagrams] = packet_bytes;
+    context->num_datagrams++;
+}
 
-static void test_stale_packets()
+static void test_fragment_size_smaller_than_receiver()
 {
     double time = 100.0;
 
-    struct test_context_t context;
-    test_default_context( &context );
+    static struct test_reorder_context_t context;
+    memset( &context, 0, sizeof( context ) );
 
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
@@ -2345,284 +6058,368 @@ static void test_stale_packets()
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.fragment_above = 300;
+    sender_config.fragment_size = 300;
     sender_config.context = &context;
-    sender_config.id = 0;
-    sender_config.transmit_packet_function = &test_stale_packets_transmit_packet_function;
-    sender_config.process_packet_function = &test_process_packet_function;
+    sender_config.transmit_packet_function = &test_reorder_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function_validate;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
-    receiver_config.id = 1;
-    receiver_config.transmit_packet_function = &test_stale_packets_transmit_packet_function;
-    receiver_config.process_packet_function = &test_stale_packets_process_packet_function;
-
-    context.sender = reliable_endpoint_create( &sender_config, time );
-    context.receiver = reliable_endpoint_create( &receiver_config, time );
+    receiver_config.transmit_packet_function = &test_reorder_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function_validate;
 
-    test_stale_packets_first_packet_bytes = 0;
-    test_stale_packets_num_processed = 0;
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &sender_config, time );
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &receiver_config, time );
 
-    // send enough packets that sequence 0 falls out of the receive window (256 entries)
+    // deliver the fragments of each packet backwards, so the last fragment arrives before the receiver knows the fragment size
 
     int i;
-    for ( i = 0; i < TEST_STALE_PACKETS_NUM_ITERATIONS; ++i )
+    for ( i = 0; i < 16; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-    }
-
-    check( test_stale_packets_num_processed == TEST_STALE_PACKETS_NUM_ITERATIONS );
-    check( test_stale_packets_first_packet_bytes > 0 );
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( sender );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
 
-    // replaying the first packet must be rejected as stale, not processed
+        context.num_datagrams = 0;
 
-    reliable_endpoint_receive_packet( context.receiver, test_stale_packets_first_packet, test_stale_packets_first_packet_bytes );
+        reliable_endpoint_send_packet( sender, packet_data, packet_bytes );
 
-    check( test_stale_packets_num_processed == TEST_STALE_PACKETS_NUM_ITERATIONS );
+        check( context.num_datagrams == ( packet_bytes + 299 ) / 300 );
 
-    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+        int j;
+        for ( j = context.num_datagrams - 1; j >= 0; --j )
+        {
+            reliable_endpoint_receive_packet( receiver, context.datagram_data[j], context.datagram_bytes[j] );
+        }
+    }
 
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_STALE] == 1 );
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( receiver );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 16 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
 
-    reliable_endpoint_destroy( context.sender );
-    reliable_endpoint_destroy( context.receiver );
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( receiver );
 }
 
-#define TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS 32
-#define TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE 16
+static int test_transmit_fragments_calls;
 
-static void test_ack_buffer_overflow()
+static void test_transmit_fragments_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * fragment_data, int fragment_bytes, int stride )
 {
-    double time = 100.0;
+    // every fragment but the last must be exactly stride bytes, or UDP_SEGMENT would cut them in the wrong places
 
-    struct test_context_t context;
-    test_default_context( &context );
-
-    struct reliable_config_t sender_config;
-    struct reliable_config_t receiver_config;
-
-    reliable_default_config( &sender_config );
-    reliable_default_config( &receiver_config );
+    check( stride == RELIABLE_FRAGMENT_HEADER_BYTES + 300 );
+    check( fragment_bytes > 0 );
 
-    // undersized ack buffer on the sender, so a single received packet acking 32 sent packets overflows it
+    test_transmit_fragments_calls++;
 
-    sender_config.ack_buffer_size = TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE;
+    int offset;
+    for ( offset = 0; offset < fragment_bytes; offset += stride )
+    {
+        int bytes = fragment_bytes - offset < stride ? fragment_bytes - offset : stride;
+        check( fragment_data[offset] == 1 );
+        test_reorder_transmit_packet_function( _context, id, sequence, fragment_data + offset, bytes );
+    }
+}
 
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
-    sender_config.context = &context;
-    sender_config.id = 0;
-    sender_config.transmit_packet_function = &test_transmit_packet_function;
-    sender_config.process_packet_function = &test_process_packet_function;
+static void test_transmit_fragments()
+{
+    double time = 100.0;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
-    receiver_config.context = &context;
-    receiver_config.id = 1;
-    receiver_config.transmit_packet_function = &test_transmit_packet_function;
-    receiver_config.process_packet_function = &test_process_packet_function;
+    static struct test_reorder_context_t contexts[2];
+    memset( contexts, 0, sizeof( contexts ) );
 
-    context.sender = reliable_endpoint_create( &sender_config, time );
-    context.receiver = reliable_endpoint_create( &receiver_config, time );
+    // two senders in lockstep, one sending fragments one at a time and one all together. the datagrams must come out identical
 
+    struct reliable_endpoint_t * senders[2];
     int i;
-    for ( i = 0; i < TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS; ++i )
+    for ( i = 0; i < 2; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.fragment_above = 300;
+        config.fragment_size = 300;
+        config.context = &contexts[i];
+        config.transmit_packet_function = &test_reorder_transmit_packet_function;
+        config.transmit_fragments_function = i == 1 ? &test_transmit_fragments_function : NULL;
+        config.process_packet_function = &test_process_packet_function_validate;
+        senders[i] = reliable_endpoint_create( &config, time );
     }
 
-    // one packet back from the receiver acks all 32, but only 16 fit in the ack buffer. the rest are dropped
+    struct reliable_config_t receiver_config;
+    reliable_default_config( &receiver_config );
+    receiver_config.fragment_above = 300;
+    receiver_config.fragment_size = 300;
+    receiver_config.context = &contexts[0];
+    receiver_config.transmit_packet_function = &test_reorder_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function_validate;
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &receiver_config, time );
+
+    test_transmit_fragments_calls = 0;
 
+    int num_fragmented = 0;
+
+    for ( i = 0; i < 16; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
-    }
+        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
+        uint16_t sequence = reliable_endpoint_next_packet_sequence( senders[0] );
+        int packet_bytes = generate_packet_data( sequence, packet_data );
 
-    int num_acks;
-    reliable_endpoint_get_acks( context.sender, &num_acks );
-    check( num_acks == TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE );
+        contexts[0].num_datagrams = 0;
+        contexts[1].num_datagrams = 0;
 
-    RELIABLE_CONST uint64_t * sender_counters = reliable_endpoint_counters( context.sender );
-    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE );
+        reliable_endpoint_send_packet( senders[0], packet_data, packet_bytes );
+        reliable_endpoint_send_packet( senders[1], packet_data, packet_bytes );
 
-    // once the caller clears acks, the dropped acks are reported on the next packet that covers them
+        if ( contexts[0].num_datagrams > 1 )
+            num_fragmented++;
 
-    reliable_endpoint_clear_acks( context.sender );
+        check( contexts[1].num_datagrams == contexts[0].num_datagrams );
 
-    {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        int j;
+        for ( j = 0; j < contexts[0].num_datagrams; ++j )
+        {
+            check( contexts[1].datagram_bytes[j] == contexts[0].datagram_bytes[j] );
+            check( memcmp( contexts[1].datagram_data[j], contexts[0].datagram_data[j], contexts[0].datagram_bytes[j] ) == 0 );
+            reliable_endpoint_receive_packet( receiver, contexts[1].datagram_data[j], contexts[1].datagram_bytes[j] );
+        }
     }
 
-    reliable_endpoint_get_acks( context.sender, &num_acks );
-    check( num_acks == TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS - TEST_ACK_BUFFER_OVERFLOW_BUFFER_SIZE );
-    check( sender_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == TEST_ACK_BUFFER_OVERFLOW_NUM_PACKETS );
-
-    reliable_endpoint_destroy( context.sender );
-    reliable_endpoint_destroy( context.receiver );
-}
+    check( num_fragmented > 0 );
+    check( test_transmit_fragments_calls == num_fragmented );
 
-#define TEST_MAX_PACKET_BYTES (4*1024)
+    RELIABLE_CONST uint64_t * sender_counters[2] = { reliable_endpoint_counters( senders[0] ), reliable_endpoint_counters( senders[1] ) };
+    check( sender_counters[1][RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_SENT] == sender_counters[0][RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_SENT] );
 
-static void generate_packet_data_with_size( uint16_t sequence, uint8_t * packet_data, int packet_bytes )
-{
-    reliable_assert( packet_bytes >= 2 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( receiver );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 16 );
+    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
 
-    packet_data[0] = (uint8_t) ( sequence & 0xFF );
-    packet_data[1] = (uint8_t) ( (sequence>>8) & 0xFF );
-    int i;
-    for ( i = 2; i < packet_bytes; ++i )
-    {
-        packet_data[i] = (uint8_t) ( ( (int)i + sequence ) % 256 );
-    }
+    reliable_endpoint_destroy( senders[0] );
+    reliable_endpoint_destroy( senders[1] );
+    reliable_endpoint_destroy( receiver );
 }
 
-static int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
+static int test_send_queue_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
-    int packet_bytes = ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2;
-    generate_packet_data_with_size( sequence, packet_data, packet_bytes );
-    return packet_bytes;
-}
+    (void) context;
+    (void) id;
 
-static void validate_packet_data( uint8_t * packet_data, int packet_bytes )
-{
-    reliable_assert( packet_bytes >= 2 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
-    uint16_t sequence = 0;
-    sequence |= (uint16_t) packet_data[0];
-    sequence |= ( (uint16_t) packet_data[1] ) << 8;
-    check( packet_bytes == ( ( (int)sequence * 1023 ) % ( TEST_MAX_PACKET_BYTES - 2 ) ) + 2 );
-    int i;
-    for ( i = 2; i < packet_bytes; ++i )
-    {
-        check( packet_data[i] == (uint8_t) ( ( (int)i + sequence ) % 256 ) );
-    }
+    // packets were generated with their position in the queue, so this checks they were sent in queue order
+
+    uint16_t queued_sequence = (uint16_t) ( packet_data[0] | ( packet_data[1] << 8 ) );
+    check( queued_sequence == sequence );
+
+    validate_packet_data( packet_data, packet_bytes );
+
+    return 1;
 }
 
-static int test_process_packet_function_validate( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+#define TEST_SEND_QUEUE_SIZE 8
+
+static void test_send_queue()
 {
-    reliable_assert( packet_data );
-    reliable_assert( packet_bytes > 0 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+
+    struct test_tracking_allocate_context_t tracking_alloc_context;
+    memset( &tracking_alloc_context, 0, sizeof( tracking_alloc_context ) );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.send_queue_size = TEST_SEND_QUEUE_SIZE;
+    sender_config.allocator_context = &tracking_alloc_context;
+    sender_config.allocate_function = &test_tracking_allocate_function;
+    sender_config.free_function = &test_tracking_free_function;
+
+    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_send_queue_process_packet_function;
 
-    (void) context;
-    (void) id;
-    (void) sequence;
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    validate_packet_data( packet_data, packet_bytes );
+    // nothing queued, nothing sent
 
-    return 1;
-}
+    check( reliable_endpoint_pump( context.sender ) == 0 );
 
-static int generate_packet_data_large( uint8_t* packet_data )
-{
-    int data_bytes = TEST_MAX_PACKET_BYTES - 2;
-    reliable_assert( data_bytes >= 2) ;
-    reliable_assert( data_bytes <= (1 << 16) );
+    // go around the queue several times, filling it each time, so the entry sequence numbers wrap
+
+    uint16_t queued_sequence = 0;
 
-    packet_data[0] = (uint8_t) (data_bytes & 0xFF);
-    packet_data[1] = (uint8_t) ( (data_bytes >> 8) & 0xFF );
     int i;
-    for ( i = 2; i < data_bytes; ++i )
+    for ( i = 0; i < 4; ++i )
     {
-        packet_data[i] = (uint8_t) ( i % 256 );
+        int j;
+        for ( j = 0; j < TEST_SEND_QUEUE_SIZE; ++j )
+        {
+            uint8_t * packet_data = (uint8_t*) reliable_endpoint_allocate_packet( context.sender, TEST_MAX_PACKET_BYTES );
+            int packet_bytes = generate_packet_data( queued_sequence++, packet_data );
+            check( reliable_endpoint_queue_packet( context.sender, packet_data, packet_bytes ) == RELIABLE_OK );
+        }
+
+        // the queue is full: the packet is refused and stays with the caller
+
+        uint8_t * packet_data = (uint8_t*) reliable_endpoint_allocate_packet( context.sender, TEST_MAX_PACKET_BYTES );
+        int packet_bytes = generate_packet_data( queued_sequence, packet_data );
+        check( reliable_endpoint_queue_packet( context.sender, packet_data, packet_bytes ) == RELIABLE_ERROR );
+        reliable_endpoint_free_packet( context.sender, packet_data );
+
+        check( reliable_endpoint_pump( context.sender ) == TEST_SEND_QUEUE_SIZE );
+        check( reliable_endpoint_pump( context.sender ) == 0 );
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        time += 0.01;
     }
-    return data_bytes + 2;
-}
 
-static int test_process_packet_function_validate_large( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
-{
-    reliable_assert( packet_data );
-    reliable_assert( packet_bytes >= 2 );
-    reliable_assert( packet_bytes <= TEST_MAX_PACKET_BYTES );
+    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == queued_sequence );
+    check( reliable_endpoint_counters( context.receiver )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == queued_sequence );
 
-    (void) context;
-    (void) id;
-    (void) sequence;
+    // packets still queued are freed on reset and destroy, not sent
 
-    uint16_t data_bytes = 0;
-    data_bytes |= (uint16_t) packet_data[0];
-    data_bytes |= ( (uint16_t) packet_data[1] ) << 8;
-    check( packet_bytes == data_bytes + 2 );
-    int i;
-    for ( i = 2; i < data_bytes; ++i )
+    for ( i = 0; i < 2; ++i )
     {
-        check( packet_data[i] == (uint8_t) ( i  % 256 ) );
+        int j;
+        for ( j = 0; j < TEST_SEND_QUEUE_SIZE / 2; ++j )
+        {
+            uint8_t * packet_data = (uint8_t*) reliable_endpoint_allocate_packet( context.sender, TEST_MAX_PACKET_BYTES );
+            int packet_bytes = generate_packet_data( (uint16_t) j, packet_data );
+            check( reliable_endpoint_queue_packet( context.sender, packet_data, packet_bytes ) == RELIABLE_OK );
+        }
+
+        if ( i == 0 )
+        {
+            reliable_endpoint_reset( context.sender );
+            check( reliable_endpoint_pump( context.sender ) == 0 );
+        }
     }
 
-    return 1;
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+
+    for ( i = 0; i < (int) ARRAY_LENGTH( tracking_alloc_context.active_allocations ); ++i )
+    {
+        check( tracking_alloc_context.active_allocations[i] == NULL );
+    }
 }
 
-void test_packets()
+static void test_snapshot()
 {
     double time = 100.0;
 
     struct test_context_t context;
     test_default_context( &context );
-    
+
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
 
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
-    sender_config.fragment_above = 500;
-    receiver_config.fragment_above = 500;
-
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
-    sender_config.process_packet_function = &test_process_packet_function_validate;
+    sender_config.process_packet_function = &test_process_packet_function;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
-    receiver_config.process_packet_function = &test_process_packet_function_validate;
+    receiver_config.process_packet_function = &test_process_packet_function;
 
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    double delta_time = 0.1;
+    struct reliable_endpoint_snapshot_t snapshot;
+    reliable_endpoint_snapshot( context.sender, &snapshot );
+    check( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 0 );
 
     int i;
     for ( i = 0; i < 16; ++i )
     {
-        {
-            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
-            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
-            int packet_bytes = generate_packet_data( sequence, packet_data );
-            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
-        }
+        uint8_t dummy_packet[8];
+        memset( dummy_packet, 0, sizeof( dummy_packet ) );
 
-        {
-            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
-            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
-            int packet_bytes = generate_packet_data( sequence, packet_data );
-            reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
-        }
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        time += 0.01;
 
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
 
         reliable_endpoint_clear_acks( context.sender );
         reliable_endpoint_clear_acks( context.receiver );
+    }
 
-        time += delta_time;
+    // the snapshot matches the endpoint as of the last update
+
+    reliable_endpoint_snapshot( context.sender, &snapshot );
+
+    for ( i = 0; i < RELIABLE_ENDPOINT_NUM_COUNTERS; ++i )
+    {
+        check( snapshot.counters[i] == reliable_endpoint_counters( context.sender )[i] );
+        check( snapshot.counters[i] == reliable_endpoint_counter( context.sender, i ) );
     }
 
+    check( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 16 );
+    check( snapshot.time == time );
+    check( snapshot.rtt == reliable_endpoint_rtt( context.sender ) );
+    check( snapshot.rtt_min == reliable_endpoint_rtt_min( context.sender ) );
+    check( snapshot.rtt_max == reliable_endpoint_rtt_max( context.sender ) );
+    check( snapshot.rtt_avg == reliable_endpoint_rtt_avg( context.sender ) );
+    check( snapshot.packet_loss == reliable_endpoint_packet_loss( context.sender ) );
+    check( snapshot.mtu == reliable_endpoint_mtu( context.sender ) );
+
+    float sent_bandwidth_kbps, received_bandwidth_kbps, acked_bandwidth_kbps;
+    reliable_endpoint_bandwidth( context.sender, &sent_bandwidth_kbps, &received_bandwidth_kbps, &acked_bandwidth_kbps );
+    check( snapshot.sent_bandwidth_kbps == sent_bandwidth_kbps );
+    check( snapshot.received_bandwidth_kbps == received_bandwidth_kbps );
+    check( snapshot.acked_bandwidth_kbps == acked_bandwidth_kbps );
+
+    // sending doesn't publish. the next update does
+
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
+    reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+
+    reliable_endpoint_snapshot( context.sender, &snapshot );
+    check( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 16 );
+    check( reliable_endpoint_counter( context.sender, RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT ) == 17 );
+
+    reliable_endpoint_update( context.sender, time );
+
+    reliable_endpoint_snapshot( context.sender, &snapshot );
+    check( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 17 );
+
+    // and reset publishes cleared counters
+
+    reliable_endpoint_reset( context.sender );
+
+    reliable_endpoint_snapshot( context.sender, &snapshot );
+    check( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 0 );
+
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
 }
 
-void test_large_packets()
+static void test_log_binary()
 {
+#if RELIABLE_ENABLE_LOGGING && RELIABLE_COMPILE_TIME_LOG_LEVEL >= RELIABLE_LOG_LEVEL_DEBUG
     double time = 100.0;
 
     struct test_context_t context;
@@ -2634,71 +6431,147 @@ void test_large_packets()
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
-    sender_config.max_packet_size = TEST_MAX_PACKET_BYTES;
-    receiver_config.max_packet_size = TEST_MAX_PACKET_BYTES;
-
-    sender_config.fragment_above = TEST_MAX_PACKET_BYTES;
-    receiver_config.fragment_above = TEST_MAX_PACKET_BYTES;
-
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
-    sender_config.process_packet_function = &test_process_packet_function_validate_large;
+    sender_config.process_packet_function = &test_process_packet_function;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
-    receiver_config.process_packet_function = &test_process_packet_function_validate_large;
+    receiver_config.process_packet_function = &test_process_packet_function;
 
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    {
-        uint8_t packet_data[TEST_MAX_PACKET_BYTES];
-        int packet_bytes = generate_packet_data_large( packet_data );
-        check( packet_bytes == TEST_MAX_PACKET_BYTES );
-        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
-    }
+    struct reliable_log_record_t records[64];
+    while ( reliable_log_read( records, ARRAY_LENGTH( records ) ) > 0 ) {}
 
-    reliable_endpoint_update( context.sender, time );
-    reliable_endpoint_update( context.receiver, time );
+    reliable_log_level( RELIABLE_LOG_LEVEL_DEBUG );
+    reliable_log_mode( RELIABLE_LOG_MODE_BINARY );
 
-    reliable_endpoint_clear_acks( context.sender );
-    reliable_endpoint_clear_acks( context.receiver );
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
+    reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
 
-    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_TOO_LARGE_TO_RECEIVE] == 0 );
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == 1 );
+    reliable_log_level( RELIABLE_LOG_LEVEL_NONE );
+    reliable_log_mode( RELIABLE_LOG_MODE_PRINTF );
+
+    // the sender logs the send, the receiver logs processing it. nothing is formatted until the records are read
+
+    int num_records = reliable_log_read( records, ARRAY_LENGTH( records ) );
+    check( num_records == 4 );
+
+    check( records[0].event == RELIABLE_LOG_EVENT_SEND_PACKET );
+    check( records[0].endpoint_id == 0 );
+    check( records[0].sequence == 0 );
+    check( records[0].level == RELIABLE_LOG_LEVEL_DEBUG );
+    check( records[0].time == time );
+
+    check( records[1].event == RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED );
+    check( records[2].event == RELIABLE_LOG_EVENT_PROCESS_PACKET );
+    check( records[2].endpoint_id == 1 );
+    check( records[3].event == RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCESSFUL );
+    check( records[3].sequence == 0 );
+
+    char buffer[256];
+    reliable_log_format( records + 0, buffer, sizeof( buffer ) );
+    check( strcmp( buffer, "100.000000 [0] sending packet 0" ) == 0 );
+
+    // with logging off nothing is recorded
+
+    reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
+    check( reliable_log_read( records, ARRAY_LENGTH( records ) ) == 0 );
 
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
+#endif // #if RELIABLE_ENABLE_LOGGING && RELIABLE_COMPILE_TIME_LOG_LEVEL >= RELIABLE_LOG_LEVEL_DEBUG
 }
 
-void test_sequence_buffer_rollover()
+static void test_histogram()
+{
+    struct reliable_histogram_t histogram;
+    reliable_histogram_reset( &histogram );
+
+    check( reliable_histogram_percentile( &histogram, 50.0f ) == 0.0f );
+
+    // every bucket's range starts where the previous one ended
+
+    uint32_t expected_lower = 0;
+    int i;
+    for ( i = 0; i < RELIABLE_HISTOGRAM_NUM_BUCKETS; ++i )
+    {
+        uint32_t lower, width;
+        reliable_histogram_bucket_range( i, &lower, &width );
+        check( lower == expected_lower );
+        check( reliable_histogram_bucket( lower ) == i );
+        check( reliable_histogram_bucket( lower + width - 1 ) == i );
+        expected_lower = lower + width;
+    }
+    check( expected_lower == RELIABLE_HISTOGRAM_MAX_VALUE + 1 );
+
+    // 1 to 1000ms, evenly
+
+    for ( i = 1; i <= 1000; ++i )
+    {
+        reliable_histogram_add( &histogram, (float) i );
+    }
+
+    check( histogram.count == 1000 );
+
+    float p50 = reliable_histogram_percentile( &histogram, 50.0f );
+    float p99 = reliable_histogram_percentile( &histogram, 99.0f );
+    check( fabs( p50 - 500.0f ) <= 500.0f / 32.0f );
+    check( fabs( p99 - 990.0f ) <= 990.0f / 32.0f );
+    check( fabs( reliable_histogram_percentile( &histogram, 0.0f ) - 1.0f ) <= 1.0f / 32.0f );
+    check( fabs( reliable_histogram_percentile( &histogram, 100.0f ) - 1000.0f ) <= 1000.0f / 32.0f );
+
+    // small values are exact to the microsecond, and huge ones land in the last bucket
+
+    struct reliable_histogram_t small;
+    reliable_histogram_reset( &small );
+    reliable_histogram_add( &small, 0.0f );
+    reliable_histogram_add( &small, 0.007f );
+    check( reliable_histogram_percentile( &small, 0.0f ) == 0.0f );
+    check( fabs( reliable_histogram_percentile( &small, 100.0f ) - 0.007f ) < 0.0001f );
+    reliable_histogram_add( &small, 1000000.0f );
+    check( small.buckets[RELIABLE_HISTOGRAM_NUM_BUCKETS-1] == 1 );
+
+    // merging is the same as adding everything to one histogram
+
+    struct reliable_histogram_t a, b, both;
+    reliable_histogram_reset( &a );
+    reliable_histogram_reset( &b );
+    reliable_histogram_reset( &both );
+    for ( i = 0; i < 100; ++i )
+    {
+        reliable_histogram_add( &a, 10.0f + i );
+        reliable_histogram_add( &b, 200.0f + i * 3 );
+        reliable_histogram_add( &both, 10.0f + i );
+        reliable_histogram_add( &both, 200.0f + i * 3 );
+    }
+    reliable_histogram_merge( &a, &b );
+    check( memcmp( &a, &both, sizeof( a ) ) == 0 );
+}
+
+static void test_rtt_percentiles()
 {
     double time = 100.0;
 
     struct test_context_t context;
     test_default_context( &context );
-    
+
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
 
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
-    sender_config.fragment_above = 500;
-    receiver_config.fragment_above = 500;
-
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
     sender_config.process_packet_function = &test_process_packet_function;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
@@ -2707,104 +6580,196 @@ void test_sequence_buffer_rollover()
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    uint8_t packet_data[TEST_MAX_PACKET_BYTES] = {0};
+    check( reliable_endpoint_rtt_percentile( context.sender, 50.0f ) == 0.0f );
+
+    // the receiver's reply acks each packet after 10ms or 30ms, alternately
+
+    uint8_t dummy_packet[8];
+    memset( dummy_packet, 0, sizeof( dummy_packet ) );
 
-    int num_packets_sent = 0;
     int i;
-    for (i = 0; i <= 32767; ++i)
+    for ( i = 0; i < 100; ++i )
     {
-        uint8_t packet_data[16] = {0};
-        int packet_bytes = sizeof( packet_data ) / sizeof( uint8_t );
-        reliable_endpoint_next_packet_sequence( context.sender );
-        reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
+        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
 
-        ++num_packets_sent;
+        time += ( i & 1 ) ? 0.03 : 0.01;
+
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+
+        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
     }
 
-    int packet_bytes = sizeof( packet_data ) / sizeof( uint8_t );
-    reliable_endpoint_next_packet_sequence( context.sender );
-    reliable_endpoint_send_packet( context.sender, packet_data, packet_bytes );
-    ++num_packets_sent;
+    check( reliable_endpoint_rtt_histogram( context.sender )->count == 100 );
+    check( reliable_endpoint_jitter_histogram( context.sender )->count == 99 );
 
-    RELIABLE_CONST uint64_t * receiver_counters = reliable_endpoint_counters( context.receiver );
+    check( fabs( reliable_endpoint_rtt_percentile( context.sender, 25.0f ) - 10.0f ) < 0.5f );
+    check( fabs( reliable_endpoint_rtt_percentile( context.sender, 99.0f ) - 30.0f ) < 1.0f );
+    check( fabs( reliable_endpoint_jitter_percentile( context.sender, 50.0f ) - 20.0f ) < 1.0f );
 
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] == (uint16_t) num_packets_sent );
-    check( receiver_counters[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID] == 0 );
+    // endpoints' histograms merge into one for the whole server
+
+    struct reliable_histogram_t merged;
+    reliable_histogram_reset( &merged );
+    reliable_histogram_merge( &merged, reliable_endpoint_rtt_histogram( context.sender ) );
+    reliable_histogram_merge( &merged, reliable_endpoint_rtt_histogram( context.receiver ) );
+    check( merged.count == reliable_endpoint_rtt_histogram( context.sender )->count + reliable_endpoint_rtt_histogram( context.receiver )->count );
+
+    reliable_endpoint_reset( context.sender );
+    check( reliable_endpoint_rtt_histogram( context.sender )->count == 0 );
+    check( reliable_endpoint_jitter_histogram( context.sender )->count == 0 );
 
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
 }
 
-#define ARRAY_LENGTH(x) (sizeof(x) / sizeof((x)[0]))
-
-struct test_tracking_allocate_context_t
+static void test_capture()
 {
-    void* active_allocations[1024];
-};
+    const char * filename = "reliable_test_capture.bin";
 
-void * test_tracking_allocate_function( void * context, size_t bytes )
-{
-    struct test_tracking_allocate_context_t* tracking_context = (struct test_tracking_allocate_context_t*)context;
-    void * allocation = malloc( bytes );
-    int tracking_index;
-    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations); ++tracking_index )
+    check( reliable_capture_start( filename, 16 ) == RELIABLE_OK );
+    check( reliable_capture_start( filename, 16 ) == RELIABLE_ERROR );
+
+    double time = 100.0;
+
+    struct test_context_t context;
+    test_default_context( &context );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.id = 1;
+    receiver_config.fragment_size = 500;
+    receiver_config.transmit_packet_function = &test_transmit_packet_function;
+    receiver_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    uint8_t packet[100];
+    memset( packet, 0, sizeof( packet ) );
+
+    const int num_frames = 10;
+
+    int i;
+    for ( i = 0; i < num_frames; ++i )
     {
-        if ( tracking_context->active_allocations[tracking_index] == NULL )
-        {
-            break;
-        }
+        reliable_endpoint_send_packet( context.sender, packet, sizeof( packet ) );
+        reliable_endpoint_send_packet( context.receiver, packet, sizeof( packet ) );
+        time += 0.01;
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
+        check( reliable_capture_flush() > 0 );
     }
 
-    reliable_assert(tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations));
-    tracking_context->active_allocations[tracking_index] = allocation;
-    return allocation;
-}
+    check( reliable_capture_stop() == 0 );
 
-void test_tracking_free_function( void * context, void * pointer )
-{
-    struct test_tracking_allocate_context_t* tracking_context = (struct test_tracking_allocate_context_t*)context;
-    int tracking_index;
-    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations); ++tracking_index )
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
+
+    // read it back the way the header describes
+
+    FILE * file = fopen( filename, "rb" );
+    check( file );
+
+    uint8_t header[RELIABLE_CAPTURE_FILE_HEADER_BYTES];
+    check( fread( header, 1, sizeof( header ), file ) == sizeof( header ) );
+    uint8_t * p = header;
+    check( reliable_read_uint32( &p ) == RELIABLE_CAPTURE_MAGIC );
+    check( reliable_read_uint32( &p ) == RELIABLE_CAPTURE_VERSION );
+    check( reliable_read_uint32( &p ) == 16 );
+
+    int num_records[4] = { 0, 0, 0, 0 };
+    double last_update_time = 0.0;
+
+    uint8_t record[RELIABLE_CAPTURE_RECORD_HEADER_BYTES];
+    while ( fread( record, 1, sizeof( record ), file ) == sizeof( record ) )
     {
-        if ( tracking_context->active_allocations[tracking_index] == pointer )
+        p = record;
+        int type = reliable_read_uint8( &p );
+        reliable_read_uint8( &p );
+        reliable_read_uint16( &p );
+        uint64_t endpoint_id = reliable_read_uint64( &p );
+        union { double d; uint64_t u; } time_bits;
+        time_bits.u = reliable_read_uint64( &p );
+        uint32_t packet_bytes = reliable_read_uint32( &p );
+        uint32_t data_bytes = reliable_read_uint32( &p );
+
+        check( type >= RELIABLE_CAPTURE_CREATE && type <= RELIABLE_CAPTURE_UPDATE );
+        check( endpoint_id <= 1 );
+
+        uint8_t data[RELIABLE_CAPTURE_NUM_CONFIG_VALUES * 4];
+        check( data_bytes <= sizeof( data ) );
+        check( fread( data, 1, data_bytes, file ) == data_bytes );
+
+        if ( type == RELIABLE_CAPTURE_CREATE )
         {
-            break;
+            check( data_bytes == RELIABLE_CAPTURE_NUM_CONFIG_VALUES * 4 );
+            p = data + RELIABLE_CAPTURE_CONFIG_FRAGMENT_SIZE * 4;
+            check( (int) reliable_read_uint32( &p ) == ( endpoint_id == 0 ? sender_config.fragment_size : receiver_config.fragment_size ) );
+        }
+        else if ( type == RELIABLE_CAPTURE_UPDATE )
+        {
+            check( data_bytes == 0 );
+            check( time_bits.d >= last_update_time );
+            last_update_time = time_bits.d;
+        }
+        else
+        {
+            check( packet_bytes > sizeof( packet ) );
+            check( data_bytes == 16 );
         }
+
+        num_records[type]++;
     }
 
-    reliable_assert( tracking_index < (int) ARRAY_LENGTH(tracking_context->active_allocations) );
-    tracking_context->active_allocations[tracking_index] = NULL;
-    free( pointer );
+    fclose( file );
+    remove( filename );
+
+    check( num_records[RELIABLE_CAPTURE_CREATE] == 2 );
+    check( num_records[RELIABLE_CAPTURE_SEND] == 2 * num_frames );
+    check( num_records[RELIABLE_CAPTURE_RECEIVE] == 2 * num_frames );
+    check( num_records[RELIABLE_CAPTURE_UPDATE] == 2 * num_frames );
+    check( last_update_time == time );
 }
 
-void test_fragment_cleanup()
+static void test_capture_pcapng()
 {
+    const char * filename = "reliable_test_capture.pcapng";
+
+    check( reliable_capture_start_pcapng( filename, -1 ) == RELIABLE_OK );
+    check( reliable_capture_start( filename, -1 ) == RELIABLE_ERROR );
+
     double time = 100.0;
 
     struct test_context_t context;
     test_default_context( &context );
 
-    struct test_tracking_allocate_context_t tracking_alloc_context;
-    memset( &tracking_alloc_context, 0, sizeof( tracking_alloc_context ) );
-    
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
 
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
-    receiver_config.allocator_context = &tracking_alloc_context;
-    receiver_config.allocate_function = &test_tracking_allocate_function;
-    receiver_config.free_function = &test_tracking_free_function;
-    receiver_config.fragment_reassembly_buffer_size = 4;
-
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
     sender_config.process_packet_function = &test_process_packet_function;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
@@ -2813,61 +6778,184 @@ void test_fragment_cleanup()
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    double delta_time = 0.1;
-
-    int packet_sizes[] = {
-        sender_config.fragment_size + sender_config.fragment_size/2,
-        10,
-        10,
-        10,
-        10,
-    };
+    uint8_t packet[101];
+    memset( packet, 0, sizeof( packet ) );
 
-    // Make sure we're sending more than receiver_config.fragment_reassembly_buffer_size packets, so the buffer wraps around.
-    reliable_assert( (int) ARRAY_LENGTH( packet_sizes ) > receiver_config.fragment_reassembly_buffer_size );
+    const int num_frames = 10;
 
     int i;
-    for ( i = 0; i < (int) ARRAY_LENGTH( packet_sizes ); ++i )
+    for ( i = 0; i < num_frames; ++i )
     {
-        // Only allow one packet per transmit, so that our fragmented packets are only partially
-        // delivered.
-        context.allow_packets = 1;
-        {
-            uint8_t packet_data[TEST_MAX_PACKET_BYTES];
-            uint16_t sequence = reliable_endpoint_next_packet_sequence( context.sender );
-            generate_packet_data_with_size( sequence, packet_data, packet_sizes[i] );
-            reliable_endpoint_send_packet( context.sender, packet_data, packet_sizes[i]);
-        }
-
+        reliable_endpoint_send_packet( context.sender, packet, sizeof( packet ) );
+        reliable_endpoint_send_packet( context.receiver, packet, sizeof( packet ) );
+        time += 0.01;
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
-
         reliable_endpoint_clear_acks( context.sender );
         reliable_endpoint_clear_acks( context.receiver );
-
-        time += delta_time;
+        check( reliable_capture_flush() > 0 );
     }
 
+    check( reliable_capture_stop() == 0 );
+
     reliable_endpoint_destroy( context.sender );
     reliable_endpoint_destroy( context.receiver );
-    
-    // Make sure that there is no memory that hasn't been freed.
-    int tracking_index;
-    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH(tracking_alloc_context.active_allocations); ++tracking_index )
+
+    // read it back as a pcapng reader would: a section header, one raw ipv4 interface, then one enhanced packet block per datagram
+
+    FILE * file = fopen( filename, "rb" );
+    check( file );
+
+    uint8_t header[48];
+    check( fread( header, 1, sizeof( header ), file ) == sizeof( header ) );
+    uint8_t * p = header;
+    check( reliable_read_uint32( &p ) == 0x0A0D0D0A );
+    check( reliable_read_uint32( &p ) == 28 );
+    check( reliable_read_uint32( &p ) == 0x1A2B3C4D );
+    p = header + 28;
+    check( reliable_read_uint32( &p ) == 1 );
+    check( reliable_read_uint32( &p ) == 20 );
+    check( reliable_read_uint16( &p ) == 101 );
+
+    int num_sent = 0;
+    int num_received = 0;
+
+    uint8_t block[256];
+    while ( fread( block, 1, 8, file ) == 8 )
     {
-        check( tracking_alloc_context.active_allocations[tracking_index] == NULL );
+        p = block;
+        check( reliable_read_uint32( &p ) == 6 );
+        uint32_t block_bytes = reliable_read_uint32( &p );
+        check( block_bytes <= sizeof( block ) );
+        check( ( block_bytes % 4 ) == 0 );
+        check( fread( block + 8, 1, block_bytes - 8, file ) == block_bytes - 8 );
+
+        reliable_read_uint32( &p );
+        uint64_t timestamp = ( (uint64_t) reliable_read_uint32( &p ) ) << 32;
+        timestamp |= reliable_read_uint32( &p );
+        uint32_t captured_bytes = reliable_read_uint32( &p );
+        uint32_t original_bytes = reliable_read_uint32( &p );
+        check( captured_bytes == original_bytes );
+        check( captured_bytes >= 28 + 4 + sizeof( packet ) && captured_bytes <= 28 + RELIABLE_MAX_PACKET_HEADER_BYTES + sizeof( packet ) );
+        check( timestamp >= 100000000 && timestamp <= 100000000 + (uint64_t) num_frames * 10000 );
+
+        uint8_t * ip = p;
+        check( ip[0] == 0x45 );
+        check( ( ( ip[2] << 8 ) | ip[3] ) == (int) captured_bytes );
+        check( ip[9] == 17 );
+        uint32_t checksum = 0;
+        for ( i = 0; i < 20; i += 2 )
+            checksum += ( ip[i] << 8 ) | ip[i+1];
+        checksum = ( checksum & 0xFFFF ) + ( checksum >> 16 );
+        check( checksum == 0xFFFF );
+
+        uint32_t source = ( (uint32_t) ip[12] << 24 ) | ( ip[13] << 16 ) | ( ip[14] << 8 ) | ip[15];
+        uint32_t destination = ( (uint32_t) ip[16] << 24 ) | ( ip[17] << 16 ) | ( ip[18] << 8 ) | ip[19];
+        if ( destination == RELIABLE_CAPTURE_PCAPNG_PEER_ADDRESS )
+        {
+            check( source == RELIABLE_CAPTURE_PCAPNG_ENDPOINT_ADDRESS || source == ( RELIABLE_CAPTURE_PCAPNG_ENDPOINT_ADDRESS | 1 ) );
+            num_sent++;
+        }
+        else
+        {
+            check( source == RELIABLE_CAPTURE_PCAPNG_PEER_ADDRESS );
+            check( destination == RELIABLE_CAPTURE_PCAPNG_ENDPOINT_ADDRESS || destination == ( RELIABLE_CAPTURE_PCAPNG_ENDPOINT_ADDRESS | 1 ) );
+            num_received++;
+        }
+
+        uint8_t * udp = ip + 20;
+        check( ( ( udp[0] << 8 ) | udp[1] ) == RELIABLE_CAPTURE_PCAPNG_PORT );
+        check( ( ( udp[2] << 8 ) | udp[3] ) == RELIABLE_CAPTURE_PCAPNG_PORT );
+        check( ( ( udp[4] << 8 ) | udp[5] ) == (int) captured_bytes - 20 );
+        check( ( udp[8] & 1 ) == 0 );
+
+        p = block + block_bytes - 4;
+        check( reliable_read_uint32( &p ) == block_bytes );
     }
+
+    fclose( file );
+    remove( filename );
+
+    check( num_sent == 2 * num_frames );
+    check( num_received == 2 * num_frames );
 }
 
-static void test_endpoint_reset()
+// sends packets_per_second packets of 100 bytes on the wire, spread over frames at the given rate, and returns the sent bandwidth
+
+static float test_bandwidth_window_kbps( int frames_per_second, int packets_per_second, double idle_time )
 {
     double time = 100.0;
 
     struct test_context_t context;
     test_default_context( &context );
+    context.drop = 1;
 
-    struct test_tracking_allocate_context_t tracking_alloc_context;
-    memset( &tracking_alloc_context, 0, sizeof( tracking_alloc_context ) );
+    struct reliable_config_t sender_config;
+    reliable_default_config( &sender_config );
+    sender_config.context = &context;
+    sender_config.id = 0;
+    sender_config.transmit_packet_function = &test_transmit_packet_function;
+    sender_config.process_packet_function = &test_process_packet_function;
+
+    context.sender = reliable_endpoint_create( &sender_config, time );
+
+    uint8_t packet[100];
+    memset( packet, 0, sizeof( packet ) );
+    int packet_bytes = sizeof( packet ) - sender_config.packet_header_size;
+
+    int i, j;
+    for ( i = 0; i < 3 * frames_per_second; ++i )
+    {
+        for ( j = 0; j < packets_per_second / frames_per_second; ++j )
+        {
+            reliable_endpoint_send_packet( context.sender, packet, packet_bytes );
+        }
+        time += 1.0 / frames_per_second;
+        reliable_endpoint_update( context.sender, time );
+    }
+
+    if ( idle_time > 0.0 )
+    {
+        reliable_endpoint_update( context.sender, time + idle_time );
+    }
+
+    float sent_bandwidth_kbps, received_bandwidth_kbps, acked_bandwidth_kbps;
+    reliable_endpoint_bandwidth( context.sender, &sent_bandwidth_kbps, &received_bandwidth_kbps, &acked_bandwidth_kbps );
+
+    check( received_bandwidth_kbps == 0.0f );
+    check( acked_bandwidth_kbps == 0.0f );
+
+    reliable_endpoint_destroy( context.sender );
+
+    return sent_bandwidth_kbps;
+}
+
+static void test_bandwidth_window()
+{
+    // 240 packets per-second of 100 bytes is 192kbps, whatever the frame rate
+
+    check( fabs( test_bandwidth_window_kbps( 20, 240, 0.0 ) - 192.0f ) < 192.0f * 0.06f );
+    check( fabs( test_bandwidth_window_kbps( 60, 240, 0.0 ) - 192.0f ) < 192.0f * 0.06f );
+    check( fabs( test_bandwidth_window_kbps( 240, 240, 0.0 ) - 192.0f ) < 192.0f * 0.06f );
+
+    // and many more packets per-second than the sent packets buffer holds are still measured over the whole window
+
+    check( fabs( test_bandwidth_window_kbps( 20, 4000, 0.0 ) - 3200.0f ) < 3200.0f * 0.06f );
+
+    // once the window has passed with nothing sent, bandwidth is zero
+
+    check( test_bandwidth_window_kbps( 60, 240, 1.5 ) == 0.0f );
+}
+
+static void test_stats_aggregator()
+{
+    double time = 100.0;
+
+    struct reliable_stats_aggregator_t * aggregator = reliable_stats_aggregator_create( 2, NULL, NULL, NULL );
+    check( aggregator );
+
+    struct test_context_t context;
+    test_default_context( &context );
 
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
@@ -2875,20 +6963,11 @@ static void test_endpoint_reset()
     reliable_default_config( &sender_config );
     reliable_default_config( &receiver_config );
 
-    sender_config.fragment_above = 500;
-    receiver_config.fragment_above = 500;
-
-    receiver_config.allocator_context = &tracking_alloc_context;
-    receiver_config.allocate_function = &test_tracking_allocate_function;
-    receiver_config.free_function = &test_tracking_free_function;
-
-    reliable_copy_string( sender_config.name, "sender", sizeof( sender_config.name ) );
     sender_config.context = &context;
     sender_config.id = 0;
     sender_config.transmit_packet_function = &test_transmit_packet_function;
     sender_config.process_packet_function = &test_process_packet_function;
 
-    reliable_copy_string( receiver_config.name, "receiver", sizeof( receiver_config.name ) );
     receiver_config.context = &context;
     receiver_config.id = 1;
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
@@ -2897,98 +6976,117 @@ static void test_endpoint_reset()
     context.sender = reliable_endpoint_create( &sender_config, time );
     context.receiver = reliable_endpoint_create( &receiver_config, time );
 
-    // exchange packets both ways so acks and counters accumulate
+    reliable_stats_aggregator_add_endpoint( aggregator, 0, context.sender );
+    reliable_stats_aggregator_add_endpoint( aggregator, 1, context.receiver );
+
+    struct reliable_stats_t stats;
+    reliable_stats_aggregator_read( aggregator, &stats );
+    check( stats.num_endpoints == 2 );
+    check( stats.packet_loss[0] == 2 );
+    check( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == 0 );
+
+    uint8_t small_packet[8];
+    memset( small_packet, 0, sizeof( small_packet ) );
+
+    uint8_t large_packet[4*1024];
+    memset( large_packet, 0, sizeof( large_packet ) );
 
     int i;
-    for ( i = 0; i < 8; ++i )
+    for ( i = 0; i < 64; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        reliable_endpoint_send_packet( context.sender, large_packet, sizeof( large_packet ) );
 
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+        time += 0.01;
 
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
 
-        time += 0.01;
-    }
-
-    int num_acks;
-    reliable_endpoint_get_acks( context.sender, &num_acks );
-    check( num_acks > 0 );
-    check( reliable_endpoint_counters( context.sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] > 0 );
-
-    // leave a fragment reassembly in progress on the receiver by delivering only the first fragment of a large packet
+        reliable_endpoint_send_packet( context.receiver, small_packet, sizeof( small_packet ) );
 
-    context.allow_packets = 1;
-    {
-        uint8_t large_packet[1500];
-        memset( large_packet, 0, sizeof( large_packet ) );
-        reliable_endpoint_send_packet( context.sender, large_packet, sizeof( large_packet ) );
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
     }
-    context.allow_packets = -1;
-
-    reliable_endpoint_reset( context.sender );
-    reliable_endpoint_reset( context.receiver );
 
-    check( reliable_endpoint_next_packet_sequence( context.sender ) == 0 );
-    check( reliable_endpoint_next_packet_sequence( context.receiver ) == 0 );
+    // the totals are the sums over both endpoints
 
-    reliable_endpoint_get_acks( context.sender, &num_acks );
-    check( num_acks == 0 );
+    reliable_stats_aggregator_read( aggregator, &stats );
 
     for ( i = 0; i < RELIABLE_ENDPOINT_NUM_COUNTERS; ++i )
     {
-        check( reliable_endpoint_counters( context.sender )[i] == 0 );
-        check( reliable_endpoint_counters( context.receiver )[i] == 0 );
+        check( stats.counters[i] == reliable_endpoint_counters( context.sender )[i] + reliable_endpoint_counters( context.receiver )[i] );
     }
 
-    // the endpoints must work normally after reset
+    uint64_t header_size = (uint64_t) sender_config.packet_header_size;
+    check( stats.bytes_sent == 64 * ( header_size + sizeof( large_packet ) ) + 64 * ( header_size + sizeof( small_packet ) ) );
+    check( stats.bytes_received > 64 * ( header_size + sizeof( small_packet ) ) );
+    check( stats.bytes_acked > 0 );
+    check( stats.rtt_histogram.count == reliable_endpoint_rtt_histogram( context.sender )->count + reliable_endpoint_rtt_histogram( context.receiver )->count );
+    check( fabs( reliable_histogram_percentile( &stats.rtt_histogram, 50.0f ) - reliable_endpoint_rtt_percentile( context.sender, 50.0f ) ) < 0.5f );
 
-    for ( i = 0; i < 8; ++i )
+    uint64_t num_endpoints_by_loss = 0;
+    for ( i = 0; i < RELIABLE_STATS_PACKET_LOSS_BUCKETS; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset( dummy_packet, 0, sizeof( dummy_packet ) );
+        num_endpoints_by_loss += stats.packet_loss[i];
+    }
+    check( num_endpoints_by_loss == 2 );
 
-        reliable_endpoint_send_packet( context.sender, dummy_packet, sizeof( dummy_packet ) );
-        reliable_endpoint_send_packet( context.receiver, dummy_packet, sizeof( dummy_packet ) );
+    // an endpoint that loses half its packets moves up the loss distribution
 
+    context.drop = 0;
+    for ( i = 0; i < 256; ++i )
+    {
+        reliable_endpoint_send_packet( context.sender, small_packet, sizeof( small_packet ) );
+        time += 0.01;
         reliable_endpoint_update( context.sender, time );
         reliable_endpoint_update( context.receiver, time );
-
-        time += 0.01;
+        context.drop = ( i & 1 );
+        reliable_endpoint_send_packet( context.receiver, small_packet, sizeof( small_packet ) );
+        context.drop = 0;
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
     }
 
-    reliable_endpoint_get_acks( context.sender, &num_acks );
-    check( num_acks > 0 );
-    check( reliable_endpoint_counters( context.receiver )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] > 0 );
+    reliable_stats_aggregator_read( aggregator, &stats );
+    check( stats.packet_loss[reliable_stats_packet_loss_bucket( reliable_endpoint_packet_loss( context.receiver ) )] >= 1 );
+    check( stats.packet_loss[0] <= 1 );
 
-    reliable_endpoint_destroy( context.sender );
-    reliable_endpoint_destroy( context.receiver );
+    // removing or destroying an endpoint takes it out of the counts, but what it contributed stays in the totals
 
-    // reset must have freed the in-progress reassembly buffer, and destroy must not double-free it
+    uint64_t packets_sent = stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT];
 
-    int tracking_index;
-    for ( tracking_index = 0; tracking_index < (int) ARRAY_LENGTH( tracking_alloc_context.active_allocations ); ++tracking_index )
+    reliable_stats_aggregator_remove_endpoint( aggregator, context.sender );
+    reliable_endpoint_destroy( context.receiver );
+
+    reliable_stats_aggregator_read( aggregator, &stats );
+    check( stats.num_endpoints == 0 );
+    for ( i = 0; i < RELIABLE_STATS_PACKET_LOSS_BUCKETS; ++i )
     {
-        check( tracking_alloc_context.active_allocations[tracking_index] == NULL );
+        check( stats.packet_loss[i] == 0 );
     }
+    check( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == packets_sent );
+
+    context.drop = 1;
+    reliable_endpoint_send_packet( context.sender, small_packet, sizeof( small_packet ) );
+    reliable_stats_aggregator_read( aggregator, &stats );
+    check( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] == packets_sent );
+
+    reliable_endpoint_destroy( context.sender );
+
+    reliable_stats_aggregator_destroy( aggregator );
 }
 
-static void test_rtt()
+static void test_profile()
 {
     double time = 100.0;
-    double delta_time = 0.01;
 
     struct test_context_t context;
-    test_default_context(&context);
+    test_default_context( &context );
 
     struct reliable_config_t sender_config;
     struct reliable_config_t receiver_config;
 
-    reliable_default_config(&sender_config);
-    reliable_default_config(&receiver_config);
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
 
     sender_config.context = &context;
     sender_config.id = 0;
@@ -3000,35 +7098,103 @@ static void test_rtt()
     receiver_config.transmit_packet_function = &test_transmit_packet_function;
     receiver_config.process_packet_function = &test_process_packet_function;
 
-    context.sender = reliable_endpoint_create(&sender_config, time);
-    context.receiver = reliable_endpoint_create(&receiver_config, time);
+    context.sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    // each iteration sends one small packet and one that splits into 4 fragments
+
+    uint8_t small_packet[8];
+    memset( small_packet, 0, sizeof( small_packet ) );
+
+    uint8_t large_packet[4*1024];
+    memset( large_packet, 0, sizeof( large_packet ) );
+
+    const int num_iterations = 16;
 
     int i;
-    for (i = 0; i < 1000; ++i)
+    for ( i = 0; i < num_iterations; ++i )
     {
-        uint8_t dummy_packet[8];
-        memset(dummy_packet, 0, sizeof(dummy_packet));
+        reliable_endpoint_send_packet( context.sender, small_packet, sizeof( small_packet ) );
+        reliable_endpoint_send_packet( context.sender, large_packet, sizeof( large_packet ) );
 
-        reliable_endpoint_send_packet(context.sender, dummy_packet, sizeof(dummy_packet));
-        reliable_endpoint_send_packet(context.receiver, dummy_packet, sizeof(dummy_packet));
+        time += 0.01;
 
-        reliable_endpoint_update(context.sender, time);
-        reliable_endpoint_update(context.receiver, time);
+        reliable_endpoint_update( context.sender, time );
+        reliable_endpoint_update( context.receiver, time );
 
-        time += delta_time;
+        reliable_endpoint_clear_acks( context.sender );
+        reliable_endpoint_clear_acks( context.receiver );
     }
 
-    float rtt = reliable_endpoint_rtt(context.sender);
-    float rtt_min = reliable_endpoint_rtt_min(context.sender);
-    float rtt_max = reliable_endpoint_rtt_max(context.sender);
-    float rtt_avg = reliable_endpoint_rtt_avg(context.sender);
+    struct reliable_profile_phase_t sender_profile[RELIABLE_PROFILE_NUM_PHASES];
+    struct reliable_profile_phase_t receiver_profile[RELIABLE_PROFILE_NUM_PHASES];
 
-    check(rtt == rtt && rtt >= 0); // Check rtt is finite and non-negative
-    check(rtt_min >= 0 && rtt_min <= rtt_avg && rtt_avg <= rtt_max);
-    check(rtt_max < 1000.0); // Assume RTT is in milliseconds
+    reliable_endpoint_profile( context.sender, sender_profile );
+    reliable_endpoint_profile( context.receiver, receiver_profile );
 
-    reliable_endpoint_destroy(context.sender);
-    reliable_endpoint_destroy(context.receiver);
+#if RELIABLE_PROFILE
+
+    check( sender_profile[RELIABLE_PROFILE_PHASE_SEND_PREPARE].count == (uint64_t) ( num_iterations * 2 ) );
+    check( sender_profile[RELIABLE_PROFILE_PHASE_SEND_TRANSMIT].count == (uint64_t) ( num_iterations * 2 ) );
+    check( sender_profile[RELIABLE_PROFILE_PHASE_RECEIVE_HEADER].count == 0 );
+
+    // reassembled packets go back through receive, so they decode a header twice: once per fragment, then once as a whole
+
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_HEADER].count == (uint64_t) ( num_iterations * 6 ) );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_REASSEMBLY].count == (uint64_t) ( num_iterations * 4 ) );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_CHECKS].count == (uint64_t) ( num_iterations * 2 ) );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_PROCESS].count == (uint64_t) ( num_iterations * 2 ) );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_ACKS].count == (uint64_t) ( num_iterations * 2 ) );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_SEND_PREPARE].count == 0 );
+
+    check( sender_profile[RELIABLE_PROFILE_PHASE_UPDATE_RTT].count == (uint64_t) num_iterations );
+    check( sender_profile[RELIABLE_PROFILE_PHASE_UPDATE_PACKET_LOSS].count == (uint64_t) num_iterations );
+    check( sender_profile[RELIABLE_PROFILE_PHASE_UPDATE_BANDWIDTH].count == (uint64_t) num_iterations );
+    check( sender_profile[RELIABLE_PROFILE_PHASE_UPDATE_MTU].count == 0 );
+    check( sender_profile[RELIABLE_PROFILE_PHASE_UPDATE_SNAPSHOT].count == (uint64_t) num_iterations );
+
+    for ( i = 0; i < RELIABLE_PROFILE_NUM_PHASES; ++i )
+    {
+        check( sender_profile[i].max_cycles <= sender_profile[i].total_cycles );
+        check( receiver_profile[i].max_cycles <= receiver_profile[i].total_cycles );
+        check( reliable_profile_phase_name( i ) != NULL );
+    }
+
+    // a packet dropped partway only counts toward the phases it finished
+
+    reliable_endpoint_reset_profile( context.receiver );
+
+    uint8_t truncated_packet[1] = { 0 };
+    reliable_endpoint_receive_packet( context.receiver, truncated_packet, sizeof( truncated_packet ) );
+
+    reliable_endpoint_profile( context.receiver, receiver_profile );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_HEADER].count == 1 );
+    check( receiver_profile[RELIABLE_PROFILE_PHASE_RECEIVE_CHECKS].count == 0 );
+
+#else // #if RELIABLE_PROFILE
+
+    for ( i = 0; i < RELIABLE_PROFILE_NUM_PHASES; ++i )
+    {
+        check( sender_profile[i].count == 0 );
+        check( receiver_profile[i].count == 0 );
+    }
+
+#endif // #if RELIABLE_PROFILE
+
+    // reset clears the profile along with the counters
+
+    reliable_endpoint_reset( context.sender );
+
+    reliable_endpoint_profile( context.sender, sender_profile );
+    for ( i = 0; i < RELIABLE_PROFILE_NUM_PHASES; ++i )
+    {
+        check( sender_profile[i].count == 0 );
+        check( sender_profile[i].total_cycles == 0 );
+        check( sender_profile[i].max_cycles == 0 );
+    }
+
+    reliable_endpoint_destroy( context.sender );
+    reliable_endpoint_destroy( context.receiver );
 }
 
 #define RUN_TEST( test_function )                                           \
@@ -3045,7 +7211,9 @@ void reliable_test()
     {
         RUN_TEST( test_endian );
         RUN_TEST( test_sequence_buffer );
+        RUN_TEST( test_sequence_buffer_index );
         RUN_TEST( test_generate_ack_bits );
+        RUN_TEST( test_simd_kernels );
         RUN_TEST( test_packet_header );
         RUN_TEST( test_acks );
         RUN_TEST( test_acks_packet_loss );
@@ -3058,6 +7226,19 @@ void reliable_test()
         RUN_TEST( test_fragment_cleanup );
         RUN_TEST( test_rtt );
         RUN_TEST( test_endpoint_reset );
+        RUN_TEST( test_mtu_probing );
+        RUN_TEST( test_fragment_size_smaller_than_receiver );
+        RUN_TEST( test_transmit_fragments );
+        RUN_TEST( test_send_queue );
+        RUN_TEST( test_snapshot );
+        RUN_TEST( test_log_binary );
+        RUN_TEST( test_profile );
+        RUN_TEST( test_histogram );
+        RUN_TEST( test_rtt_percentiles );
+        RUN_TEST( test_bandwidth_window );
+        RUN_TEST( test_capture );
+        RUN_TEST( test_capture_pcapng );
+        RUN_TEST( test_stats_aggregator );
     }
 }
 
@@ -32,9 +32,9 @@
 #ifndef RELIABLE_H
 #define RELIABLE_H
 
-#define RELIABLE_VERSION_FULL    "1.4.0"
-#define RELIABLE_VERSION_MAJOR   1
-#define RELIABLE_VERSION_MINOR   4
+#define RELIABLE_VERSION_FULL    "2.0.0"
+#define RELIABLE_VERSION_MAJOR   2
+#define RELIABLE_VERSION_MINOR   0
 #define RELIABLE_VERSION_PATCH   0
 
 #include <stdint.h>
@@ -82,11 +82,22 @@
 #define RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED                    8
 #define RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_INVALID                     9
 #define RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_DUPLICATE                     10
-#define RELIABLE_ENDPOINT_NUM_COUNTERS                                      11
+#define RELIABLE_ENDPOINT_COUNTER_NUM_MTU_PROBES_SENT                       11
+#define RELIABLE_ENDPOINT_COUNTER_NUM_MTU_PROBES_RECEIVED                   12
+#define RELIABLE_ENDPOINT_NUM_COUNTERS                                      13
 
 #define RELIABLE_MAX_PACKET_HEADER_BYTES 9
 #define RELIABLE_FRAGMENT_HEADER_BYTES   5
 
+// upper bounds on the memory an endpoint allocates for its own state, for each sent packet, received packet, bandwidth bucket
+// and send queue entry, and for each fragment reassembly entry. not counting the buffers sized directly from the config.
+// reliable.hpp uses these to size an endpoint's memory at compile time, and reliable.c fails to build if they're too small
+
+#define RELIABLE_ENDPOINT_STATE_BYTES       8192
+#define RELIABLE_PACKET_ENTRY_BYTES         32
+#define RELIABLE_REASSEMBLY_ENTRY_BYTES     320
+#define RELIABLE_BANDWIDTH_BUCKET_TIME      0.01
+
 #define RELIABLE_LOG_LEVEL_NONE     0
 #define RELIABLE_LOG_LEVEL_ERROR    1
 #define RELIABLE_LOG_LEVEL_INFO     2
@@ -114,6 +125,17 @@ int reliable_init(void);
 
 void reliable_term(void);
 
+// reliable_init picks the fastest simd kernels this cpu runs for the rtt statistics in update and for building ack bits.
+// set the RELIABLE_SIMD environment variable to "scalar", "sse4.2", "avx2", "avx512" or "neon" to choose one instead.
+// reliable_simd_set does the same at runtime, and returns RELIABLE_ERROR without changing anything if the name is unknown
+// or the cpu can't run it. don't call it while other threads are updating endpoints
+
+int reliable_simd_set( RELIABLE_CONST char * name );
+
+// the name of the kernels in use
+
+RELIABLE_CONST char * reliable_simd_name(void);
+
 struct reliable_config_t
 {
     char name[256];                                                             // name of the endpoint. used in log output
@@ -124,21 +146,36 @@ struct reliable_config_t
     int max_fragments;                                                          // maximum number of fragments per-packet. 256 max. must cover max_packet_size / fragment_size
     int fragment_size;                                                          // size of each fragment (bytes)
     int ack_buffer_size;                                                        // maximum number of acks buffered between calls to reliable_endpoint_clear_acks
-    int sent_packets_buffer_size;                                               // number of sent packets tracked for acks, packet loss and bandwidth stats
+    int sent_packets_buffer_size;                                               // number of sent packets tracked for acks and packet loss
     int received_packets_buffer_size;                                           // number of received packets tracked. also the window for stale and duplicate packet rejection
     int fragment_reassembly_buffer_size;                                        // number of packets that can be under reassembly from fragments at the same time
     float rtt_smoothing_factor;                                                 // exponential smoothing factor for the rtt moving average
     int rtt_history_size;                                                       // number of rtt samples kept for min/max/avg rtt and jitter
     float packet_loss_smoothing_factor;                                         // exponential smoothing factor for packet loss
-    float bandwidth_smoothing_factor;                                           // exponential smoothing factor for bandwidth
+    float bandwidth_smoothing_factor;                                           // deprecated and ignored since 2.0, bandwidth is measured exactly over bandwidth_window. will be removed in 3.0
     int packet_header_size;                                                     // assumed network header overhead per-packet, used only for bandwidth stats. 28 = IPv4 + UDP
     void (*transmit_packet_function)(void*,uint64_t,uint16_t,uint8_t*,int);     // called to send a packet: (context, id, sequence, packet_data, packet_bytes). must not send packets on the same endpoint
     int (*process_packet_function)(void*,uint64_t,uint16_t,uint8_t*,int);       // called when a packet is received: (context, id, sequence, packet_data, packet_bytes). return 1 to accept and ack the packet, 0 to reject it (rejected packets are not acked and may be processed again if they arrive again)
     void * allocator_context;                                                   // passed to the allocate and free functions
     void * (*allocate_function)(void*,size_t);                                  // custom allocator. NULL = malloc
     void (*free_function)(void*,void*);                                         // custom free. NULL = free
+
+    // added in 2.0. new fields go after this point, so the ones above keep the offsets they had in 1.x
+
+    float bandwidth_window;                                                     // seconds of traffic bandwidth is measured over. split into 10ms buckets
+    int mtu_probing;                                                            // 1 = probe for the path mtu and size fragments to fit it at runtime. fragment_above and fragment_size become upper bounds. needs max_fragments well above max_packet_size / fragment_size, or there is no room to probe (the defaults have none)
+    int mtu_min;                                                                // smallest datagram (bytes) assumed to always get through. probing starts here and never goes below it
+    int mtu_max;                                                                // largest datagram (bytes) to probe for. 0 = big enough for a full fragment_size fragment
+    float mtu_probe_interval;                                                   // seconds between mtu probes while searching
+    int send_queue_size;                                                        // packets that other threads can queue between calls to reliable_endpoint_pump. power of two. 0 = no send queue
+    void (*transmit_fragments_function)(void*,uint64_t,uint16_t,uint8_t*,int,int); // optional. called to send every fragment after the first in one buffer: (context, id, sequence, fragment_data, fragment_bytes, stride). see below. NULL = each goes through transmit_packet_function
 };
 
+// with transmit_fragments_function set, a fragmented packet costs two calls instead of one per fragment. the first fragment
+// carries the packet header too, so it goes through transmit_packet_function as usual. the rest are written back to back,
+// each stride bytes long except the last, which may be shorter. that is the layout UDP generic segmentation offload
+// expects: pass stride as the UDP_SEGMENT size, or see reliable_udp_mmsg_send_segments in reliable_udp.h
+
 // fills a config with sensible defaults for a client/server game exchanging packets at 60HZ
 
 void reliable_default_config( struct reliable_config_t * config );
@@ -153,10 +190,28 @@ struct reliable_endpoint_t * reliable_endpoint_create( struct reliable_config_t
 
 uint16_t reliable_endpoint_next_packet_sequence( struct reliable_endpoint_t * endpoint );
 
-// sends a packet. the packet is handed to the transmit packet callback, split into fragments first if larger than config.fragment_above
+// sends a packet. the packet is handed to the transmit packet callback, split into fragments first if larger than config.fragment_above.
+// with mtu probing on, fragment_above and fragment_size are lowered as needed to fit the discovered path mtu
 
 void reliable_endpoint_send_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes );
 
+// allocates a packet with the endpoint's allocator. only as thread safe as that allocator (the default, malloc, is)
+
+void * reliable_endpoint_allocate_packet( struct reliable_endpoint_t * endpoint, size_t bytes );
+
+// queues a packet to be sent on the next call to reliable_endpoint_pump. unlike the rest of the endpoint, this is safe to call from any number
+// of threads at once, while another thread owns the endpoint. it never locks. requires config.send_queue_size > 0.
+// the packet is not copied: the endpoint takes ownership of packet_data and frees it with the endpoint's allocator once sent, so allocate it
+// with reliable_endpoint_allocate_packet. returns RELIABLE_ERROR if the queue is full, in which case the caller still owns packet_data.
+// sequence numbers are assigned when the packet is pumped, not when it's queued
+
+int reliable_endpoint_queue_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes );
+
+// sends packets queued with reliable_endpoint_queue_packet, oldest first, via reliable_endpoint_send_packet. call from the thread that owns the endpoint,
+// typically once per-frame before reliable_endpoint_update. returns the number of packets sent
+
+int reliable_endpoint_pump( struct reliable_endpoint_t * endpoint );
+
 // call this for each packet received from your socket. valid packets are passed to the process packet callback. stale and duplicate packets are dropped
 
 void reliable_endpoint_receive_packet( struct reliable_endpoint_t * endpoint, uint8_t * packet_data, int packet_bytes );
@@ -173,11 +228,12 @@ uint16_t * reliable_endpoint_get_acks( struct reliable_endpoint_t * endpoint, in
 
 void reliable_endpoint_clear_acks( struct reliable_endpoint_t * endpoint );
 
-// resets the endpoint to its initial state: acks, counters, sequence number and all tracking buffers are cleared
+// resets the endpoint to its initial state: acks, counters, sequence number and all tracking buffers are cleared. packets still in the send queue are dropped
 
 void reliable_endpoint_reset( struct reliable_endpoint_t * endpoint );
 
-// updates rtt, jitter, packet loss and bandwidth stats. call once per-frame with the current time
+// updates rtt, jitter, packet loss and bandwidth stats. call once per-frame with the current time.
+// with mtu probing on, this is also where probe packets are sent, so the transmit packet callback may be called from here
 
 void reliable_endpoint_update( struct reliable_endpoint_t * endpoint, double time );
 
@@ -201,10 +257,159 @@ float reliable_endpoint_packet_loss( struct reliable_endpoint_t * endpoint );
 
 void reliable_endpoint_bandwidth( struct reliable_endpoint_t * endpoint, float * sent_bandwidth_kbps, float * received_bandwidth_kbps, float * acked_bandwidth_kpbs );
 
-// returns the array of RELIABLE_ENDPOINT_NUM_COUNTERS counters. index with RELIABLE_ENDPOINT_COUNTER_*
+// returns the largest datagram (bytes) known to get through to the other side. without mtu probing, this is just the largest datagram the config allows
+
+int reliable_endpoint_mtu( struct reliable_endpoint_t * endpoint );
+
+// fixed size log-linear histogram of times in milliseconds, with buckets no wider than 1/16 of their value (hdr histogram style).
+// percentiles are accurate to within half a bucket, about 3%. histograms with the same layout can be added together, so
+// a server can merge its endpoints' histograms and ask for percentiles across all of them
+
+#define RELIABLE_HISTOGRAM_NUM_BUCKETS 336
+
+struct reliable_histogram_t
+{
+    uint64_t count;
+    uint64_t buckets[RELIABLE_HISTOGRAM_NUM_BUCKETS];
+};
+
+void reliable_histogram_reset( struct reliable_histogram_t * histogram );
+
+void reliable_histogram_add( struct reliable_histogram_t * histogram, float milliseconds );
+
+// adds other into histogram
+
+void reliable_histogram_merge( struct reliable_histogram_t * histogram, RELIABLE_CONST struct reliable_histogram_t * other );
+
+// percentile is 0 to 100, e.g. 99 for p99. 0 is the smallest value recorded and 100 the largest. returns 0 if the histogram is empty
+
+float reliable_histogram_percentile( RELIABLE_CONST struct reliable_histogram_t * histogram, float percentile );
+
+// each endpoint adds every ack's rtt to one histogram, and how much it differs from the previous ack's rtt to another.
+// they accumulate from create until reset or reset_histograms. only read them from the thread that owns the endpoint
+
+RELIABLE_CONST struct reliable_histogram_t * reliable_endpoint_rtt_histogram( struct reliable_endpoint_t * endpoint );
+
+RELIABLE_CONST struct reliable_histogram_t * reliable_endpoint_jitter_histogram( struct reliable_endpoint_t * endpoint );
+
+float reliable_endpoint_rtt_percentile( struct reliable_endpoint_t * endpoint, float percentile );
+
+float reliable_endpoint_jitter_percentile( struct reliable_endpoint_t * endpoint, float percentile );
+
+void reliable_endpoint_reset_histograms( struct reliable_endpoint_t * endpoint );
+
+// process-wide totals without touching every endpoint. endpoints added to an aggregator add their counters, bytes and
+// rtt samples to a shard of it as they happen, and reading the totals only sums the shards. give each thread that owns
+// endpoints its own shard: a shard must only be written by one thread at a time, but reading is safe from any thread
+
+#define RELIABLE_STATS_PACKET_LOSS_BUCKETS 101
+
+struct reliable_stats_t
+{
+    uint64_t num_endpoints;
+    uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];                  // summed across endpoints, indexed with RELIABLE_ENDPOINT_COUNTER_*
+    uint64_t bytes_sent;                                                // including packet_header_size per packet, like the bandwidth stats
+    uint64_t bytes_received;
+    uint64_t bytes_acked;
+    struct reliable_histogram_t rtt_histogram;                          // every rtt sample from every endpoint
+    uint64_t packet_loss[RELIABLE_STATS_PACKET_LOSS_BUCKETS];           // packet_loss[i] = endpoints currently losing at least i% and less than i+1%
+};
+
+// allocator may be NULL for malloc and free
+
+struct reliable_stats_aggregator_t * reliable_stats_aggregator_create( int num_shards, 
+                                                                       void * allocator_context, 
+                                                                       void * (*allocate_function)(void*,size_t), 
+                                                                       void (*free_function)(void*,void*) );
+
+// remove or destroy every endpoint first
+
+void reliable_stats_aggregator_destroy( struct reliable_stats_aggregator_t * aggregator );
+
+// call from the thread that owns the shard. stats the endpoint collected before it was added are not included, and
+// destroying the endpoint removes it
+
+void reliable_stats_aggregator_add_endpoint( struct reliable_stats_aggregator_t * aggregator, int shard, struct reliable_endpoint_t * endpoint );
+
+void reliable_stats_aggregator_remove_endpoint( struct reliable_stats_aggregator_t * aggregator, struct reliable_endpoint_t * endpoint );
+
+// sums the shards. O(shards), safe from any thread. each value is exact, but a read that overlaps updates may see one
+// value a little ahead of another
+
+void reliable_stats_aggregator_read( struct reliable_stats_aggregator_t * aggregator, struct reliable_stats_t * stats );
+
+// returns the array of RELIABLE_ENDPOINT_NUM_COUNTERS counters. index with RELIABLE_ENDPOINT_COUNTER_*. only read it from the thread that owns the endpoint
 
 RELIABLE_CONST uint64_t * reliable_endpoint_counters( struct reliable_endpoint_t * endpoint );
 
+// returns one counter. when reliable.c is compiled with RELIABLE_ATOMIC_COUNTERS=1, counters are updated with relaxed atomic stores
+// on their own cache line, and this may be called from any thread while the endpoint is in use
+
+uint64_t reliable_endpoint_counter( struct reliable_endpoint_t * endpoint, int counter );
+
+// a consistent copy of the counters and stats, as of the last call to reliable_endpoint_update (or create/reset)
+
+struct reliable_endpoint_snapshot_t
+{
+    uint64_t counters[RELIABLE_ENDPOINT_NUM_COUNTERS];
+    double time;
+    float rtt;
+    float rtt_min;
+    float rtt_max;
+    float rtt_avg;
+    float jitter_avg_vs_min_rtt;
+    float jitter_max_vs_min_rtt;
+    float jitter_stddev_vs_avg_rtt;
+    float packet_loss;
+    float sent_bandwidth_kbps;
+    float received_bandwidth_kbps;
+    float acked_bandwidth_kbps;
+    int mtu;
+};
+
+// copies the latest snapshot. safe to call from any thread, e.g. a metrics exporter, while another thread uses the endpoint.
+// it is a seqlock: the endpoint publishes a new snapshot at the end of each update without ever waiting, and this retries
+// in the rare case it overlaps with an update
+
+void reliable_endpoint_snapshot( struct reliable_endpoint_t * endpoint, struct reliable_endpoint_snapshot_t * snapshot );
+
+// phases of send, receive and update timed when reliable.c is compiled with RELIABLE_PROFILE=1
+
+#define RELIABLE_PROFILE_PHASE_SEND_PREPARE                 0
+#define RELIABLE_PROFILE_PHASE_SEND_TRANSMIT                1
+#define RELIABLE_PROFILE_PHASE_RECEIVE_HEADER               2
+#define RELIABLE_PROFILE_PHASE_RECEIVE_CHECKS               3
+#define RELIABLE_PROFILE_PHASE_RECEIVE_PROCESS              4
+#define RELIABLE_PROFILE_PHASE_RECEIVE_ACKS                 5
+#define RELIABLE_PROFILE_PHASE_RECEIVE_REASSEMBLY           6
+#define RELIABLE_PROFILE_PHASE_UPDATE_RTT                   7
+#define RELIABLE_PROFILE_PHASE_UPDATE_PACKET_LOSS           8
+#define RELIABLE_PROFILE_PHASE_UPDATE_BANDWIDTH             9
+#define RELIABLE_PROFILE_PHASE_UPDATE_MTU                   10
+#define RELIABLE_PROFILE_PHASE_UPDATE_SNAPSHOT              11
+#define RELIABLE_PROFILE_NUM_PHASES                         12
+
+// cycles are read from the cpu timestamp counter (rdtsc on x86, cntvct_el0 on arm64), or are nanoseconds where there isn't one.
+// a packet dropped partway through only counts toward the phases it finished
+
+struct reliable_profile_phase_t
+{
+    uint64_t count;
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+};
+
+// copies RELIABLE_PROFILE_NUM_PHASES phases into phases, indexed with RELIABLE_PROFILE_PHASE_*. all zero without RELIABLE_PROFILE.
+// only call it from the thread that owns the endpoint
+
+void reliable_endpoint_profile( struct reliable_endpoint_t * endpoint, struct reliable_profile_phase_t * phases );
+
+// zeroes the profile, e.g. once per frame so max_cycles is the worst call in that frame
+
+void reliable_endpoint_reset_profile( struct reliable_endpoint_t * endpoint );
+
+RELIABLE_CONST char * reliable_profile_phase_name( int phase );
+
 // destroys an endpoint, freeing everything it allocated
 
 void reliable_endpoint_destroy( struct reliable_endpoint_t * endpoint );
@@ -217,6 +422,133 @@ void reliable_log_level( int level );
 
 void reliable_set_printf_function( int (*function)( RELIABLE_CONST char *, ... ) );
 
+#define RELIABLE_LOG_MODE_PRINTF    0
+#define RELIABLE_LOG_MODE_BINARY    1
+
+// selects how endpoints log (process-wide). RELIABLE_LOG_MODE_PRINTF formats and prints each message as it happens.
+// RELIABLE_LOG_MODE_BINARY instead writes a fixed-size record into a lock-free ring owned by the calling thread, which costs a few
+// nanoseconds, and nothing is formatted until reliable_log_read or reliable_log_flush. if a ring fills up, new records are dropped and counted.
+// rings are allocated with malloc the first time each thread logs, and freed by reliable_term
+
+void reliable_log_mode( int mode );
+
+#define RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_SEND         0
+#define RELIABLE_LOG_EVENT_SEND_PACKET                      1
+#define RELIABLE_LOG_EVENT_SEND_PACKET_UNFRAGMENTED         2
+#define RELIABLE_LOG_EVENT_SEND_PACKET_FRAGMENTED           3
+#define RELIABLE_LOG_EVENT_SEND_MTU_PROBE                   4
+#define RELIABLE_LOG_EVENT_MTU_PROBE_ACKED                  5
+#define RELIABLE_LOG_EVENT_MTU_CHANGED                      6
+#define RELIABLE_LOG_EVENT_MTU_LOST                         7
+#define RELIABLE_LOG_EVENT_PACKET_TOO_LARGE_TO_RECEIVE      8
+#define RELIABLE_LOG_EVENT_PAYLOAD_TOO_LARGE_TO_RECEIVE     9
+#define RELIABLE_LOG_EVENT_INVALID_PACKET                   10
+#define RELIABLE_LOG_EVENT_STALE_PACKET                     11
+#define RELIABLE_LOG_EVENT_DUPLICATE_PACKET                 12
+#define RELIABLE_LOG_EVENT_PROCESS_PACKET                   13
+#define RELIABLE_LOG_EVENT_PROCESS_MTU_PROBE                14
+#define RELIABLE_LOG_EVENT_PROCESS_PACKET_SUCCESSFUL        15
+#define RELIABLE_LOG_EVENT_PROCESS_PACKET_FAILED            16
+#define RELIABLE_LOG_EVENT_PACKET_ACKED                     17
+#define RELIABLE_LOG_EVENT_ACK_BUFFER_FULL                  18
+#define RELIABLE_LOG_EVENT_INVALID_FRAGMENT                 19
+#define RELIABLE_LOG_EVENT_FRAGMENT_OF_RECEIVED_PACKET      20
+#define RELIABLE_LOG_EVENT_FRAGMENT_STALE                   21
+#define RELIABLE_LOG_EVENT_FRAGMENT_COUNT_MISMATCH          22
+#define RELIABLE_LOG_EVENT_FRAGMENT_DUPLICATE               23
+#define RELIABLE_LOG_EVENT_FRAGMENT_SIZE_MISMATCH           24
+#define RELIABLE_LOG_EVENT_LAST_FRAGMENT_TOO_LARGE          25
+#define RELIABLE_LOG_EVENT_FRAGMENT_RECEIVED                26
+#define RELIABLE_LOG_EVENT_REASSEMBLY_COMPLETE              27
+#define RELIABLE_LOG_NUM_EVENTS                             28
+
+// one binary log record. args are event specific, in the order they appear in the formatted message
+
+struct reliable_log_record_t
+{
+    double time;                                                                // endpoint time when the event was logged
+    uint64_t endpoint_id;                                                       // config.id of the endpoint
+    uint16_t event;                                                             // RELIABLE_LOG_EVENT_*
+    uint16_t sequence;                                                          // packet sequence the event is about, if any
+    uint8_t level;                                                              // RELIABLE_LOG_LEVEL_*
+    int32_t args[3];
+};
+
+// moves up to max_records binary log records out of the per-thread rings. records from the same thread are in order. returns the number of records
+
+int reliable_log_read( struct reliable_log_record_t * records, int max_records );
+
+// formats a binary log record as text, the same message printf mode would have logged
+
+void reliable_log_format( RELIABLE_CONST struct reliable_log_record_t * record, char * buffer, size_t buffer_size );
+
+// reads, formats and prints every pending binary log record through the printf function. call from a consumer thread or when dumping. returns the number of records
+
+int reliable_log_flush(void);
+
+// packet capture, for replaying production traffic offline with reliable_replay. while a capture runs, every endpoint records its
+// creation, each datagram it sends and receives and each update into a lock-free ring owned by the calling thread, and
+// reliable_capture_flush writes those records to the file. datagrams are cut to max_payload_bytes in the file (-1 = keep them whole).
+// returns RELIABLE_ERROR if a capture is already running or the file could not be opened
+
+int reliable_capture_start( RELIABLE_CONST char * filename, int max_payload_bytes );
+
+// starts a capture that writes a pcapng file instead, for wireshark and the dissector in tools/wireshark. only sends and receives
+// are written. each datagram is wrapped in made up ipv4 and udp headers: the endpoint is 10.x.y.z from the low 24 bits of its id,
+// the far end is always RELIABLE_CAPTURE_PCAPNG_PEER_ADDRESS and both use port RELIABLE_CAPTURE_PCAPNG_PORT. timestamps are endpoint time.
+// flush and stop work the same for both formats
+
+int reliable_capture_start_pcapng( RELIABLE_CONST char * filename, int max_payload_bytes );
+
+// writes every pending record to the capture file. call regularly from one thread, e.g. once per-frame. returns the number of bytes written
+
+int reliable_capture_flush(void);
+
+// flushes and closes the capture file. call between frames, when no endpoint is in use. returns the number of records dropped because a ring was full
+
+int reliable_capture_stop(void);
+
+// a capture file is a 12 byte header (uint32 RELIABLE_CAPTURE_MAGIC, uint32 RELIABLE_CAPTURE_VERSION, int32 max_payload_bytes) followed by records.
+// each record is a 28 byte header followed by data_bytes of data. everything is little-endian:
+//
+//     [type]              (uint8)     RELIABLE_CAPTURE_*
+//     [reserved]          (uint8, uint16)
+//     [endpoint id]       (uint64)
+//     [time]              (float64)   endpoint time, as passed to reliable_endpoint_update
+//     [packet bytes]      (uint32)    size of the datagram before it was cut to max_payload_bytes
+//     [data bytes]        (uint32)
+//
+// records from one endpoint are in order. records from endpoints on different threads are interleaved
+
+#define RELIABLE_CAPTURE_MAGIC                              0x70616372
+#define RELIABLE_CAPTURE_VERSION                            1
+#define RELIABLE_CAPTURE_FILE_HEADER_BYTES                  12
+#define RELIABLE_CAPTURE_RECORD_HEADER_BYTES                28
+
+#define RELIABLE_CAPTURE_PCAPNG_ENDPOINT_ADDRESS            0x0A000000  // 10.0.0.0
+#define RELIABLE_CAPTURE_PCAPNG_PEER_ADDRESS                0xC0000201  // 192.0.2.1
+#define RELIABLE_CAPTURE_PCAPNG_PORT                        40000
+
+#define RELIABLE_CAPTURE_CREATE                             0           // data is RELIABLE_CAPTURE_NUM_CONFIG_VALUES int32 config values, in the order below
+#define RELIABLE_CAPTURE_RECEIVE                            1           // data is the datagram passed to reliable_endpoint_receive_packet
+#define RELIABLE_CAPTURE_SEND                               2           // data is the datagram passed to the transmit packet callback
+#define RELIABLE_CAPTURE_UPDATE                             3           // no data
+
+#define RELIABLE_CAPTURE_CONFIG_MAX_PACKET_SIZE                     0
+#define RELIABLE_CAPTURE_CONFIG_FRAGMENT_ABOVE                      1
+#define RELIABLE_CAPTURE_CONFIG_MAX_FRAGMENTS                       2
+#define RELIABLE_CAPTURE_CONFIG_FRAGMENT_SIZE                       3
+#define RELIABLE_CAPTURE_CONFIG_ACK_BUFFER_SIZE                     4
+#define RELIABLE_CAPTURE_CONFIG_SENT_PACKETS_BUFFER_SIZE            5
+#define RELIABLE_CAPTURE_CONFIG_RECEIVED_PACKETS_BUFFER_SIZE        6
+#define RELIABLE_CAPTURE_CONFIG_FRAGMENT_REASSEMBLY_BUFFER_SIZE     7
+#define RELIABLE_CAPTURE_CONFIG_RTT_HISTORY_SIZE                    8
+#define RELIABLE_CAPTURE_CONFIG_PACKET_HEADER_SIZE                  9
+#define RELIABLE_CAPTURE_CONFIG_MTU_PROBING                         10
+#define RELIABLE_CAPTURE_CONFIG_MTU_MIN                             11
+#define RELIABLE_CAPTURE_CONFIG_MTU_MAX                             12
+#define RELIABLE_CAPTURE_NUM_CONFIG_VALUES                          13
+
 extern void (*reliable_assert_function)( RELIABLE_CONST char *, RELIABLE_CONST char *, RELIABLE_CONST char * file, int line );
 
 #ifdef RELIABLE_DEBUG
@@ -245,3 +577,13 @@ void reliable_copy_string( char * dest, RELIABLE_CONST char * source, size_t des
 #endif
 
 #endif // #ifndef RELIABLE_H
+
+// to build without linking the library, define RELIABLE_IMPLEMENTATION before including reliable.h in exactly one source
+// file, with reliable.c next to reliable.h. the library is then compiled into that file, so calls from your network code
+// into the send and receive paths can be inlined without link time optimization. every other file includes reliable.h as
+// usual. don't also link the reliable library
+
+#if defined( RELIABLE_IMPLEMENTATION ) && !defined( RELIABLE_IMPLEMENTATION_INCLUDED )
+#define RELIABLE_IMPLEMENTATION_INCLUDED
+#include "reliable.c"
+#endif // #if defined( RELIABLE_IMPLEMENTATION ) && !defined( RELIABLE_IMPLEMENTATION_INCLUDED )
@@ -0,0 +1,242 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RELIABLE_HPP
+#define RELIABLE_HPP
+
+#include "reliable.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// an optional C++17 wrapper for endpoints whose configuration is known at compile time. buffer sizes, fragment
+// parameters and feature toggles come from a Config type instead of a reliable_config_t, and are checked with
+// static_assert. the endpoint and everything it allocates live in a std::array inside the Endpoint, so nothing is
+// allocated on the heap, and the tracking buffers are powers of two so every sequence lookup is a mask.
+//
+// it is the same endpoint underneath, so it interoperates with plain C endpoints on the wire. derive from
+// reliable::DefaultConfig and shadow what you want to change:
+//
+//     struct SmallConfig : reliable::DefaultConfig
+//     {
+//         static constexpr int max_packet_size = 4 * 1024;
+//         static constexpr int max_fragments = 4;
+//         static constexpr int fragment_reassembly_buffer_size = 8;
+//     };
+//
+//     static reliable::Endpoint<SmallConfig> endpoint( "client", 0, &context, transmit, process, time );
+//
+// with the defaults an Endpoint is over a megabyte, mostly reassembly buffers, so make it static or allocate it once
+// rather than putting it on the stack. an Endpoint can't be copied or moved, since the endpoint points into itself
+
+namespace reliable
+{
+    struct DefaultConfig
+    {
+        static constexpr int max_packet_size = 16 * 1024;
+        static constexpr int fragment_above = 1024;
+        static constexpr int max_fragments = 16;
+        static constexpr int fragment_size = 1024;
+        static constexpr int ack_buffer_size = 256;
+        static constexpr int sent_packets_buffer_size = 256;
+        static constexpr int received_packets_buffer_size = 256;
+        static constexpr int fragment_reassembly_buffer_size = 64;
+        static constexpr int rtt_history_size = 512;
+        static constexpr float bandwidth_window = 1.0f;
+        static constexpr bool mtu_probing = false;
+    };
+
+    template <typename Config = DefaultConfig> class Endpoint
+    {
+    public:
+
+        static_assert( Config::max_packet_size > 0, "max_packet_size must be positive" );
+        static_assert( Config::fragment_above > 0, "fragment_above must be positive" );
+        static_assert( Config::fragment_size > 0, "fragment_size must be positive" );
+        static_assert( Config::max_fragments > 0 && Config::max_fragments <= 256, "max_fragments must be 1 to 256" );
+        static_assert( Config::max_fragments * Config::fragment_size >= Config::max_packet_size, "max_fragments fragments of fragment_size must cover max_packet_size" );
+        static_assert( Config::ack_buffer_size > 0, "ack_buffer_size must be positive" );
+        static_assert( Config::rtt_history_size > 0, "rtt_history_size must be positive" );
+        static_assert( Config::bandwidth_window >= RELIABLE_BANDWIDTH_BUCKET_TIME, "bandwidth_window must cover at least one bucket" );
+        static_assert( Config::sent_packets_buffer_size > 0 && ( Config::sent_packets_buffer_size & ( Config::sent_packets_buffer_size - 1 ) ) == 0, "sent_packets_buffer_size must be a power of two" );
+        static_assert( Config::received_packets_buffer_size > 0 && ( Config::received_packets_buffer_size & ( Config::received_packets_buffer_size - 1 ) ) == 0, "received_packets_buffer_size must be a power of two" );
+        static_assert( Config::fragment_reassembly_buffer_size > 0 && ( Config::fragment_reassembly_buffer_size & ( Config::fragment_reassembly_buffer_size - 1 ) ) == 0, "fragment_reassembly_buffer_size must be a power of two" );
+
+        // each allocation is padded to 16 bytes. the endpoint makes fewer than 16 allocations when it is created, from the
+        // front of memory, and one reassembly buffer per packet under reassembly, from fixed size slots at the back
+
+        static constexpr size_t alignment = 16;
+
+        static constexpr size_t align( size_t bytes ) { return ( bytes + alignment - 1 ) & ~( alignment - 1 ); }
+
+        static constexpr size_t bandwidth_buckets = size_t( Config::bandwidth_window / RELIABLE_BANDWIDTH_BUCKET_TIME + 0.5 );
+
+        static constexpr size_t transmit_buffer_bytes = size_t( Config::max_packet_size + RELIABLE_MAX_PACKET_HEADER_BYTES ) > size_t( RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + Config::fragment_size ) ?
+                                                        size_t( Config::max_packet_size + RELIABLE_MAX_PACKET_HEADER_BYTES ) : size_t( RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES + Config::fragment_size );
+
+        static constexpr size_t state_bytes = RELIABLE_ENDPOINT_STATE_BYTES + 16 * alignment
+                                            + size_t( Config::ack_buffer_size ) * sizeof( uint16_t )
+                                            + size_t( Config::sent_packets_buffer_size + Config::received_packets_buffer_size ) * RELIABLE_PACKET_ENTRY_BYTES
+                                            + size_t( Config::fragment_reassembly_buffer_size ) * RELIABLE_REASSEMBLY_ENTRY_BYTES
+                                            + size_t( Config::rtt_history_size ) * sizeof( float )
+                                            + bandwidth_buckets * RELIABLE_PACKET_ENTRY_BYTES
+                                            + transmit_buffer_bytes;
+
+        static constexpr size_t slot_bytes = align( size_t( RELIABLE_MAX_PACKET_HEADER_BYTES ) + size_t( Config::max_fragments ) * size_t( Config::fragment_size ) );
+
+        static constexpr size_t num_slots = size_t( Config::fragment_reassembly_buffer_size );
+
+        static constexpr size_t memory_bytes = align( state_bytes ) + num_slots * slot_bytes;
+
+        Endpoint( const char * name, uint64_t id, void * context, void (*transmit_packet_function)(void*,uint64_t,uint16_t,uint8_t*,int), int (*process_packet_function)(void*,uint64_t,uint16_t,uint8_t*,int), double time )
+        {
+            state_used = 0;
+            free_slots = nullptr;
+            for ( size_t i = num_slots; i > 0; --i )
+            {
+                Slot * slot = reinterpret_cast<Slot*>( memory.data() + align( state_bytes ) + ( i - 1 ) * slot_bytes );
+                slot->next = free_slots;
+                free_slots = slot;
+            }
+
+            struct reliable_config_t config;
+            reliable_default_config( &config );
+            reliable_copy_string( config.name, name, sizeof( config.name ) );
+            config.context = context;
+            config.id = id;
+            config.max_packet_size = Config::max_packet_size;
+            config.fragment_above = Config::fragment_above;
+            config.max_fragments = Config::max_fragments;
+            config.fragment_size = Config::fragment_size;
+            config.ack_buffer_size = Config::ack_buffer_size;
+            config.sent_packets_buffer_size = Config::sent_packets_buffer_size;
+            config.received_packets_buffer_size = Config::received_packets_buffer_size;
+            config.fragment_reassembly_buffer_size = Config::fragment_reassembly_buffer_size;
+            config.rtt_history_size = Config::rtt_history_size;
+            config.bandwidth_window = Config::bandwidth_window;
+            config.mtu_probing = Config::mtu_probing ? 1 : 0;
+            config.transmit_packet_function = transmit_packet_function;
+            config.process_packet_function = process_packet_function;
+            config.allocator_context = this;
+            config.allocate_function = &Endpoint::allocate_function;
+            config.free_function = &Endpoint::free_function;
+
+            endpoint = reliable_endpoint_create( &config, time );
+            reliable_assert( endpoint );
+        }
+
+        ~Endpoint()
+        {
+            reliable_endpoint_destroy( endpoint );
+        }
+
+        Endpoint( const Endpoint & ) = delete;
+        Endpoint & operator = ( const Endpoint & ) = delete;
+
+        uint16_t next_packet_sequence() { return reliable_endpoint_next_packet_sequence( endpoint ); }
+
+        void send_packet( uint8_t * packet_data, int packet_bytes ) { reliable_endpoint_send_packet( endpoint, packet_data, packet_bytes ); }
+
+        void receive_packet( uint8_t * packet_data, int packet_bytes ) { reliable_endpoint_receive_packet( endpoint, packet_data, packet_bytes ); }
+
+        uint16_t * get_acks( int * num_acks ) { return reliable_endpoint_get_acks( endpoint, num_acks ); }
+
+        void clear_acks() { reliable_endpoint_clear_acks( endpoint ); }
+
+        void reset() { reliable_endpoint_reset( endpoint ); }
+
+        void update( double time ) { reliable_endpoint_update( endpoint, time ); }
+
+        float rtt() { return reliable_endpoint_rtt( endpoint ); }
+
+        float packet_loss() { return reliable_endpoint_packet_loss( endpoint ); }
+
+        RELIABLE_CONST uint64_t * counters() { return reliable_endpoint_counters( endpoint ); }
+
+        // the underlying endpoint, for everything else in reliable.h
+
+        struct reliable_endpoint_t * get() { return endpoint; }
+
+        // bytes of memory used by the endpoint's own state, and the number of slots holding packets under reassembly
+
+        size_t memory_used() const { return state_used; }
+
+        size_t slots_used() const
+        {
+            size_t num_free = 0;
+            for ( const Slot * slot = free_slots; slot; slot = slot->next )
+                num_free++;
+            return num_slots - num_free;
+        }
+
+    private:
+
+        struct Slot
+        {
+            Slot * next;
+        };
+
+        // reliable.hpp checks its bounds at compile time, so running out of memory here is a bug in those bounds
+
+        static void * allocate_function( void * context, size_t bytes )
+        {
+            Endpoint * self = static_cast<Endpoint*>( context );
+            if ( !self->endpoint )
+            {
+                size_t aligned_bytes = align( bytes );
+                reliable_assert( self->state_used + aligned_bytes <= align( state_bytes ) );
+                uint8_t * pointer = self->memory.data() + self->state_used;
+                self->state_used += aligned_bytes;
+                return pointer;
+            }
+            reliable_assert( bytes <= slot_bytes );
+            reliable_assert( self->free_slots );
+            Slot * slot = self->free_slots;
+            self->free_slots = slot->next;
+            return slot;
+        }
+
+        // memory from the front is given back all at once when the Endpoint is destroyed. slots go back on the free list
+
+        static void free_function( void * context, void * pointer )
+        {
+            Endpoint * self = static_cast<Endpoint*>( context );
+            uint8_t * p = static_cast<uint8_t*>( pointer );
+            if ( p >= self->memory.data() + align( state_bytes ) && p < self->memory.data() + memory_bytes )
+            {
+                Slot * slot = reinterpret_cast<Slot*>( p );
+                slot->next = self->free_slots;
+                self->free_slots = slot;
+            }
+        }
+
+        alignas( alignment ) std::array<uint8_t, memory_bytes> memory;
+        size_t state_used;
+        Slot * free_slots;
+        struct reliable_endpoint_t * endpoint = nullptr;
+    };
+}
+
+#endif // #ifndef RELIABLE_HPP
@@ -0,0 +1,638 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// Microbenchmarks for the hot paths: packet header encode/decode, ack bits generation, sending with and without
+// fragmentation, receiving with ack processing, fragment reassembly and reliable_endpoint_update at several buffer
+// sizes. Inputs come from a fixed seed, so two runs do exactly the same work and the JSON this prints can be diffed
+// between commits. Each benchmark runs once to warm up, then REPETITIONS times. The median is the headline number.
+//
+// See BUILDING.md before reading anything into the numbers.
+//
+// reliable_bench_single is this same file built with RELIABLE_IMPLEMENTATION, so the library is compiled in here rather
+// than linked. Run both to see what inlining the library into its caller is worth.
+//
+// Usage: reliable_bench [--quick] [--filter substring] [--output file.json]
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// internals under test. not in reliable.h, but they have external linkage. built with RELIABLE_IMPLEMENTATION they are
+// static inline and already visible from reliable.h
+
+#if !defined( RELIABLE_IMPLEMENTATION )
+
+struct reliable_sequence_buffer_t;
+
+int reliable_write_packet_header( uint8_t * packet_data, uint16_t sequence, uint16_t ack, uint32_t ack_bits );
+int reliable_read_packet_header( const char * name, uint8_t * packet_data, int packet_bytes, uint16_t * sequence, uint16_t * ack, uint32_t * ack_bits );
+struct reliable_sequence_buffer_t * reliable_sequence_buffer_create( int num_entries, int entry_stride, void * allocator_context, void * (*allocate_function)(void*,size_t), void (*free_function)(void*,void*) );
+void reliable_sequence_buffer_destroy( struct reliable_sequence_buffer_t * sequence_buffer );
+void * reliable_sequence_buffer_insert( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t sequence );
+void reliable_sequence_buffer_generate_ack_bits( struct reliable_sequence_buffer_t * sequence_buffer, uint16_t * ack, uint32_t * ack_bits );
+
+#endif // #if !defined( RELIABLE_IMPLEMENTATION )
+
+#define BENCH_SEED 0x5EED1234u
+#define REPETITIONS 5
+#define MAX_CAPTURED_PACKETS 4096
+#define MAX_DATAGRAM_BYTES ( 16 * 1024 + 64 )
+
+static double bench_time()
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+// xorshift32. rand() differs between platforms, this doesn't
+
+static uint32_t random_state = BENCH_SEED;
+
+static uint32_t random_uint32()
+{
+    uint32_t x = random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random_state = x;
+    return x;
+}
+
+// stops the compiler from throwing away work whose result is otherwise unused
+
+static volatile uint32_t sink;
+
+// ---------------------------------------------------------------
+
+// packets an endpoint transmits can be captured, so receive benchmarks replay the same datagrams every repetition
+
+struct captured_packet_t
+{
+    uint8_t * data;
+    int bytes;
+};
+
+static struct captured_packet_t captured_packets[MAX_CAPTURED_PACKETS];
+static int num_captured_packets;
+static int capture_packets;
+
+// where each endpoint's packets go, indexed by config.id. NULL drops them
+
+static struct reliable_endpoint_t * link_to[2];
+
+static void transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+
+    if ( capture_packets && id == 0 )
+    {
+        assert( num_captured_packets < MAX_CAPTURED_PACKETS );
+        struct captured_packet_t * packet = captured_packets + num_captured_packets++;
+        packet->data = (uint8_t*) malloc( packet_bytes );
+        assert( packet->data );
+        memcpy( packet->data, packet_data, packet_bytes );
+        packet->bytes = packet_bytes;
+        return;
+    }
+
+    // 10% of packets are lost, so acks have holes in them
+
+    if ( link_to[id] && ( random_uint32() % 10 ) != 0 )
+        reliable_endpoint_receive_packet( link_to[id], packet_data, packet_bytes );
+}
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+static void bench_config( struct reliable_config_t * config, uint64_t id )
+{
+    reliable_default_config( config );
+    config->id = id;
+    config->transmit_packet_function = transmit_packet_function;
+    config->process_packet_function = process_packet_function;
+    config->ack_buffer_size = MAX_CAPTURED_PACKETS;
+    config->sent_packets_buffer_size = MAX_CAPTURED_PACKETS;
+}
+
+static void free_captured_packets()
+{
+    int i;
+    for ( i = 0; i < num_captured_packets; ++i )
+        free( captured_packets[i].data );
+    num_captured_packets = 0;
+}
+
+// endpoint 0 sends num_packets packets of packet_bytes each while endpoint 1 sends to it, and endpoint 0's packets are
+// captured. the captures ack endpoint 1's sequences 0 .. num_packets-1, with the holes left by 10% loss
+
+static void capture( int num_packets, int packet_bytes )
+{
+    static uint8_t packet_data[16*1024];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    struct reliable_config_t config;
+    bench_config( &config, 0 );
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &config, 100.0 );
+    bench_config( &config, 1 );
+    struct reliable_endpoint_t * receiver = reliable_endpoint_create( &config, 100.0 );
+
+    free_captured_packets();
+
+    link_to[1] = sender;
+    capture_packets = 1;
+
+    int i;
+    for ( i = 0; i < num_packets; ++i )
+    {
+        reliable_endpoint_send_packet( receiver, packet_data, 100 );
+        reliable_endpoint_send_packet( sender, packet_data, packet_bytes );
+    }
+
+    capture_packets = 0;
+    link_to[1] = NULL;
+
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( receiver );
+}
+
+// ---------------------------------------------------------------
+
+// doesn't touch the library. it measures how fast the machine is right now, so tools/perf/check_perf.py can tell a
+// slower library from a slower machine
+
+static uint32_t calibration_data[4096];
+
+static double bench_calibration( int iterations )
+{
+    uint32_t x = BENCH_SEED;
+    double start_time = bench_time();
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        calibration_data[x % 4096] += x;
+    }
+    double seconds = bench_time() - start_time;
+    sink = x + calibration_data[0];
+    return seconds;
+}
+
+// ---------------------------------------------------------------
+
+#define NUM_HEADERS 1024
+
+static uint16_t header_sequence[NUM_HEADERS];
+static uint16_t header_ack[NUM_HEADERS];
+static uint32_t header_ack_bits[NUM_HEADERS];
+static uint8_t header_data[NUM_HEADERS][16];
+static int header_bytes[NUM_HEADERS];
+
+// a mix of the header shapes seen on the wire: mostly no loss and a recent ack, some loss, some old acks
+
+static void setup_headers()
+{
+    int i;
+    for ( i = 0; i < NUM_HEADERS; ++i )
+    {
+        uint32_t r = random_uint32();
+        header_sequence[i] = (uint16_t) random_uint32();
+        header_ack[i] = ( r % 8 ) != 0 ? (uint16_t) ( header_sequence[i] - ( r >> 8 ) % 64 ) : (uint16_t) random_uint32();
+        header_ack_bits[i] = ( r % 4 ) != 0 ? 0xFFFFFFFF : ( 0xFFFFFFFF & ~( 1u << ( ( r >> 16 ) % 32 ) ) );
+        header_bytes[i] = reliable_write_packet_header( header_data[i], header_sequence[i], header_ack[i], header_ack_bits[i] );
+    }
+}
+
+static double bench_write_packet_header( int iterations )
+{
+    uint8_t packet_data[16];
+    uint32_t total = 0;
+    double start_time = bench_time();
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        int index = i % NUM_HEADERS;
+        total += reliable_write_packet_header( packet_data, header_sequence[index], header_ack[index], header_ack_bits[index] );
+        total += packet_data[0];
+    }
+    double seconds = bench_time() - start_time;
+    sink = total;
+    return seconds;
+}
+
+static double bench_read_packet_header( int iterations )
+{
+    uint32_t total = 0;
+    double start_time = bench_time();
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        int index = i % NUM_HEADERS;
+        uint16_t sequence = 0;
+        uint16_t ack = 0;
+        uint32_t ack_bits = 0;
+        total += reliable_read_packet_header( "bench", header_data[index], header_bytes[index], &sequence, &ack, &ack_bits );
+        total += sequence + ack + ack_bits;
+    }
+    double seconds = bench_time() - start_time;
+    sink = total;
+    return seconds;
+}
+
+// a received packets buffer as an endpoint would have it, with 10% of packets lost
+
+static struct reliable_sequence_buffer_t * ack_bits_buffer;
+
+static void setup_generate_ack_bits()
+{
+    ack_bits_buffer = reliable_sequence_buffer_create( 256, 16, NULL, NULL, NULL );
+    int i;
+    for ( i = 0; i < 256; ++i )
+    {
+        if ( ( random_uint32() % 10 ) != 0 )
+            reliable_sequence_buffer_insert( ack_bits_buffer, (uint16_t) i );
+    }
+}
+
+static void teardown_generate_ack_bits()
+{
+    reliable_sequence_buffer_destroy( ack_bits_buffer );
+    ack_bits_buffer = NULL;
+}
+
+static double bench_generate_ack_bits( int iterations )
+{
+    uint32_t total = 0;
+    double start_time = bench_time();
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        uint16_t ack;
+        uint32_t ack_bits;
+        reliable_sequence_buffer_generate_ack_bits( ack_bits_buffer, &ack, &ack_bits );
+        total += ack + ack_bits;
+    }
+    double seconds = bench_time() - start_time;
+    sink = total;
+    return seconds;
+}
+
+// sending. nothing is listening, so this is the cost of building the packet or fragments and handing them over
+
+static struct reliable_endpoint_t * bench_endpoint;
+
+static void setup_endpoint()
+{
+    struct reliable_config_t config;
+    bench_config( &config, 1 );
+    bench_endpoint = reliable_endpoint_create( &config, 100.0 );
+}
+
+static void teardown_endpoint()
+{
+    reliable_endpoint_destroy( bench_endpoint );
+    bench_endpoint = NULL;
+}
+
+static double bench_send( int iterations, int packet_bytes )
+{
+    static uint8_t packet_data[16*1024];
+    double start_time = bench_time();
+    int i;
+    for ( i = 0; i < iterations; ++i )
+        reliable_endpoint_send_packet( bench_endpoint, packet_data, packet_bytes );
+    return bench_time() - start_time;
+}
+
+static double bench_send_unfragmented( int iterations ) { return bench_send( iterations, 100 ); }
+static double bench_send_fragmented_2( int iterations ) { return bench_send( iterations, 2 * 1024 ); }
+static double bench_send_fragmented_4( int iterations ) { return bench_send( iterations, 4 * 1024 ); }
+static double bench_send_fragmented_16( int iterations ) { return bench_send( iterations, 16 * 1024 ); }
+
+// receiving. the captured packets are replayed into an endpoint that has just sent the packets they ack. only the
+// replay is timed
+
+static double bench_receive( int iterations )
+{
+    double seconds = 0.0;
+    while ( iterations > 0 )
+    {
+        reliable_endpoint_reset( bench_endpoint );
+        uint8_t packet_data[100];
+        memset( packet_data, 0, sizeof( packet_data ) );
+        int i;
+        for ( i = 0; i < num_captured_packets; ++i )
+            reliable_endpoint_send_packet( bench_endpoint, packet_data, sizeof( packet_data ) );
+
+        int batch = iterations < num_captured_packets ? iterations : num_captured_packets;
+        double start_time = bench_time();
+        for ( i = 0; i < batch; ++i )
+            reliable_endpoint_receive_packet( bench_endpoint, captured_packets[i].data, captured_packets[i].bytes );
+        seconds += bench_time() - start_time;
+
+        reliable_endpoint_clear_acks( bench_endpoint );
+        iterations -= batch;
+    }
+    return seconds;
+}
+
+static void setup_receive_acks()
+{
+    setup_endpoint();
+    capture( MAX_CAPTURED_PACKETS, 100 );
+}
+
+static void teardown_receive()
+{
+    teardown_endpoint();
+    free_captured_packets();
+}
+
+// reassembly. an op is a whole packet, so each op receives every fragment of one packet
+
+static int reassembly_num_fragments;
+
+static double bench_reassembly( int iterations )
+{
+    return bench_receive( iterations * reassembly_num_fragments );
+}
+
+static void setup_reassembly( int num_fragments )
+{
+    setup_endpoint();
+    reassembly_num_fragments = num_fragments;
+    capture( MAX_CAPTURED_PACKETS / num_fragments, num_fragments * 1024 );
+    assert( num_captured_packets == ( MAX_CAPTURED_PACKETS / num_fragments ) * num_fragments );
+}
+
+static void setup_reassembly_4() { setup_reassembly( 4 ); }
+static void setup_reassembly_16() { setup_reassembly( 16 ); }
+
+// update. the endpoint has live traffic in its buffers, so the rtt, packet loss and bandwidth calculations all
+// have real data to walk
+
+static double update_time;
+
+static void setup_update( int rtt_history_size, int buffer_size )
+{
+    struct reliable_config_t config;
+    bench_config( &config, 1 );
+    config.rtt_history_size = rtt_history_size;
+    config.sent_packets_buffer_size = buffer_size;
+    config.received_packets_buffer_size = buffer_size;
+    config.ack_buffer_size = buffer_size;
+    bench_endpoint = reliable_endpoint_create( &config, 100.0 );
+
+    bench_config( &config, 0 );
+    struct reliable_endpoint_t * peer = reliable_endpoint_create( &config, 100.0 );
+
+    uint8_t packet_data[100];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    link_to[0] = bench_endpoint;
+    link_to[1] = peer;
+    update_time = 100.0;
+    int i;
+    for ( i = 0; i < buffer_size + rtt_history_size; ++i )
+    {
+        reliable_endpoint_send_packet( bench_endpoint, packet_data, sizeof( packet_data ) );
+        reliable_endpoint_send_packet( peer, packet_data, sizeof( packet_data ) );
+        update_time += 0.01;
+        reliable_endpoint_update( peer, update_time );
+        reliable_endpoint_update( bench_endpoint, update_time );
+        reliable_endpoint_clear_acks( peer );
+        reliable_endpoint_clear_acks( bench_endpoint );
+    }
+    link_to[0] = NULL;
+    link_to[1] = NULL;
+
+    reliable_endpoint_destroy( peer );
+}
+
+static double bench_update( int iterations )
+{
+    double start_time = bench_time();
+    int i;
+    for ( i = 0; i < iterations; ++i )
+    {
+        update_time += 0.01;
+        reliable_endpoint_update( bench_endpoint, update_time );
+    }
+    return bench_time() - start_time;
+}
+
+static void setup_update_rtt_64_buffer_256() { setup_update( 64, 256 ); }
+static void setup_update_rtt_512_buffer_256() { setup_update( 512, 256 ); }
+static void setup_update_rtt_4096_buffer_256() { setup_update( 4096, 256 ); }
+static void setup_update_rtt_512_buffer_1024() { setup_update( 512, 1024 ); }
+static void setup_update_rtt_512_buffer_4096() { setup_update( 512, 4096 ); }
+
+// ---------------------------------------------------------------
+
+struct benchmark_t
+{
+    const char * name;
+    const char * unit;                      // what one op is
+    int iterations;
+    int packets_per_op;                     // 0 when an op is not a packet
+    void (*setup)();
+    double (*run)( int iterations );
+    void (*teardown)();
+};
+
+static void no_setup() {}
+static void no_teardown() {}
+
+static struct benchmark_t benchmarks[] = 
+{
+    { "calibration",                     "loop",    20000000, 0, no_setup,                         bench_calibration,          no_teardown },
+    { "write_packet_header",             "header",  10000000, 0, setup_headers,                    bench_write_packet_header,  no_teardown },
+    { "read_packet_header",              "header",  10000000, 0, setup_headers,                    bench_read_packet_header,   no_teardown },
+    { "generate_ack_bits",               "call",    2000000,  0, setup_generate_ack_bits,          bench_generate_ack_bits,    teardown_generate_ack_bits },
+    { "send_unfragmented",               "packet",  1000000,  1, setup_endpoint,                   bench_send_unfragmented,    teardown_endpoint },
+    { "send_fragmented_2",               "packet",  500000,   1, setup_endpoint,                   bench_send_fragmented_2,    teardown_endpoint },
+    { "send_fragmented_4",               "packet",  250000,   1, setup_endpoint,                   bench_send_fragmented_4,    teardown_endpoint },
+    { "send_fragmented_16",              "packet",  50000,    1, setup_endpoint,                   bench_send_fragmented_16,   teardown_endpoint },
+    { "receive_acks",                    "packet",  500000,   1, setup_receive_acks,               bench_receive,              teardown_receive },
+    { "reassembly_4",                    "packet",  100000,   1, setup_reassembly_4,               bench_reassembly,           teardown_receive },
+    { "reassembly_16",                   "packet",  25000,    1, setup_reassembly_16,              bench_reassembly,           teardown_receive },
+    { "update_rtt_64_buffer_256",        "update",  200000,   0, setup_update_rtt_64_buffer_256,   bench_update,               teardown_endpoint },
+    { "update_rtt_512_buffer_256",       "update",  100000,   0, setup_update_rtt_512_buffer_256,  bench_update,               teardown_endpoint },
+    { "update_rtt_4096_buffer_256",      "update",  20000,    0, setup_update_rtt_4096_buffer_256, bench_update,               teardown_endpoint },
+    { "update_rtt_512_buffer_1024",      "update",  50000,    0, setup_update_rtt_512_buffer_1024, bench_update,               teardown_endpoint },
+    { "update_rtt_512_buffer_4096",      "update",  20000,    0, setup_update_rtt_512_buffer_4096, bench_update,               teardown_endpoint },
+};
+
+#define NUM_BENCHMARKS ( (int) ( sizeof( benchmarks ) / sizeof( benchmarks[0] ) ) )
+
+static int compare_double( const void * a, const void * b )
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return x < y ? -1 : ( x > y ? 1 : 0 );
+}
+
+int main( int argc, char ** argv )
+{
+    int quick = 0;
+    const char * filter = NULL;
+    const char * output_filename = NULL;
+
+    int i;
+    for ( i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--quick" ) == 0 )
+            quick = 1;
+        else if ( strcmp( argv[i], "--filter" ) == 0 && i + 1 < argc )
+            filter = argv[++i];
+        else if ( strcmp( argv[i], "--output" ) == 0 && i + 1 < argc )
+            output_filename = argv[++i];
+        else
+        {
+            printf( "usage: reliable_bench [--quick] [--filter substring] [--output file.json]\n" );
+            return 1;
+        }
+    }
+
+    FILE * output = stdout;
+    if ( output_filename )
+    {
+        output = fopen( output_filename, "w" );
+        if ( !output )
+        {
+            printf( "error: could not open %s\n", output_filename );
+            return 1;
+        }
+    }
+
+    reliable_init();
+
+#if defined( RELIABLE_DEBUG )
+    const char * build = "debug";
+#elif defined( RELIABLE_RELEASE )
+    const char * build = "release";
+#else
+    const char * build = "unknown";
+#endif
+
+#if defined( RELIABLE_IMPLEMENTATION )
+    const char * linkage = "single";
+#else
+    const char * linkage = "library";
+#endif
+
+    fprintf( output, "{\n" );
+    fprintf( output, "    \"seed\": %u,\n", BENCH_SEED );
+    fprintf( output, "    \"build\": \"%s\",\n", build );
+    fprintf( output, "    \"linkage\": \"%s\",\n", linkage );
+    fprintf( output, "    \"simd\": \"%s\",\n", reliable_simd_name() );
+    fprintf( output, "    \"repetitions\": %d,\n", REPETITIONS );
+    fprintf( output, "    \"benchmarks\": [" );
+
+    int num_run = 0;
+
+    for ( i = 0; i < NUM_BENCHMARKS; ++i )
+    {
+        struct benchmark_t * benchmark = benchmarks + i;
+
+        if ( filter && !strstr( benchmark->name, filter ) )
+            continue;
+
+        int iterations = quick ? ( benchmark->iterations / 100 > 0 ? benchmark->iterations / 100 : 1 ) : benchmark->iterations;
+
+        // every benchmark starts from the same random state, so adding or filtering benchmarks doesn't change the others
+
+        random_state = BENCH_SEED;
+
+        benchmark->setup();
+
+        benchmark->run( iterations );
+
+        double ns_per_op[REPETITIONS];
+        int j;
+        for ( j = 0; j < REPETITIONS; ++j )
+            ns_per_op[j] = benchmark->run( iterations ) * 1000000000.0 / iterations;
+
+        benchmark->teardown();
+
+        qsort( ns_per_op, REPETITIONS, sizeof( double ), compare_double );
+
+        double median = ns_per_op[REPETITIONS/2];
+        double ops_per_sec = median > 0.0 ? 1000000000.0 / median : 0.0;
+
+        fprintf( output, "%s\n        {\n", num_run > 0 ? "," : "" );
+        fprintf( output, "            \"name\": \"%s\",\n", benchmark->name );
+        fprintf( output, "            \"unit\": \"%s\",\n", benchmark->unit );
+        fprintf( output, "            \"iterations\": %d,\n", iterations );
+        fprintf( output, "            \"ns_per_op\": %.3f,\n", median );
+        fprintf( output, "            \"ns_per_op_min\": %.3f,\n", ns_per_op[0] );
+        fprintf( output, "            \"ns_per_op_max\": %.3f,\n", ns_per_op[REPETITIONS-1] );
+        fprintf( output, "            \"ops_per_sec\": %.1f", ops_per_sec );
+        if ( benchmark->packets_per_op > 0 )
+            fprintf( output, ",\n            \"packets_per_sec\": %.1f", ops_per_sec * benchmark->packets_per_op );
+        fprintf( output, "\n        }" );
+        fflush( output );
+
+        if ( output != stdout )
+            printf( "%-32s %12.1f ns/op\n", benchmark->name, median );
+
+        num_run++;
+    }
+
+    fprintf( output, "\n    ]\n}\n" );
+
+    if ( output != stdout )
+        fclose( output );
+
+    reliable_term();
+
+    return 0;
+}
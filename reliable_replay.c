@@ -0,0 +1,580 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Replays a packet capture made with reliable_capture_start into fresh endpoints, so a production cpu spike can be
+// reproduced offline under perf. Each captured endpoint is recreated from its CREATE record (or the default config if
+// the capture started after it was created), then fed every datagram it received and updated at every time it was
+// updated, in capture order. Each packet it sent is sent again with a zeroed payload of the same size, worked out from
+// the captured datagram (or all the fragments of it), so acks, rtt and packet loss run against the same sent packets.
+// What the endpoints transmit is discarded. MTU probes aren't resent, because the replayed updates send their own.
+// Datagrams that were cut short in the capture are zero padded back to their original size.
+//
+// By default the capture is replayed as fast as possible. With --realtime, updates are paced to the capture's clock.
+// reliable.c is compiled into this program with RELIABLE_PROFILE=1, so it reports per-phase timing as well.
+//
+// Usage: reliable_replay <capture file> [--realtime] [--repeat N]
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define MAX_DATAGRAM_BYTES ( 64 * 1024 )
+#define MAX_SEND_BYTES ( 1024 * 1024 )
+
+static double replay_time()
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+static void replay_sleep( double seconds )
+{
+#if defined( _WIN32 )
+    Sleep( (DWORD) ( seconds * 1000.0 ) );
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t) seconds;
+    ts.tv_nsec = (long) ( ( seconds - (double) ts.tv_sec ) * 1000000000.0 );
+    nanosleep( &ts, NULL );
+#endif
+}
+
+static uint32_t read_uint32( const uint8_t * p )
+{
+    return (uint32_t) p[0] | ( (uint32_t) p[1] << 8 ) | ( (uint32_t) p[2] << 16 ) | ( (uint32_t) p[3] << 24 );
+}
+
+static uint64_t read_uint64( const uint8_t * p )
+{
+    return (uint64_t) read_uint32( p ) | ( (uint64_t) read_uint32( p + 4 ) << 32 );
+}
+
+static void transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+}
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+// endpoints by captured id, open addressing. grows when half full
+
+struct replay_entry_t
+{
+    uint64_t id;
+    struct reliable_endpoint_t * endpoint;
+    int pending_fragments;                  // fragments of the packet being sent still to come. 0 when there is none
+    uint16_t pending_sequence;
+    int pending_bytes;                      // payload bytes of the fragments seen so far
+};
+
+static struct replay_entry_t * entries = NULL;
+static int num_entries = 0;
+static int max_entries = 0;
+
+static struct reliable_profile_phase_t profile[RELIABLE_PROFILE_NUM_PHASES];
+
+static struct replay_entry_t * replay_find( uint64_t id )
+{
+    if ( max_entries == 0 )
+        return NULL;
+    uint64_t index = ( id * 0x9E3779B97F4A7C15ULL ) & ( max_entries - 1 );
+    while ( entries[index].endpoint )
+    {
+        if ( entries[index].id == id )
+            return entries + index;
+        index = ( index + 1 ) & ( max_entries - 1 );
+    }
+    return entries + index;
+}
+
+static void replay_insert( uint64_t id, struct reliable_endpoint_t * endpoint )
+{
+    if ( ( num_entries + 1 ) * 2 > max_entries )
+    {
+        struct replay_entry_t * old_entries = entries;
+        int old_max_entries = max_entries;
+        max_entries = max_entries ? max_entries * 2 : 64;
+        entries = (struct replay_entry_t*) calloc( max_entries, sizeof( struct replay_entry_t ) );
+        if ( !entries )
+        {
+            printf( "error: out of memory\n" );
+            exit( 1 );
+        }
+        int i;
+        for ( i = 0; i < old_max_entries; ++i )
+        {
+            if ( old_entries[i].endpoint )
+                *replay_find( old_entries[i].id ) = old_entries[i];
+        }
+        free( old_entries );
+    }
+    struct replay_entry_t * entry = replay_find( id );
+    entry->id = id;
+    entry->endpoint = endpoint;
+    entry->pending_fragments = 0;
+    num_entries++;
+}
+
+static void replay_accumulate_profile( struct reliable_endpoint_t * endpoint )
+{
+    struct reliable_profile_phase_t phases[RELIABLE_PROFILE_NUM_PHASES];
+    reliable_endpoint_profile( endpoint, phases );
+    int i;
+    for ( i = 0; i < RELIABLE_PROFILE_NUM_PHASES; ++i )
+    {
+        profile[i].count += phases[i].count;
+        profile[i].total_cycles += phases[i].total_cycles;
+        if ( phases[i].max_cycles > profile[i].max_cycles )
+            profile[i].max_cycles = phases[i].max_cycles;
+    }
+}
+
+// reliable_endpoint_create only asserts on its config, so a corrupt create record is checked here first. sequence numbers
+// are 16 bits, so no buffer needs more than 65536 entries
+
+#define MAX_BUFFER_SIZE 65536
+
+static int replay_config_valid( const struct reliable_config_t * config )
+{
+    if ( config->max_packet_size <= 0 || config->max_packet_size > MAX_SEND_BYTES )
+        return 0;
+    if ( config->fragment_above <= 0 || config->fragment_size <= 0 || config->fragment_size > MAX_DATAGRAM_BYTES )
+        return 0;
+    if ( config->max_fragments <= 0 || config->max_fragments > 256 )
+        return 0;
+    if ( config->ack_buffer_size <= 0 || config->ack_buffer_size > MAX_BUFFER_SIZE )
+        return 0;
+    if ( config->sent_packets_buffer_size <= 0 || config->sent_packets_buffer_size > MAX_BUFFER_SIZE )
+        return 0;
+    if ( config->received_packets_buffer_size <= 0 || config->received_packets_buffer_size > MAX_BUFFER_SIZE )
+        return 0;
+    if ( config->fragment_reassembly_buffer_size <= 0 || config->fragment_reassembly_buffer_size > MAX_BUFFER_SIZE )
+        return 0;
+    if ( config->rtt_history_size <= 0 || config->rtt_history_size > MAX_BUFFER_SIZE )
+        return 0;
+    if ( config->packet_header_size < 0 )
+        return 0;
+    if ( config->mtu_probing && ( config->mtu_min <= RELIABLE_FRAGMENT_HEADER_BYTES + RELIABLE_MAX_PACKET_HEADER_BYTES || config->mtu_max < 0 || config->mtu_max > MAX_DATAGRAM_BYTES ) )
+        return 0;
+    return 1;
+}
+
+// returns NULL when the captured config is bad or the endpoint can't be created
+
+static struct reliable_endpoint_t * replay_create_endpoint( uint64_t id, double time, const uint8_t * config_data, int config_bytes )
+{
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    snprintf( config.name, sizeof( config.name ), "%llu", (unsigned long long) id );
+    config.id = id;
+    config.transmit_packet_function = &transmit_packet_function;
+    config.process_packet_function = &process_packet_function;
+
+    if ( config_data && config_bytes >= RELIABLE_CAPTURE_NUM_CONFIG_VALUES * 4 )
+    {
+        int32_t values[RELIABLE_CAPTURE_NUM_CONFIG_VALUES];
+        int i;
+        for ( i = 0; i < RELIABLE_CAPTURE_NUM_CONFIG_VALUES; ++i )
+            values[i] = (int32_t) read_uint32( config_data + i * 4 );
+        config.max_packet_size = values[RELIABLE_CAPTURE_CONFIG_MAX_PACKET_SIZE];
+        config.fragment_above = values[RELIABLE_CAPTURE_CONFIG_FRAGMENT_ABOVE];
+        config.max_fragments = values[RELIABLE_CAPTURE_CONFIG_MAX_FRAGMENTS];
+        config.fragment_size = values[RELIABLE_CAPTURE_CONFIG_FRAGMENT_SIZE];
+        config.ack_buffer_size = values[RELIABLE_CAPTURE_CONFIG_ACK_BUFFER_SIZE];
+        config.sent_packets_buffer_size = values[RELIABLE_CAPTURE_CONFIG_SENT_PACKETS_BUFFER_SIZE];
+        config.received_packets_buffer_size = values[RELIABLE_CAPTURE_CONFIG_RECEIVED_PACKETS_BUFFER_SIZE];
+        config.fragment_reassembly_buffer_size = values[RELIABLE_CAPTURE_CONFIG_FRAGMENT_REASSEMBLY_BUFFER_SIZE];
+        config.rtt_history_size = values[RELIABLE_CAPTURE_CONFIG_RTT_HISTORY_SIZE];
+        config.packet_header_size = values[RELIABLE_CAPTURE_CONFIG_PACKET_HEADER_SIZE];
+        config.mtu_probing = values[RELIABLE_CAPTURE_CONFIG_MTU_PROBING];
+        config.mtu_min = values[RELIABLE_CAPTURE_CONFIG_MTU_MIN];
+        config.mtu_max = values[RELIABLE_CAPTURE_CONFIG_MTU_MAX];
+        if ( !replay_config_valid( &config ) )
+            return NULL;
+    }
+
+    return reliable_endpoint_create( &config, time );
+}
+
+static struct replay_entry_t * replay_entry( uint64_t id, double time )
+{
+    struct replay_entry_t * entry = replay_find( id );
+    if ( entry && entry->endpoint )
+        return entry;
+    struct reliable_endpoint_t * endpoint = replay_create_endpoint( id, time, NULL, 0 );
+    if ( !endpoint )
+    {
+        printf( "error: could not create endpoint %" PRIu64 "\n", id );
+        exit( 1 );
+    }
+    replay_insert( id, endpoint );
+    return replay_find( id );
+}
+
+static struct reliable_endpoint_t * replay_endpoint( uint64_t id, double time )
+{
+    return replay_entry( id, time )->endpoint;
+}
+
+// bytes in the packet header starting with this prefix byte. see "Packet Header" in STANDARD.md
+
+static int replay_packet_header_bytes( uint8_t prefix )
+{
+    int bytes = 3 + ( ( prefix & ( 1 << 5 ) ) ? 1 : 2 );
+    int i;
+    for ( i = 1; i <= 4; ++i )
+    {
+        if ( prefix & ( 1 << i ) )
+            bytes++;
+    }
+    return bytes;
+}
+
+static void replay_destroy_endpoints()
+{
+    int i;
+    for ( i = 0; i < max_entries; ++i )
+    {
+        if ( entries[i].endpoint )
+        {
+            replay_accumulate_profile( entries[i].endpoint );
+            reliable_endpoint_destroy( entries[i].endpoint );
+        }
+    }
+    free( entries );
+    entries = NULL;
+    num_entries = 0;
+    max_entries = 0;
+}
+
+struct replay_stats_t
+{
+    uint64_t num_creates;
+    uint64_t num_rejected;
+    uint64_t num_receives;
+    uint64_t num_truncated;
+    uint64_t num_send_datagrams;
+    uint64_t num_sends;
+    uint64_t num_updates;
+    double receive_seconds;
+    double send_seconds;
+    double update_seconds;
+};
+
+static void replay_send( struct reliable_endpoint_t * endpoint, int payload_bytes, struct replay_stats_t * stats )
+{
+    static uint8_t payload[MAX_SEND_BYTES];
+    if ( payload_bytes <= 0 )
+        return;
+    if ( payload_bytes > MAX_SEND_BYTES )
+        payload_bytes = MAX_SEND_BYTES;
+    double t = replay_time();
+    reliable_endpoint_send_packet( endpoint, payload, payload_bytes );
+    stats->send_seconds += replay_time() - t;
+    stats->num_sends++;
+}
+
+// sends the packet a captured datagram belongs to. a fragmented packet is sent once its last fragment has been seen,
+// or when its endpoint sends something else first, if the capture is missing some of its fragments
+
+static void replay_send_datagram( struct replay_entry_t * entry, const uint8_t * data, int packet_bytes, int data_bytes, struct replay_stats_t * stats )
+{
+    stats->num_send_datagrams++;
+
+    if ( data_bytes < 1 )
+        return;
+
+    int fragment = ( data[0] & 1 ) != 0;
+    int fragment_id = fragment && data_bytes >= RELIABLE_FRAGMENT_HEADER_BYTES ? data[3] : 0;
+    uint16_t sequence = data_bytes >= 3 ? (uint16_t) ( data[1] | ( data[2] << 8 ) ) : 0;
+
+    if ( entry->pending_fragments > 0 && ( !fragment || fragment_id == 0 || sequence != entry->pending_sequence ) )
+    {
+        entry->pending_fragments = 0;
+        replay_send( entry->endpoint, entry->pending_bytes, stats );
+    }
+
+    if ( !fragment )
+    {
+        if ( data[0] & ( 1 << 6 ) )
+            return;
+        replay_send( entry->endpoint, packet_bytes - replay_packet_header_bytes( data[0] ), stats );
+        return;
+    }
+
+    if ( data_bytes < RELIABLE_FRAGMENT_HEADER_BYTES + 1 )
+        return;
+
+    int fragment_payload_bytes = packet_bytes - RELIABLE_FRAGMENT_HEADER_BYTES;
+
+    if ( fragment_id == 0 )
+    {
+        int num_fragments = data[4] + 1;
+        int payload_bytes = fragment_payload_bytes - replay_packet_header_bytes( data[RELIABLE_FRAGMENT_HEADER_BYTES] );
+        if ( num_fragments == 1 )
+        {
+            replay_send( entry->endpoint, payload_bytes, stats );
+            return;
+        }
+        entry->pending_fragments = num_fragments - 1;
+        entry->pending_sequence = sequence;
+        entry->pending_bytes = payload_bytes;
+        return;
+    }
+
+    if ( entry->pending_fragments > 0 )
+    {
+        entry->pending_bytes += fragment_payload_bytes;
+        if ( --entry->pending_fragments == 0 )
+        {
+            replay_send( entry->endpoint, entry->pending_bytes, stats );
+        }
+    }
+}
+
+static int replay( FILE * file, int realtime, struct replay_stats_t * stats )
+{
+    static uint8_t data[MAX_DATAGRAM_BYTES];
+
+    uint8_t header[RELIABLE_CAPTURE_FILE_HEADER_BYTES];
+    if ( fread( header, 1, sizeof( header ), file ) != sizeof( header ) || read_uint32( header ) != RELIABLE_CAPTURE_MAGIC || read_uint32( header + 4 ) != RELIABLE_CAPTURE_VERSION )
+    {
+        printf( "error: not a reliable capture file\n" );
+        return 0;
+    }
+
+    double first_time = -1.0;
+    double start_time = replay_time();
+
+    uint8_t record[RELIABLE_CAPTURE_RECORD_HEADER_BYTES];
+    while ( fread( record, 1, sizeof( record ), file ) == sizeof( record ) )
+    {
+        int type = record[0];
+        uint64_t id = read_uint64( record + 4 );
+        union { double d; uint64_t u; } time_bits;
+        time_bits.u = read_uint64( record + 12 );
+        double time = time_bits.d;
+        uint32_t packet_bytes = read_uint32( record + 20 );
+        uint32_t data_bytes = read_uint32( record + 24 );
+
+        if ( data_bytes > MAX_DATAGRAM_BYTES || packet_bytes > MAX_DATAGRAM_BYTES || fread( data, 1, data_bytes, file ) != data_bytes )
+        {
+            printf( "error: capture file is truncated or corrupt\n" );
+            return 0;
+        }
+
+        if ( realtime && type == RELIABLE_CAPTURE_UPDATE )
+        {
+            if ( first_time < 0.0 )
+                first_time = time;
+            double wait = ( time - first_time ) - ( replay_time() - start_time );
+            if ( wait > 0.0 )
+                replay_sleep( wait );
+        }
+
+        switch ( type )
+        {
+            case RELIABLE_CAPTURE_CREATE:
+            {
+                // a rejected create leaves the endpoint as it was. with no endpoint yet, the next record for
+                // this id creates one with the default config, as it does when the capture misses the create
+
+                struct reliable_endpoint_t * endpoint = replay_create_endpoint( id, time, data, (int) data_bytes );
+                if ( !endpoint )
+                {
+                    printf( "warning: rejected create record with a bad config for endpoint %" PRIu64 "\n", id );
+                    stats->num_rejected++;
+                    break;
+                }
+                struct replay_entry_t * entry = replay_find( id );
+                if ( entry && entry->endpoint )
+                {
+                    replay_accumulate_profile( entry->endpoint );
+                    reliable_endpoint_destroy( entry->endpoint );
+                    entry->endpoint = endpoint;
+                    entry->pending_fragments = 0;
+                }
+                else
+                {
+                    replay_insert( id, endpoint );
+                }
+                stats->num_creates++;
+            }
+            break;
+
+            case RELIABLE_CAPTURE_RECEIVE:
+            {
+                if ( packet_bytes == 0 )
+                    break;
+                if ( data_bytes < packet_bytes )
+                {
+                    memset( data + data_bytes, 0, packet_bytes - data_bytes );
+                    stats->num_truncated++;
+                }
+                struct reliable_endpoint_t * endpoint = replay_endpoint( id, time );
+                double t = replay_time();
+                reliable_endpoint_receive_packet( endpoint, data, (int) packet_bytes );
+                stats->receive_seconds += replay_time() - t;
+                stats->num_receives++;
+            }
+            break;
+
+            case RELIABLE_CAPTURE_SEND:
+            {
+                if ( packet_bytes == 0 )
+                    break;
+                replay_send_datagram( replay_entry( id, time ), data, (int) packet_bytes, (int) data_bytes, stats );
+            }
+            break;
+
+            case RELIABLE_CAPTURE_UPDATE:
+            {
+                struct reliable_endpoint_t * endpoint = replay_endpoint( id, time );
+                double t = replay_time();
+                reliable_endpoint_update( endpoint, time );
+                reliable_endpoint_clear_acks( endpoint );
+                stats->update_seconds += replay_time() - t;
+                stats->num_updates++;
+            }
+            break;
+
+            default:
+                break;
+        }
+    }
+
+    return 1;
+}
+
+int main( int argc, char ** argv )
+{
+    const char * filename = NULL;
+    int realtime = 0;
+    int repeat = 1;
+
+    int i;
+    for ( i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--realtime" ) == 0 )
+        {
+            realtime = 1;
+        }
+        else if ( strcmp( argv[i], "--repeat" ) == 0 && i + 1 < argc )
+        {
+            repeat = atoi( argv[++i] );
+        }
+        else if ( !filename )
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if ( !filename || repeat < 1 )
+    {
+        printf( "usage: reliable_replay <capture file> [--realtime] [--repeat N]\n" );
+        return 1;
+    }
+
+    reliable_init();
+
+    struct replay_stats_t stats;
+    memset( &stats, 0, sizeof( stats ) );
+
+    double start_time = replay_time();
+
+    int r;
+    for ( r = 0; r < repeat; ++r )
+    {
+        FILE * file = fopen( filename, "rb" );
+        if ( !file )
+        {
+            printf( "error: could not open %s\n", filename );
+            return 1;
+        }
+        int ok = replay( file, realtime, &stats );
+        fclose( file );
+        replay_destroy_endpoints();
+        if ( !ok )
+            return 1;
+    }
+
+    double seconds = replay_time() - start_time;
+
+    reliable_term();
+
+    printf( "replayed %s%s\n\n", filename, realtime ? " in real time" : "" );
+    printf( "    %" PRIu64 " endpoints created (%" PRIu64 " rejected), %" PRIu64 " datagrams received (%" PRIu64 " truncated), %" PRIu64 " packets sent (from %" PRIu64 " datagrams), %" PRIu64 " updates\n",
+        stats.num_creates, stats.num_rejected, stats.num_receives, stats.num_truncated, stats.num_sends, stats.num_send_datagrams, stats.num_updates );
+    printf( "    %.3f seconds total, %.1fns per-receive, %.1fns per-send, %.1fns per-update\n\n",
+        seconds,
+        stats.num_receives ? stats.receive_seconds / stats.num_receives * 1000000000.0 : 0.0,
+        stats.num_sends ? stats.send_seconds / stats.num_sends * 1000000000.0 : 0.0,
+        stats.num_updates ? stats.update_seconds / stats.num_updates * 1000000000.0 : 0.0 );
+
+    printf( "    %-20s %12s %16s %14s %12s\n", "phase", "count", "total cycles", "avg cycles", "max cycles" );
+    for ( i = 0; i < RELIABLE_PROFILE_NUM_PHASES; ++i )
+    {
+        printf( "    %-20s %12" PRIu64 " %16" PRIu64 " %14.1f %12" PRIu64 "\n",
+            reliable_profile_phase_name( i ),
+            profile[i].count,
+            profile[i].total_cycles,
+            profile[i].count ? (double) profile[i].total_cycles / profile[i].count : 0.0,
+            profile[i].max_cycles );
+    }
+
+    return 0;
+}
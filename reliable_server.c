@@ -0,0 +1,659 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable_server.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define RELIABLE_SERVER_CACHE_LINE_BYTES 64
+
+// ---------------------------------------------------------------
+
+#if defined( _WIN32 )
+
+typedef HANDLE reliable_server_thread_t;
+typedef SRWLOCK reliable_server_mutex_t;
+typedef CONDITION_VARIABLE reliable_server_condition_t;
+
+static void reliable_server_mutex_create( reliable_server_mutex_t * mutex ) { InitializeSRWLock( mutex ); }
+static void reliable_server_mutex_destroy( reliable_server_mutex_t * mutex ) { (void) mutex; }
+static void reliable_server_mutex_lock( reliable_server_mutex_t * mutex ) { AcquireSRWLockExclusive( mutex ); }
+static void reliable_server_mutex_unlock( reliable_server_mutex_t * mutex ) { ReleaseSRWLockExclusive( mutex ); }
+
+static void reliable_server_condition_create( reliable_server_condition_t * condition ) { InitializeConditionVariable( condition ); }
+static void reliable_server_condition_destroy( reliable_server_condition_t * condition ) { (void) condition; }
+static void reliable_server_condition_wait( reliable_server_condition_t * condition, reliable_server_mutex_t * mutex ) { SleepConditionVariableSRW( condition, mutex, INFINITE, 0 ); }
+static void reliable_server_condition_signal_all( reliable_server_condition_t * condition ) { WakeAllConditionVariable( condition ); }
+
+static DWORD WINAPI reliable_server_worker_thread( LPVOID data );
+
+static int reliable_server_thread_create( reliable_server_thread_t * thread, void * data )
+{
+    *thread = CreateThread( NULL, 0, reliable_server_worker_thread, data, 0, NULL );
+    return *thread != NULL ? RELIABLE_OK : RELIABLE_ERROR;
+}
+
+static void reliable_server_thread_join( reliable_server_thread_t * thread )
+{
+    WaitForSingleObject( *thread, INFINITE );
+    CloseHandle( *thread );
+}
+
+static uint32_t reliable_server_load_acquire( volatile uint32_t * pointer )
+{
+    return (uint32_t) InterlockedCompareExchange( (volatile LONG*) pointer, 0, 0 );
+}
+
+static void reliable_server_store_release( volatile uint32_t * pointer, uint32_t value )
+{
+    InterlockedExchange( (volatile LONG*) pointer, (LONG) value );
+}
+
+#else // #if defined( _WIN32 )
+
+typedef pthread_t reliable_server_thread_t;
+typedef pthread_mutex_t reliable_server_mutex_t;
+typedef pthread_cond_t reliable_server_condition_t;
+
+static void reliable_server_mutex_create( reliable_server_mutex_t * mutex ) { pthread_mutex_init( mutex, NULL ); }
+static void reliable_server_mutex_destroy( reliable_server_mutex_t * mutex ) { pthread_mutex_destroy( mutex ); }
+static void reliable_server_mutex_lock( reliable_server_mutex_t * mutex ) { pthread_mutex_lock( mutex ); }
+static void reliable_server_mutex_unlock( reliable_server_mutex_t * mutex ) { pthread_mutex_unlock( mutex ); }
+
+static void reliable_server_condition_create( reliable_server_condition_t * condition ) { pthread_cond_init( condition, NULL ); }
+static void reliable_server_condition_destroy( reliable_server_condition_t * condition ) { pthread_cond_destroy( condition ); }
+static void reliable_server_condition_wait( reliable_server_condition_t * condition, reliable_server_mutex_t * mutex ) { pthread_cond_wait( condition, mutex ); }
+static void reliable_server_condition_signal_all( reliable_server_condition_t * condition ) { pthread_cond_broadcast( condition ); }
+
+static void * reliable_server_worker_thread( void * data );
+
+static int reliable_server_thread_create( reliable_server_thread_t * thread, void * data )
+{
+    return pthread_create( thread, NULL, reliable_server_worker_thread, data ) == 0 ? RELIABLE_OK : RELIABLE_ERROR;
+}
+
+static void reliable_server_thread_join( reliable_server_thread_t * thread )
+{
+    pthread_join( *thread, NULL );
+}
+
+static uint32_t reliable_server_load_acquire( volatile uint32_t * pointer )
+{
+    return __atomic_load_n( pointer, __ATOMIC_ACQUIRE );
+}
+
+static void reliable_server_store_release( volatile uint32_t * pointer, uint32_t value )
+{
+    __atomic_store_n( pointer, value, __ATOMIC_RELEASE );
+}
+
+#endif // #if defined( _WIN32 )
+
+// each counter has a single writer, but reliable_server_counters can read it from any thread. a relaxed load and store
+// keeps that race free without a locked read-modify-write on the routing path
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+
+#include <intrin.h>
+
+static uint64_t reliable_server_load_counter( volatile uint64_t * pointer )
+{
+    return (uint64_t) __iso_volatile_load64( (volatile __int64*) pointer );
+}
+
+static void reliable_server_increment_counter( volatile uint64_t * pointer )
+{
+    __iso_volatile_store64( (volatile __int64*) pointer, (__int64) ( __iso_volatile_load64( (volatile __int64*) pointer ) + 1 ) );
+}
+
+#else // #if defined( _MSC_VER ) && !defined( __clang__ )
+
+static uint64_t reliable_server_load_counter( volatile uint64_t * pointer )
+{
+    return __atomic_load_n( pointer, __ATOMIC_RELAXED );
+}
+
+static void reliable_server_increment_counter( volatile uint64_t * pointer )
+{
+    __atomic_store_n( pointer, __atomic_load_n( pointer, __ATOMIC_RELAXED ) + 1, __ATOMIC_RELAXED );
+}
+
+#endif // #if defined( _MSC_VER ) && !defined( __clang__ )
+
+// ---------------------------------------------------------------
+
+static void * reliable_server_default_allocate_function( void * context, size_t bytes )
+{
+    (void) context;
+    return malloc( bytes );
+}
+
+static void reliable_server_default_free_function( void * context, void * pointer )
+{
+    (void) context;
+    free( pointer );
+}
+
+void reliable_server_default_config( struct reliable_server_config_t * config )
+{
+    reliable_assert( config );
+    memset( config, 0, sizeof( struct reliable_server_config_t ) );
+    config->num_threads = 4;
+    config->max_endpoints = 4096;
+    config->max_packet_bytes = 1500;
+    config->receive_ring_size = 4096;
+}
+
+// ---------------------------------------------------------------
+
+// each datagram in a receive ring is a small header followed by the datagram, at a fixed stride
+
+struct reliable_server_ring_header_t
+{
+    uint64_t id;
+    int packet_bytes;
+    int padding;
+};
+
+struct reliable_server_slot_t
+{
+    uint64_t id;
+    struct reliable_endpoint_t * endpoint;
+};
+
+// the routing thread only writes the first cache line and the worker only writes the second, so they never contend
+
+struct reliable_server_shard_t
+{
+    uint8_t padding_0[RELIABLE_SERVER_CACHE_LINE_BYTES];
+    volatile uint32_t ring_write_index;
+    volatile uint64_t num_packets_routed;
+    volatile uint64_t num_packets_ring_full;
+    volatile uint64_t num_packets_too_large;
+    uint8_t padding_1[RELIABLE_SERVER_CACHE_LINE_BYTES];
+    volatile uint32_t ring_read_index;
+    volatile uint64_t num_packets_unknown_endpoint;
+    uint8_t padding_2[RELIABLE_SERVER_CACHE_LINE_BYTES];
+    struct reliable_server_t * server;
+    int index;
+    uint8_t * ring_data;
+    int num_endpoints;
+    int max_endpoints;
+    struct reliable_server_slot_t * endpoints;
+    reliable_server_thread_t thread;
+};
+
+// open addressing from endpoint id to endpoint. it only changes between updates, so workers read it without locking
+
+struct reliable_server_entry_t
+{
+    uint64_t id;
+    struct reliable_endpoint_t * endpoint;
+    int index;
+};
+
+struct reliable_server_t
+{
+    struct reliable_server_config_t config;
+    struct reliable_server_shard_t * shards;
+    int num_threads_started;
+    int ring_stride;
+    uint32_t ring_mask;
+    int num_endpoints;
+    uint32_t entry_mask;
+    struct reliable_server_entry_t * entries;
+    reliable_server_mutex_t mutex;
+    reliable_server_condition_t frame_start;
+    reliable_server_condition_t frame_done;
+    uint64_t frame;
+    double time;
+    int num_shards_done;
+    int quit;
+};
+
+static uint32_t reliable_server_hash_id( uint64_t id )
+{
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdULL;
+    id ^= id >> 33;
+    return (uint32_t) id;
+}
+
+static struct reliable_server_entry_t * reliable_server_find_entry( struct reliable_server_t * server, uint64_t id )
+{
+    uint32_t index = reliable_server_hash_id( id ) & server->entry_mask;
+    while ( server->entries[index].endpoint )
+    {
+        if ( server->entries[index].id == id )
+            return server->entries + index;
+        index = ( index + 1 ) & server->entry_mask;
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------
+
+static void reliable_server_receive_packets( struct reliable_server_shard_t * shard )
+{
+    struct reliable_server_t * server = shard->server;
+
+    uint32_t write_index = reliable_server_load_acquire( &shard->ring_write_index );
+    uint32_t read_index = shard->ring_read_index;
+
+    while ( read_index != write_index )
+    {
+        uint8_t * slot = shard->ring_data + (size_t) ( read_index & server->ring_mask ) * server->ring_stride;
+        struct reliable_server_ring_header_t * header = (struct reliable_server_ring_header_t*) slot;
+
+        struct reliable_server_entry_t * entry = reliable_server_find_entry( server, header->id );
+        if ( entry )
+        {
+            reliable_endpoint_receive_packet( entry->endpoint, slot + sizeof( struct reliable_server_ring_header_t ), header->packet_bytes );
+        }
+        else
+        {
+            reliable_server_increment_counter( &shard->num_packets_unknown_endpoint );
+        }
+
+        read_index++;
+    }
+
+    reliable_server_store_release( &shard->ring_read_index, read_index );
+}
+
+static void reliable_server_update_shard( struct reliable_server_shard_t * shard, double time )
+{
+    struct reliable_server_t * server = shard->server;
+
+    reliable_server_receive_packets( shard );
+
+    int i;
+    for ( i = 0; i < shard->num_endpoints; ++i )
+    {
+        struct reliable_endpoint_t * endpoint = shard->endpoints[i].endpoint;
+
+        reliable_endpoint_pump( endpoint );
+
+        reliable_endpoint_update( endpoint, time );
+
+        if ( server->config.update_function )
+        {
+            server->config.update_function( server->config.context, shard->index, endpoint, time );
+        }
+
+        reliable_endpoint_clear_acks( endpoint );
+    }
+}
+
+#if defined( _WIN32 )
+static DWORD WINAPI reliable_server_worker_thread( LPVOID data )
+#else
+static void * reliable_server_worker_thread( void * data )
+#endif
+{
+    struct reliable_server_shard_t * shard = (struct reliable_server_shard_t*) data;
+    struct reliable_server_t * server = shard->server;
+
+    uint64_t frame = 0;
+
+    reliable_server_mutex_lock( &server->mutex );
+
+    while ( 1 )
+    {
+        while ( server->frame == frame && !server->quit )
+        {
+            reliable_server_condition_wait( &server->frame_start, &server->mutex );
+        }
+
+        if ( server->quit )
+            break;
+
+        frame = server->frame;
+        double time = server->time;
+
+        reliable_server_mutex_unlock( &server->mutex );
+
+        reliable_server_update_shard( shard, time );
+
+        reliable_server_mutex_lock( &server->mutex );
+
+        server->num_shards_done++;
+        if ( server->num_shards_done == server->config.num_threads - 1 )
+        {
+            reliable_server_condition_signal_all( &server->frame_done );
+        }
+    }
+
+    reliable_server_mutex_unlock( &server->mutex );
+
+    return 0;
+}
+
+// ---------------------------------------------------------------
+
+struct reliable_server_t * reliable_server_create( struct reliable_server_config_t * config )
+{
+    reliable_assert( config );
+    reliable_assert( config->num_threads >= 1 );
+    reliable_assert( config->max_endpoints >= 1 );
+    reliable_assert( config->max_packet_bytes > 0 );
+    reliable_assert( config->receive_ring_size > 0 );
+    reliable_assert( ( config->receive_ring_size & ( config->receive_ring_size - 1 ) ) == 0 );
+
+    void * allocator_context = config->allocator_context;
+    void * (*allocate_function)(void*,size_t) = config->allocate_function;
+    void (*free_function)(void*,void*) = config->free_function;
+
+    if ( !allocate_function )
+        allocate_function = reliable_server_default_allocate_function;
+
+    if ( !free_function )
+        free_function = reliable_server_default_free_function;
+
+    struct reliable_server_t * server = (struct reliable_server_t*) allocate_function( allocator_context, sizeof( struct reliable_server_t ) );
+    reliable_assert( server );
+    memset( server, 0, sizeof( struct reliable_server_t ) );
+
+    server->config = *config;
+    server->config.allocate_function = allocate_function;
+    server->config.free_function = free_function;
+
+    server->ring_stride = (int) sizeof( struct reliable_server_ring_header_t ) + ( ( config->max_packet_bytes + 15 ) & ~15 );
+    server->ring_mask = (uint32_t) config->receive_ring_size - 1;
+
+    // at most half full, so probes stay short
+
+    uint32_t num_entries = 1;
+    while ( num_entries < (uint32_t) config->max_endpoints * 2 )
+        num_entries *= 2;
+
+    server->entry_mask = num_entries - 1;
+    server->entries = (struct reliable_server_entry_t*) allocate_function( allocator_context, num_entries * sizeof( struct reliable_server_entry_t ) );
+    reliable_assert( server->entries );
+    memset( server->entries, 0, num_entries * sizeof( struct reliable_server_entry_t ) );
+
+    server->shards = (struct reliable_server_shard_t*) allocate_function( allocator_context, config->num_threads * sizeof( struct reliable_server_shard_t ) );
+    reliable_assert( server->shards );
+    memset( server->shards, 0, config->num_threads * sizeof( struct reliable_server_shard_t ) );
+
+    int i;
+    for ( i = 0; i < config->num_threads; ++i )
+    {
+        struct reliable_server_shard_t * shard = server->shards + i;
+        shard->server = server;
+        shard->index = i;
+        shard->ring_data = (uint8_t*) allocate_function( allocator_context, (size_t) config->receive_ring_size * server->ring_stride );
+        reliable_assert( shard->ring_data );
+    }
+
+    reliable_server_mutex_create( &server->mutex );
+    reliable_server_condition_create( &server->frame_start );
+    reliable_server_condition_create( &server->frame_done );
+
+    // shard 0 is worked by the thread that calls reliable_server_update
+
+    for ( i = 1; i < config->num_threads; ++i )
+    {
+        if ( reliable_server_thread_create( &server->shards[i].thread, server->shards + i ) != RELIABLE_OK )
+        {
+            reliable_server_destroy( server );
+            return NULL;
+        }
+        server->num_threads_started++;
+    }
+
+    return server;
+}
+
+void reliable_server_destroy( struct reliable_server_t * server )
+{
+    reliable_assert( server );
+
+    reliable_server_mutex_lock( &server->mutex );
+    server->quit = 1;
+    reliable_server_condition_signal_all( &server->frame_start );
+    reliable_server_mutex_unlock( &server->mutex );
+
+    int i;
+    for ( i = 0; i < server->num_threads_started; ++i )
+    {
+        reliable_server_thread_join( &server->shards[i+1].thread );
+    }
+
+    reliable_server_condition_destroy( &server->frame_done );
+    reliable_server_condition_destroy( &server->frame_start );
+    reliable_server_mutex_destroy( &server->mutex );
+
+    void * allocator_context = server->config.allocator_context;
+    void (*free_function)(void*,void*) = server->config.free_function;
+
+    for ( i = 0; i < server->config.num_threads; ++i )
+    {
+        struct reliable_server_shard_t * shard = server->shards + i;
+        int j;
+        for ( j = 0; j < shard->num_endpoints; ++j )
+        {
+            reliable_endpoint_destroy( shard->endpoints[j].endpoint );
+        }
+        if ( shard->endpoints )
+        {
+            free_function( allocator_context, shard->endpoints );
+        }
+        free_function( allocator_context, shard->ring_data );
+    }
+
+    free_function( allocator_context, server->shards );
+    free_function( allocator_context, server->entries );
+    free_function( allocator_context, server );
+}
+
+int reliable_server_shard( struct reliable_server_t * server, uint64_t id )
+{
+    reliable_assert( server );
+    return (int) ( id % (uint64_t) server->config.num_threads );
+}
+
+struct reliable_endpoint_t * reliable_server_add_endpoint( struct reliable_server_t * server, struct reliable_config_t * config, double time )
+{
+    reliable_assert( server );
+    reliable_assert( config );
+    reliable_assert( reliable_server_find_entry( server, config->id ) == NULL );
+
+    if ( server->num_endpoints == server->config.max_endpoints )
+        return NULL;
+
+    struct reliable_server_shard_t * shard = server->shards + reliable_server_shard( server, config->id );
+
+    if ( shard->num_endpoints == shard->max_endpoints )
+    {
+        int max_endpoints = shard->max_endpoints ? shard->max_endpoints * 2 : 64;
+        struct reliable_server_slot_t * endpoints = (struct reliable_server_slot_t*) 
+            server->config.allocate_function( server->config.allocator_context, max_endpoints * sizeof( struct reliable_server_slot_t ) );
+        reliable_assert( endpoints );
+        if ( shard->endpoints )
+        {
+            memcpy( endpoints, shard->endpoints, shard->num_endpoints * sizeof( struct reliable_server_slot_t ) );
+            server->config.free_function( server->config.allocator_context, shard->endpoints );
+        }
+        shard->endpoints = endpoints;
+        shard->max_endpoints = max_endpoints;
+    }
+
+    struct reliable_endpoint_t * endpoint = reliable_endpoint_create( config, time );
+    if ( !endpoint )
+        return NULL;
+
+    uint32_t index = reliable_server_hash_id( config->id ) & server->entry_mask;
+    while ( server->entries[index].endpoint )
+    {
+        index = ( index + 1 ) & server->entry_mask;
+    }
+
+    server->entries[index].id = config->id;
+    server->entries[index].endpoint = endpoint;
+    server->entries[index].index = shard->num_endpoints;
+
+    shard->endpoints[shard->num_endpoints].id = config->id;
+    shard->endpoints[shard->num_endpoints].endpoint = endpoint;
+    shard->num_endpoints++;
+    server->num_endpoints++;
+
+    if ( server->config.stats_aggregator )
+    {
+        reliable_stats_aggregator_add_endpoint( server->config.stats_aggregator, (int) ( shard - server->shards ), endpoint );
+    }
+
+    return endpoint;
+}
+
+int reliable_server_remove_endpoint( struct reliable_server_t * server, uint64_t id )
+{
+    reliable_assert( server );
+
+    struct reliable_server_entry_t * entry = reliable_server_find_entry( server, id );
+    if ( !entry )
+        return RELIABLE_ERROR;
+
+    struct reliable_server_shard_t * shard = server->shards + reliable_server_shard( server, id );
+
+    // move the shard's last endpoint into the hole
+
+    int index = entry->index;
+    reliable_endpoint_destroy( entry->endpoint );
+    shard->num_endpoints--;
+    if ( index != shard->num_endpoints )
+    {
+        shard->endpoints[index] = shard->endpoints[shard->num_endpoints];
+        reliable_server_find_entry( server, shard->endpoints[index].id )->index = index;
+    }
+
+    // backward shift deletion, so no tombstones are needed
+
+    uint32_t hole = (uint32_t) ( entry - server->entries );
+    uint32_t next = hole;
+    while ( 1 )
+    {
+        next = ( next + 1 ) & server->entry_mask;
+        if ( !server->entries[next].endpoint )
+            break;
+        uint32_t home = reliable_server_hash_id( server->entries[next].id ) & server->entry_mask;
+        if ( ( ( next - home ) & server->entry_mask ) >= ( ( next - hole ) & server->entry_mask ) )
+        {
+            server->entries[hole] = server->entries[next];
+            hole = next;
+        }
+    }
+    memset( server->entries + hole, 0, sizeof( struct reliable_server_entry_t ) );
+
+    server->num_endpoints--;
+
+    return RELIABLE_OK;
+}
+
+struct reliable_endpoint_t * reliable_server_endpoint( struct reliable_server_t * server, uint64_t id )
+{
+    reliable_assert( server );
+    struct reliable_server_entry_t * entry = reliable_server_find_entry( server, id );
+    return entry ? entry->endpoint : NULL;
+}
+
+int reliable_server_route_packet( struct reliable_server_t * server, uint64_t id, RELIABLE_CONST uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( server );
+    reliable_assert( packet_data );
+
+    struct reliable_server_shard_t * shard = server->shards + reliable_server_shard( server, id );
+
+    if ( packet_bytes <= 0 || packet_bytes > server->config.max_packet_bytes )
+    {
+        reliable_server_increment_counter( &shard->num_packets_too_large );
+        return RELIABLE_ERROR;
+    }
+
+    uint32_t write_index = shard->ring_write_index;
+
+    if ( write_index - reliable_server_load_acquire( &shard->ring_read_index ) > server->ring_mask )
+    {
+        reliable_server_increment_counter( &shard->num_packets_ring_full );
+        return RELIABLE_ERROR;
+    }
+
+    uint8_t * slot = shard->ring_data + (size_t) ( write_index & server->ring_mask ) * server->ring_stride;
+    struct reliable_server_ring_header_t * header = (struct reliable_server_ring_header_t*) slot;
+    header->id = id;
+    header->packet_bytes = packet_bytes;
+    memcpy( slot + sizeof( struct reliable_server_ring_header_t ), packet_data, packet_bytes );
+
+    reliable_server_store_release( &shard->ring_write_index, write_index + 1 );
+
+    reliable_server_increment_counter( &shard->num_packets_routed );
+
+    return RELIABLE_OK;
+}
+
+void reliable_server_update( struct reliable_server_t * server, double time )
+{
+    reliable_assert( server );
+
+    reliable_server_mutex_lock( &server->mutex );
+    server->time = time;
+    server->num_shards_done = 0;
+    server->frame++;
+    reliable_server_condition_signal_all( &server->frame_start );
+    reliable_server_mutex_unlock( &server->mutex );
+
+    reliable_server_update_shard( server->shards, time );
+
+    reliable_server_mutex_lock( &server->mutex );
+    while ( server->num_shards_done < server->config.num_threads - 1 )
+    {
+        reliable_server_condition_wait( &server->frame_done, &server->mutex );
+    }
+    reliable_server_mutex_unlock( &server->mutex );
+}
+
+void reliable_server_counters( struct reliable_server_t * server, uint64_t * counters )
+{
+    reliable_assert( server );
+    reliable_assert( counters );
+
+    memset( counters, 0, RELIABLE_SERVER_NUM_COUNTERS * sizeof( uint64_t ) );
+
+    int i;
+    for ( i = 0; i < server->config.num_threads; ++i )
+    {
+        struct reliable_server_shard_t * shard = server->shards + i;
+        counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_ROUTED] += reliable_server_load_counter( &shard->num_packets_routed );
+        counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_RING_FULL] += reliable_server_load_counter( &shard->num_packets_ring_full );
+        counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_TOO_LARGE] += reliable_server_load_counter( &shard->num_packets_too_large );
+        counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_UNKNOWN_ENDPOINT] += reliable_server_load_counter( &shard->num_packets_unknown_endpoint );
+    }
+}
@@ -0,0 +1,109 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RELIABLE_SERVER_H
+#define RELIABLE_SERVER_H
+
+#include "reliable.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a server owns a fleet of endpoints and updates them on a pool of worker threads.
+// endpoints are partitioned into shards by id, one shard per-thread, and never move between shards. packets read
+// from the socket are routed to the owning shard through a single-producer, single-consumer ring, so workers
+// receive and update their endpoints without sharing any locks. endpoint callbacks run on the worker that owns
+// the endpoint, and the shard for an id is always reliable_server_shard( server, id ).
+
+struct reliable_server_config_t
+{
+    int num_threads;                                                            // number of shards and worker threads. the thread calling reliable_server_update works shard 0
+    int max_endpoints;                                                          // maximum number of endpoints across all shards
+    int max_packet_bytes;                                                       // largest datagram that can be routed (bytes)
+    int receive_ring_size;                                                      // datagrams each shard can buffer between updates. power of two
+    void * context;                                                             // passed to the update function
+    void (*update_function)(void*,int,struct reliable_endpoint_t*,double);      // called on the worker after each endpoint updates: (context, shard, endpoint, time). read acks and send packets here. NULL = none
+    void * allocator_context;                                                   // passed to the allocate and free functions
+    void * (*allocate_function)(void*,size_t);                                  // custom allocator. NULL = malloc
+    void (*free_function)(void*,void*);                                         // custom free. NULL = free
+    struct reliable_stats_aggregator_t * stats_aggregator;                      // endpoints are added to the shard with the same index. needs num_threads shards and must outlive the server. NULL = none
+};
+
+// fills a server config with defaults: 4 threads, 4096 endpoints, 1500 byte datagrams and 4096 datagrams per-shard per-update
+
+void reliable_server_default_config( struct reliable_server_config_t * config );
+
+// creates a server and starts its worker threads. returns NULL if the threads could not be started
+
+struct reliable_server_t * reliable_server_create( struct reliable_server_config_t * config );
+
+// stops the worker threads and destroys the server and all its endpoints
+
+void reliable_server_destroy( struct reliable_server_t * server );
+
+// returns the shard that owns endpoints with this id
+
+int reliable_server_shard( struct reliable_server_t * server, uint64_t id );
+
+// creates an endpoint owned by the server, keyed by config->id, which must be unique. returns NULL if the server is full.
+// endpoints may only be added and removed between calls to reliable_server_update
+
+struct reliable_endpoint_t * reliable_server_add_endpoint( struct reliable_server_t * server, struct reliable_config_t * config, double time );
+
+// destroys the endpoint with this id. returns RELIABLE_ERROR if there is no such endpoint
+
+int reliable_server_remove_endpoint( struct reliable_server_t * server, uint64_t id );
+
+// returns the endpoint with this id, or NULL
+
+struct reliable_endpoint_t * reliable_server_endpoint( struct reliable_server_t * server, uint64_t id );
+
+// copies a datagram into the receive ring of the shard that owns the endpoint with this id. it is passed to
+// reliable_endpoint_receive_packet on the next update. call from one thread only, typically the one reading the socket.
+// safe to call while an update is running. returns RELIABLE_ERROR if the datagram is too large or the ring is full
+
+int reliable_server_route_packet( struct reliable_server_t * server, uint64_t id, RELIABLE_CONST uint8_t * packet_data, int packet_bytes );
+
+// runs one frame on every shard in parallel and returns when all shards are done. each shard receives the
+// datagrams routed to it, then for each endpoint calls reliable_endpoint_pump, reliable_endpoint_update,
+// the update function and reliable_endpoint_clear_acks
+
+void reliable_server_update( struct reliable_server_t * server, double time );
+
+#define RELIABLE_SERVER_COUNTER_NUM_PACKETS_ROUTED                          0
+#define RELIABLE_SERVER_COUNTER_NUM_PACKETS_RING_FULL                       1
+#define RELIABLE_SERVER_COUNTER_NUM_PACKETS_TOO_LARGE                       2
+#define RELIABLE_SERVER_COUNTER_NUM_PACKETS_UNKNOWN_ENDPOINT                3
+#define RELIABLE_SERVER_NUM_COUNTERS                                        4
+
+// sums the shard counters into an array of RELIABLE_SERVER_NUM_COUNTERS. call between updates
+
+void reliable_server_counters( struct reliable_server_t * server, uint64_t * counters );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef RELIABLE_SERVER_H
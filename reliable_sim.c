@@ -0,0 +1,384 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "reliable_sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void * reliable_sim_default_allocate_function( void * context, size_t bytes )
+{
+    (void) context;
+    return malloc( bytes );
+}
+
+static void reliable_sim_default_free_function( void * context, void * pointer )
+{
+    (void) context;
+    free( pointer );
+}
+
+void reliable_sim_default_config( struct reliable_sim_config_t * config )
+{
+    reliable_assert( config );
+    memset( config, 0, sizeof( struct reliable_sim_config_t ) );
+    config->seed = 1;
+    config->max_packets = 4096;
+    config->max_packet_bytes = 1500;
+}
+
+// ---------------------------------------------------------------
+
+// pcg32. the sim has its own generator so that nothing else calling rand() can change the traffic it produces
+
+struct reliable_sim_random_t
+{
+    uint64_t state;
+    uint64_t increment;
+};
+
+static uint32_t reliable_sim_random_uint32( struct reliable_sim_random_t * random )
+{
+    uint64_t old_state = random->state;
+    random->state = old_state * 6364136223846793005ULL + random->increment;
+    uint32_t xor_shifted = (uint32_t) ( ( ( old_state >> 18 ) ^ old_state ) >> 27 );
+    uint32_t rotation = (uint32_t) ( old_state >> 59 );
+    return ( xor_shifted >> rotation ) | ( xor_shifted << ( ( -rotation ) & 31 ) );
+}
+
+static void reliable_sim_random_seed( struct reliable_sim_random_t * random, uint64_t seed )
+{
+    random->state = 0;
+    random->increment = ( seed << 1 ) | 1;
+    reliable_sim_random_uint32( random );
+    random->state += seed;
+    reliable_sim_random_uint32( random );
+}
+
+// uniform in [0,1)
+
+static double reliable_sim_random_double( struct reliable_sim_random_t * random )
+{
+    return ( reliable_sim_random_uint32( random ) >> 8 ) * ( 1.0 / 16777216.0 );
+}
+
+static int reliable_sim_random_chance( struct reliable_sim_random_t * random, float percent )
+{
+    if ( percent <= 0.0f )
+        return 0;
+    return reliable_sim_random_double( random ) * 100.0 < percent;
+}
+
+// ---------------------------------------------------------------
+
+// datagrams in flight are a binary min-heap on delivery time. ties go to whichever was sent first, so delivery
+// order never depends on how the heap happens to be arranged
+
+struct reliable_sim_packet_t
+{
+    double delivery_time;
+    uint64_t order;
+    uint64_t to;
+    int packet_bytes;
+    int slot;
+};
+
+struct reliable_sim_t
+{
+    struct reliable_sim_config_t config;
+    double time;
+    struct reliable_sim_random_t random;
+    int in_burst;
+    double link_free_time;
+    uint64_t next_order;
+    int num_packets;
+    struct reliable_sim_packet_t * packets;
+    int num_free_slots;
+    int * free_slots;
+    int received_slot;
+    uint8_t * arena;
+    uint64_t counters[RELIABLE_SIM_NUM_COUNTERS];
+};
+
+struct reliable_sim_t * reliable_sim_create( struct reliable_sim_config_t * config, double time )
+{
+    reliable_assert( config );
+    reliable_assert( config->max_packets > 0 );
+    reliable_assert( config->max_packet_bytes > 0 );
+    reliable_assert( config->latency >= 0.0 );
+    reliable_assert( config->jitter >= 0.0 );
+    reliable_assert( config->bandwidth_kbps >= 0 );
+    reliable_assert( config->queue_bytes >= 0 );
+    reliable_assert( config->mtu >= 0 );
+
+    void * allocator_context = config->allocator_context;
+    void * (*allocate_function)(void*,size_t) = config->allocate_function ? config->allocate_function : reliable_sim_default_allocate_function;
+
+    struct reliable_sim_t * sim = (struct reliable_sim_t*) allocate_function( allocator_context, sizeof( struct reliable_sim_t ) );
+
+    reliable_assert( sim );
+
+    memset( sim, 0, sizeof( struct reliable_sim_t ) );
+
+    sim->config = *config;
+    sim->config.allocate_function = allocate_function;
+    sim->config.free_function = config->free_function ? config->free_function : reliable_sim_default_free_function;
+    sim->time = time;
+
+    sim->packets = (struct reliable_sim_packet_t*) allocate_function( allocator_context, config->max_packets * sizeof( struct reliable_sim_packet_t ) );
+    sim->free_slots = (int*) allocate_function( allocator_context, config->max_packets * sizeof( int ) );
+    sim->arena = (uint8_t*) allocate_function( allocator_context, (size_t) config->max_packets * config->max_packet_bytes );
+
+    reliable_assert( sim->packets );
+    reliable_assert( sim->free_slots );
+    reliable_assert( sim->arena );
+
+    reliable_sim_random_seed( &sim->random, config->seed );
+
+    reliable_sim_reset( sim );
+
+    return sim;
+}
+
+void reliable_sim_destroy( struct reliable_sim_t * sim )
+{
+    reliable_assert( sim );
+
+    void * allocator_context = sim->config.allocator_context;
+    void (*free_function)(void*,void*) = sim->config.free_function;
+
+    free_function( allocator_context, sim->packets );
+    free_function( allocator_context, sim->free_slots );
+    free_function( allocator_context, sim->arena );
+    free_function( allocator_context, sim );
+}
+
+void reliable_sim_reset( struct reliable_sim_t * sim )
+{
+    reliable_assert( sim );
+
+    sim->num_packets = 0;
+    sim->num_free_slots = sim->config.max_packets;
+    int i;
+    for ( i = 0; i < sim->config.max_packets; ++i )
+    {
+        sim->free_slots[i] = sim->config.max_packets - 1 - i;
+    }
+    sim->received_slot = -1;
+    sim->in_burst = 0;
+    sim->link_free_time = sim->time;
+}
+
+static int reliable_sim_packet_before( RELIABLE_CONST struct reliable_sim_packet_t * a, RELIABLE_CONST struct reliable_sim_packet_t * b )
+{
+    if ( a->delivery_time != b->delivery_time )
+        return a->delivery_time < b->delivery_time;
+    return a->order < b->order;
+}
+
+static void reliable_sim_push( struct reliable_sim_t * sim, struct reliable_sim_packet_t * packet )
+{
+    reliable_assert( sim->num_packets < sim->config.max_packets );
+
+    int index = sim->num_packets++;
+    while ( index > 0 )
+    {
+        int parent = ( index - 1 ) / 2;
+        if ( !reliable_sim_packet_before( packet, sim->packets + parent ) )
+            break;
+        sim->packets[index] = sim->packets[parent];
+        index = parent;
+    }
+    sim->packets[index] = *packet;
+}
+
+static void reliable_sim_pop( struct reliable_sim_t * sim, struct reliable_sim_packet_t * packet )
+{
+    reliable_assert( sim->num_packets > 0 );
+
+    *packet = sim->packets[0];
+
+    struct reliable_sim_packet_t last = sim->packets[--sim->num_packets];
+    int index = 0;
+    for ( ;; )
+    {
+        int child = index * 2 + 1;
+        if ( child >= sim->num_packets )
+            break;
+        if ( child + 1 < sim->num_packets && reliable_sim_packet_before( sim->packets + child + 1, sim->packets + child ) )
+            child++;
+        if ( !reliable_sim_packet_before( sim->packets + child, &last ) )
+            break;
+        sim->packets[index] = sim->packets[child];
+        index = child;
+    }
+    sim->packets[index] = last;
+}
+
+void reliable_sim_send( struct reliable_sim_t * sim, uint64_t to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( sim );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_SENT]++;
+
+    if ( packet_bytes > sim->config.max_packet_bytes || ( sim->config.mtu > 0 && packet_bytes > sim->config.mtu ) )
+    {
+        sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+        return;
+    }
+
+    // the datagram leaves once everything queued ahead of it is on the wire. if that queue is full it is tail dropped
+
+    double depart_time = sim->time;
+
+    if ( sim->config.bandwidth_kbps > 0 )
+    {
+        double bytes_per_second = sim->config.bandwidth_kbps * 1000.0 / 8.0;
+        if ( sim->link_free_time > depart_time )
+        {
+            depart_time = sim->link_free_time;
+        }
+        if ( sim->config.queue_bytes > 0 && ( depart_time - sim->time ) * bytes_per_second + packet_bytes > sim->config.queue_bytes )
+        {
+            sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_QUEUE_FULL]++;
+            return;
+        }
+        depart_time += packet_bytes / bytes_per_second;
+        sim->link_free_time = depart_time;
+    }
+
+    float packet_loss = sim->config.packet_loss;
+
+    if ( sim->config.burst_enter > 0.0f )
+    {
+        if ( sim->in_burst )
+        {
+            sim->in_burst = !reliable_sim_random_chance( &sim->random, sim->config.burst_exit );
+        }
+        else
+        {
+            sim->in_burst = reliable_sim_random_chance( &sim->random, sim->config.burst_enter );
+        }
+        if ( sim->in_burst )
+        {
+            packet_loss = sim->config.burst_loss;
+        }
+    }
+
+    if ( reliable_sim_random_chance( &sim->random, packet_loss ) )
+    {
+        sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_LOST]++;
+        return;
+    }
+
+    int corrupt_bit = -1;
+    if ( reliable_sim_random_chance( &sim->random, sim->config.corrupt ) )
+    {
+        corrupt_bit = (int) ( reliable_sim_random_uint32( &sim->random ) % ( (uint32_t) packet_bytes * 8 ) );
+        sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_CORRUPTED]++;
+    }
+
+    int num_copies = reliable_sim_random_chance( &sim->random, sim->config.duplicate ) ? 2 : 1;
+
+    int i;
+    for ( i = 0; i < num_copies; ++i )
+    {
+        if ( sim->num_free_slots == 0 )
+        {
+            sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_SIM_FULL]++;
+            return;
+        }
+
+        struct reliable_sim_packet_t packet;
+        packet.delivery_time = depart_time + sim->config.latency;
+        if ( sim->config.jitter > 0.0 )
+        {
+            packet.delivery_time += ( reliable_sim_random_double( &sim->random ) * 2.0 - 1.0 ) * sim->config.jitter;
+            if ( packet.delivery_time < depart_time )
+            {
+                packet.delivery_time = depart_time;
+            }
+        }
+        packet.order = sim->next_order++;
+        packet.to = to;
+        packet.packet_bytes = packet_bytes;
+        packet.slot = sim->free_slots[--sim->num_free_slots];
+
+        uint8_t * data = sim->arena + (size_t) packet.slot * sim->config.max_packet_bytes;
+
+        memcpy( data, packet_data, packet_bytes );
+
+        if ( corrupt_bit >= 0 )
+        {
+            data[corrupt_bit / 8] ^= (uint8_t) ( 1 << ( corrupt_bit % 8 ) );
+        }
+
+        if ( i == 1 )
+        {
+            sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_DUPLICATED]++;
+        }
+
+        reliable_sim_push( sim, &packet );
+    }
+}
+
+void reliable_sim_update( struct reliable_sim_t * sim, double time )
+{
+    reliable_assert( sim );
+    reliable_assert( time >= sim->time );
+    sim->time = time;
+}
+
+uint8_t * reliable_sim_receive( struct reliable_sim_t * sim, uint64_t * to, int * packet_bytes )
+{
+    reliable_assert( sim );
+    reliable_assert( to );
+    reliable_assert( packet_bytes );
+
+    if ( sim->received_slot >= 0 )
+    {
+        sim->free_slots[sim->num_free_slots++] = sim->received_slot;
+        sim->received_slot = -1;
+    }
+
+    if ( sim->num_packets == 0 || sim->packets[0].delivery_time > sim->time )
+        return NULL;
+
+    struct reliable_sim_packet_t packet;
+    reliable_sim_pop( sim, &packet );
+
+    sim->counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_DELIVERED]++;
+
+    sim->received_slot = packet.slot;
+    *to = packet.to;
+    *packet_bytes = packet.packet_bytes;
+    return sim->arena + (size_t) packet.slot * sim->config.max_packet_bytes;
+}
+
+RELIABLE_CONST uint64_t * reliable_sim_counters( struct reliable_sim_t * sim )
+{
+    reliable_assert( sim );
+    return sim->counters;
+}
@@ -0,0 +1,103 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RELIABLE_SIM_H
+#define RELIABLE_SIM_H
+
+#include "reliable.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a simulated network for tests, soaks and benchmarks. datagrams sent into it are held in a priority queue ordered by
+// delivery time and come out of reliable_sim_receive once the simulation time reaches it. along the way they may be
+// delayed, reordered by jitter, lost at random or in bursts, queued behind a bandwidth cap, dropped when that queue
+// is full or when they exceed the mtu, duplicated, or have a bit flipped. datagram data lives in a fixed arena
+// allocated up front, so nothing is allocated per-packet. every random decision comes from the sim's own generator,
+// so a given seed and sequence of calls always produces the same traffic
+
+struct reliable_sim_config_t
+{
+    uint64_t seed;                                                              // seeds the random number generator. same seed, same calls, same results
+    int max_packets;                                                            // maximum number of datagrams in flight. more are dropped
+    int max_packet_bytes;                                                       // largest datagram the arena can hold (bytes). larger datagrams are dropped
+    double latency;                                                             // one way delay (seconds)
+    double jitter;                                                              // each datagram's delay varies uniformly by up to this much either way (seconds). more than the send interval reorders
+    float packet_loss;                                                          // percentage of datagrams lost at random. outside of bursts when burst_enter is set
+    float burst_enter;                                                          // percentage chance per-datagram of entering a burst of loss (gilbert-elliott). 0 = no bursts
+    float burst_exit;                                                           // percentage chance per-datagram of leaving a burst
+    float burst_loss;                                                           // percentage of datagrams lost during a burst
+    float duplicate;                                                            // percentage of datagrams delivered twice
+    float corrupt;                                                              // percentage of datagrams with a single bit flipped
+    int bandwidth_kbps;                                                         // datagrams are serialized onto the link at this rate. 0 = unlimited
+    int queue_bytes;                                                            // bytes that can wait behind the bandwidth cap. more are dropped. 0 = unlimited
+    int mtu;                                                                    // datagrams larger than this are dropped (bytes). 0 = no mtu
+    void * allocator_context;                                                   // passed to the allocate and free functions
+    void * (*allocate_function)(void*,size_t);                                  // custom allocator. NULL = malloc
+    void (*free_function)(void*,void*);                                         // custom free. NULL = free
+};
+
+// fills a sim config with defaults: a perfect link with no latency, 4096 datagrams in flight of up to 1500 bytes
+
+void reliable_sim_default_config( struct reliable_sim_config_t * config );
+
+struct reliable_sim_t * reliable_sim_create( struct reliable_sim_config_t * config, double time );
+
+void reliable_sim_destroy( struct reliable_sim_t * sim );
+
+// sends a datagram to the address "to" at the current simulation time. the data is copied
+
+void reliable_sim_send( struct reliable_sim_t * sim, uint64_t to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes );
+
+// advances simulation time. time may not go backwards
+
+void reliable_sim_update( struct reliable_sim_t * sim, double time );
+
+// returns the next datagram due by the current simulation time and sets to and packet_bytes, or NULL if there are none.
+// the data stays valid until the next call to reliable_sim_receive, reliable_sim_reset or reliable_sim_destroy
+
+uint8_t * reliable_sim_receive( struct reliable_sim_t * sim, uint64_t * to, int * packet_bytes );
+
+// drops every datagram in flight
+
+void reliable_sim_reset( struct reliable_sim_t * sim );
+
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_SENT                               0
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_DELIVERED                          1
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_LOST                               2
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_DUPLICATED                         3
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_CORRUPTED                          4
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_TOO_LARGE                          5
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_QUEUE_FULL                         6
+#define RELIABLE_SIM_COUNTER_NUM_PACKETS_SIM_FULL                           7
+#define RELIABLE_SIM_NUM_COUNTERS                                           8
+
+RELIABLE_CONST uint64_t * reliable_sim_counters( struct reliable_sim_t * sim );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef RELIABLE_SIM_H
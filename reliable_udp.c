@@ -0,0 +1,1432 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                             // recvmmsg and sendmmsg
+#endif
+
+#include "reliable_udp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+
+#ifndef RELIABLE_UDP_IO_URING
+#if defined( __linux__ ) && defined( __has_include )
+#if __has_include( <linux/io_uring.h> )
+#define RELIABLE_UDP_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifndef RELIABLE_UDP_IO_URING
+#define RELIABLE_UDP_IO_URING 0
+#endif
+
+#if RELIABLE_UDP_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if !defined( IORING_RECV_MULTISHOT ) || !defined( IORING_CQE_F_MORE )
+#undef RELIABLE_UDP_IO_URING
+#define RELIABLE_UDP_IO_URING 0                 // these headers predate multishot recvmsg
+#endif
+#endif // #if RELIABLE_UDP_IO_URING
+
+// ---------------------------------------------------------------
+
+static void * reliable_udp_default_allocate_function( void * context, size_t bytes )
+{
+    (void) context;
+    return malloc( bytes );
+}
+
+static void reliable_udp_default_free_function( void * context, void * pointer )
+{
+    (void) context;
+    free( pointer );
+}
+
+int reliable_udp_address_parse( struct reliable_udp_address_t * address, RELIABLE_CONST char * string )
+{
+    reliable_assert( address );
+    reliable_assert( string );
+
+    memset( address, 0, sizeof( struct reliable_udp_address_t ) );
+
+    char buffer[RELIABLE_UDP_ADDRESS_STRING_BYTES];
+    reliable_copy_string( buffer, string, sizeof( buffer ) );
+
+    char * host = buffer;
+    char * port = NULL;
+
+    if ( host[0] == '[' )
+    {
+        char * end = strchr( host, ']' );
+        if ( !end )
+            return RELIABLE_ERROR;
+        *end = '\0';
+        host++;
+        if ( end[1] == ':' )
+            port = end + 2;
+        else if ( end[1] != '\0' )
+            return RELIABLE_ERROR;
+    }
+    else
+    {
+        // a single colon separates the port. more than one means a bare ipv6 address
+
+        char * colon = strchr( host, ':' );
+        if ( colon && !strchr( colon + 1, ':' ) )
+        {
+            *colon = '\0';
+            port = colon + 1;
+        }
+    }
+
+    if ( port )
+    {
+        char * end = NULL;
+        long value = strtol( port, &end, 10 );
+        if ( end == port || *end != '\0' || value < 0 || value > 65535 )
+            return RELIABLE_ERROR;
+        address->port = (uint16_t) value;
+    }
+
+    if ( inet_pton( AF_INET, host, address->data ) == 1 )
+    {
+        address->type = RELIABLE_UDP_ADDRESS_IPV4;
+        return RELIABLE_OK;
+    }
+
+    if ( inet_pton( AF_INET6, host, address->data ) == 1 )
+    {
+        address->type = RELIABLE_UDP_ADDRESS_IPV6;
+        return RELIABLE_OK;
+    }
+
+    memset( address, 0, sizeof( struct reliable_udp_address_t ) );
+
+    return RELIABLE_ERROR;
+}
+
+char * reliable_udp_address_to_string( RELIABLE_CONST struct reliable_udp_address_t * address, char * buffer, int buffer_size )
+{
+    reliable_assert( address );
+    reliable_assert( buffer );
+    reliable_assert( buffer_size > 0 );
+
+    char host[INET6_ADDRSTRLEN];
+
+    if ( address->type == RELIABLE_UDP_ADDRESS_IPV4 )
+    {
+        inet_ntop( AF_INET, address->data, host, sizeof( host ) );
+        snprintf( buffer, buffer_size, "%s:%d", host, address->port );
+    }
+    else if ( address->type == RELIABLE_UDP_ADDRESS_IPV6 )
+    {
+        inet_ntop( AF_INET6, address->data, host, sizeof( host ) );
+        snprintf( buffer, buffer_size, "[%s]:%d", host, address->port );
+    }
+    else
+    {
+        snprintf( buffer, buffer_size, "none" );
+    }
+
+    return buffer;
+}
+
+int reliable_udp_address_equal( RELIABLE_CONST struct reliable_udp_address_t * a, RELIABLE_CONST struct reliable_udp_address_t * b )
+{
+    reliable_assert( a );
+    reliable_assert( b );
+
+    if ( a->type != b->type || a->port != b->port )
+        return 0;
+
+    if ( a->type == RELIABLE_UDP_ADDRESS_IPV4 )
+        return memcmp( a->data, b->data, 4 ) == 0;
+
+    if ( a->type == RELIABLE_UDP_ADDRESS_IPV6 )
+        return memcmp( a->data, b->data, 16 ) == 0;
+
+    return 1;
+}
+
+static socklen_t reliable_udp_address_to_sockaddr( RELIABLE_CONST struct reliable_udp_address_t * address, struct sockaddr_storage * sockaddr )
+{
+    memset( sockaddr, 0, sizeof( struct sockaddr_storage ) );
+
+    if ( address->type == RELIABLE_UDP_ADDRESS_IPV6 )
+    {
+        struct sockaddr_in6 * sockaddr_ipv6 = (struct sockaddr_in6*) sockaddr;
+        sockaddr_ipv6->sin6_family = AF_INET6;
+        sockaddr_ipv6->sin6_port = htons( address->port );
+        memcpy( &sockaddr_ipv6->sin6_addr, address->data, 16 );
+        return sizeof( struct sockaddr_in6 );
+    }
+
+    struct sockaddr_in * sockaddr_ipv4 = (struct sockaddr_in*) sockaddr;
+    sockaddr_ipv4->sin_family = AF_INET;
+    sockaddr_ipv4->sin_port = htons( address->port );
+    memcpy( &sockaddr_ipv4->sin_addr, address->data, 4 );
+    return sizeof( struct sockaddr_in );
+}
+
+static void reliable_udp_address_from_sockaddr( struct reliable_udp_address_t * address, RELIABLE_CONST void * sockaddr )
+{
+    memset( address, 0, sizeof( struct reliable_udp_address_t ) );
+
+    RELIABLE_CONST struct sockaddr * generic = (RELIABLE_CONST struct sockaddr*) sockaddr;
+
+    if ( generic->sa_family == AF_INET )
+    {
+        RELIABLE_CONST struct sockaddr_in * sockaddr_ipv4 = (RELIABLE_CONST struct sockaddr_in*) sockaddr;
+        address->type = RELIABLE_UDP_ADDRESS_IPV4;
+        address->port = ntohs( sockaddr_ipv4->sin_port );
+        memcpy( address->data, &sockaddr_ipv4->sin_addr, 4 );
+    }
+    else if ( generic->sa_family == AF_INET6 )
+    {
+        RELIABLE_CONST struct sockaddr_in6 * sockaddr_ipv6 = (RELIABLE_CONST struct sockaddr_in6*) sockaddr;
+        address->type = RELIABLE_UDP_ADDRESS_IPV6;
+        address->port = ntohs( sockaddr_ipv6->sin6_port );
+        memcpy( address->data, &sockaddr_ipv6->sin6_addr, 16 );
+    }
+}
+
+// creates a non-blocking udp socket bound to bind_address and fills in the address it actually got. returns -1 on failure
+
+static int reliable_udp_socket_create( RELIABLE_CONST struct reliable_udp_address_t * bind_address, int send_buffer_size, int receive_buffer_size, struct reliable_udp_address_t * bound_address )
+{
+    int family = bind_address->type == RELIABLE_UDP_ADDRESS_IPV6 ? AF_INET6 : AF_INET;
+
+    int handle = socket( family, SOCK_DGRAM, IPPROTO_UDP );
+    if ( handle < 0 )
+        return -1;
+
+    if ( family == AF_INET6 )
+    {
+        int yes = 1;
+        setsockopt( handle, IPPROTO_IPV6, IPV6_V6ONLY, &yes, sizeof( yes ) );
+    }
+
+    setsockopt( handle, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof( send_buffer_size ) );
+    setsockopt( handle, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof( receive_buffer_size ) );
+
+    struct sockaddr_storage sockaddr;
+    socklen_t sockaddr_bytes = reliable_udp_address_to_sockaddr( bind_address, &sockaddr );
+    if ( bind( handle, (struct sockaddr*) &sockaddr, sockaddr_bytes ) < 0 )
+    {
+        close( handle );
+        return -1;
+    }
+
+    sockaddr_bytes = sizeof( sockaddr );
+    if ( getsockname( handle, (struct sockaddr*) &sockaddr, &sockaddr_bytes ) < 0 )
+    {
+        close( handle );
+        return -1;
+    }
+    reliable_udp_address_from_sockaddr( bound_address, &sockaddr );
+
+    if ( fcntl( handle, F_SETFL, fcntl( handle, F_GETFL, 0 ) | O_NONBLOCK ) < 0 )
+    {
+        close( handle );
+        return -1;
+    }
+
+    return handle;
+}
+
+// ---------------------------------------------------------------
+
+void reliable_udp_io_uring_default_config( struct reliable_udp_io_uring_config_t * config )
+{
+    reliable_assert( config );
+    memset( config, 0, sizeof( struct reliable_udp_io_uring_config_t ) );
+    config->bind_address.type = RELIABLE_UDP_ADDRESS_IPV4;
+    config->queue_depth = 1024;
+    config->num_receive_buffers = 1024;
+    config->num_send_buffers = 1024;
+    config->max_packet_bytes = 1500;
+    config->socket_send_buffer_size = 4 * 1024 * 1024;
+    config->socket_receive_buffer_size = 4 * 1024 * 1024;
+}
+
+#if RELIABLE_UDP_IO_URING
+
+#define RELIABLE_UDP_IO_URING_RECEIVE_USER_DATA 0xFFFFFFFFFFFFFFFFULL
+
+struct reliable_udp_io_uring_send_buffer_t
+{
+    struct msghdr message;
+    struct iovec iov;
+    struct sockaddr_storage address;
+};
+
+struct reliable_udp_io_uring_completion_t
+{
+    int32_t result;
+    uint32_t flags;
+};
+
+struct reliable_udp_io_uring_t
+{
+    struct reliable_udp_io_uring_config_t config;
+    struct reliable_udp_address_t address;
+    int socket;
+    int ring;
+
+    void * sq_ring_memory;
+    size_t sq_ring_bytes;
+    void * cq_ring_memory;
+    size_t cq_ring_bytes;
+    struct io_uring_sqe * sqes;
+    size_t sqes_bytes;
+
+    volatile uint32_t * sq_head;
+    volatile uint32_t * sq_tail;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t sq_local_tail;
+
+    volatile uint32_t * cq_head;
+    volatile uint32_t * cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe * cqes;
+
+    struct io_uring_buf_ring * buffer_ring;
+    size_t buffer_ring_bytes;
+    uint16_t buffer_ring_tail;
+    uint8_t * receive_buffers;
+    int receive_buffer_bytes;
+    struct msghdr receive_message;
+    int receive_armed;
+
+    // receive completions reaped while sending wait here until the next reliable_udp_io_uring_receive, so the receive
+    // function is only ever called from there. each one holds a receive buffer, and a multishot receive ends with at most
+    // one completion without a buffer, so this never needs more than num_receive_buffers + 1
+
+    struct reliable_udp_io_uring_completion_t * pending_receives;
+    int num_pending_receives;
+
+    struct reliable_udp_io_uring_send_buffer_t * send_buffers;
+    uint8_t * send_data;
+    int * free_send_buffers;
+    int num_free_send_buffers;
+
+    uint64_t counters[RELIABLE_UDP_NUM_COUNTERS];
+};
+
+static int reliable_udp_io_uring_enter( struct reliable_udp_io_uring_t * driver, uint32_t to_submit, uint32_t min_complete )
+{
+    driver->counters[RELIABLE_UDP_COUNTER_NUM_SYSCALLS]++;
+    return (int) syscall( __NR_io_uring_enter, driver->ring, to_submit, min_complete, IORING_ENTER_GETEVENTS, NULL, 0 );
+}
+
+// publishes queued submissions and enters the kernel once. getevents is always set, because with deferred task running
+// that is what runs the work that posts completions
+
+static void reliable_udp_io_uring_submit( struct reliable_udp_io_uring_t * driver, int wait )
+{
+    __atomic_store_n( driver->sq_tail, driver->sq_local_tail, __ATOMIC_RELEASE );
+    uint32_t to_submit = driver->sq_local_tail - __atomic_load_n( driver->sq_head, __ATOMIC_ACQUIRE );
+    reliable_udp_io_uring_enter( driver, to_submit, wait ? 1 : 0 );
+}
+
+static struct io_uring_sqe * reliable_udp_io_uring_get_sqe( struct reliable_udp_io_uring_t * driver )
+{
+    if ( driver->sq_local_tail - __atomic_load_n( driver->sq_head, __ATOMIC_ACQUIRE ) >= driver->sq_entries )
+    {
+        reliable_udp_io_uring_submit( driver, 0 );
+        if ( driver->sq_local_tail - __atomic_load_n( driver->sq_head, __ATOMIC_ACQUIRE ) >= driver->sq_entries )
+            return NULL;
+    }
+    struct io_uring_sqe * sqe = driver->sqes + ( driver->sq_local_tail & driver->sq_mask );
+    memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+    driver->sq_local_tail++;
+    return sqe;
+}
+
+static void reliable_udp_io_uring_arm_receive( struct reliable_udp_io_uring_t * driver )
+{
+    struct io_uring_sqe * sqe = reliable_udp_io_uring_get_sqe( driver );
+    if ( !sqe )
+        return;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = driver->socket;
+    sqe->addr = (uint64_t) (uintptr_t) &driver->receive_message;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = RELIABLE_UDP_IO_URING_RECEIVE_USER_DATA;
+    driver->receive_armed = 1;
+}
+
+static void reliable_udp_io_uring_provide_buffer( struct reliable_udp_io_uring_t * driver, uint16_t buffer_id )
+{
+    struct io_uring_buf * buffer = driver->buffer_ring->bufs + ( driver->buffer_ring_tail & ( driver->config.num_receive_buffers - 1 ) );
+    buffer->addr = (uint64_t) (uintptr_t) ( driver->receive_buffers + (size_t) buffer_id * driver->receive_buffer_bytes );
+    buffer->len = (uint32_t) driver->receive_buffer_bytes;
+    buffer->bid = buffer_id;
+    driver->buffer_ring_tail++;
+}
+
+// takes every completion off the queue. send buffers go straight back on the free list, receives wait in pending_receives
+
+static void reliable_udp_io_uring_reap( struct reliable_udp_io_uring_t * driver )
+{
+    uint32_t head = *driver->cq_head;
+    uint32_t tail = __atomic_load_n( driver->cq_tail, __ATOMIC_ACQUIRE );
+
+    while ( head != tail )
+    {
+        struct io_uring_cqe * cqe = driver->cqes + ( head & driver->cq_mask );
+
+        if ( cqe->user_data == RELIABLE_UDP_IO_URING_RECEIVE_USER_DATA )
+        {
+            if ( !( cqe->flags & IORING_CQE_F_MORE ) )
+                driver->receive_armed = 0;
+            reliable_assert( driver->num_pending_receives <= driver->config.num_receive_buffers );
+            driver->pending_receives[driver->num_pending_receives].result = cqe->res;
+            driver->pending_receives[driver->num_pending_receives].flags = cqe->flags;
+            driver->num_pending_receives++;
+        }
+        else
+        {
+            if ( cqe->res < 0 )
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS]++;
+            driver->free_send_buffers[driver->num_free_send_buffers++] = (int) cqe->user_data;
+        }
+
+        head++;
+    }
+
+    __atomic_store_n( driver->cq_head, head, __ATOMIC_RELEASE );
+}
+
+static void reliable_udp_io_uring_free( struct reliable_udp_io_uring_t * driver )
+{
+    void * allocator_context = driver->config.allocator_context;
+    void (*free_function)(void*,void*) = driver->config.free_function;
+
+    if ( driver->ring >= 0 )
+        close( driver->ring );
+    if ( driver->socket >= 0 )
+        close( driver->socket );
+    if ( driver->buffer_ring )
+        munmap( driver->buffer_ring, driver->buffer_ring_bytes );
+    if ( driver->sqes )
+        munmap( driver->sqes, driver->sqes_bytes );
+    if ( driver->cq_ring_memory && driver->cq_ring_memory != driver->sq_ring_memory )
+        munmap( driver->cq_ring_memory, driver->cq_ring_bytes );
+    if ( driver->sq_ring_memory )
+        munmap( driver->sq_ring_memory, driver->sq_ring_bytes );
+
+    free_function( allocator_context, driver->receive_buffers );
+    free_function( allocator_context, driver->pending_receives );
+    free_function( allocator_context, driver->send_buffers );
+    free_function( allocator_context, driver->send_data );
+    free_function( allocator_context, driver->free_send_buffers );
+    free_function( allocator_context, driver );
+}
+
+static int reliable_udp_io_uring_setup( struct reliable_udp_io_uring_t * driver )
+{
+    struct reliable_udp_io_uring_config_t * config = &driver->config;
+
+    // the completion queue holds every receive buffer and every send at once, so it can never overflow
+
+    uint32_t cq_entries = 1;
+    while ( cq_entries < (uint32_t) ( config->num_receive_buffers + config->num_send_buffers + 1 ) || cq_entries < (uint32_t) config->queue_depth * 2 )
+        cq_entries *= 2;
+
+    struct io_uring_params params;
+    memset( &params, 0, sizeof( params ) );
+    params.flags = IORING_SETUP_CQSIZE;
+#if defined( IORING_SETUP_SINGLE_ISSUER ) && defined( IORING_SETUP_DEFER_TASKRUN )
+    params.flags |= IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+#endif
+    params.cq_entries = cq_entries;
+
+    driver->ring = (int) syscall( __NR_io_uring_setup, config->queue_depth, &params );
+    if ( driver->ring < 0 && errno == EINVAL )
+    {
+        // kernels before 6.1 don't know the single issuer flags
+
+        memset( &params, 0, sizeof( params ) );
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = cq_entries;
+        driver->ring = (int) syscall( __NR_io_uring_setup, config->queue_depth, &params );
+    }
+    if ( driver->ring < 0 )
+        return RELIABLE_ERROR;
+
+    driver->sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof( uint32_t );
+    driver->cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+    {
+        if ( driver->cq_ring_bytes > driver->sq_ring_bytes )
+            driver->sq_ring_bytes = driver->cq_ring_bytes;
+        driver->cq_ring_bytes = driver->sq_ring_bytes;
+    }
+
+    void * memory = mmap( NULL, driver->sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, driver->ring, IORING_OFF_SQ_RING );
+    if ( memory == MAP_FAILED )
+        return RELIABLE_ERROR;
+    driver->sq_ring_memory = memory;
+
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+    {
+        driver->cq_ring_memory = driver->sq_ring_memory;
+    }
+    else
+    {
+        memory = mmap( NULL, driver->cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, driver->ring, IORING_OFF_CQ_RING );
+        if ( memory == MAP_FAILED )
+            return RELIABLE_ERROR;
+        driver->cq_ring_memory = memory;
+    }
+
+    driver->sqes_bytes = params.sq_entries * sizeof( struct io_uring_sqe );
+    memory = mmap( NULL, driver->sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, driver->ring, IORING_OFF_SQES );
+    if ( memory == MAP_FAILED )
+        return RELIABLE_ERROR;
+    driver->sqes = (struct io_uring_sqe*) memory;
+
+    uint8_t * sq = (uint8_t*) driver->sq_ring_memory;
+    driver->sq_head = (volatile uint32_t*) ( sq + params.sq_off.head );
+    driver->sq_tail = (volatile uint32_t*) ( sq + params.sq_off.tail );
+    driver->sq_mask = *(uint32_t*) ( sq + params.sq_off.ring_mask );
+    driver->sq_entries = *(uint32_t*) ( sq + params.sq_off.ring_entries );
+    driver->sq_local_tail = *driver->sq_tail;
+
+    uint32_t * sq_array = (uint32_t*) ( sq + params.sq_off.array );
+    uint32_t i;
+    for ( i = 0; i < driver->sq_entries; ++i )
+        sq_array[i] = i;
+
+    uint8_t * cq = (uint8_t*) driver->cq_ring_memory;
+    driver->cq_head = (volatile uint32_t*) ( cq + params.cq_off.head );
+    driver->cq_tail = (volatile uint32_t*) ( cq + params.cq_off.tail );
+    driver->cq_mask = *(uint32_t*) ( cq + params.cq_off.ring_mask );
+    driver->cqes = (struct io_uring_cqe*) ( cq + params.cq_off.cqes );
+
+    // the provided buffer ring must be page aligned, so it comes from mmap rather than the allocator
+
+    driver->buffer_ring_bytes = config->num_receive_buffers * sizeof( struct io_uring_buf );
+    memory = mmap( NULL, driver->buffer_ring_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( memory == MAP_FAILED )
+        return RELIABLE_ERROR;
+    driver->buffer_ring = (struct io_uring_buf_ring*) memory;
+
+    struct io_uring_buf_reg registration;
+    memset( &registration, 0, sizeof( registration ) );
+    registration.ring_addr = (uint64_t) (uintptr_t) driver->buffer_ring;
+    registration.ring_entries = (uint32_t) config->num_receive_buffers;
+    registration.bgid = 0;
+    if ( syscall( __NR_io_uring_register, driver->ring, IORING_REGISTER_PBUF_RING, &registration, 1 ) < 0 )
+        return RELIABLE_ERROR;
+
+    int buffer_id;
+    for ( buffer_id = 0; buffer_id < config->num_receive_buffers; ++buffer_id )
+        reliable_udp_io_uring_provide_buffer( driver, (uint16_t) buffer_id );
+    __atomic_store_n( &driver->buffer_ring->tail, driver->buffer_ring_tail, __ATOMIC_RELEASE );
+
+    return RELIABLE_OK;
+}
+
+struct reliable_udp_io_uring_t * reliable_udp_io_uring_create( struct reliable_udp_io_uring_config_t * config )
+{
+    reliable_assert( config );
+    reliable_assert( config->queue_depth > 0 );
+    reliable_assert( ( config->queue_depth & ( config->queue_depth - 1 ) ) == 0 );
+    reliable_assert( config->num_receive_buffers > 0 );
+    reliable_assert( config->num_receive_buffers <= 32768 );
+    reliable_assert( ( config->num_receive_buffers & ( config->num_receive_buffers - 1 ) ) == 0 );
+    reliable_assert( config->num_send_buffers > 0 );
+    reliable_assert( config->max_packet_bytes > 0 );
+    reliable_assert( config->receive_function );
+
+    void * allocator_context = config->allocator_context;
+    void * (*allocate_function)(void*,size_t) = config->allocate_function ? config->allocate_function : reliable_udp_default_allocate_function;
+
+    struct reliable_udp_io_uring_t * driver = (struct reliable_udp_io_uring_t*) allocate_function( allocator_context, sizeof( struct reliable_udp_io_uring_t ) );
+
+    reliable_assert( driver );
+
+    memset( driver, 0, sizeof( struct reliable_udp_io_uring_t ) );
+
+    driver->config = *config;
+    driver->config.allocate_function = allocate_function;
+    driver->config.free_function = config->free_function ? config->free_function : reliable_udp_default_free_function;
+    driver->socket = -1;
+    driver->ring = -1;
+
+    // each receive buffer holds the recvmsg header, the source address and the datagram, in that order
+
+    driver->receive_buffer_bytes = (int) ( sizeof( struct io_uring_recvmsg_out ) + sizeof( struct sockaddr_in6 ) ) + config->max_packet_bytes;
+    driver->receive_buffer_bytes = ( driver->receive_buffer_bytes + 63 ) & ~63;
+
+    driver->receive_buffers = (uint8_t*) allocate_function( allocator_context, (size_t) config->num_receive_buffers * driver->receive_buffer_bytes );
+    driver->pending_receives = (struct reliable_udp_io_uring_completion_t*) allocate_function( allocator_context, ( config->num_receive_buffers + 1 ) * sizeof( struct reliable_udp_io_uring_completion_t ) );
+    driver->send_buffers = (struct reliable_udp_io_uring_send_buffer_t*) allocate_function( allocator_context, config->num_send_buffers * sizeof( struct reliable_udp_io_uring_send_buffer_t ) );
+    driver->send_data = (uint8_t*) allocate_function( allocator_context, (size_t) config->num_send_buffers * config->max_packet_bytes );
+    driver->free_send_buffers = (int*) allocate_function( allocator_context, config->num_send_buffers * sizeof( int ) );
+
+    reliable_assert( driver->receive_buffers );
+    reliable_assert( driver->pending_receives );
+    reliable_assert( driver->send_buffers );
+    reliable_assert( driver->send_data );
+    reliable_assert( driver->free_send_buffers );
+
+    int i;
+    for ( i = 0; i < config->num_send_buffers; ++i )
+    {
+        driver->free_send_buffers[i] = config->num_send_buffers - 1 - i;
+    }
+    driver->num_free_send_buffers = config->num_send_buffers;
+
+    driver->receive_message.msg_namelen = sizeof( struct sockaddr_in6 );
+
+    driver->socket = reliable_udp_socket_create( &config->bind_address, config->socket_send_buffer_size, config->socket_receive_buffer_size, &driver->address );
+
+    if ( driver->socket < 0 || reliable_udp_io_uring_setup( driver ) != RELIABLE_OK )
+    {
+        reliable_udp_io_uring_free( driver );
+        return NULL;
+    }
+
+    reliable_udp_io_uring_arm_receive( driver );
+    reliable_udp_io_uring_submit( driver, 0 );
+
+    return driver;
+}
+
+void reliable_udp_io_uring_destroy( struct reliable_udp_io_uring_t * driver )
+{
+    reliable_assert( driver );
+
+    // closing the ring cancels the receive and any sends still in flight
+
+    reliable_udp_io_uring_free( driver );
+}
+
+void reliable_udp_io_uring_address( struct reliable_udp_io_uring_t * driver, struct reliable_udp_address_t * address )
+{
+    reliable_assert( driver );
+    reliable_assert( address );
+    *address = driver->address;
+}
+
+int reliable_udp_io_uring_send( struct reliable_udp_io_uring_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( driver );
+    reliable_assert( to );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    if ( packet_bytes > driver->config.max_packet_bytes )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+        return RELIABLE_ERROR;
+    }
+
+    if ( driver->num_free_send_buffers == 0 )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_SEND_BUFFERS_FULL]++;
+        while ( driver->num_free_send_buffers == 0 )
+        {
+            reliable_udp_io_uring_submit( driver, 1 );
+            reliable_udp_io_uring_reap( driver );
+        }
+    }
+
+    struct io_uring_sqe * sqe = reliable_udp_io_uring_get_sqe( driver );
+    if ( !sqe )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS]++;
+        return RELIABLE_ERROR;
+    }
+
+    int index = driver->free_send_buffers[--driver->num_free_send_buffers];
+
+    struct reliable_udp_io_uring_send_buffer_t * buffer = driver->send_buffers + index;
+    uint8_t * data = driver->send_data + (size_t) index * driver->config.max_packet_bytes;
+    memcpy( data, packet_data, packet_bytes );
+
+    buffer->iov.iov_base = data;
+    buffer->iov.iov_len = (size_t) packet_bytes;
+    memset( &buffer->message, 0, sizeof( buffer->message ) );
+    buffer->message.msg_name = &buffer->address;
+    buffer->message.msg_namelen = reliable_udp_address_to_sockaddr( to, &buffer->address );
+    buffer->message.msg_iov = &buffer->iov;
+    buffer->message.msg_iovlen = 1;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = driver->socket;
+    sqe->addr = (uint64_t) (uintptr_t) &buffer->message;
+    sqe->len = 1;
+    sqe->user_data = (uint64_t) index;
+
+    driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_SENT]++;
+
+    return RELIABLE_OK;
+}
+
+void reliable_udp_io_uring_flush( struct reliable_udp_io_uring_t * driver )
+{
+    reliable_assert( driver );
+    reliable_udp_io_uring_submit( driver, 0 );
+    reliable_udp_io_uring_reap( driver );
+}
+
+int reliable_udp_io_uring_receive( struct reliable_udp_io_uring_t * driver )
+{
+    reliable_assert( driver );
+
+    reliable_udp_io_uring_submit( driver, 0 );
+    reliable_udp_io_uring_reap( driver );
+
+    int num_received = 0;
+
+    // the receive function may send, and sending may reap more receives onto the end of the list, so re-read the count each time
+
+    int i;
+    for ( i = 0; i < driver->num_pending_receives; ++i )
+    {
+        struct reliable_udp_io_uring_completion_t completion = driver->pending_receives[i];
+
+        if ( completion.result < 0 )
+        {
+            if ( completion.result == -ENOBUFS )
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_RECEIVE_BUFFERS_EMPTY]++;
+            continue;
+        }
+
+        if ( !( completion.flags & IORING_CQE_F_BUFFER ) )
+            continue;
+
+        uint16_t buffer_id = (uint16_t) ( completion.flags >> IORING_CQE_BUFFER_SHIFT );
+        uint8_t * buffer = driver->receive_buffers + (size_t) buffer_id * driver->receive_buffer_bytes;
+        struct io_uring_recvmsg_out * header = (struct io_uring_recvmsg_out*) buffer;
+
+        if ( header->flags & MSG_TRUNC )
+        {
+            driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+        }
+        else
+        {
+            uint8_t * name = buffer + sizeof( struct io_uring_recvmsg_out );
+            uint8_t * packet_data = name + driver->receive_message.msg_namelen + driver->receive_message.msg_controllen;
+            struct reliable_udp_address_t from;
+            reliable_udp_address_from_sockaddr( &from, name );
+            driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_RECEIVED]++;
+            driver->config.receive_function( driver->config.context, &from, packet_data, (int) header->payloadlen );
+            num_received++;
+        }
+
+        reliable_udp_io_uring_provide_buffer( driver, buffer_id );
+    }
+
+    driver->num_pending_receives = 0;
+
+    __atomic_store_n( &driver->buffer_ring->tail, driver->buffer_ring_tail, __ATOMIC_RELEASE );
+
+    // a multishot receive stops when it runs out of buffers. now there are buffers again, queue another for the next submit
+
+    if ( !driver->receive_armed )
+        reliable_udp_io_uring_arm_receive( driver );
+
+    return num_received;
+}
+
+RELIABLE_CONST uint64_t * reliable_udp_io_uring_counters( struct reliable_udp_io_uring_t * driver )
+{
+    reliable_assert( driver );
+    return driver->counters;
+}
+
+#else // #if RELIABLE_UDP_IO_URING
+
+struct reliable_udp_io_uring_t
+{
+    uint64_t counters[RELIABLE_UDP_NUM_COUNTERS];
+};
+
+struct reliable_udp_io_uring_t * reliable_udp_io_uring_create( struct reliable_udp_io_uring_config_t * config )
+{
+    (void) config;
+    return NULL;
+}
+
+void reliable_udp_io_uring_destroy( struct reliable_udp_io_uring_t * driver )
+{
+    (void) driver;
+}
+
+void reliable_udp_io_uring_address( struct reliable_udp_io_uring_t * driver, struct reliable_udp_address_t * address )
+{
+    (void) driver;
+    memset( address, 0, sizeof( struct reliable_udp_address_t ) );
+}
+
+int reliable_udp_io_uring_send( struct reliable_udp_io_uring_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes )
+{
+    (void) driver;
+    (void) to;
+    (void) packet_data;
+    (void) packet_bytes;
+    return RELIABLE_ERROR;
+}
+
+void reliable_udp_io_uring_flush( struct reliable_udp_io_uring_t * driver )
+{
+    (void) driver;
+}
+
+int reliable_udp_io_uring_receive( struct reliable_udp_io_uring_t * driver )
+{
+    (void) driver;
+    return 0;
+}
+
+RELIABLE_CONST uint64_t * reliable_udp_io_uring_counters( struct reliable_udp_io_uring_t * driver )
+{
+    return driver->counters;
+}
+
+#endif // #if RELIABLE_UDP_IO_URING
+
+// ---------------------------------------------------------------
+
+// open-addressing hash table from address to endpoint, with linear probing. a slot is 32 bytes, so two share a cache line
+// and a lookup that hits usually touches one. the table is kept at most half full, and removal shifts later entries of
+// the same probe chain back instead of leaving tombstones, so lookups never slow down as endpoints come and go
+
+struct reliable_udp_address_slot_t
+{
+    uint32_t hash;                                                              // 0 = empty
+    uint16_t port;
+    uint8_t type;
+    uint8_t padding;
+    uint8_t data[16];
+    struct reliable_endpoint_t * endpoint;
+};
+
+static uint32_t reliable_udp_address_hash( RELIABLE_CONST struct reliable_udp_address_t * address )
+{
+    uint64_t a, b;
+    memcpy( &a, address->data, 8 );
+    memcpy( &b, address->data + 8, 8 );
+    if ( address->type == RELIABLE_UDP_ADDRESS_IPV4 )
+    {
+        a &= 0xFFFFFFFFULL;
+        b = 0;
+    }
+    uint64_t hash = a ^ ( b * 0x9E3779B97F4A7C15ULL ) ^ ( ( (uint64_t) address->port << 8 ) | address->type );
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    uint32_t result = (uint32_t) hash;
+    return result ? result : 1;
+}
+
+static int reliable_udp_address_slot_matches( RELIABLE_CONST struct reliable_udp_address_slot_t * slot, uint32_t hash, RELIABLE_CONST struct reliable_udp_address_t * address )
+{
+    return slot->hash == hash && slot->port == address->port && slot->type == address->type &&
+        memcmp( slot->data, address->data, address->type == RELIABLE_UDP_ADDRESS_IPV4 ? 4 : 16 ) == 0;
+}
+
+#define RELIABLE_UDP_MMSG_MAX_SEND_BUFFERS 1024
+
+// generic segmentation and receive offload. the kernel sends a train of equally sized datagrams from one buffer, and hands
+// back datagrams from the same sender as one buffer plus the size they were cut at. a train is at most 64 datagrams and 64K
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define RELIABLE_UDP_GSO_MAX_SEGMENTS 64
+#define RELIABLE_UDP_GSO_MAX_BYTES 65507
+#define RELIABLE_UDP_GRO_BUFFER_BYTES 65536
+
+union reliable_udp_control_t
+{
+    uint8_t data[CMSG_SPACE( sizeof( int ) )];
+    struct cmsghdr align;
+};
+
+struct reliable_udp_mmsg_t
+{
+    struct reliable_udp_mmsg_config_t config;
+    struct reliable_udp_address_t address;
+    int socket;
+
+    struct reliable_udp_address_slot_t * slots;
+    uint32_t slot_mask;
+    int num_endpoints;
+
+    struct mmsghdr * receive_messages;
+    struct iovec * receive_iovecs;
+    struct sockaddr_storage * receive_addresses;
+    union reliable_udp_control_t * receive_controls;
+    uint8_t * receive_data;
+    int receive_buffer_bytes;
+
+    struct mmsghdr * send_messages;
+    struct iovec * send_iovecs;
+    struct sockaddr_storage * send_addresses;
+    union reliable_udp_control_t * send_controls;
+    int * send_datagrams;                                                       // datagrams in each queued message. more than one for a segment train
+    uint8_t * send_data;
+    int send_data_bytes;
+    int send_data_used;
+    int num_queued_sends;
+
+    int gso;
+    int gro;
+
+    uint64_t counters[RELIABLE_UDP_NUM_COUNTERS];
+};
+
+void reliable_udp_mmsg_default_config( struct reliable_udp_mmsg_config_t * config )
+{
+    reliable_assert( config );
+    memset( config, 0, sizeof( struct reliable_udp_mmsg_config_t ) );
+    config->bind_address.type = RELIABLE_UDP_ADDRESS_IPV4;
+    config->max_endpoints = 1024;
+    config->receive_batch_size = 64;
+    config->num_send_buffers = 1024;
+    config->max_packet_bytes = 1500;
+    config->socket_send_buffer_size = 4 * 1024 * 1024;
+    config->socket_receive_buffer_size = 4 * 1024 * 1024;
+    config->gso = 1;
+}
+
+static void reliable_udp_mmsg_free( struct reliable_udp_mmsg_t * driver )
+{
+    void * allocator_context = driver->config.allocator_context;
+    void (*free_function)(void*,void*) = driver->config.free_function;
+
+    if ( driver->socket >= 0 )
+        close( driver->socket );
+
+    free_function( allocator_context, driver->slots );
+    free_function( allocator_context, driver->receive_messages );
+    free_function( allocator_context, driver->receive_iovecs );
+    free_function( allocator_context, driver->receive_addresses );
+    free_function( allocator_context, driver->receive_controls );
+    free_function( allocator_context, driver->receive_data );
+    free_function( allocator_context, driver->send_messages );
+    free_function( allocator_context, driver->send_iovecs );
+    free_function( allocator_context, driver->send_addresses );
+    free_function( allocator_context, driver->send_controls );
+    free_function( allocator_context, driver->send_datagrams );
+    free_function( allocator_context, driver->send_data );
+    free_function( allocator_context, driver );
+}
+
+struct reliable_udp_mmsg_t * reliable_udp_mmsg_create( struct reliable_udp_mmsg_config_t * config )
+{
+    reliable_assert( config );
+    reliable_assert( config->max_endpoints > 0 );
+    reliable_assert( config->receive_batch_size > 0 );
+    reliable_assert( config->num_send_buffers > 0 );
+    reliable_assert( config->num_send_buffers <= RELIABLE_UDP_MMSG_MAX_SEND_BUFFERS );
+    reliable_assert( config->max_packet_bytes > 0 );
+
+    void * allocator_context = config->allocator_context;
+    void * (*allocate_function)(void*,size_t) = config->allocate_function ? config->allocate_function : reliable_udp_default_allocate_function;
+
+    struct reliable_udp_mmsg_t * driver = (struct reliable_udp_mmsg_t*) allocate_function( allocator_context, sizeof( struct reliable_udp_mmsg_t ) );
+
+    reliable_assert( driver );
+
+    memset( driver, 0, sizeof( struct reliable_udp_mmsg_t ) );
+
+    driver->config = *config;
+    driver->config.allocate_function = allocate_function;
+    driver->config.free_function = config->free_function ? config->free_function : reliable_udp_default_free_function;
+
+    uint32_t num_slots = 1;
+    while ( num_slots < (uint32_t) config->max_endpoints * 2 )
+        num_slots *= 2;
+    driver->slot_mask = num_slots - 1;
+
+    int batch = config->receive_batch_size;
+    int sends = config->num_send_buffers;
+
+    // with receive offload a buffer can hold a whole train of datagrams, so each one has to be big enough for the largest.
+    // sends are copied back to back into one area instead, so a segment train takes the space of the datagrams in it
+
+    driver->receive_buffer_bytes = config->gro ? RELIABLE_UDP_GRO_BUFFER_BYTES : config->max_packet_bytes;
+    driver->send_data_bytes = sends * config->max_packet_bytes;
+
+    driver->slots = (struct reliable_udp_address_slot_t*) allocate_function( allocator_context, num_slots * sizeof( struct reliable_udp_address_slot_t ) );
+    driver->receive_messages = (struct mmsghdr*) allocate_function( allocator_context, batch * sizeof( struct mmsghdr ) );
+    driver->receive_iovecs = (struct iovec*) allocate_function( allocator_context, batch * sizeof( struct iovec ) );
+    driver->receive_addresses = (struct sockaddr_storage*) allocate_function( allocator_context, batch * sizeof( struct sockaddr_storage ) );
+    driver->receive_controls = (union reliable_udp_control_t*) allocate_function( allocator_context, batch * sizeof( union reliable_udp_control_t ) );
+    driver->receive_data = (uint8_t*) allocate_function( allocator_context, (size_t) batch * driver->receive_buffer_bytes );
+    driver->send_messages = (struct mmsghdr*) allocate_function( allocator_context, sends * sizeof( struct mmsghdr ) );
+    driver->send_iovecs = (struct iovec*) allocate_function( allocator_context, sends * sizeof( struct iovec ) );
+    driver->send_addresses = (struct sockaddr_storage*) allocate_function( allocator_context, sends * sizeof( struct sockaddr_storage ) );
+    driver->send_controls = (union reliable_udp_control_t*) allocate_function( allocator_context, sends * sizeof( union reliable_udp_control_t ) );
+    driver->send_datagrams = (int*) allocate_function( allocator_context, sends * sizeof( int ) );
+    driver->send_data = (uint8_t*) allocate_function( allocator_context, (size_t) driver->send_data_bytes );
+
+    reliable_assert( driver->slots );
+    reliable_assert( driver->receive_messages );
+    reliable_assert( driver->receive_iovecs );
+    reliable_assert( driver->receive_addresses );
+    reliable_assert( driver->receive_controls );
+    reliable_assert( driver->receive_data );
+    reliable_assert( driver->send_messages );
+    reliable_assert( driver->send_iovecs );
+    reliable_assert( driver->send_addresses );
+    reliable_assert( driver->send_controls );
+    reliable_assert( driver->send_datagrams );
+    reliable_assert( driver->send_data );
+
+    memset( driver->slots, 0, num_slots * sizeof( struct reliable_udp_address_slot_t ) );
+    memset( driver->receive_messages, 0, batch * sizeof( struct mmsghdr ) );
+    memset( driver->send_messages, 0, sends * sizeof( struct mmsghdr ) );
+
+    // every message points at its own iovec and address once, here. receives also get their own slice of the data
+
+    int i;
+    for ( i = 0; i < batch; ++i )
+    {
+        driver->receive_iovecs[i].iov_base = driver->receive_data + (size_t) i * driver->receive_buffer_bytes;
+        driver->receive_iovecs[i].iov_len = (size_t) driver->receive_buffer_bytes;
+        driver->receive_messages[i].msg_hdr.msg_iov = driver->receive_iovecs + i;
+        driver->receive_messages[i].msg_hdr.msg_iovlen = 1;
+        driver->receive_messages[i].msg_hdr.msg_name = driver->receive_addresses + i;
+    }
+
+    for ( i = 0; i < sends; ++i )
+    {
+        driver->send_messages[i].msg_hdr.msg_iov = driver->send_iovecs + i;
+        driver->send_messages[i].msg_hdr.msg_iovlen = 1;
+        driver->send_messages[i].msg_hdr.msg_name = driver->send_addresses + i;
+    }
+
+    driver->socket = reliable_udp_socket_create( &config->bind_address, config->socket_send_buffer_size, config->socket_receive_buffer_size, &driver->address );
+    if ( driver->socket < 0 )
+    {
+        reliable_udp_mmsg_free( driver );
+        return NULL;
+    }
+
+    // both were added in linux 5.0. where they are missing, segment trains go out as separate datagrams and nothing is coalesced
+
+    if ( config->gso )
+    {
+        int segment_bytes = 0;
+        driver->gso = setsockopt( driver->socket, SOL_UDP, UDP_SEGMENT, &segment_bytes, sizeof( segment_bytes ) ) == 0;
+    }
+
+    if ( config->gro )
+    {
+        int enable = 1;
+        driver->gro = setsockopt( driver->socket, SOL_UDP, UDP_GRO, &enable, sizeof( enable ) ) == 0;
+    }
+
+    return driver;
+}
+
+void reliable_udp_mmsg_destroy( struct reliable_udp_mmsg_t * driver )
+{
+    reliable_assert( driver );
+    reliable_udp_mmsg_free( driver );
+}
+
+void reliable_udp_mmsg_address( struct reliable_udp_mmsg_t * driver, struct reliable_udp_address_t * address )
+{
+    reliable_assert( driver );
+    reliable_assert( address );
+    *address = driver->address;
+}
+
+int reliable_udp_mmsg_add_endpoint( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address, struct reliable_endpoint_t * endpoint )
+{
+    reliable_assert( driver );
+    reliable_assert( address );
+    reliable_assert( address->type == RELIABLE_UDP_ADDRESS_IPV4 || address->type == RELIABLE_UDP_ADDRESS_IPV6 );
+    reliable_assert( endpoint );
+
+    if ( driver->num_endpoints == driver->config.max_endpoints )
+        return RELIABLE_ERROR;
+
+    uint32_t hash = reliable_udp_address_hash( address );
+    uint32_t index = hash & driver->slot_mask;
+    while ( driver->slots[index].hash != 0 )
+    {
+        if ( reliable_udp_address_slot_matches( driver->slots + index, hash, address ) )
+            return RELIABLE_ERROR;
+        index = ( index + 1 ) & driver->slot_mask;
+    }
+
+    struct reliable_udp_address_slot_t * slot = driver->slots + index;
+    memset( slot, 0, sizeof( struct reliable_udp_address_slot_t ) );
+    slot->hash = hash;
+    slot->port = address->port;
+    slot->type = address->type;
+    memcpy( slot->data, address->data, address->type == RELIABLE_UDP_ADDRESS_IPV4 ? 4 : 16 );
+    slot->endpoint = endpoint;
+
+    driver->num_endpoints++;
+
+    return RELIABLE_OK;
+}
+
+static int reliable_udp_mmsg_find_slot( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address )
+{
+    uint32_t hash = reliable_udp_address_hash( address );
+    uint32_t index = hash & driver->slot_mask;
+    while ( driver->slots[index].hash != 0 )
+    {
+        if ( reliable_udp_address_slot_matches( driver->slots + index, hash, address ) )
+            return (int) index;
+        index = ( index + 1 ) & driver->slot_mask;
+    }
+    return -1;
+}
+
+int reliable_udp_mmsg_remove_endpoint( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address )
+{
+    reliable_assert( driver );
+    reliable_assert( address );
+
+    int found = reliable_udp_mmsg_find_slot( driver, address );
+    if ( found < 0 )
+        return RELIABLE_ERROR;
+
+    // backward shift: walk the rest of the probe chain and move back each entry that the hole now sits between it and its home slot
+
+    uint32_t hole = (uint32_t) found;
+    uint32_t index = ( hole + 1 ) & driver->slot_mask;
+    while ( driver->slots[index].hash != 0 )
+    {
+        uint32_t home = driver->slots[index].hash & driver->slot_mask;
+        if ( ( ( index - home ) & driver->slot_mask ) >= ( ( index - hole ) & driver->slot_mask ) )
+        {
+            driver->slots[hole] = driver->slots[index];
+            hole = index;
+        }
+        index = ( index + 1 ) & driver->slot_mask;
+    }
+    memset( driver->slots + hole, 0, sizeof( struct reliable_udp_address_slot_t ) );
+
+    driver->num_endpoints--;
+
+    return RELIABLE_OK;
+}
+
+struct reliable_endpoint_t * reliable_udp_mmsg_find_endpoint( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address )
+{
+    reliable_assert( driver );
+    reliable_assert( address );
+    int index = reliable_udp_mmsg_find_slot( driver, address );
+    return index >= 0 ? driver->slots[index].endpoint : NULL;
+}
+
+// copies one message into the send area. segment_bytes > 0 makes it a train of datagrams cut every segment_bytes
+
+static void reliable_udp_mmsg_queue( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * data, int bytes, int segment_bytes )
+{
+    reliable_assert( bytes <= driver->send_data_bytes );
+
+    if ( driver->num_queued_sends == driver->config.num_send_buffers || driver->send_data_used + bytes > driver->send_data_bytes )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_SEND_BUFFERS_FULL]++;
+        reliable_udp_mmsg_flush( driver );
+    }
+
+    int index = driver->num_queued_sends++;
+
+    uint8_t * message_data = driver->send_data + driver->send_data_used;
+    driver->send_data_used += bytes;
+
+    memcpy( message_data, data, bytes );
+    driver->send_iovecs[index].iov_base = message_data;
+    driver->send_iovecs[index].iov_len = (size_t) bytes;
+
+    struct msghdr * header = &driver->send_messages[index].msg_hdr;
+
+    header->msg_namelen = reliable_udp_address_to_sockaddr( to, driver->send_addresses + index );
+
+    if ( segment_bytes > 0 && bytes > segment_bytes )
+    {
+        header->msg_control = driver->send_controls + index;
+        header->msg_controllen = CMSG_SPACE( sizeof( uint16_t ) );
+        struct cmsghdr * control = CMSG_FIRSTHDR( header );
+        control->cmsg_level = SOL_UDP;
+        control->cmsg_type = UDP_SEGMENT;
+        control->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+        uint16_t size = (uint16_t) segment_bytes;
+        memcpy( CMSG_DATA( control ), &size, sizeof( size ) );
+        driver->send_datagrams[index] = ( bytes + segment_bytes - 1 ) / segment_bytes;
+    }
+    else
+    {
+        header->msg_control = NULL;
+        header->msg_controllen = 0;
+        driver->send_datagrams[index] = 1;
+    }
+}
+
+int reliable_udp_mmsg_send( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes )
+{
+    reliable_assert( driver );
+    reliable_assert( to );
+    reliable_assert( packet_data );
+    reliable_assert( packet_bytes > 0 );
+
+    if ( packet_bytes > driver->config.max_packet_bytes )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+        return RELIABLE_ERROR;
+    }
+
+    reliable_udp_mmsg_queue( driver, to, packet_data, packet_bytes, 0 );
+
+    return RELIABLE_OK;
+}
+
+int reliable_udp_mmsg_send_segments( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * data, int bytes, int segment_bytes )
+{
+    reliable_assert( driver );
+    reliable_assert( to );
+    reliable_assert( data );
+    reliable_assert( bytes > 0 );
+    reliable_assert( segment_bytes > 0 );
+
+    if ( segment_bytes > driver->config.max_packet_bytes )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+        return RELIABLE_ERROR;
+    }
+
+    if ( !driver->gso )
+    {
+        int offset;
+        for ( offset = 0; offset < bytes; offset += segment_bytes )
+        {
+            reliable_udp_mmsg_queue( driver, to, data + offset, bytes - offset < segment_bytes ? bytes - offset : segment_bytes, 0 );
+        }
+        return RELIABLE_OK;
+    }
+
+    // cut into trains the kernel and the send area can take whole. every train but the last is a multiple of segment_bytes
+
+    int max_train_bytes = driver->send_data_bytes < RELIABLE_UDP_GSO_MAX_BYTES ? driver->send_data_bytes : RELIABLE_UDP_GSO_MAX_BYTES;
+    int max_segments = max_train_bytes / segment_bytes;
+    if ( max_segments > RELIABLE_UDP_GSO_MAX_SEGMENTS )
+        max_segments = RELIABLE_UDP_GSO_MAX_SEGMENTS;
+
+    int train_bytes = max_segments * segment_bytes;
+
+    while ( bytes > 0 )
+    {
+        int message_bytes = bytes < train_bytes ? bytes : train_bytes;
+        reliable_udp_mmsg_queue( driver, to, data, message_bytes, segment_bytes );
+        data += message_bytes;
+        bytes -= message_bytes;
+    }
+
+    return RELIABLE_OK;
+}
+
+void reliable_udp_mmsg_flush( struct reliable_udp_mmsg_t * driver )
+{
+    reliable_assert( driver );
+
+    int sent = 0;
+    while ( sent < driver->num_queued_sends )
+    {
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_SYSCALLS]++;
+        int result = sendmmsg( driver->socket, driver->send_messages + sent, (unsigned int) ( driver->num_queued_sends - sent ), 0 );
+        if ( result < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            // sendmmsg only fails outright when the first message fails, so drop that one and carry on with the rest.
+            // a segment train fails with EIO where the device can't checksum segments. send them separately from now on
+
+            if ( driver->send_messages[sent].msg_hdr.msg_controllen != 0 && ( errno == EIO || errno == EINVAL ) )
+                driver->gso = 0;
+
+            driver->counters[RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS]++;
+            sent++;
+            continue;
+        }
+
+        int i;
+        for ( i = sent; i < sent + result; ++i )
+        {
+            driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_SENT] += (uint64_t) driver->send_datagrams[i];
+            if ( driver->send_datagrams[i] > 1 )
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_SENT]++;
+        }
+        sent += result;
+    }
+
+    driver->num_queued_sends = 0;
+    driver->send_data_used = 0;
+}
+
+// the size a coalesced buffer was cut at, or 0 if it holds a single datagram
+
+static int reliable_udp_mmsg_segment_bytes( struct msghdr * header )
+{
+    struct cmsghdr * control;
+    for ( control = CMSG_FIRSTHDR( header ); control; control = CMSG_NXTHDR( header, control ) )
+    {
+        if ( control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO )
+        {
+            int segment_bytes;
+            memcpy( &segment_bytes, CMSG_DATA( control ), sizeof( segment_bytes ) );
+            return segment_bytes;
+        }
+    }
+    return 0;
+}
+
+int reliable_udp_mmsg_receive( struct reliable_udp_mmsg_t * driver )
+{
+    reliable_assert( driver );
+
+    int num_received = 0;
+    int batch = driver->config.receive_batch_size;
+
+    while ( 1 )
+    {
+        int i;
+        for ( i = 0; i < batch; ++i )
+        {
+            struct msghdr * header = &driver->receive_messages[i].msg_hdr;
+            header->msg_namelen = sizeof( struct sockaddr_storage );
+            header->msg_control = driver->gro ? driver->receive_controls + i : NULL;
+            header->msg_controllen = driver->gro ? sizeof( union reliable_udp_control_t ) : 0;
+        }
+
+        driver->counters[RELIABLE_UDP_COUNTER_NUM_SYSCALLS]++;
+        int result = recvmmsg( driver->socket, driver->receive_messages, (unsigned int) batch, MSG_DONTWAIT, NULL );
+        if ( result <= 0 )
+        {
+            if ( result < 0 && errno == EINTR )
+                continue;
+            break;
+        }
+
+        for ( i = 0; i < result; ++i )
+        {
+            struct mmsghdr * message = driver->receive_messages + i;
+
+            if ( message->msg_hdr.msg_flags & MSG_TRUNC )
+            {
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+                continue;
+            }
+
+            uint8_t * data = (uint8_t*) driver->receive_iovecs[i].iov_base;
+            int bytes = (int) message->msg_len;
+
+            // split coalesced buffers back into the datagrams that were sent, so the endpoint sees each fragment on its own
+
+            int segment_bytes = driver->gro ? reliable_udp_mmsg_segment_bytes( &message->msg_hdr ) : 0;
+            if ( segment_bytes <= 0 || segment_bytes >= bytes )
+                segment_bytes = bytes;
+            else
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_RECEIVED]++;
+
+            if ( segment_bytes > driver->config.max_packet_bytes )
+            {
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE]++;
+                continue;
+            }
+
+            struct reliable_udp_address_t from;
+            reliable_udp_address_from_sockaddr( &from, driver->receive_addresses + i );
+
+            // looked up per datagram, since the callbacks may add or remove endpoints
+
+            int offset;
+            for ( offset = 0; offset < bytes; offset += segment_bytes )
+            {
+                uint8_t * packet_data = data + offset;
+                int packet_bytes = bytes - offset < segment_bytes ? bytes - offset : segment_bytes;
+
+                driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_RECEIVED]++;
+                num_received++;
+
+                int index = reliable_udp_mmsg_find_slot( driver, &from );
+
+                if ( index >= 0 )
+                {
+                    reliable_endpoint_receive_packet( driver->slots[index].endpoint, packet_data, packet_bytes );
+                }
+                else
+                {
+                    driver->counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_UNKNOWN_ADDRESS]++;
+                    if ( driver->config.receive_function )
+                        driver->config.receive_function( driver->config.context, &from, packet_data, packet_bytes );
+                }
+            }
+        }
+
+        // a short batch means the socket is empty, so don't spend another syscall finding that out
+
+        if ( result < batch )
+            break;
+    }
+
+    return num_received;
+}
+
+RELIABLE_CONST uint64_t * reliable_udp_mmsg_counters( struct reliable_udp_mmsg_t * driver )
+{
+    reliable_assert( driver );
+    return driver->counters;
+}
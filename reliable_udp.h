@@ -0,0 +1,208 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RELIABLE_UDP_H
+#define RELIABLE_UDP_H
+
+#include "reliable.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// udp socket drivers for linux servers, so you don't have to write your own socket glue around transmit_packet_function.
+// a driver owns one non-blocking udp socket. reliable_udp_*_send queues a datagram, reliable_udp_*_flush sends everything
+// queued, and reliable_udp_*_receive hands each datagram that has arrived to an endpoint. a driver is not thread safe:
+// use it from one thread, e.g. the one updating its endpoints
+
+#define RELIABLE_UDP_ADDRESS_NONE                                           0
+#define RELIABLE_UDP_ADDRESS_IPV4                                           1
+#define RELIABLE_UDP_ADDRESS_IPV6                                           2
+
+#define RELIABLE_UDP_ADDRESS_STRING_BYTES                                   64
+
+struct reliable_udp_address_t
+{
+    uint8_t type;                                                               // RELIABLE_UDP_ADDRESS_*
+    uint8_t data[16];                                                           // ipv4 uses the first 4 bytes. network byte order
+    uint16_t port;                                                              // host byte order
+};
+
+// parses "127.0.0.1:40000", "[::1]:40000", or an address without a port, which gets port 0. returns RELIABLE_ERROR if it is not an address
+
+int reliable_udp_address_parse( struct reliable_udp_address_t * address, RELIABLE_CONST char * string );
+
+// formats an address the way reliable_udp_address_parse reads it. buffer should be RELIABLE_UDP_ADDRESS_STRING_BYTES. returns buffer
+
+char * reliable_udp_address_to_string( RELIABLE_CONST struct reliable_udp_address_t * address, char * buffer, int buffer_size );
+
+int reliable_udp_address_equal( RELIABLE_CONST struct reliable_udp_address_t * a, RELIABLE_CONST struct reliable_udp_address_t * b );
+
+// ---------------------------------------------------------------
+
+// io_uring driver. a multishot recvmsg receives into a ring of buffers registered with the kernel, so one submission keeps
+// receiving until the buffers run out, and the receive function gets a pointer straight into the buffer the kernel wrote.
+// sends are copied into send buffers and queued as sendmsg operations, all submitted together by the next receive or flush.
+// a frame that sends and receives any number of datagrams costs one io_uring_enter. needs linux 6.0 or later. where the
+// kernel supports it the ring is single issuer, and then only the thread that created the driver may use it
+
+struct reliable_udp_io_uring_config_t
+{
+    struct reliable_udp_address_t bind_address;                                // address to bind. port 0 picks a free port, see reliable_udp_io_uring_address
+    int queue_depth;                                                            // submission queue entries. power of two
+    int num_receive_buffers;                                                    // buffers in the ring the kernel receives into. power of two, at most 32768
+    int num_send_buffers;                                                       // datagrams that can be queued or in flight to the kernel at once
+    int max_packet_bytes;                                                       // largest datagram sent or received (bytes). larger received datagrams are dropped
+    int socket_send_buffer_size;                                                // SO_SNDBUF (bytes)
+    int socket_receive_buffer_size;                                             // SO_RCVBUF (bytes)
+    void * context;                                                             // passed to the receive function
+    void (*receive_function)(void*,RELIABLE_CONST struct reliable_udp_address_t*,uint8_t*,int); // (context, from, packet_data, packet_bytes). the data is only valid during the call
+    void * allocator_context;                                                   // passed to the allocate and free functions
+    void * (*allocate_function)(void*,size_t);                                  // custom allocator. NULL = malloc
+    void (*free_function)(void*,void*);                                         // custom free. NULL = free
+};
+
+// fills a config with defaults: bind 0.0.0.0 on any port, 1024 queue entries, 1024 receive and send buffers, 1500 byte datagrams and 4MB socket buffers
+
+void reliable_udp_io_uring_default_config( struct reliable_udp_io_uring_config_t * config );
+
+// creates the socket and the ring and starts receiving. returns NULL if the socket could not be bound, or if this kernel
+// does not have io_uring or has it disabled, so the caller can fall back to another driver
+
+struct reliable_udp_io_uring_t * reliable_udp_io_uring_create( struct reliable_udp_io_uring_config_t * config );
+
+void reliable_udp_io_uring_destroy( struct reliable_udp_io_uring_t * driver );
+
+// the address the socket is bound to, with the port filled in if the config asked for any port
+
+void reliable_udp_io_uring_address( struct reliable_udp_io_uring_t * driver, struct reliable_udp_address_t * address );
+
+// copies a datagram into a send buffer and queues it. it goes out with the next flush or receive. if every send buffer is
+// in use this submits and waits for one to complete. safe to call from the receive function. returns RELIABLE_ERROR if
+// the datagram is larger than max_packet_bytes
+
+int reliable_udp_io_uring_send( struct reliable_udp_io_uring_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes );
+
+// submits queued sends without receiving
+
+void reliable_udp_io_uring_flush( struct reliable_udp_io_uring_t * driver );
+
+// submits queued sends, then calls the receive function for each datagram that has arrived. never blocks. returns the number of datagrams received
+
+int reliable_udp_io_uring_receive( struct reliable_udp_io_uring_t * driver );
+
+#define RELIABLE_UDP_COUNTER_NUM_PACKETS_SENT                               0
+#define RELIABLE_UDP_COUNTER_NUM_PACKETS_RECEIVED                           1
+#define RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS                                2
+#define RELIABLE_UDP_COUNTER_NUM_SEND_BUFFERS_FULL                          3
+#define RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE                          4
+#define RELIABLE_UDP_COUNTER_NUM_RECEIVE_BUFFERS_EMPTY                      5
+#define RELIABLE_UDP_COUNTER_NUM_SYSCALLS                                   6
+#define RELIABLE_UDP_COUNTER_NUM_PACKETS_UNKNOWN_ADDRESS                    7
+#define RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_SENT                        8
+#define RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_RECEIVED                    9
+#define RELIABLE_UDP_NUM_COUNTERS                                           10
+
+RELIABLE_CONST uint64_t * reliable_udp_io_uring_counters( struct reliable_udp_io_uring_t * driver );
+
+// ---------------------------------------------------------------
+
+// recvmmsg/sendmmsg driver, for kernels where io_uring is missing or not allowed. sends from every endpoint are queued
+// and go out together in one sendmmsg per frame. receive reads up to receive_batch_size datagrams per recvmmsg until the
+// socket is empty, looks each source address up in an open-addressing hash table of endpoints, and passes the datagram
+// straight to reliable_endpoint_receive_packet. datagrams from addresses without an endpoint go to the receive function
+
+struct reliable_udp_mmsg_config_t
+{
+    struct reliable_udp_address_t bind_address;                                // address to bind. port 0 picks a free port, see reliable_udp_mmsg_address
+    int max_endpoints;                                                          // maximum number of endpoints in the address table
+    int receive_batch_size;                                                     // datagrams read per recvmmsg
+    int num_send_buffers;                                                       // datagrams that can be queued between flushes. a full queue flushes itself. at most 1024
+    int max_packet_bytes;                                                       // largest datagram sent or received (bytes). larger received datagrams are dropped
+    int socket_send_buffer_size;                                                // SO_SNDBUF (bytes)
+    int socket_receive_buffer_size;                                             // SO_RCVBUF (bytes)
+    int gso;                                                                    // 1 = send reliable_udp_mmsg_send_segments as one segment train (UDP_SEGMENT) where the kernel supports it
+    int gro;                                                                    // 1 = let the kernel coalesce received datagrams (UDP_GRO). each of the receive_batch_size buffers grows to 64K
+    void * context;                                                             // passed to the receive function
+    void (*receive_function)(void*,RELIABLE_CONST struct reliable_udp_address_t*,uint8_t*,int); // (context, from, packet_data, packet_bytes) for datagrams from unknown addresses. the data is only valid during the call. NULL = drop them
+    void * allocator_context;                                                   // passed to the allocate and free functions
+    void * (*allocate_function)(void*,size_t);                                  // custom allocator. NULL = malloc
+    void (*free_function)(void*,void*);                                         // custom free. NULL = free
+};
+
+// fills a config with defaults: bind 0.0.0.0 on any port, 1024 endpoints, batches of 64 received datagrams, 1024 send buffers, 1500 byte datagrams,
+// 4MB socket buffers, and segmentation offload on but receive offload off
+
+void reliable_udp_mmsg_default_config( struct reliable_udp_mmsg_config_t * config );
+
+// creates and binds the socket. returns NULL if it could not be bound
+
+struct reliable_udp_mmsg_t * reliable_udp_mmsg_create( struct reliable_udp_mmsg_config_t * config );
+
+// destroys the driver. endpoints in the address table are not destroyed
+
+void reliable_udp_mmsg_destroy( struct reliable_udp_mmsg_t * driver );
+
+void reliable_udp_mmsg_address( struct reliable_udp_mmsg_t * driver, struct reliable_udp_address_t * address );
+
+// routes datagrams from this address to this endpoint. returns RELIABLE_ERROR if the address already has an endpoint or the table is full
+
+int reliable_udp_mmsg_add_endpoint( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address, struct reliable_endpoint_t * endpoint );
+
+// returns RELIABLE_ERROR if the address has no endpoint
+
+int reliable_udp_mmsg_remove_endpoint( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address );
+
+// returns the endpoint for this address, or NULL
+
+struct reliable_endpoint_t * reliable_udp_mmsg_find_endpoint( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * address );
+
+// copies a datagram into the send queue. it goes out with the next flush. call from your transmit packet function.
+// returns RELIABLE_ERROR if the datagram is larger than max_packet_bytes
+
+int reliable_udp_mmsg_send( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * packet_data, int packet_bytes );
+
+// queues datagrams that were written back to back, each segment_bytes long except the last, which may be shorter. with gso on
+// they go to the kernel as one segment train, which it cuts into datagrams after routing, so a 16 fragment packet costs the
+// send path one message instead of 16. call from a transmit_fragments_function, passing its stride as segment_bytes.
+// returns RELIABLE_ERROR if segment_bytes is larger than max_packet_bytes
+
+int reliable_udp_mmsg_send_segments( struct reliable_udp_mmsg_t * driver, RELIABLE_CONST struct reliable_udp_address_t * to, RELIABLE_CONST uint8_t * data, int bytes, int segment_bytes );
+
+// sends everything queued with one sendmmsg. call once per-frame, after the endpoints have sent
+
+void reliable_udp_mmsg_flush( struct reliable_udp_mmsg_t * driver );
+
+// reads every datagram that has arrived and passes each to its endpoint. with gro on, buffers the kernel coalesced are split
+// back into the datagrams that were sent first. never blocks. returns the number of datagrams received
+
+int reliable_udp_mmsg_receive( struct reliable_udp_mmsg_t * driver );
+
+RELIABLE_CONST uint64_t * reliable_udp_mmsg_counters( struct reliable_udp_mmsg_t * driver );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // #ifndef RELIABLE_UDP_H
@@ -0,0 +1,377 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// How far one thread scales in endpoint count. Creates N endpoints with the default config, N from 1 to 100,000,
+// and drives them the way a 60HZ server would: every frame each endpoint sends one packet to its peer, then every
+// endpoint updates and clears acks. Endpoints are paired (0 with 1, 2 with 3, ...) and packets are delivered
+// straight into the peer.
+//
+// For each N it reports the memory allocated per endpoint, the average and worst frame time, the share of a 60HZ
+// frame that is, the time per endpoint per frame, and last level cache misses per endpoint per frame when the kernel
+// allows perf_event_open. Time per endpoint should stay flat while everything fits in cache, and climbs once the
+// endpoints and their sequence buffers no longer do.
+//
+// See BUILDING.md before reading anything into the numbers.
+//
+// Usage: scaling_bench [--max-endpoints N] [--frames N] [--output file.json]
+
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined( __linux__ )
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define PACKET_BYTES 200
+#define WARMUP_FRAMES 10
+#define FRAME_RATE 60.0
+
+static double bench_time()
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+// ---------------------------------------------------------------
+
+// last level cache misses for this thread, via perf_event_open. returns -1 where that isn't available or allowed
+
+static int llc_misses_fd = -1;
+
+static void llc_misses_open()
+{
+#if defined( __linux__ )
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof( attr ) );
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof( attr );
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    llc_misses_fd = (int) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+#endif
+}
+
+static void llc_misses_start()
+{
+#if defined( __linux__ )
+    if ( llc_misses_fd >= 0 )
+    {
+        ioctl( llc_misses_fd, PERF_EVENT_IOC_RESET, 0 );
+        ioctl( llc_misses_fd, PERF_EVENT_IOC_ENABLE, 0 );
+    }
+#endif
+}
+
+static int64_t llc_misses_stop()
+{
+#if defined( __linux__ )
+    if ( llc_misses_fd >= 0 )
+    {
+        ioctl( llc_misses_fd, PERF_EVENT_IOC_DISABLE, 0 );
+        uint64_t value;
+        if ( read( llc_misses_fd, &value, sizeof( value ) ) == (ssize_t) sizeof( value ) )
+            return (int64_t) value;
+    }
+#endif
+    return -1;
+}
+
+// ---------------------------------------------------------------
+
+// counts what the endpoints allocate. each block is prefixed with its size so frees can be subtracted
+
+static size_t bytes_allocated;
+
+static void * allocate_function( void * context, size_t bytes )
+{
+    (void) context;
+    size_t * p = (size_t*) malloc( bytes + 16 );
+    if ( !p )
+        return NULL;
+    p[0] = bytes;
+    bytes_allocated += bytes;
+    return ( (uint8_t*) p ) + 16;
+}
+
+static void free_function( void * context, void * pointer )
+{
+    (void) context;
+    if ( !pointer )
+        return;
+    size_t * p = (size_t*) ( ( (uint8_t*) pointer ) - 16 );
+    bytes_allocated -= p[0];
+    free( p );
+}
+
+static struct reliable_endpoint_t ** endpoints;
+static int num_endpoints;
+
+static void transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    int peer = (int) ( id ^ 1 );
+    if ( peer >= num_endpoints )
+        peer = (int) id;
+    reliable_endpoint_receive_packet( endpoints[peer], packet_data, packet_bytes );
+}
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+struct result_t
+{
+    int num_endpoints;
+    double bytes_per_endpoint;
+    double frame_ms_avg;
+    double frame_ms_max;
+    double ns_per_endpoint;
+    double llc_misses_per_endpoint;
+};
+
+static double frame_time;
+
+static void frame( uint8_t * packet_data )
+{
+    int i;
+    for ( i = 0; i < num_endpoints; ++i )
+        reliable_endpoint_send_packet( endpoints[i], packet_data, PACKET_BYTES );
+
+    frame_time += 1.0 / FRAME_RATE;
+
+    for ( i = 0; i < num_endpoints; ++i )
+    {
+        reliable_endpoint_update( endpoints[i], frame_time );
+        reliable_endpoint_clear_acks( endpoints[i] );
+    }
+}
+
+static int run( int n, int num_frames, struct result_t * result )
+{
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.transmit_packet_function = transmit_packet_function;
+    config.process_packet_function = process_packet_function;
+    config.allocate_function = allocate_function;
+    config.free_function = free_function;
+
+    frame_time = 100.0;
+    bytes_allocated = 0;
+
+    endpoints = (struct reliable_endpoint_t**) calloc( n, sizeof( struct reliable_endpoint_t* ) );
+    if ( !endpoints )
+        return 0;
+
+    int i;
+    for ( i = 0; i < n; ++i )
+    {
+        config.id = (uint64_t) i;
+        endpoints[i] = reliable_endpoint_create( &config, frame_time );
+        if ( !endpoints[i] )
+            break;
+    }
+
+    num_endpoints = i;
+
+    int ok = num_endpoints == n;
+
+    if ( ok )
+    {
+        uint8_t packet_data[PACKET_BYTES];
+        memset( packet_data, 0, sizeof( packet_data ) );
+
+        for ( i = 0; i < WARMUP_FRAMES; ++i )
+            frame( packet_data );
+
+        double total_seconds = 0.0;
+        double max_seconds = 0.0;
+        int64_t total_llc_misses = 0;
+
+        for ( i = 0; i < num_frames; ++i )
+        {
+            llc_misses_start();
+            double start_time = bench_time();
+            frame( packet_data );
+            double seconds = bench_time() - start_time;
+            int64_t llc_misses = llc_misses_stop();
+            total_seconds += seconds;
+            if ( seconds > max_seconds )
+                max_seconds = seconds;
+            total_llc_misses = ( llc_misses >= 0 && total_llc_misses >= 0 ) ? total_llc_misses + llc_misses : -1;
+        }
+
+        result->num_endpoints = n;
+        result->bytes_per_endpoint = (double) bytes_allocated / n;
+        result->frame_ms_avg = total_seconds * 1000.0 / num_frames;
+        result->frame_ms_max = max_seconds * 1000.0;
+        result->ns_per_endpoint = total_seconds * 1000000000.0 / num_frames / n;
+        result->llc_misses_per_endpoint = total_llc_misses >= 0 ? (double) total_llc_misses / num_frames / n : -1.0;
+    }
+
+    for ( i = 0; i < num_endpoints; ++i )
+        reliable_endpoint_destroy( endpoints[i] );
+
+    free( endpoints );
+    endpoints = NULL;
+    num_endpoints = 0;
+
+    return ok;
+}
+
+int main( int argc, char ** argv )
+{
+    int max_endpoints = 100000;
+    int num_frames = 30;
+    const char * output_filename = NULL;
+
+    int i;
+    for ( i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--max-endpoints" ) == 0 && i + 1 < argc )
+            max_endpoints = atoi( argv[++i] );
+        else if ( strcmp( argv[i], "--frames" ) == 0 && i + 1 < argc )
+            num_frames = atoi( argv[++i] );
+        else if ( strcmp( argv[i], "--output" ) == 0 && i + 1 < argc )
+            output_filename = argv[++i];
+        else
+            max_endpoints = 0;
+    }
+
+    if ( max_endpoints <= 0 || num_frames <= 0 )
+    {
+        printf( "usage: scaling_bench [--max-endpoints N] [--frames N] [--output file.json]\n" );
+        return 1;
+    }
+
+    reliable_init();
+
+    llc_misses_open();
+
+    printf( "[scaling_bench] default config, %d byte packets at %.0fHZ, %d frames per step\n\n", PACKET_BYTES, FRAME_RATE, num_frames );
+    printf( "endpoints    KB/endpoint    total MB    frame ms (avg / max)    60HZ budget    ns/endpoint    LLC misses/endpoint\n" );
+
+    const int steps[] = { 1, 10, 100, 1000, 3000, 10000, 30000, 100000 };
+    const int num_steps = (int) ( sizeof( steps ) / sizeof( steps[0] ) );
+
+    struct result_t results[sizeof( steps ) / sizeof( steps[0] )];
+    int num_results = 0;
+
+    for ( i = 0; i < num_steps && steps[i] <= max_endpoints; ++i )
+    {
+        struct result_t * r = results + num_results;
+        if ( !run( steps[i], num_frames, r ) )
+        {
+            printf( "%9d    could not create endpoints. out of memory?\n", steps[i] );
+            break;
+        }
+        num_results++;
+
+        char llc_misses[32];
+        if ( r->llc_misses_per_endpoint >= 0.0 )
+            snprintf( llc_misses, sizeof( llc_misses ), "%.1f", r->llc_misses_per_endpoint );
+        else
+            snprintf( llc_misses, sizeof( llc_misses ), "n/a" );
+
+        printf( "%9d    %11.1f    %8.1f    %8.3f / %8.3f    %10.1f%%    %11.0f    %19s\n",
+            r->num_endpoints, r->bytes_per_endpoint / 1024.0, r->bytes_per_endpoint * r->num_endpoints / ( 1024.0 * 1024.0 ),
+            r->frame_ms_avg, r->frame_ms_max, r->frame_ms_avg * FRAME_RATE / 10.0, r->ns_per_endpoint, llc_misses );
+        fflush( stdout );
+    }
+
+    if ( llc_misses_fd < 0 )
+        printf( "\nLLC misses are not available here (no perf_event_open, or kernel.perf_event_paranoid is too high)\n" );
+
+    if ( output_filename )
+    {
+        FILE * output = fopen( output_filename, "w" );
+        if ( !output )
+        {
+            printf( "error: could not open %s\n", output_filename );
+            return 1;
+        }
+
+        fprintf( output, "{\n" );
+        fprintf( output, "    \"packet_bytes\": %d,\n", PACKET_BYTES );
+        fprintf( output, "    \"frame_rate\": %.0f,\n", FRAME_RATE );
+        fprintf( output, "    \"frames\": %d,\n", num_frames );
+        fprintf( output, "    \"results\": [" );
+        for ( i = 0; i < num_results; ++i )
+        {
+            struct result_t * r = results + i;
+            fprintf( output, "%s\n        {\n", i > 0 ? "," : "" );
+            fprintf( output, "            \"endpoints\": %d,\n", r->num_endpoints );
+            fprintf( output, "            \"bytes_per_endpoint\": %.1f,\n", r->bytes_per_endpoint );
+            fprintf( output, "            \"frame_ms_avg\": %.4f,\n", r->frame_ms_avg );
+            fprintf( output, "            \"frame_ms_max\": %.4f,\n", r->frame_ms_max );
+            fprintf( output, "            \"ns_per_endpoint\": %.1f,\n", r->ns_per_endpoint );
+            if ( r->llc_misses_per_endpoint >= 0.0 )
+                fprintf( output, "            \"llc_misses_per_endpoint\": %.2f\n", r->llc_misses_per_endpoint );
+            else
+                fprintf( output, "            \"llc_misses_per_endpoint\": null\n" );
+            fprintf( output, "        }" );
+        }
+        fprintf( output, "\n    ]\n}\n" );
+        fclose( output );
+    }
+
+#if defined( __linux__ )
+    if ( llc_misses_fd >= 0 )
+        close( llc_misses_fd );
+#endif
+
+    reliable_term();
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Scaling benchmark for reliable_server_t. Connections are pairs of endpoints hosted by the same server and
+// talking over the same lossy loopback link as soak.c: every endpoint sends a packet each frame, the transmit
+// function puts datagrams in a per-shard outbox, and between frames the main thread routes them to the peer's
+// shard, the way a socket thread would. The same workload runs at 1, 2, 4, 8 and 16 threads.
+//
+// Usage: server_bench [num_connections] [num_frames] [max_threads]
+
+#include "reliable_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined( _WIN32 )
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define MAX_PACKET_BYTES 1200
+#define MAX_DATAGRAM_BYTES 1500
+#define MAX_THREADS 16
+
+static double bench_time()
+{
+#if defined( _WIN32 )
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &counter );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+// datagrams sent by the endpoints of one shard during a frame. only that shard's worker writes to it
+
+struct outbox_t
+{
+    uint8_t * data;
+    size_t bytes;
+    size_t capacity;
+    uint8_t padding[64];
+};
+
+struct outbox_header_t
+{
+    uint64_t id;
+    int packet_bytes;
+    int padding;
+};
+
+struct bench_t
+{
+    struct reliable_server_t * server;
+    struct outbox_t outboxes[MAX_THREADS];
+    int failed;
+};
+
+static struct bench_t bench;
+
+// 5% loss like soak.c, but from a hash instead of rand() so it's thread safe and the same at every thread count
+
+static int packet_lost( uint64_t id, uint16_t sequence, int packet_bytes )
+{
+    uint32_t hash = (uint32_t) ( id * 0x9E3779B1u ) ^ ( (uint32_t) sequence * 0x85EBCA6Bu ) ^ (uint32_t) packet_bytes;
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+    return ( hash % 100 ) < 5;
+}
+
+static void transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+
+    if ( packet_lost( id, sequence, packet_bytes ) )
+        return;
+
+    struct outbox_t * outbox = bench.outboxes + reliable_server_shard( bench.server, id );
+
+    size_t bytes = sizeof( struct outbox_header_t ) + packet_bytes;
+    if ( outbox->bytes + bytes > outbox->capacity )
+    {
+        outbox->capacity = ( outbox->capacity + bytes ) * 2;
+        outbox->data = (uint8_t*) realloc( outbox->data, outbox->capacity );
+        assert( outbox->data );
+    }
+
+    struct outbox_header_t header;
+    header.id = id;
+    header.packet_bytes = packet_bytes;
+    header.padding = 0;
+    memcpy( outbox->data + outbox->bytes, &header, sizeof( header ) );
+    memcpy( outbox->data + outbox->bytes + sizeof( header ), packet_data, packet_bytes );
+    outbox->bytes += bytes;
+}
+
+static int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
+{
+    int packet_bytes = ( ( (int)sequence * 1023 ) % ( MAX_PACKET_BYTES - 2 ) ) + 2;
+    packet_data[0] = (uint8_t) ( sequence & 0xFF );
+    packet_data[1] = (uint8_t) ( (sequence>>8) & 0xFF );
+    int i;
+    for ( i = 2; i < packet_bytes; ++i )
+    {
+        packet_data[i] = (uint8_t) ( ( (int)i + sequence ) % 256 );
+    }
+    return packet_bytes;
+}
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+
+    uint16_t packet_sequence = (uint16_t) ( packet_data[0] | ( packet_data[1] << 8 ) );
+    int valid = packet_bytes == ( ( (int)packet_sequence * 1023 ) % ( MAX_PACKET_BYTES - 2 ) ) + 2;
+    int i;
+    for ( i = 2; valid && i < packet_bytes; ++i )
+    {
+        valid = packet_data[i] == (uint8_t) ( ( (int)i + packet_sequence ) % 256 );
+    }
+
+    if ( !valid )
+    {
+        printf( "error: corrupt packet received by endpoint %d\n", (int) id );
+        bench.failed = 1;
+    }
+
+    return 1;
+}
+
+// runs on the worker that owns the endpoint
+
+static void update_function( void * context, int shard, struct reliable_endpoint_t * endpoint, double time )
+{
+    (void) context;
+    (void) shard;
+    (void) time;
+
+    uint8_t packet_data[MAX_PACKET_BYTES];
+    uint16_t sequence = reliable_endpoint_next_packet_sequence( endpoint );
+    int packet_bytes = generate_packet_data( sequence, packet_data );
+    reliable_endpoint_send_packet( endpoint, packet_data, packet_bytes );
+}
+
+static double run( int num_threads, int num_connections, int num_frames, uint64_t * num_packets_received )
+{
+    struct reliable_server_config_t server_config;
+    reliable_server_default_config( &server_config );
+    server_config.num_threads = num_threads;
+    server_config.max_endpoints = num_connections * 2;
+    server_config.max_packet_bytes = MAX_DATAGRAM_BYTES;
+    server_config.update_function = update_function;
+
+    // every endpoint sends at most two fragments per-frame
+
+    server_config.receive_ring_size = 1;
+    while ( server_config.receive_ring_size < ( num_connections * 2 / num_threads + 1 ) * 2 )
+        server_config.receive_ring_size *= 2;
+
+    memset( &bench, 0, sizeof( bench ) );
+
+    bench.server = reliable_server_create( &server_config );
+    if ( !bench.server )
+    {
+        printf( "error: could not create server with %d threads\n", num_threads );
+        exit( 1 );
+    }
+
+    double time = 100.0;
+
+    int i;
+    for ( i = 0; i < num_connections * 2; ++i )
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.fragment_above = 500;
+        config.id = (uint64_t) i;
+        config.transmit_packet_function = transmit_packet_function;
+        config.process_packet_function = process_packet_function;
+        reliable_server_add_endpoint( bench.server, &config, time );
+    }
+
+    double start_time = bench_time();
+
+    int frame;
+    for ( frame = 0; frame < num_frames; ++frame )
+    {
+        reliable_server_update( bench.server, time );
+
+        // route each datagram to the other endpoint of its connection
+
+        int j;
+        for ( j = 0; j < num_threads; ++j )
+        {
+            struct outbox_t * outbox = bench.outboxes + j;
+            size_t offset = 0;
+            while ( offset < outbox->bytes )
+            {
+                struct outbox_header_t header;
+                memcpy( &header, outbox->data + offset, sizeof( header ) );
+                offset += sizeof( header );
+                reliable_server_route_packet( bench.server, header.id ^ 1, outbox->data + offset, header.packet_bytes );
+                offset += header.packet_bytes;
+            }
+            outbox->bytes = 0;
+        }
+
+        time += 1.0 / 60.0;
+    }
+
+    double elapsed = bench_time() - start_time;
+
+    uint64_t server_counters[RELIABLE_SERVER_NUM_COUNTERS];
+    reliable_server_counters( bench.server, server_counters );
+    if ( server_counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_RING_FULL] || server_counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_TOO_LARGE] ||
+         server_counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_UNKNOWN_ENDPOINT] )
+    {
+        printf( "error: server dropped packets\n" );
+        bench.failed = 1;
+    }
+
+    *num_packets_received = 0;
+    for ( i = 0; i < num_connections * 2; ++i )
+    {
+        RELIABLE_CONST uint64_t * counters = reliable_endpoint_counters( reliable_server_endpoint( bench.server, (uint64_t) i ) );
+        *num_packets_received += counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED];
+        if ( num_frames >= 60 && counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] == 0 )
+        {
+            printf( "error: endpoint %d has no acks\n", i );
+            bench.failed = 1;
+        }
+    }
+
+    reliable_server_destroy( bench.server );
+
+    for ( i = 0; i < MAX_THREADS; ++i )
+        free( bench.outboxes[i].data );
+
+    return elapsed;
+}
+
+int main( int argc, char ** argv )
+{
+    int num_connections = 1024;
+    int num_frames = 300;
+    int max_threads = MAX_THREADS;
+
+    if ( argc >= 2 )
+        num_connections = atoi( argv[1] );
+    if ( argc >= 3 )
+        num_frames = atoi( argv[2] );
+    if ( argc >= 4 )
+        max_threads = atoi( argv[3] );
+
+    if ( num_connections <= 0 || num_frames <= 0 || max_threads <= 0 || max_threads > MAX_THREADS )
+    {
+        printf( "usage: server_bench [num_connections] [num_frames] [max_threads <= %d]\n", MAX_THREADS );
+        return 1;
+    }
+
+    reliable_init();
+
+    printf( "[server_bench] %d endpoints, %d frames\n\n", num_connections * 2, num_frames );
+    printf( "threads    seconds    frame ms    packets/sec    speedup\n" );
+
+    double single_thread_seconds = 0.0;
+
+    int num_threads;
+    for ( num_threads = 1; num_threads <= max_threads; num_threads *= 2 )
+    {
+        uint64_t num_packets_received;
+        double seconds = run( num_threads, num_connections, num_frames, &num_packets_received );
+
+        if ( num_threads == 1 )
+            single_thread_seconds = seconds;
+
+        printf( "%7d    %7.3f    %8.3f    %11.0f    %6.2fx\n", num_threads, seconds, seconds * 1000.0 / num_frames, num_packets_received / seconds, single_thread_seconds / seconds );
+
+        if ( bench.failed )
+            break;
+    }
+
+    reliable_term();
+
+    if ( bench.failed )
+    {
+        printf( "\nFAILED\n" );
+        return 1;
+    }
+
+    return 0;
+}
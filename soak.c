@@ -23,6 +23,7 @@
 */
 
 #include "reliable.h"
+#include "reliable_sim.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
@@ -41,42 +42,28 @@ void interrupt_handler( int signal )
     quit = 1;
 }
 
-int random_int( int a, int b )
-{
-    assert( a < b );
-    int result = a + rand() % ( b - a + 1 );
-    assert( result >= a );
-    assert( result <= b );
-    return result;
-}
-
 struct test_context_t
 {
     struct reliable_endpoint_t * client;
     struct reliable_endpoint_t * server;
+    struct reliable_sim_t * sim;
 };
 
 double global_time = 100.0;
 
 struct test_context_t global_context;
 
+int global_mtu = 0;
+
+int global_num_iterations = 0;
+
 void test_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
 {
     (void) sequence;
 
     struct test_context_t * context = (struct test_context_t*) _context;
 
-    if ( random_int(0,100) < 5 )
-        return;
-
-    if ( id == 0 )
-    {
-        reliable_endpoint_receive_packet( context->server, packet_data, packet_bytes );
-    }
-    else if ( id == 1 )
-    {
-        reliable_endpoint_receive_packet( context->client, packet_data, packet_bytes );
-    }
+    reliable_sim_send( context->sim, id == 0 ? 1 : 0, packet_data, packet_bytes );
 }
 
 int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
@@ -161,6 +148,16 @@ void soak_initialize( int quiet )
     }
 
     memset( &global_context, 0, sizeof( global_context ) );
+
+    // 5% packet loss. with --mtu, anything larger is silently dropped, like a tunnel with a small mtu would
+
+    struct reliable_sim_config_t sim_config;
+    reliable_sim_default_config( &sim_config );
+    sim_config.max_packet_bytes = 2048;
+    sim_config.packet_loss = 5.0f;
+    sim_config.mtu = global_mtu;
+
+    global_context.sim = reliable_sim_create( &sim_config, global_time );
     
     struct reliable_config_t client_config;
     struct reliable_config_t server_config;
@@ -171,6 +168,21 @@ void soak_initialize( int quiet )
     client_config.fragment_above = 500;
     server_config.fragment_above = 500;
 
+    if ( global_mtu > 0 )
+    {
+        printf( "mtu clamp is %d bytes\n", global_mtu );
+
+        client_config.fragment_above = 1400;
+        client_config.fragment_size = 1400;
+        client_config.max_fragments = 64;
+        client_config.mtu_probing = 1;
+
+        server_config.fragment_above = 1400;
+        server_config.fragment_size = 1400;
+        server_config.max_fragments = 64;
+        server_config.mtu_probing = 1;
+    }
+
     reliable_copy_string( client_config.name, "client", sizeof( client_config.name ) );
     client_config.context = &global_context;
     client_config.id = 0;
@@ -189,11 +201,32 @@ void soak_initialize( int quiet )
 
 void soak_shutdown()
 {
+    if ( global_mtu > 0 )
+    {
+        int client_mtu = reliable_endpoint_mtu( global_context.client );
+        int server_mtu = reliable_endpoint_mtu( global_context.server );
+
+        printf( "discovered mtu: client = %d bytes, server = %d bytes\n", client_mtu, server_mtu );
+
+        check( client_mtu <= global_mtu );
+        check( server_mtu <= global_mtu );
+
+        // plenty of time to finish the search, even with the packet loss
+
+        if ( global_num_iterations >= 1000 )
+        {
+            check( client_mtu > global_mtu - 64 );
+            check( server_mtu > global_mtu - 64 );
+        }
+    }
+
     printf( "shutdown\n" );
 
     reliable_endpoint_destroy( global_context.client );
     reliable_endpoint_destroy( global_context.server );
 
+    reliable_sim_destroy( global_context.sim );
+
     reliable_term();
 }
 
@@ -212,17 +245,32 @@ void soak_iteration( double time )
     packet_bytes = generate_packet_data( sequence, packet_data );
     reliable_endpoint_send_packet( global_context.server, packet_data, packet_bytes );
 
+    reliable_sim_update( global_context.sim, time );
+
+    uint64_t to;
+    uint8_t * received_packet_data;
+    while ( ( received_packet_data = reliable_sim_receive( global_context.sim, &to, &packet_bytes ) ) != NULL )
+    {
+        reliable_endpoint_receive_packet( to == 0 ? global_context.client : global_context.server, received_packet_data, packet_bytes );
+    }
+
     reliable_endpoint_update( global_context.client, time );
     reliable_endpoint_update( global_context.server, time );
 
     reliable_endpoint_clear_acks( global_context.client );
     reliable_endpoint_clear_acks( global_context.server );
+
+    reliable_capture_flush();
+
+    global_num_iterations++;
 }
 
 int main( int argc, char ** argv )
 {
     int num_iterations = -1;
     int quiet = 0;
+    const char * capture_filename = NULL;
+    int capture_pcapng = 0;
 
     int i;
     for ( i = 1; i < argc; ++i )
@@ -231,12 +279,31 @@ int main( int argc, char ** argv )
         {
             quiet = 1;
         }
+        else if ( strcmp( argv[i], "--mtu" ) == 0 && i + 1 < argc )
+        {
+            global_mtu = atoi( argv[++i] );
+        }
+        else if ( strcmp( argv[i], "--capture" ) == 0 && i + 1 < argc )
+        {
+            capture_filename = argv[++i];
+        }
+        else if ( strcmp( argv[i], "--pcapng" ) == 0 && i + 1 < argc )
+        {
+            capture_filename = argv[++i];
+            capture_pcapng = 1;
+        }
         else
         {
             num_iterations = atoi( argv[i] );
         }
     }
 
+    if ( capture_filename && ( capture_pcapng ? reliable_capture_start_pcapng( capture_filename, -1 ) : reliable_capture_start( capture_filename, -1 ) ) != RELIABLE_OK )
+    {
+        printf( "error: could not capture to %s\n", capture_filename );
+        return 1;
+    }
+
     soak_initialize( quiet );
 
     signal( SIGINT, interrupt_handler );
@@ -23,6 +23,7 @@
 */
 
 #include "reliable.h"
+#include "reliable_sim.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -55,6 +56,7 @@ struct test_context_t
 {
     struct reliable_endpoint_t * client;
     struct reliable_endpoint_t * server;
+    struct reliable_sim_t * sim;
 };
 
 double global_time = 100.0;
@@ -67,17 +69,7 @@ void test_transmit_packet_function( void * _context, uint64_t id, uint16_t seque
 
     struct test_context_t * context = (struct test_context_t*) _context;
 
-    if ( ( sequence % 5 ) == 0 )
-        return;
-
-    if ( id == 0 )
-    {
-        reliable_endpoint_receive_packet( context->server, packet_data, packet_bytes );
-    }
-    else if ( id == 1 )
-    {
-        reliable_endpoint_receive_packet( context->client, packet_data, packet_bytes );
-    }
+    reliable_sim_send( context->sim, id == 0 ? 1 : 0, packet_data, packet_bytes );
 }
 
 int generate_packet_data( uint16_t sequence, uint8_t * packet_data )
@@ -155,6 +147,16 @@ void stats_initialize()
     reliable_init();
 
     memset( &global_context, 0, sizeof( global_context ) );
+
+    // 50ms each way with a little jitter and 20% packet loss, so there is something to see
+
+    struct reliable_sim_config_t sim_config;
+    reliable_sim_default_config( &sim_config );
+    sim_config.latency = 0.05;
+    sim_config.jitter = 0.005;
+    sim_config.packet_loss = 20.0f;
+
+    global_context.sim = reliable_sim_create( &sim_config, global_time );
     
     struct reliable_config_t client_config;
     struct reliable_config_t server_config;
@@ -188,6 +190,8 @@ void stats_shutdown()
     reliable_endpoint_destroy( global_context.client );
     reliable_endpoint_destroy( global_context.server );
 
+    reliable_sim_destroy( global_context.sim );
+
     reliable_term();
 }
 
@@ -206,6 +210,15 @@ void stats_iteration( double time )
     packet_bytes = generate_packet_data( sequence, packet_data );
     reliable_endpoint_send_packet( global_context.server, packet_data, packet_bytes );
 
+    reliable_sim_update( global_context.sim, time );
+
+    uint64_t to;
+    uint8_t * received_packet_data;
+    while ( ( received_packet_data = reliable_sim_receive( global_context.sim, &to, &packet_bytes ) ) != NULL )
+    {
+        reliable_endpoint_receive_packet( to == 0 ? global_context.client : global_context.server, received_packet_data, packet_bytes );
+    }
+
     reliable_endpoint_update( global_context.client, time );
     reliable_endpoint_update( global_context.server, time );
 
@@ -23,11 +23,1456 @@
 */
 
 #include "reliable.h"
+#include "reliable.hpp"
+#include "reliable_server.h"
+#include "reliable_sim.h"
+#if defined( __linux__ )
+#include "reliable_udp.h"
+#endif // #if defined( __linux__ )
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 extern "C" void reliable_test();
 
+static void test_fail( const char * format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    printf( "error: " );
+    vprintf( format, args );
+    printf( "\n" );
+    va_end( args );
+    exit( 1 );
+}
+
+// the send queue is the only part of an endpoint that other threads may touch, so it's tested here with real threads.
+// several producers queue packets tagged with their id and a counter while the main thread pumps the endpoint.
+// every packet must arrive exactly once, and each producer's packets must arrive in the order they were queued
+
+#define SEND_QUEUE_NUM_PRODUCERS 4
+#define SEND_QUEUE_PACKETS_PER_PRODUCER 20000
+
+struct send_queue_context_t
+{
+    struct reliable_endpoint_t * receiver;
+    uint32_t next_counter[SEND_QUEUE_NUM_PRODUCERS];
+    int num_packets_received;
+};
+
+static void send_queue_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    send_queue_context_t * context = (send_queue_context_t*) _context;
+    if ( context->receiver )
+        reliable_endpoint_receive_packet( context->receiver, packet_data, packet_bytes );
+}
+
+static int send_queue_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    send_queue_context_t * context = (send_queue_context_t*) _context;
+    if ( packet_bytes != 5 || packet_data[0] >= SEND_QUEUE_NUM_PRODUCERS )
+        test_fail( "unexpected packet in send queue test" );
+    uint32_t counter;
+    memcpy( &counter, packet_data + 1, 4 );
+    if ( counter != context->next_counter[packet_data[0]] )
+        test_fail( "producer %d packet %u arrived out of order (expected %u)", packet_data[0], counter, context->next_counter[packet_data[0]] );
+    context->next_counter[packet_data[0]]++;
+    context->num_packets_received++;
+    return 1;
+}
+
+static void test_send_queue_threads()
+{
+    printf( "test_send_queue_threads\n" );
+
+    send_queue_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_config_t sender_config;
+    struct reliable_config_t receiver_config;
+    reliable_default_config( &sender_config );
+    reliable_default_config( &receiver_config );
+
+    sender_config.send_queue_size = 256;
+    sender_config.context = &context;
+    sender_config.transmit_packet_function = send_queue_transmit_packet_function;
+    sender_config.process_packet_function = send_queue_process_packet_function;
+
+    receiver_config.context = &context;
+    receiver_config.transmit_packet_function = send_queue_transmit_packet_function;
+    receiver_config.process_packet_function = send_queue_process_packet_function;
+
+    double time = 100.0;
+
+    struct reliable_endpoint_t * sender = reliable_endpoint_create( &sender_config, time );
+    context.receiver = reliable_endpoint_create( &receiver_config, time );
+
+    std::vector<std::thread> producers;
+    for ( int i = 0; i < SEND_QUEUE_NUM_PRODUCERS; ++i )
+    {
+        producers.emplace_back( [sender, i]()
+        {
+            for ( uint32_t counter = 0; counter < SEND_QUEUE_PACKETS_PER_PRODUCER; ++counter )
+            {
+                uint8_t * packet_data = (uint8_t*) reliable_endpoint_allocate_packet( sender, 5 );
+                packet_data[0] = (uint8_t) i;
+                memcpy( packet_data + 1, &counter, 4 );
+                while ( reliable_endpoint_queue_packet( sender, packet_data, 5 ) != RELIABLE_OK )
+                {
+                    std::this_thread::yield();
+                }
+            }
+        } );
+    }
+
+    const int total_packets = SEND_QUEUE_NUM_PRODUCERS * SEND_QUEUE_PACKETS_PER_PRODUCER;
+
+    while ( context.num_packets_received < total_packets )
+    {
+        if ( reliable_endpoint_pump( sender ) == 0 )
+        {
+            std::this_thread::yield();
+        }
+        reliable_endpoint_update( sender, time );
+        time += 0.001;
+    }
+
+    for ( auto & producer : producers )
+        producer.join();
+
+    if ( reliable_endpoint_pump( sender ) != 0 || reliable_endpoint_counters( sender )[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] != (uint64_t) total_packets )
+        test_fail( "send queue sent the wrong number of packets" );
+
+    reliable_endpoint_destroy( sender );
+    reliable_endpoint_destroy( context.receiver );
+}
+
+// a monitoring thread reads counters and snapshots while the main thread drives traffic. every snapshot must be internally
+// consistent (nothing is acked before it is sent) and snapshots and counters must never go backwards. run under tsan to check for races
+
+static void snapshot_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+    struct reliable_endpoint_t ** endpoints = (struct reliable_endpoint_t**) _context;
+    if ( ( sequence % 10 ) != 0 )
+        reliable_endpoint_receive_packet( endpoints[id^1], packet_data, packet_bytes );
+}
+
+static int snapshot_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) _context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+static void test_snapshot_threads()
+{
+    printf( "test_snapshot_threads\n" );
+
+    struct reliable_endpoint_t * endpoints[2];
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.context = endpoints;
+    config.transmit_packet_function = snapshot_transmit_packet_function;
+    config.process_packet_function = snapshot_process_packet_function;
+
+    double time = 100.0;
+
+    config.id = 0;
+    endpoints[0] = reliable_endpoint_create( &config, time );
+    config.id = 1;
+    endpoints[1] = reliable_endpoint_create( &config, time );
+
+    std::atomic<bool> done( false );
+    int num_snapshots = 0;
+
+    std::thread monitor( [&]()
+    {
+        uint64_t last_sent = 0;
+        uint64_t last_counter = 0;
+        double last_time = 0.0;
+        while ( !done.load() )
+        {
+            struct reliable_endpoint_snapshot_t snapshot;
+            reliable_endpoint_snapshot( endpoints[0], &snapshot );
+            if ( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] > snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] ||
+                 snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] < last_sent || snapshot.time < last_time )
+                test_fail( "inconsistent snapshot" );
+            last_sent = snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT];
+            last_time = snapshot.time;
+
+            uint64_t counter = reliable_endpoint_counter( endpoints[0], RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT );
+            if ( counter < last_counter )
+                test_fail( "counter went backwards" );
+            last_counter = counter;
+
+            num_snapshots++;
+        }
+    } );
+
+    uint8_t packet_data[64];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    for ( int i = 0; i < 20000; ++i )
+    {
+        reliable_endpoint_send_packet( endpoints[0], packet_data, sizeof( packet_data ) );
+        reliable_endpoint_send_packet( endpoints[1], packet_data, sizeof( packet_data ) );
+        time += 0.01;
+        reliable_endpoint_update( endpoints[0], time );
+        reliable_endpoint_update( endpoints[1], time );
+        reliable_endpoint_clear_acks( endpoints[0] );
+        reliable_endpoint_clear_acks( endpoints[1] );
+    }
+
+    done.store( true );
+    monitor.join();
+
+    struct reliable_endpoint_snapshot_t snapshot;
+    reliable_endpoint_snapshot( endpoints[0], &snapshot );
+    if ( snapshot.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_SENT] != 20000 || num_snapshots == 0 )
+        test_fail( "final snapshot is wrong" );
+
+    reliable_endpoint_destroy( endpoints[0] );
+    reliable_endpoint_destroy( endpoints[1] );
+}
+
+// adds and removes endpoints on a multi-threaded server, checking lookups survive removal, then routes packets between them
+
+struct server_context_t
+{
+    struct reliable_server_t * server;
+    int num_packets_received[256];
+};
+
+static void server_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) _context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+}
+
+static int server_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    server_context_t * context = (server_context_t*) _context;
+    context->num_packets_received[id]++;
+    return 1;
+}
+
+static void test_server()
+{
+    printf( "test_server\n" );
+
+    server_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_server_config_t server_config;
+    reliable_server_default_config( &server_config );
+    server_config.num_threads = 3;
+    server_config.max_endpoints = 256;
+    server_config.receive_ring_size = 128;
+
+    context.server = reliable_server_create( &server_config );
+    if ( !context.server )
+        test_fail( "could not create server" );
+
+    double time = 100.0;
+
+    for ( int i = 0; i < 256; ++i )
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.id = (uint64_t) i;
+        config.context = &context;
+        config.transmit_packet_function = server_transmit_packet_function;
+        config.process_packet_function = server_process_packet_function;
+        if ( !reliable_server_add_endpoint( context.server, &config, time ) )
+            test_fail( "could not add endpoint" );
+    }
+
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.id = 1000;
+        if ( reliable_server_add_endpoint( context.server, &config, time ) )
+            test_fail( "added an endpoint to a full server" );
+    }
+
+    for ( int i = 0; i < 256; i += 3 )
+    {
+        if ( reliable_server_remove_endpoint( context.server, (uint64_t) i ) != RELIABLE_OK )
+            test_fail( "could not remove endpoint" );
+    }
+
+    if ( reliable_server_remove_endpoint( context.server, 0 ) != RELIABLE_ERROR )
+        test_fail( "removed an endpoint twice" );
+
+    for ( int i = 0; i < 256; ++i )
+    {
+        struct reliable_endpoint_t * endpoint = reliable_server_endpoint( context.server, (uint64_t) i );
+        if ( ( endpoint == NULL ) != ( ( i % 3 ) == 0 ) )
+            test_fail( "endpoint lookup is wrong after removal" );
+    }
+
+    // a packet for every id, removed or not, in each of several frames
+
+    uint8_t packet_data[8];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    for ( int frame = 0; frame < 4; ++frame )
+    {
+        for ( int i = 0; i < 256; ++i )
+        {
+            // sequence number in the packet header, so each is a new packet
+            packet_data[1] = (uint8_t) frame;
+            if ( reliable_server_route_packet( context.server, (uint64_t) i, packet_data, sizeof( packet_data ) ) != RELIABLE_OK )
+                test_fail( "could not route packet" );
+        }
+
+        reliable_server_update( context.server, time );
+
+        time += 0.01;
+    }
+
+    for ( int i = 0; i < 256; ++i )
+    {
+        if ( context.num_packets_received[i] != ( ( i % 3 ) == 0 ? 0 : 4 ) )
+            test_fail( "endpoint received the wrong number of packets" );
+    }
+
+    uint64_t counters[RELIABLE_SERVER_NUM_COUNTERS];
+    reliable_server_counters( context.server, counters );
+    if ( counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_ROUTED] != 4 * 256 || counters[RELIABLE_SERVER_COUNTER_NUM_PACKETS_UNKNOWN_ENDPOINT] != 4 * 86 )
+        test_fail( "server counters are wrong" );
+
+    reliable_server_destroy( context.server );
+}
+
+// each thread that logs in binary mode writes to its own ring, which a consumer drains concurrently. records may be
+// dropped when a ring fills, but the ones that come through must be whole and in the order each endpoint logged them
+
+#define LOG_NUM_WRITERS 4
+#define LOG_PACKETS_PER_WRITER 20000
+
+static void log_transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+}
+
+static int log_process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    return 1;
+}
+
+static void test_log_threads()
+{
+    printf( "test_log_threads\n" );
+
+    struct reliable_log_record_t records[256];
+    while ( reliable_log_read( records, 256 ) > 0 ) {}
+
+    reliable_log_level( RELIABLE_LOG_LEVEL_DEBUG );
+    reliable_log_mode( RELIABLE_LOG_MODE_BINARY );
+
+    std::atomic<int> num_writers_done( 0 );
+    std::vector<std::thread> writers;
+
+    for ( int i = 0; i < LOG_NUM_WRITERS; ++i )
+    {
+        writers.push_back( std::thread( [i]()
+        {
+            struct reliable_config_t config;
+            reliable_default_config( &config );
+            config.id = (uint64_t) i;
+            config.transmit_packet_function = log_transmit_packet_function;
+            config.process_packet_function = log_process_packet_function;
+
+            struct reliable_endpoint_t * endpoint = reliable_endpoint_create( &config, 100.0 );
+
+            uint8_t packet_data[32];
+            memset( packet_data, 0, sizeof( packet_data ) );
+            for ( int j = 0; j < LOG_PACKETS_PER_WRITER; ++j )
+                reliable_endpoint_send_packet( endpoint, packet_data, sizeof( packet_data ) );
+
+            reliable_endpoint_destroy( endpoint );
+        } ) );
+    }
+
+    int next_sequence[LOG_NUM_WRITERS] = { 0 };
+    int num_received = 0;
+
+    std::thread consumer( [&]()
+    {
+        while ( true )
+        {
+            bool writers_done = num_writers_done.load() == LOG_NUM_WRITERS;
+            int num_records = reliable_log_read( records, 256 );
+            for ( int i = 0; i < num_records; ++i )
+            {
+                if ( records[i].endpoint_id >= LOG_NUM_WRITERS || records[i].level != RELIABLE_LOG_LEVEL_DEBUG )
+                    test_fail( "corrupt log record" );
+                if ( records[i].event != RELIABLE_LOG_EVENT_SEND_PACKET )
+                    continue;
+                int id = (int) records[i].endpoint_id;
+                if ( records[i].sequence < next_sequence[id] )
+                    test_fail( "log records out of order" );
+                next_sequence[id] = records[i].sequence + 1;
+                num_received++;
+            }
+            if ( writers_done && num_records == 0 )
+                break;
+        }
+    } );
+
+    for ( int i = 0; i < LOG_NUM_WRITERS; ++i )
+    {
+        writers[i].join();
+        num_writers_done++;
+    }
+
+    consumer.join();
+
+    reliable_log_level( RELIABLE_LOG_LEVEL_NONE );
+    reliable_log_mode( RELIABLE_LOG_MODE_PRINTF );
+
+    if ( num_received == 0 || num_received > LOG_NUM_WRITERS * LOG_PACKETS_PER_WRITER )
+        test_fail( "wrong number of log records" );
+}
+
+// server workers add to their own aggregator shards while an exporter thread reads the totals. every read must be
+// at least the one before, and once the workers are idle the totals must match the endpoints exactly
+
+#define STATS_NUM_ENDPOINTS 96
+#define STATS_NUM_FRAMES 200
+
+static void test_stats_threads()
+{
+    printf( "test_stats_threads\n" );
+
+    server_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_server_config_t server_config;
+    reliable_server_default_config( &server_config );
+    server_config.num_threads = 3;
+    server_config.max_endpoints = STATS_NUM_ENDPOINTS;
+    server_config.receive_ring_size = 128;
+    server_config.stats_aggregator = reliable_stats_aggregator_create( server_config.num_threads, NULL, NULL, NULL );
+    if ( !server_config.stats_aggregator )
+        test_fail( "could not create stats aggregator" );
+
+    context.server = reliable_server_create( &server_config );
+    if ( !context.server )
+        test_fail( "could not create server" );
+
+    double time = 100.0;
+
+    for ( int i = 0; i < STATS_NUM_ENDPOINTS; ++i )
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.id = (uint64_t) i;
+        config.context = &context;
+        config.transmit_packet_function = server_transmit_packet_function;
+        config.process_packet_function = server_process_packet_function;
+        if ( !reliable_server_add_endpoint( context.server, &config, time ) )
+            test_fail( "could not add endpoint" );
+    }
+
+    std::atomic<bool> quit( false );
+    bool went_backwards = false;
+
+    std::thread exporter( [&]()
+    {
+        uint64_t last_received = 0;
+        while ( !quit.load() )
+        {
+            struct reliable_stats_t stats;
+            reliable_stats_aggregator_read( server_config.stats_aggregator, &stats );
+            uint64_t received = stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED];
+            if ( received < last_received || stats.num_endpoints != STATS_NUM_ENDPOINTS )
+                went_backwards = true;
+            last_received = received;
+        }
+    } );
+
+    uint8_t packet_data[8];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    for ( int frame = 0; frame < STATS_NUM_FRAMES; ++frame )
+    {
+        for ( int i = 0; i < STATS_NUM_ENDPOINTS; ++i )
+        {
+            packet_data[1] = (uint8_t) frame;
+            if ( reliable_server_route_packet( context.server, (uint64_t) i, packet_data, sizeof( packet_data ) ) != RELIABLE_OK )
+                test_fail( "could not route packet" );
+        }
+
+        reliable_server_update( context.server, time );
+
+        time += 0.01;
+    }
+
+    quit.store( true );
+    exporter.join();
+
+    if ( went_backwards )
+        test_fail( "stats went backwards while the server was updating" );
+
+    struct reliable_stats_t stats;
+    reliable_stats_aggregator_read( server_config.stats_aggregator, &stats );
+
+    for ( int counter = 0; counter < RELIABLE_ENDPOINT_NUM_COUNTERS; ++counter )
+    {
+        uint64_t total = 0;
+        for ( int i = 0; i < STATS_NUM_ENDPOINTS; ++i )
+            total += reliable_endpoint_counters( reliable_server_endpoint( context.server, (uint64_t) i ) )[counter];
+        if ( stats.counters[counter] != total )
+            test_fail( "aggregated counters don't match the endpoints" );
+    }
+
+    if ( stats.counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_RECEIVED] != STATS_NUM_ENDPOINTS * STATS_NUM_FRAMES )
+        test_fail( "wrong number of packets received" );
+
+    reliable_server_destroy( context.server );
+
+    reliable_stats_aggregator_read( server_config.stats_aggregator, &stats );
+    if ( stats.num_endpoints != 0 )
+        test_fail( "destroyed endpoints are still in the stats" );
+
+    reliable_stats_aggregator_destroy( server_config.stats_aggregator );
+}
+
+// the simulated network must be reproducible from its seed, and each impairment must do what it says
+
+static uint64_t test_sim_run( uint64_t seed )
+{
+    struct reliable_sim_config_t config;
+    reliable_sim_default_config( &config );
+    config.seed = seed;
+    config.latency = 0.05;
+    config.jitter = 0.03;
+    config.packet_loss = 5.0f;
+    config.burst_enter = 2.0f;
+    config.burst_exit = 25.0f;
+    config.burst_loss = 50.0f;
+    config.duplicate = 5.0f;
+    config.corrupt = 10.0f;
+
+    double time = 100.0;
+
+    struct reliable_sim_t * sim = reliable_sim_create( &config, time );
+
+    // fnv-1a over everything delivered, in the order it was delivered
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    uint8_t packet_data[256];
+    for ( int frame = 0; frame < 500; ++frame )
+    {
+        for ( int i = 0; i < 4; ++i )
+        {
+            memset( packet_data, frame + i, sizeof( packet_data ) );
+            reliable_sim_send( sim, (uint64_t) i, packet_data, 1 + ( frame * 7 + i ) % 256 );
+        }
+
+        time += 1.0 / 60.0;
+        reliable_sim_update( sim, time );
+
+        uint64_t to;
+        int packet_bytes;
+        uint8_t * received_packet_data;
+        while ( ( received_packet_data = reliable_sim_receive( sim, &to, &packet_bytes ) ) != NULL )
+        {
+            hash = ( hash ^ to ) * 1099511628211ULL;
+            for ( int i = 0; i < packet_bytes; ++i )
+                hash = ( hash ^ received_packet_data[i] ) * 1099511628211ULL;
+        }
+    }
+
+    RELIABLE_CONST uint64_t * counters = reliable_sim_counters( sim );
+    if ( counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_LOST] == 0 || counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_DUPLICATED] == 0 || counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_CORRUPTED] == 0 )
+        test_fail( "sim impairments did not happen" );
+
+    reliable_sim_destroy( sim );
+
+    return hash;
+}
+
+static void test_sim()
+{
+    printf( "test_sim\n" );
+
+    if ( test_sim_run( 1 ) != test_sim_run( 1 ) )
+        test_fail( "sim is not deterministic" );
+
+    if ( test_sim_run( 1 ) == test_sim_run( 2 ) )
+        test_fail( "sim ignores its seed" );
+
+    uint8_t packet_data[1000];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    uint64_t to;
+    int packet_bytes;
+
+    // latency holds datagrams back, then they arrive in the order they were sent
+
+    {
+        struct reliable_sim_config_t config;
+        reliable_sim_default_config( &config );
+        config.latency = 0.1;
+
+        struct reliable_sim_t * sim = reliable_sim_create( &config, 0.0 );
+
+        for ( int i = 0; i < 10; ++i )
+        {
+            packet_data[0] = (uint8_t) i;
+            reliable_sim_send( sim, 0, packet_data, 100 );
+        }
+
+        reliable_sim_update( sim, 0.09 );
+        if ( reliable_sim_receive( sim, &to, &packet_bytes ) != NULL )
+            test_fail( "datagram arrived before the latency" );
+
+        reliable_sim_update( sim, 0.1 );
+        for ( int i = 0; i < 10; ++i )
+        {
+            uint8_t * received_packet_data = reliable_sim_receive( sim, &to, &packet_bytes );
+            if ( !received_packet_data || received_packet_data[0] != i || packet_bytes != 100 )
+                test_fail( "datagrams arrived out of order without jitter" );
+        }
+
+        reliable_sim_destroy( sim );
+    }
+
+    // 80kbps is 10 bytes per-millisecond, so 1000 byte datagrams leave 100ms apart. the queue holds 5 of them
+
+    {
+        struct reliable_sim_config_t config;
+        reliable_sim_default_config( &config );
+        config.bandwidth_kbps = 80;
+        config.queue_bytes = 5000;
+        config.mtu = 1000;
+
+        struct reliable_sim_t * sim = reliable_sim_create( &config, 0.0 );
+
+        for ( int i = 0; i < 10; ++i )
+        {
+            reliable_sim_send( sim, 0, packet_data, 1000 );
+        }
+        reliable_sim_send( sim, 0, packet_data, 1001 );
+
+        RELIABLE_CONST uint64_t * counters = reliable_sim_counters( sim );
+        if ( counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_QUEUE_FULL] != 5 || counters[RELIABLE_SIM_COUNTER_NUM_PACKETS_TOO_LARGE] != 1 )
+            test_fail( "sim queue or mtu dropped the wrong datagrams" );
+
+        for ( int i = 1; i <= 5; ++i )
+        {
+            reliable_sim_update( sim, i * 0.1 - 0.001 );
+            if ( reliable_sim_receive( sim, &to, &packet_bytes ) != NULL )
+                test_fail( "datagram arrived faster than the bandwidth allows" );
+            reliable_sim_update( sim, i * 0.1 + 0.001 );
+            if ( reliable_sim_receive( sim, &to, &packet_bytes ) == NULL )
+                test_fail( "datagram held back longer than the bandwidth requires" );
+        }
+
+        reliable_sim_destroy( sim );
+    }
+
+    // the arena only holds max_packets datagrams
+
+    {
+        struct reliable_sim_config_t config;
+        reliable_sim_default_config( &config );
+        config.max_packets = 4;
+
+        struct reliable_sim_t * sim = reliable_sim_create( &config, 0.0 );
+
+        for ( int i = 0; i < 5; ++i )
+        {
+            reliable_sim_send( sim, 0, packet_data, 100 );
+        }
+
+        if ( reliable_sim_counters( sim )[RELIABLE_SIM_COUNTER_NUM_PACKETS_SIM_FULL] != 1 )
+            test_fail( "sim held more datagrams than max_packets" );
+
+        int num_received = 0;
+        while ( reliable_sim_receive( sim, &to, &packet_bytes ) != NULL )
+            num_received++;
+
+        if ( num_received != 4 )
+            test_fail( "sim lost datagrams it had room for" );
+
+        reliable_sim_destroy( sim );
+    }
+
+    // gilbert-elliott losses come in bursts. entering 1% of the time and leaving 10% of the time spends 1/11 of
+    // datagrams in a burst, with bursts 10 long on average
+
+    {
+        struct reliable_sim_config_t config;
+        reliable_sim_default_config( &config );
+        config.burst_enter = 1.0f;
+        config.burst_exit = 10.0f;
+        config.burst_loss = 100.0f;
+
+        struct reliable_sim_t * sim = reliable_sim_create( &config, 0.0 );
+
+        const int num_packets = 100000;
+        int num_lost = 0;
+        int num_bursts = 0;
+        int lost_last = 0;
+        for ( int i = 0; i < num_packets; ++i )
+        {
+            reliable_sim_send( sim, 0, packet_data, 100 );
+            int lost = reliable_sim_receive( sim, &to, &packet_bytes ) == NULL;
+            num_lost += lost;
+            num_bursts += lost && !lost_last;
+            lost_last = lost;
+        }
+
+        double loss = num_lost / (double) num_packets;
+        if ( loss < 0.07 || loss > 0.11 )
+            test_fail( "gilbert-elliott loss rate is wrong" );
+
+        if ( num_bursts == 0 || num_lost / (double) num_bursts < 7.0 )
+            test_fail( "gilbert-elliott losses are not bursty" );
+
+        reliable_sim_destroy( sim );
+    }
+}
+
+// a reliable::Endpoint must be the same endpoint on the wire as one configured at runtime. a templated client and a plain C
+// server exchange fragmented and unfragmented packets over a lossy, reordering link, and everything that arrives must be intact
+
+struct TestTemplateConfig : reliable::DefaultConfig
+{
+    static constexpr int max_packet_size = 4 * 1024;
+    static constexpr int max_fragments = 4;
+    static constexpr int sent_packets_buffer_size = 512;
+    static constexpr int fragment_reassembly_buffer_size = 8;
+    static constexpr int rtt_history_size = 128;
+};
+
+struct test_template_context_t
+{
+    struct reliable_sim_t * sim;
+    int num_packets_received[2];
+    int num_fragmented_packets_received[2];
+};
+
+static int test_template_packet_bytes( uint16_t sequence )
+{
+    return 1 + ( sequence * 997 ) % TestTemplateConfig::max_packet_size;
+}
+
+static void test_template_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) sequence;
+    test_template_context_t * context = (test_template_context_t*) _context;
+    reliable_sim_send( context->sim, id == 0 ? 1 : 0, packet_data, packet_bytes );
+}
+
+static int test_template_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    test_template_context_t * context = (test_template_context_t*) _context;
+    if ( packet_bytes != test_template_packet_bytes( sequence ) )
+        test_fail( "templated endpoint packet has the wrong size" );
+    for ( int i = 0; i < packet_bytes; ++i )
+    {
+        if ( packet_data[i] != (uint8_t) ( sequence + i ) )
+            test_fail( "templated endpoint packet is corrupt" );
+    }
+    context->num_packets_received[id]++;
+    if ( packet_bytes > TestTemplateConfig::fragment_above )
+        context->num_fragmented_packets_received[id]++;
+    return 1;
+}
+
+static void test_template_generate_packet( uint16_t sequence, uint8_t * packet_data, int * packet_bytes )
+{
+    *packet_bytes = test_template_packet_bytes( sequence );
+    for ( int i = 0; i < *packet_bytes; ++i )
+        packet_data[i] = (uint8_t) ( sequence + i );
+}
+
+static void test_template()
+{
+    printf( "test_template\n" );
+
+    double time = 100.0;
+
+    test_template_context_t context;
+    memset( &context, 0, sizeof( context ) );
+
+    struct reliable_sim_config_t sim_config;
+    reliable_sim_default_config( &sim_config );
+    sim_config.seed = 1;
+    sim_config.max_packet_bytes = 2048;
+    sim_config.latency = 0.05;
+    sim_config.jitter = 0.03;
+    sim_config.packet_loss = 5.0f;
+    sim_config.duplicate = 5.0f;
+    context.sim = reliable_sim_create( &sim_config, time );
+
+    // an Endpoint holds its memory inline, so keep the big ones off the stack
+
+    reliable::Endpoint<TestTemplateConfig> & client = *new reliable::Endpoint<TestTemplateConfig>( "client", 0, &context, test_template_transmit_packet_function, test_template_process_packet_function, time );
+
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    reliable_copy_string( config.name, "server", sizeof( config.name ) );
+    config.context = &context;
+    config.id = 1;
+    config.max_packet_size = TestTemplateConfig::max_packet_size;
+    config.max_fragments = TestTemplateConfig::max_fragments;
+    config.sent_packets_buffer_size = TestTemplateConfig::sent_packets_buffer_size;
+    config.fragment_reassembly_buffer_size = TestTemplateConfig::fragment_reassembly_buffer_size;
+    config.rtt_history_size = TestTemplateConfig::rtt_history_size;
+    config.transmit_packet_function = test_template_transmit_packet_function;
+    config.process_packet_function = test_template_process_packet_function;
+    struct reliable_endpoint_t * server = reliable_endpoint_create( &config, time );
+
+    if ( client.memory_used() == 0 || client.memory_used() > reliable::Endpoint<TestTemplateConfig>::state_bytes )
+        test_fail( "templated endpoint memory bounds are wrong" );
+
+    uint8_t packet_data[TestTemplateConfig::max_packet_size];
+    int packet_bytes;
+    int num_acks_total[2] = { 0, 0 };
+    size_t max_slots_used = 0;
+
+    const int num_frames = 2000;
+    for ( int frame = 0; frame < num_frames; ++frame )
+    {
+        test_template_generate_packet( client.next_packet_sequence(), packet_data, &packet_bytes );
+        client.send_packet( packet_data, packet_bytes );
+
+        test_template_generate_packet( reliable_endpoint_next_packet_sequence( server ), packet_data, &packet_bytes );
+        reliable_endpoint_send_packet( server, packet_data, packet_bytes );
+
+        time += 1.0 / 60.0;
+        reliable_sim_update( context.sim, time );
+
+        uint64_t to;
+        uint8_t * received_packet_data;
+        while ( ( received_packet_data = reliable_sim_receive( context.sim, &to, &packet_bytes ) ) != NULL )
+        {
+            if ( to == 0 )
+                client.receive_packet( received_packet_data, packet_bytes );
+            else
+                reliable_endpoint_receive_packet( server, received_packet_data, packet_bytes );
+        }
+
+        if ( client.slots_used() > max_slots_used )
+            max_slots_used = client.slots_used();
+
+        client.update( time );
+        reliable_endpoint_update( server, time );
+
+        int num_acks;
+        client.get_acks( &num_acks );
+        num_acks_total[0] += num_acks;
+        reliable_endpoint_get_acks( server, &num_acks );
+        num_acks_total[1] += num_acks;
+
+        client.clear_acks();
+        reliable_endpoint_clear_acks( server );
+    }
+
+    // with 5% loss per fragment most packets still get through, and fragmented packets must reassemble in both directions
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        if ( context.num_packets_received[i] < num_frames / 2 || context.num_fragmented_packets_received[i] < num_frames / 4 )
+            test_fail( "templated endpoint did not interoperate with a C endpoint" );
+        if ( num_acks_total[i] < num_frames / 2 )
+            test_fail( "templated endpoint acks did not get through" );
+    }
+
+    if ( client.counters()[RELIABLE_ENDPOINT_COUNTER_NUM_FRAGMENTS_RECEIVED] == 0 || client.rtt() <= 0.0f )
+        test_fail( "templated endpoint stats are wrong" );
+
+    if ( max_slots_used == 0 || max_slots_used > reliable::Endpoint<TestTemplateConfig>::num_slots )
+        test_fail( "templated endpoint reassembly slots are wrong" );
+
+    // reset hands every reassembly buffer back
+
+    client.reset();
+    if ( client.slots_used() != 0 )
+        test_fail( "templated endpoint leaked reassembly slots" );
+
+    delete &client;
+    reliable_endpoint_destroy( server );
+    reliable_sim_destroy( context.sim );
+
+    reliable::Endpoint<> * endpoint = new reliable::Endpoint<>( "default", 0, &context, test_template_transmit_packet_function, test_template_process_packet_function, time );
+    if ( endpoint->next_packet_sequence() != 0 || endpoint->memory_used() > reliable::Endpoint<>::state_bytes )
+        test_fail( "default templated endpoint is wrong" );
+    delete endpoint;
+}
+
+#if defined( __linux__ )
+
+// two endpoints talking over real udp sockets on localhost through the io_uring driver. skipped where io_uring is unavailable
+
+struct test_udp_context_t
+{
+    struct reliable_udp_io_uring_t * driver;
+    struct reliable_udp_address_t peer_address;
+    struct reliable_endpoint_t * endpoint;
+    int num_packets_received;
+};
+
+static void test_udp_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    test_udp_context_t * context = (test_udp_context_t*) _context;
+    reliable_udp_io_uring_send( context->driver, &context->peer_address, packet_data, packet_bytes );
+}
+
+static int test_udp_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    test_udp_context_t * context = (test_udp_context_t*) _context;
+    context->num_packets_received++;
+    return 1;
+}
+
+static void test_udp_receive_function( void * _context, RELIABLE_CONST struct reliable_udp_address_t * from, uint8_t * packet_data, int packet_bytes )
+{
+    test_udp_context_t * context = (test_udp_context_t*) _context;
+    if ( !reliable_udp_address_equal( from, &context->peer_address ) )
+        test_fail( "udp datagram came from the wrong address" );
+    reliable_endpoint_receive_packet( context->endpoint, packet_data, packet_bytes );
+}
+
+static void test_udp()
+{
+    printf( "test_udp\n" );
+
+    struct reliable_udp_address_t address;
+    char string[RELIABLE_UDP_ADDRESS_STRING_BYTES];
+
+    if ( reliable_udp_address_parse( &address, "127.0.0.1:40000" ) != RELIABLE_OK || address.type != RELIABLE_UDP_ADDRESS_IPV4 || address.port != 40000 )
+        test_fail( "could not parse an ipv4 address" );
+    if ( strcmp( reliable_udp_address_to_string( &address, string, sizeof( string ) ), "127.0.0.1:40000" ) != 0 )
+        test_fail( "ipv4 address did not format back to what was parsed" );
+
+    if ( reliable_udp_address_parse( &address, "[::1]:5" ) != RELIABLE_OK || address.type != RELIABLE_UDP_ADDRESS_IPV6 || address.port != 5 || address.data[15] != 1 )
+        test_fail( "could not parse an ipv6 address" );
+    if ( strcmp( reliable_udp_address_to_string( &address, string, sizeof( string ) ), "[::1]:5" ) != 0 )
+        test_fail( "ipv6 address did not format back to what was parsed" );
+
+    struct reliable_udp_address_t other;
+    if ( reliable_udp_address_parse( &other, "::1" ) != RELIABLE_OK || other.port != 0 || reliable_udp_address_equal( &address, &other ) )
+        test_fail( "address without a port" );
+    other.port = 5;
+    if ( !reliable_udp_address_equal( &address, &other ) )
+        test_fail( "equal addresses compare unequal" );
+
+    if ( reliable_udp_address_parse( &address, "nope" ) != RELIABLE_ERROR || reliable_udp_address_parse( &address, "1.2.3.4:99999" ) != RELIABLE_ERROR )
+        test_fail( "parsed an invalid address" );
+
+    test_udp_context_t contexts[2];
+    memset( contexts, 0, sizeof( contexts ) );
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        struct reliable_udp_io_uring_config_t config;
+        reliable_udp_io_uring_default_config( &config );
+        reliable_udp_address_parse( &config.bind_address, "127.0.0.1" );
+        config.num_receive_buffers = 64;
+        config.num_send_buffers = 64;
+        config.context = &contexts[i];
+        config.receive_function = test_udp_receive_function;
+        contexts[i].driver = reliable_udp_io_uring_create( &config );
+        if ( !contexts[i].driver )
+        {
+            printf( "    io_uring is not available here, skipping\n" );
+            if ( i == 1 )
+                reliable_udp_io_uring_destroy( contexts[0].driver );
+            return;
+        }
+    }
+
+    reliable_udp_io_uring_address( contexts[1].driver, &contexts[0].peer_address );
+    reliable_udp_io_uring_address( contexts[0].driver, &contexts[1].peer_address );
+
+    double time = 100.0;
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.id = (uint64_t) i;
+        config.context = &contexts[i];
+        config.transmit_packet_function = test_udp_transmit_packet_function;
+        config.process_packet_function = test_udp_process_packet_function;
+        contexts[i].endpoint = reliable_endpoint_create( &config, time );
+    }
+
+    uint8_t packet_data[4000];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    if ( reliable_udp_io_uring_send( contexts[0].driver, &contexts[0].peer_address, packet_data, sizeof( packet_data ) ) != RELIABLE_ERROR )
+        test_fail( "sent a datagram larger than max_packet_bytes" );
+
+    // a small packet and one that fragments, each way, every frame. localhost doesn't drop, so everything must arrive
+
+    const int num_frames = 100;
+
+    for ( int frame = 0; frame < num_frames; ++frame )
+    {
+        for ( int i = 0; i < 2; ++i )
+        {
+            reliable_endpoint_send_packet( contexts[i].endpoint, packet_data, 100 );
+            reliable_endpoint_send_packet( contexts[i].endpoint, packet_data, 3000 );
+            reliable_udp_io_uring_flush( contexts[i].driver );
+        }
+
+        for ( int attempt = 0; attempt < 1000; ++attempt )
+        {
+            reliable_udp_io_uring_receive( contexts[0].driver );
+            reliable_udp_io_uring_receive( contexts[1].driver );
+            if ( contexts[0].num_packets_received == 2 * ( frame + 1 ) && contexts[1].num_packets_received == 2 * ( frame + 1 ) )
+                break;
+        }
+
+        time += 0.01;
+        for ( int i = 0; i < 2; ++i )
+        {
+            reliable_endpoint_update( contexts[i].endpoint, time );
+            reliable_endpoint_clear_acks( contexts[i].endpoint );
+        }
+    }
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        if ( contexts[i].num_packets_received != 2 * num_frames )
+            test_fail( "packets were lost on localhost" );
+
+        RELIABLE_CONST uint64_t * counters = reliable_endpoint_counters( contexts[i].endpoint );
+        if ( counters[RELIABLE_ENDPOINT_COUNTER_NUM_PACKETS_ACKED] < (uint64_t) ( 2 * num_frames - 4 ) )
+            test_fail( "packets sent over udp were not acked" );
+
+        RELIABLE_CONST uint64_t * udp_counters = reliable_udp_io_uring_counters( contexts[i].driver );
+        if ( udp_counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_TOO_LARGE] != (uint64_t) ( i == 0 ? 1 : 0 ) || udp_counters[RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS] != 0 )
+            test_fail( "udp driver counted errors" );
+
+        reliable_endpoint_destroy( contexts[i].endpoint );
+        reliable_udp_io_uring_destroy( contexts[i].driver );
+    }
+}
+
+// one server socket with an endpoint per client, demultiplexed by source address through the recvmmsg/sendmmsg driver
+
+struct test_udp_mmsg_context_t
+{
+    struct reliable_udp_mmsg_t * driver;
+    struct reliable_udp_address_t peer_address;
+    struct reliable_endpoint_t * endpoint;
+    int num_packets_received;
+};
+
+static void test_udp_mmsg_transmit_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    test_udp_mmsg_context_t * context = (test_udp_mmsg_context_t*) _context;
+    reliable_udp_mmsg_send( context->driver, &context->peer_address, packet_data, packet_bytes );
+}
+
+static int test_udp_mmsg_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    test_udp_mmsg_context_t * context = (test_udp_mmsg_context_t*) _context;
+    context->num_packets_received++;
+    return 1;
+}
+
+static void test_udp_mmsg_unknown_function( void * context, RELIABLE_CONST struct reliable_udp_address_t * from, uint8_t * packet_data, int packet_bytes )
+{
+    (void) from;
+    (void) packet_data;
+    (void) packet_bytes;
+    int * num_unknown = (int*) context;
+    (*num_unknown)++;
+}
+
+static void test_udp_mmsg()
+{
+    printf( "test_udp_mmsg\n" );
+
+    // the address table on its own: fill it, remove every other entry, and make sure the survivors are still found
+
+    {
+        struct reliable_udp_mmsg_config_t config;
+        reliable_udp_mmsg_default_config( &config );
+        reliable_udp_address_parse( &config.bind_address, "127.0.0.1" );
+        config.max_endpoints = 1000;
+        struct reliable_udp_mmsg_t * driver = reliable_udp_mmsg_create( &config );
+        if ( !driver )
+            test_fail( "could not create a recvmmsg/sendmmsg driver" );
+
+        static struct reliable_endpoint_t * endpoints[1000];
+        struct reliable_udp_address_t address;
+        for ( int i = 0; i < 1000; ++i )
+        {
+            endpoints[i] = (struct reliable_endpoint_t*) ( (uintptr_t) ( i + 1 ) * 64 );
+            reliable_udp_address_parse( &address, i & 1 ? "10.0.0.1" : "[2001:db8::1]" );
+            address.data[address.type == RELIABLE_UDP_ADDRESS_IPV4 ? 3 : 15] = (uint8_t) ( i >> 8 );
+            address.port = (uint16_t) ( 1000 + i );
+            if ( reliable_udp_mmsg_add_endpoint( driver, &address, endpoints[i] ) != RELIABLE_OK )
+                test_fail( "could not add an endpoint" );
+        }
+
+        if ( reliable_udp_mmsg_add_endpoint( driver, &address, endpoints[0] ) != RELIABLE_ERROR )
+            test_fail( "added an endpoint past max_endpoints" );
+
+        for ( int pass = 0; pass < 2; ++pass )
+        {
+            for ( int i = 0; i < 1000; ++i )
+            {
+                reliable_udp_address_parse( &address, i & 1 ? "10.0.0.1" : "[2001:db8::1]" );
+                address.data[address.type == RELIABLE_UDP_ADDRESS_IPV4 ? 3 : 15] = (uint8_t) ( i >> 8 );
+                address.port = (uint16_t) ( 1000 + i );
+                bool removed = pass == 1 && ( i % 3 ) == 0;
+                if ( pass == 0 && ( i % 3 ) == 0 && reliable_udp_mmsg_remove_endpoint( driver, &address ) != RELIABLE_OK )
+                    test_fail( "could not remove an endpoint" );
+                if ( pass == 1 && reliable_udp_mmsg_find_endpoint( driver, &address ) != ( removed ? NULL : endpoints[i] ) )
+                    test_fail( "address table lookup returned the wrong endpoint" );
+            }
+        }
+
+        if ( reliable_udp_mmsg_remove_endpoint( driver, &address ) != RELIABLE_ERROR )
+            test_fail( "removed an endpoint twice" );
+
+        reliable_udp_mmsg_destroy( driver );
+    }
+
+    const int num_clients = 4;
+
+    test_udp_mmsg_context_t server[num_clients];
+    test_udp_mmsg_context_t clients[num_clients];
+    memset( server, 0, sizeof( server ) );
+    memset( clients, 0, sizeof( clients ) );
+
+    int num_unknown = 0;
+
+    struct reliable_udp_mmsg_config_t driver_config;
+    reliable_udp_mmsg_default_config( &driver_config );
+    reliable_udp_address_parse( &driver_config.bind_address, "127.0.0.1" );
+    driver_config.max_endpoints = num_clients;
+    driver_config.receive_batch_size = 16;
+    driver_config.num_send_buffers = 8;
+    driver_config.context = &num_unknown;
+    driver_config.receive_function = test_udp_mmsg_unknown_function;
+
+    struct reliable_udp_mmsg_t * server_driver = reliable_udp_mmsg_create( &driver_config );
+    if ( !server_driver )
+        test_fail( "could not create a recvmmsg/sendmmsg driver" );
+
+    struct reliable_udp_address_t server_address;
+    reliable_udp_mmsg_address( server_driver, &server_address );
+
+    double time = 100.0;
+
+    for ( int i = 0; i < num_clients; ++i )
+    {
+        driver_config.max_endpoints = 1;
+        clients[i].driver = reliable_udp_mmsg_create( &driver_config );
+        if ( !clients[i].driver )
+            test_fail( "could not create a recvmmsg/sendmmsg driver" );
+        clients[i].peer_address = server_address;
+        server[i].driver = server_driver;
+        reliable_udp_mmsg_address( clients[i].driver, &server[i].peer_address );
+
+        for ( int j = 0; j < 2; ++j )
+        {
+            test_udp_mmsg_context_t * context = j == 0 ? &clients[i] : &server[i];
+            struct reliable_config_t config;
+            reliable_default_config( &config );
+            config.id = (uint64_t) i;
+            config.context = context;
+            config.transmit_packet_function = test_udp_mmsg_transmit_packet_function;
+            config.process_packet_function = test_udp_mmsg_process_packet_function;
+            context->endpoint = reliable_endpoint_create( &config, time );
+        }
+
+        if ( reliable_udp_mmsg_add_endpoint( clients[i].driver, &server_address, clients[i].endpoint ) != RELIABLE_OK ||
+             reliable_udp_mmsg_add_endpoint( server_driver, &server[i].peer_address, server[i].endpoint ) != RELIABLE_OK )
+        {
+            test_fail( "could not add an endpoint" );
+        }
+    }
+
+    if ( reliable_udp_mmsg_add_endpoint( server_driver, &server[0].peer_address, server[1].endpoint ) != RELIABLE_ERROR )
+        test_fail( "added the same address twice" );
+
+    // every client sends a small packet and one that fragments each frame, and the server answers each client in kind.
+    // the last client is removed from the server's table halfway through, after which its packets must go to receive_function
+
+    uint8_t packet_data[3000];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    const int num_frames = 100;
+    const int remove_frame = num_frames / 2;
+
+    for ( int frame = 0; frame < num_frames; ++frame )
+    {
+        if ( frame == remove_frame && reliable_udp_mmsg_remove_endpoint( server_driver, &server[num_clients-1].peer_address ) != RELIABLE_OK )
+            test_fail( "could not remove an endpoint" );
+
+        for ( int i = 0; i < num_clients; ++i )
+        {
+            reliable_endpoint_send_packet( clients[i].endpoint, packet_data, 100 );
+            reliable_endpoint_send_packet( clients[i].endpoint, packet_data, 3000 );
+            reliable_udp_mmsg_flush( clients[i].driver );
+            reliable_endpoint_send_packet( server[i].endpoint, packet_data, 100 );
+            reliable_endpoint_send_packet( server[i].endpoint, packet_data, 3000 );
+        }
+        reliable_udp_mmsg_flush( server_driver );
+
+        for ( int attempt = 0; attempt < 1000; ++attempt )
+        {
+            reliable_udp_mmsg_receive( server_driver );
+            bool done = true;
+            for ( int i = 0; i < num_clients; ++i )
+            {
+                reliable_udp_mmsg_receive( clients[i].driver );
+                int expected = ( i == num_clients - 1 ) ? 2 * ( frame < remove_frame ? frame + 1 : remove_frame ) : 2 * ( frame + 1 );
+                if ( server[i].num_packets_received != expected || clients[i].num_packets_received != 2 * ( frame + 1 ) )
+                    done = false;
+            }
+            if ( done )
+                break;
+        }
+
+        time += 0.01;
+        for ( int i = 0; i < num_clients; ++i )
+        {
+            reliable_endpoint_update( clients[i].endpoint, time );
+            reliable_endpoint_clear_acks( clients[i].endpoint );
+            reliable_endpoint_update( server[i].endpoint, time );
+            reliable_endpoint_clear_acks( server[i].endpoint );
+        }
+    }
+
+    for ( int i = 0; i < num_clients; ++i )
+    {
+        if ( clients[i].num_packets_received != 2 * num_frames )
+            test_fail( "packets were lost on localhost" );
+        if ( server[i].num_packets_received != 2 * ( i == num_clients - 1 ? remove_frame : num_frames ) )
+            test_fail( "packets were delivered to the wrong endpoint" );
+    }
+
+    // each frame the removed client sends one packet plus three fragments
+
+    RELIABLE_CONST uint64_t * counters = reliable_udp_mmsg_counters( server_driver );
+    if ( num_unknown != 4 * ( num_frames - remove_frame ) || counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_UNKNOWN_ADDRESS] != (uint64_t) num_unknown )
+        test_fail( "datagrams from an unknown address were not counted" );
+    if ( counters[RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS] != 0 || counters[RELIABLE_UDP_COUNTER_NUM_SEND_BUFFERS_FULL] == 0 )
+        test_fail( "udp driver counters are wrong" );
+    if ( counters[RELIABLE_UDP_COUNTER_NUM_SYSCALLS] >= counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_SENT] + counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_RECEIVED] )
+        test_fail( "recvmmsg/sendmmsg did not batch" );
+
+    for ( int i = 0; i < num_clients; ++i )
+    {
+        reliable_endpoint_destroy( clients[i].endpoint );
+        reliable_endpoint_destroy( server[i].endpoint );
+        reliable_udp_mmsg_destroy( clients[i].driver );
+    }
+    reliable_udp_mmsg_destroy( server_driver );
+}
+
+// fragment bursts as segment trains (UDP_SEGMENT), coalesced again on receive (UDP_GRO), over localhost. the first side
+// has receive offload on and the second doesn't, so one gets trains back whole and the other gets them cut up by the kernel
+
+static void test_udp_gso_transmit_fragments_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * fragment_data, int fragment_bytes, int stride )
+{
+    (void) id;
+    (void) sequence;
+    test_udp_mmsg_context_t * context = (test_udp_mmsg_context_t*) _context;
+    if ( reliable_udp_mmsg_send_segments( context->driver, &context->peer_address, fragment_data, fragment_bytes, stride ) != RELIABLE_OK )
+        test_fail( "could not send a segment train" );
+}
+
+static int test_udp_gso_process_packet_function( void * _context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) id;
+    (void) sequence;
+    if ( packet_bytes != 100 && packet_bytes != 16 * 1024 )
+        test_fail( "segment train packet has the wrong size" );
+    for ( int i = 0; i < packet_bytes; ++i )
+    {
+        if ( packet_data[i] != (uint8_t) ( i * 7 + ( i >> 8 ) ) )
+            test_fail( "segment train packet was corrupted" );
+    }
+    test_udp_mmsg_context_t * context = (test_udp_mmsg_context_t*) _context;
+    context->num_packets_received++;
+    return 1;
+}
+
+static void test_udp_gso()
+{
+    printf( "test_udp_gso\n" );
+
+    test_udp_mmsg_context_t contexts[2];
+    memset( contexts, 0, sizeof( contexts ) );
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        struct reliable_udp_mmsg_config_t config;
+        reliable_udp_mmsg_default_config( &config );
+        reliable_udp_address_parse( &config.bind_address, "127.0.0.1" );
+        config.max_endpoints = 1;
+        config.num_send_buffers = 64;
+        config.gso = 1;
+        config.gro = i == 0;
+        contexts[i].driver = reliable_udp_mmsg_create( &config );
+        if ( !contexts[i].driver )
+            test_fail( "could not create a recvmmsg/sendmmsg driver" );
+    }
+
+    double time = 100.0;
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        reliable_udp_mmsg_address( contexts[1-i].driver, &contexts[i].peer_address );
+
+        struct reliable_config_t config;
+        reliable_default_config( &config );
+        config.id = (uint64_t) i;
+        config.context = &contexts[i];
+        config.transmit_packet_function = test_udp_mmsg_transmit_packet_function;
+        config.transmit_fragments_function = test_udp_gso_transmit_fragments_function;
+        config.process_packet_function = test_udp_gso_process_packet_function;
+        contexts[i].endpoint = reliable_endpoint_create( &config, time );
+
+        reliable_udp_mmsg_add_endpoint( contexts[i].driver, &contexts[i].peer_address, contexts[i].endpoint );
+    }
+
+    static uint8_t packet_data[16*1024];
+    for ( int i = 0; i < (int) sizeof( packet_data ); ++i )
+        packet_data[i] = (uint8_t) ( i * 7 + ( i >> 8 ) );
+
+    // a 16K packet is 16 fragments: the first on its own, then a train of 15. with the small packet that's 17 datagrams a frame
+
+    const int num_frames = 50;
+
+    for ( int frame = 0; frame < num_frames; ++frame )
+    {
+        for ( int i = 0; i < 2; ++i )
+        {
+            reliable_endpoint_send_packet( contexts[i].endpoint, packet_data, 100 );
+            reliable_endpoint_send_packet( contexts[i].endpoint, packet_data, sizeof( packet_data ) );
+            reliable_udp_mmsg_flush( contexts[i].driver );
+        }
+
+        for ( int attempt = 0; attempt < 1000; ++attempt )
+        {
+            reliable_udp_mmsg_receive( contexts[0].driver );
+            reliable_udp_mmsg_receive( contexts[1].driver );
+            if ( contexts[0].num_packets_received == 2 * ( frame + 1 ) && contexts[1].num_packets_received == 2 * ( frame + 1 ) )
+                break;
+        }
+
+        time += 0.01;
+        for ( int i = 0; i < 2; ++i )
+        {
+            reliable_endpoint_update( contexts[i].endpoint, time );
+            reliable_endpoint_clear_acks( contexts[i].endpoint );
+        }
+    }
+
+    RELIABLE_CONST uint64_t * counters[2] = { reliable_udp_mmsg_counters( contexts[0].driver ), reliable_udp_mmsg_counters( contexts[1].driver ) };
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        if ( contexts[i].num_packets_received != 2 * num_frames )
+            test_fail( "packets were lost on localhost" );
+        if ( counters[i][RELIABLE_UDP_COUNTER_NUM_PACKETS_SENT] != (uint64_t) ( 17 * num_frames ) || counters[i][RELIABLE_UDP_COUNTER_NUM_PACKETS_RECEIVED] != (uint64_t) ( 17 * num_frames ) )
+            test_fail( "segment trains were not counted as their datagrams" );
+        if ( counters[i][RELIABLE_UDP_COUNTER_NUM_SEND_ERRORS] != 0 )
+            test_fail( "udp driver counted errors" );
+    }
+
+    if ( counters[0][RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_SENT] == 0 )
+    {
+        printf( "    UDP_SEGMENT is not available here, fragments went out one by one\n" );
+    }
+    else
+    {
+        if ( counters[0][RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_SENT] != (uint64_t) num_frames )
+            test_fail( "fragments were not sent as one segment train" );
+        if ( counters[0][RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_RECEIVED] == 0 )
+            printf( "    UDP_GRO did not coalesce here, datagrams arrived one by one\n" );
+        if ( counters[1][RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_RECEIVED] != 0 )
+            test_fail( "received a segment train without UDP_GRO" );
+    }
+
+    // with gso off, the same call queues each segment as its own datagram
+
+    {
+        struct reliable_udp_mmsg_config_t config;
+        reliable_udp_mmsg_default_config( &config );
+        reliable_udp_address_parse( &config.bind_address, "127.0.0.1" );
+        config.gso = 0;
+        struct reliable_udp_mmsg_t * driver = reliable_udp_mmsg_create( &config );
+        if ( !driver )
+            test_fail( "could not create a recvmmsg/sendmmsg driver" );
+        reliable_udp_mmsg_send_segments( driver, &contexts[1].peer_address, packet_data, 10 * 1000 + 1, 1000 );
+        if ( reliable_udp_mmsg_send_segments( driver, &contexts[1].peer_address, packet_data, 3000, 2000 ) != RELIABLE_ERROR )
+            test_fail( "sent segments larger than max_packet_bytes" );
+        reliable_udp_mmsg_flush( driver );
+        RELIABLE_CONST uint64_t * driver_counters = reliable_udp_mmsg_counters( driver );
+        if ( driver_counters[RELIABLE_UDP_COUNTER_NUM_PACKETS_SENT] != 11 || driver_counters[RELIABLE_UDP_COUNTER_NUM_SEGMENT_TRAINS_SENT] != 0 )
+            test_fail( "segments were not sent one by one with gso off" );
+        reliable_udp_mmsg_destroy( driver );
+    }
+
+    for ( int i = 0; i < 2; ++i )
+    {
+        reliable_endpoint_destroy( contexts[i].endpoint );
+        reliable_udp_mmsg_destroy( contexts[i].driver );
+    }
+}
+
+#endif // #if defined( __linux__ )
+
 int main( int argc, char ** argv )
 {
 	(void) argc;
@@ -39,6 +1484,28 @@ int main( int argc, char ** argv )
 
    reliable_test();
 
+   test_send_queue_threads();
+
+   test_snapshot_threads();
+
+   test_server();
+
+   test_log_threads();
+
+   test_stats_threads();
+
+   test_sim();
+
+   test_template();
+
+#if defined( __linux__ )
+   test_udp();
+
+   test_udp_mmsg();
+
+   test_udp_gso();
+#endif // #if defined( __linux__ )
+
    reliable_term();
 
    printf( "\n*** ALL TESTS PASSED ***\n\n" );
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Check reliable_bench against a checked-in baseline.
+
+Runs the benchmark suite several times, takes the median of each benchmark
+across runs, and compares it with tools/perf/baseline.json using the
+per-benchmark tolerances in tools/perf/tolerances.json. A benchmark only counts
+as a regression when both its median and its fastest run are over the limit,
+and it is still over the limit when run again on its own, so one unlucky run
+can't fail the check.
+
+The "calibration" benchmark doesn't touch the library. Every other result is
+scaled by how its speed compares with the baseline's, so a machine that is
+uniformly slower today than when the baseline was taken doesn't look like a
+regression.
+
+Benchmarks whose runs disagree with each other by more than their tolerance are
+reported as noisy instead of being judged. If too many are noisy, the machine is
+too busy to say anything and the check is skipped.
+
+The bench runs with RELIABLE_SIMD=scalar, so the baseline holds on any cpu.
+
+usage: python3 tools/perf/check_perf.py --bench build/bin/reliable_bench [--runs N] [--update-baseline]
+exit:  0 = no regressions, 1 = regressions, 2 = could not run, 3 = too noisy to tell or baseline at another simd level
+"""
+import argparse, json, os, statistics, subprocess, sys, tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+BASELINE = os.path.join(HERE, "baseline.json")
+TOLERANCES = os.path.join(HERE, "tolerances.json")
+
+# the bench always runs the scalar kernels, so one baseline holds on any cpu. reliable_init would otherwise pick
+# sse4.2, avx2, avx512 or neon, which are several times apart on the ack bits and rtt statistics benchmarks
+SIMD = "scalar"
+BENCH_ENV = dict(os.environ, RELIABLE_SIMD=SIMD)
+
+
+def run_bench(bench, runs, quick, filter=None):
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for i in range(runs):
+            out = os.path.join(tmp, f"run{i}.json")
+            cmd = [bench, "--output", out] + (["--quick"] if quick else []) + (["--filter", filter] if filter else [])
+            r = subprocess.run(cmd, capture_output=True, text=True, env=BENCH_ENV)
+            if r.returncode != 0:
+                print(f"{' '.join(cmd)} failed:\n" + (r.stdout + r.stderr)[:2000], file=sys.stderr); sys.exit(2)
+            with open(out) as f:
+                results.append(json.load(f))
+            print(f"{filter + ' ' if filter else ''}run {i + 1}/{runs} done", flush=True)
+    return results
+
+
+def summarize(results):
+    """Per benchmark: median of the run medians, the fastest run, and the spread between runs."""
+    summary = {}
+    for b in results[0]["benchmarks"]:
+        name = b["name"]
+        medians = [next(x for x in r["benchmarks"] if x["name"] == name)["ns_per_op"] for r in results]
+        fastest = min(next(x for x in r["benchmarks"] if x["name"] == name)["ns_per_op_min"] for r in results)
+        median = statistics.median(medians)
+        spread = (max(medians) - min(medians)) / median if median > 0 else 0.0
+        summary[name] = {"ns_per_op": median, "fastest": fastest, "spread": spread}
+    return summary
+
+
+def tolerance_for(tolerances, name):
+    return tolerances.get("benchmarks", {}).get(name, tolerances["default"])
+
+
+def regressed(s, base, tol):
+    return s["ns_per_op"] > base * (1.0 + tol) and s["fastest"] > base * (1.0 + tol)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--bench", required=True, help="path to the reliable_bench binary")
+    ap.add_argument("--runs", type=int, default=3)
+    ap.add_argument("--quick", action="store_true", help="pass --quick to the bench. only meaningful against a --quick baseline")
+    ap.add_argument("--update-baseline", action="store_true", help="write the results as the new baseline instead of checking")
+    a = ap.parse_args()
+
+    if not os.path.exists(a.bench):
+        print(f"no benchmark binary at {a.bench}", file=sys.stderr); return 2
+
+    with open(TOLERANCES) as f:
+        tolerances = json.load(f)
+
+    results = run_bench(a.bench, a.runs, a.quick)
+    build = results[0].get("build", "unknown")
+    simd = results[0].get("simd", "scalar")
+    summary = summarize(results)
+
+    if a.update_baseline:
+        baseline = {"build": build, "simd": simd, "quick": a.quick, "runs": a.runs,
+                    "benchmarks": {k: round(v["ns_per_op"], 3) for k, v in summary.items()}}
+        with open(BASELINE, "w") as f:
+            json.dump(baseline, f, indent=4)
+            f.write("\n")
+        print(f"wrote {BASELINE}")
+        return 0
+
+    with open(BASELINE) as f:
+        baseline = json.load(f)
+
+    if baseline["build"] != build or baseline.get("quick", False) != a.quick:
+        print(f"the baseline is from a {baseline['build']}{' --quick' if baseline.get('quick') else ''} build, this is "
+              f"{build}{' --quick' if a.quick else ''}. build Release and run with the same flags", file=sys.stderr)
+        return 2
+
+    # a baseline taken at another simd level can't be compared with. skip rather than fail
+
+    if baseline.get("simd", "unknown") != simd:
+        print(f"the baseline was taken with the {baseline.get('simd', 'unknown')} kernels, this ran {simd}. "
+              f"rerun with --update-baseline to judge this build", file=sys.stderr)
+        return 3
+
+    scale = 1.0
+    if "calibration" in summary and "calibration" in baseline["benchmarks"]:
+        scale = summary["calibration"]["ns_per_op"] / baseline["benchmarks"]["calibration"]
+        print(f"\nthis machine is running at {1.0 / scale:.2f}x the speed it was when the baseline was taken. results are scaled to match")
+
+    regressions, noisy, improvements = [], [], []
+
+    print(f"\n{'benchmark':32} {'baseline':>10} {'now':>10} {'change':>8} {'limit':>7} {'spread':>7}")
+    for name, s in summary.items():
+        if name == "calibration":
+            continue
+        if name not in baseline["benchmarks"]:
+            print(f"{name:32} {'-':>10} {s['ns_per_op']:10.1f}    (new, not in baseline)")
+            continue
+        base = baseline["benchmarks"][name] * scale
+        tol = tolerance_for(tolerances, name)
+        change = s["ns_per_op"] / base - 1.0
+        status = ""
+        if s["spread"] > tol:
+            status = "noisy"; noisy.append(name)
+        elif regressed(s, base, tol):
+            status = "REGRESSED"; regressions.append(name)
+        elif change < -tol:
+            status = "faster"; improvements.append(name)
+        print(f"{name:32} {base:10.1f} {s['ns_per_op']:10.1f} {change * 100:+7.1f}% {tol * 100:6.0f}% {s['spread'] * 100:6.1f}%  {status}")
+
+    for name in baseline["benchmarks"]:
+        if name not in summary:
+            print(f"{name:32} is in the baseline but the bench no longer runs it")
+
+    print()
+    judged = len(summary) - 1
+    if len(noisy) > judged * tolerances.get("max_noisy_fraction", 0.25):
+        print(f"{len(noisy)} of {judged} benchmarks varied between runs by more than their tolerance. "
+              f"this machine is too noisy to judge. close other programs, pin the cpu frequency, or raise --runs")
+        return 3
+    confirmed = []
+    for name in regressions:
+        s = summarize(run_bench(a.bench, a.runs, a.quick, name))[name]
+        base = baseline["benchmarks"][name] * scale
+        if regressed(s, base, tolerance_for(tolerances, name)):
+            confirmed.append(name)
+        print(f"{name}: {s['ns_per_op']:.1f} ns on a second look, {'still' if name in confirmed else 'no longer'} over the limit")
+    regressions = confirmed
+
+    if regressions:
+        print(f"{len(regressions)} regression(s): {', '.join(regressions)}")
+        print("if the slowdown is intended, rerun with --update-baseline and commit tools/perf/baseline.json")
+        return 1
+    if improvements:
+        print(f"faster than the baseline: {', '.join(improvements)}. consider --update-baseline so regressions from here are caught")
+    print("no regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
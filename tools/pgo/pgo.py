@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Build reliable with profile guided optimization and report what it buys.
+
+Makes two Release builds under --build-dir. "release" is a plain Release build.
+"pgo" is configured with RELIABLE_PGO=GENERATE, runs pgo_train to write the
+profiles, then is reconfigured with RELIABLE_PGO=USE and rebuilt in place. With
+clang the raw profiles are merged with llvm-profdata in between. --lto turns on
+RELIABLE_LTO in both builds, so the difference is PGO alone.
+
+reliable_bench and loopback_bench then run against both builds in turn, and the
+medians across --runs are compared for the send, receive and update paths.
+
+usage: python3 tools/pgo/pgo.py [--build-dir build-pgo] [--lto] [--frames N] [--runs N] [--output report.json]
+exit:  0 = built and reported, 2 = could not build or run
+"""
+import argparse, glob, json, os, shutil, statistics, subprocess, sys, tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+# the reliable_bench results worth reporting, and the loopback_bench columns
+BENCH_PREFIXES = ("send_", "receive_", "reassembly_", "update_", "generate_ack_bits", "write_packet_header", "read_packet_header")
+LOOPBACK_PHASES = ("send", "receive", "update")
+
+
+def run(cmd, **kwargs):
+    r = subprocess.run(cmd, capture_output=True, text=True, **kwargs)
+    if r.returncode != 0:
+        print(f"{' '.join(cmd)} failed:\n" + (r.stdout + r.stderr)[-3000:], file=sys.stderr)
+        sys.exit(2)
+    return r.stdout
+
+
+def configure(build_dir, lto, pgo, pgo_dir=None):
+    cmd = ["cmake", "-S", ROOT, "-B", build_dir, "-DCMAKE_BUILD_TYPE=Release", f"-DRELIABLE_LTO={'ON' if lto else 'OFF'}", f"-DRELIABLE_PGO={pgo}"]
+    if pgo_dir:
+        cmd.append(f"-DRELIABLE_PGO_DIR={pgo_dir}")
+    run(cmd)
+
+
+def build(build_dir, targets):
+    run(["cmake", "--build", build_dir, "-j", str(os.cpu_count() or 1), "--target"] + targets)
+
+
+def merge_clang_profiles(pgo_dir):
+    raw = glob.glob(os.path.join(pgo_dir, "*.profraw"))
+    if not raw:
+        return
+    profdata = os.environ.get("LLVM_PROFDATA") or shutil.which("llvm-profdata")
+    if not profdata:
+        print("clang wrote raw profiles but there is no llvm-profdata on the path. set LLVM_PROFDATA", file=sys.stderr)
+        sys.exit(2)
+    run([profdata, "merge", "-output=" + os.path.join(pgo_dir, "reliable.profdata")] + raw)
+
+
+def bench_once(bin_dir, tmp, tag, i):
+    out = os.path.join(tmp, f"{tag}_bench{i}.json")
+    run([os.path.join(bin_dir, "reliable_bench"), "--output", out])
+    with open(out) as f:
+        bench = {b["name"]: b["ns_per_op"] for b in json.load(f)["benchmarks"]}
+    out = os.path.join(tmp, f"{tag}_loopback{i}.json")
+    run([os.path.join(bin_dir, "loopback_bench"), "--lossy", "--output", out])
+    with open(out) as f:
+        loopback = {}
+        for r in json.load(f)["results"]:
+            for phase in LOOPBACK_PHASES:
+                loopback[f"loopback_{phase}_{r['payload_bytes']}"] = r[f"{phase}_cycles_per_packet"]
+    return bench, loopback
+
+
+def medians(runs):
+    return {name: statistics.median(r[name] for r in runs) for name in runs[0]}
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--build-dir", default=os.path.join(ROOT, "build-pgo"))
+    ap.add_argument("--lto", action="store_true", help="build both with RELIABLE_LTO")
+    ap.add_argument("--frames", type=int, default=20000, help="frames of training traffic")
+    ap.add_argument("--runs", type=int, default=3)
+    ap.add_argument("--output", help="write the report as json")
+    a = ap.parse_args()
+
+    targets = ["reliable_bench", "loopback_bench", "pgo_train"]
+    release_dir = os.path.join(a.build_dir, "release")
+    pgo_dir = os.path.join(a.build_dir, "pgo")
+    profile_dir = os.path.join(pgo_dir, "profiles")
+
+    print("building release", flush=True)
+    configure(release_dir, a.lto, "")
+    build(release_dir, targets)
+
+    print("building instrumented", flush=True)
+    shutil.rmtree(profile_dir, ignore_errors=True)
+    configure(pgo_dir, a.lto, "GENERATE", profile_dir)
+    build(pgo_dir, targets)
+
+    print(f"training for {a.frames} frames", flush=True)
+    print(run([os.path.join(pgo_dir, "bin", "pgo_train"), str(a.frames)]).strip())
+    merge_clang_profiles(profile_dir)
+
+    print("building with the profile", flush=True)
+    configure(pgo_dir, a.lto, "USE", profile_dir)
+    build(pgo_dir, targets)
+
+    # the optimized build must still pass the workload it was trained on
+    run([os.path.join(pgo_dir, "bin", "pgo_train"), "2000"])
+
+    results = {"release": ([], []), "pgo": ([], [])}
+    with tempfile.TemporaryDirectory() as tmp:
+        for i in range(a.runs):
+            for tag, d in (("release", release_dir), ("pgo", pgo_dir)):
+                bench, loopback = bench_once(os.path.join(d, "bin"), tmp, tag, i)
+                results[tag][0].append(bench)
+                results[tag][1].append(loopback)
+            print(f"run {i + 1}/{a.runs} done", flush=True)
+
+    report = {"lto": a.lto, "frames": a.frames, "runs": a.runs, "benchmarks": []}
+
+    print(f"\n{'benchmark':32} {'release':>10} {'pgo':>10} {'change':>8}")
+    for index, unit in ((0, "ns"), (1, "cycles")):
+        release, pgo = medians(results["release"][index]), medians(results["pgo"][index])
+        for name in release:
+            if index == 0 and not name.startswith(BENCH_PREFIXES):
+                continue
+            change = pgo[name] / release[name] - 1.0 if release[name] > 0 else 0.0
+            print(f"{name:32} {release[name]:10.1f} {pgo[name]:10.1f} {change * 100:+7.1f}%")
+            report["benchmarks"].append({"name": name, "unit": unit, "release": round(release[name], 3), "pgo": round(pgo[name], 3), "change": round(change, 4)})
+        print()
+
+    print("reliable_bench rows are ns per op, loopback rows are cycles per packet. negative is faster")
+
+    if a.output:
+        with open(a.output, "w") as f:
+            json.dump(report, f, indent=4)
+            f.write("\n")
+        print(f"wrote {a.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
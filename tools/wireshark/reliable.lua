@@ -0,0 +1,225 @@
+-- Wireshark dissector for the reliable wire format, written from STANDARD.md.
+--
+-- Decodes the prefix byte, sequence, ack / ack_bits elision and the fragment
+-- header, and adds a generated reliable.header_bytes field so the average
+-- header cost of a capture can be measured. By default it claims UDP port
+-- 40000, which is what reliable_capture_start_pcapng writes. Change the port
+-- under Preferences > Protocols > RELIABLE, or use Decode As.
+--
+--     wireshark -X lua_script:tools/wireshark/reliable.lua capture.pcapng
+
+local reliable = Proto( "reliable", "reliable" )
+
+local f = reliable.fields
+
+f.prefix           = ProtoField.uint8(  "reliable.prefix",           "Prefix",               base.HEX )
+f.fragment         = ProtoField.bool(   "reliable.fragment",         "Fragment",             8, nil, 0x01 )
+f.ack_bits_flags   = ProtoField.uint8(  "reliable.ack_bits_flags",   "Ack bits present",     base.HEX, nil, 0x1E )
+f.ack_is_diff      = ProtoField.bool(   "reliable.ack_is_difference", "Ack is a difference", 8, nil, 0x20 )
+f.probe            = ProtoField.bool(   "reliable.probe",            "MTU probe",            8, nil, 0x40 )
+f.unused           = ProtoField.uint8(  "reliable.unused",           "Unused",               base.HEX, nil, 0x80 )
+f.sequence         = ProtoField.uint16( "reliable.sequence",         "Sequence",             base.DEC )
+f.ack              = ProtoField.uint16( "reliable.ack",              "Ack",                  base.DEC )
+f.ack_difference   = ProtoField.uint8(  "reliable.ack_difference",   "Ack difference",       base.DEC )
+f.ack_bits         = ProtoField.uint32( "reliable.ack_bits",         "Ack bits",             base.HEX )
+f.ack_bits_byte    = ProtoField.uint8(  "reliable.ack_bits_byte",    "Ack bits byte",        base.HEX )
+f.fragment_id      = ProtoField.uint8(  "reliable.fragment_id",      "Fragment id",          base.DEC )
+f.num_fragments    = ProtoField.uint16( "reliable.num_fragments",    "Number of fragments",  base.DEC )
+f.header_bytes     = ProtoField.uint8(  "reliable.header_bytes",     "Header bytes",         base.DEC )
+f.payload_bytes    = ProtoField.uint32( "reliable.payload_bytes",    "Payload bytes",        base.DEC )
+f.payload          = ProtoField.bytes(  "reliable.payload",          "Payload" )
+
+local e_short         = ProtoExpert.new( "reliable.short",         "Too short to contain its header",          expert.group.MALFORMED, expert.severity.ERROR )
+local e_prefix        = ProtoExpert.new( "reliable.bad_prefix",    "Fragment prefix byte must be exactly 1",   expert.group.MALFORMED, expert.severity.ERROR )
+local e_unused        = ProtoExpert.new( "reliable.unused_set",    "Unused prefix bit 7 is set",               expert.group.MALFORMED, expert.severity.WARN )
+local e_canonical     = ProtoExpert.new( "reliable.non_canonical", "Header is not canonically encoded",        expert.group.PROTOCOL,  expert.severity.WARN )
+local e_sequence      = ProtoExpert.new( "reliable.sequence_mismatch", "Embedded header sequence differs from the fragment's", expert.group.PROTOCOL, expert.severity.ERROR )
+local e_fragment_id   = ProtoExpert.new( "reliable.bad_fragment_id", "Fragment id is not less than the number of fragments", expert.group.MALFORMED, expert.severity.ERROR )
+
+reliable.experts = { e_short, e_prefix, e_unused, e_canonical, e_sequence, e_fragment_id }
+
+reliable.prefs.port = Pref.uint( "UDP port", 40000, "UDP port to decode as reliable" )
+
+local registered_port = nil
+
+local function register_port()
+    local udp_port = DissectorTable.get( "udp.port" )
+    if registered_port then
+        udp_port:remove( registered_port, reliable )
+    end
+    registered_port = reliable.prefs.port
+    udp_port:add( registered_port, reliable )
+end
+
+function reliable.prefs_changed()
+    register_port()
+end
+
+-- decodes the packet header at offset, per "Packet Header" in STANDARD.md. returns the bytes consumed, sequence, ack and ack_bits,
+-- or nil if the buffer is too short. a clear ack_bits flag means the byte is absent and reads as 0xFF
+
+local function dissect_packet_header( tvb, pinfo, tree, offset )
+    local length = tvb:len() - offset
+    if length < 1 then
+        return nil
+    end
+
+    local prefix_range = tvb( offset, 1 )
+    local prefix = prefix_range:uint()
+
+    tree:add( f.prefix, prefix_range )
+    tree:add( f.fragment, prefix_range )
+    tree:add( f.ack_bits_flags, prefix_range )
+    tree:add( f.ack_is_diff, prefix_range )
+    tree:add( f.probe, prefix_range )
+    local unused_item = tree:add( f.unused, prefix_range )
+    if bit.band( prefix, 0x80 ) ~= 0 then
+        unused_item:add_proto_expert_info( e_unused )
+    end
+
+    local ack_is_difference = bit.band( prefix, 0x20 ) ~= 0
+
+    local bytes = 3 + ( ack_is_difference and 1 or 2 )
+    for n = 1, 4 do
+        if bit.band( prefix, bit.lshift( 1, n ) ) ~= 0 then
+            bytes = bytes + 1
+        end
+    end
+
+    if length < bytes then
+        return nil
+    end
+
+    local i = offset + 1
+
+    local sequence = tvb( i, 2 ):le_uint()
+    tree:add_le( f.sequence, tvb( i, 2 ) )
+    i = i + 2
+
+    local ack
+    if ack_is_difference then
+        local difference = tvb( i, 1 ):uint()
+        tree:add( f.ack_difference, tvb( i, 1 ) )
+        ack = ( sequence - difference ) % 65536
+        tree:add( f.ack, tvb( i, 1 ), ack ):set_generated()
+        i = i + 1
+    else
+        ack = tvb( i, 2 ):le_uint()
+        local ack_item = tree:add_le( f.ack, tvb( i, 2 ) )
+        if ( sequence - ack ) % 65536 <= 255 then
+            ack_item:add_proto_expert_info( e_canonical, "16 bit ack where the difference fits in a byte" )
+        end
+        i = i + 2
+    end
+
+    local ack_bits = 0
+    local scale = 1
+    for n = 0, 3 do
+        local value = 0xFF
+        if bit.band( prefix, bit.lshift( 1, n + 1 ) ) ~= 0 then
+            value = tvb( i, 1 ):uint()
+            local byte_item = tree:add( f.ack_bits_byte, tvb( i, 1 ) )
+            if value == 0xFF then
+                byte_item:add_proto_expert_info( e_canonical, "ack_bits byte 0xFF should have been elided" )
+            end
+            i = i + 1
+        end
+        ack_bits = ack_bits + value * scale
+        scale = scale * 256
+    end
+    tree:add( f.ack_bits, tvb( offset, bytes ), ack_bits ):set_generated()
+
+    return bytes, sequence, ack, ack_bits
+end
+
+function reliable.dissector( tvb, pinfo, tree )
+    local length = tvb:len()
+    if length < 1 then
+        return 0
+    end
+
+    pinfo.cols.protocol = "RELIABLE"
+
+    local subtree = tree:add( reliable, tvb() )
+
+    local prefix = tvb( 0, 1 ):uint()
+    local header_bytes
+
+    if bit.band( prefix, 1 ) ~= 0 then
+
+        -- fragment header, per "Fragments" in STANDARD.md. always 5 bytes, and fragment 0 carries the packet header after it
+
+        if length < 5 then
+            subtree:add_proto_expert_info( e_short )
+            return length
+        end
+
+        local prefix_item = subtree:add( f.prefix, tvb( 0, 1 ) )
+        subtree:add( f.fragment, tvb( 0, 1 ) )
+        if prefix ~= 1 then
+            prefix_item:add_proto_expert_info( e_prefix )
+        end
+
+        local sequence = tvb( 1, 2 ):le_uint()
+        subtree:add_le( f.sequence, tvb( 1, 2 ) )
+
+        local fragment_id = tvb( 3, 1 ):uint()
+        local fragment_id_item = subtree:add( f.fragment_id, tvb( 3, 1 ) )
+
+        local num_fragments = tvb( 4, 1 ):uint() + 1
+        subtree:add( f.num_fragments, tvb( 4, 1 ), num_fragments )
+
+        if fragment_id >= num_fragments then
+            fragment_id_item:add_proto_expert_info( e_fragment_id )
+        end
+
+        header_bytes = 5
+
+        local info = string.format( "Fragment %d/%d seq=%d", fragment_id, num_fragments, sequence )
+
+        if fragment_id == 0 then
+            if length < 5 + 4 then
+                subtree:add_proto_expert_info( e_short )
+                return length
+            end
+            local header_tree = subtree:add( tvb( 5 ), "Packet header" )
+            local bytes, embedded_sequence, ack, ack_bits = dissect_packet_header( tvb, pinfo, header_tree, 5 )
+            if not bytes then
+                subtree:add_proto_expert_info( e_short )
+                return length
+            end
+            header_tree:set_len( bytes )
+            if embedded_sequence ~= sequence then
+                header_tree:add_proto_expert_info( e_sequence )
+            end
+            header_bytes = header_bytes + bytes
+            info = info .. string.format( " ack=%d ack_bits=0x%08X", ack, ack_bits )
+        end
+
+        pinfo.cols.info = info
+
+    else
+
+        local bytes, sequence, ack, ack_bits = dissect_packet_header( tvb, pinfo, subtree, 0 )
+        if not bytes then
+            subtree:add_proto_expert_info( e_short )
+            return length
+        end
+
+        header_bytes = bytes
+
+        local kind = bit.band( prefix, 0x40 ) ~= 0 and "Probe" or "Packet"
+        pinfo.cols.info = string.format( "%s seq=%d ack=%d ack_bits=0x%08X", kind, sequence, ack, ack_bits )
+
+    end
+
+    subtree:add( f.header_bytes, tvb( 0, header_bytes ), header_bytes ):set_generated()
+    subtree:add( f.payload_bytes, tvb( 0, header_bytes ), length - header_bytes ):set_generated()
+    if length > header_bytes then
+        subtree:add( f.payload, tvb( header_bytes ) )
+    end
+
+    return length
+end
+
+register_port()
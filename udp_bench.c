@@ -0,0 +1,415 @@
+/*
+    reliable
+
+    Copyright © 2017 - 2026, Más Bandwidth LLC
+
+    Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+        1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+        2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer 
+           in the documentation and/or other materials provided with the distribution.
+
+        3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived 
+           from this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+    INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+    WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+    USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Throughput of two endpoints talking over real udp sockets on localhost, through each socket driver. Each frame both
+// endpoints send a burst of packets, then each side receives everything that has arrived and both endpoints update.
+// The baseline is the loop everybody writes first: sendto in the transmit callback, and recvfrom until EAGAIN.
+// sendmmsg/recvmmsg sends each side's burst in one call and receives up to 64 datagrams per call.
+//
+// For each driver this reports packets/sec received, nanoseconds per packet and syscalls per packet. Drivers that
+// this kernel can't run are skipped. See BUILDING.md before reading anything into the numbers.
+//
+// Usage: udp_bench [--frames N] [--packets N] [--bytes N]
+
+#include "reliable.h"
+#include "reliable_udp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MAX_PACKET_BYTES 1500
+
+static double bench_time()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+struct side_t
+{
+    struct reliable_endpoint_t * endpoint;
+    int socket;                                         // plain sockets only
+    struct sockaddr_in peer_sockaddr;
+    struct reliable_udp_io_uring_t * io_uring;          // io_uring only
+    struct reliable_udp_mmsg_t * mmsg;                  // recvmmsg/sendmmsg only
+    struct reliable_udp_address_t peer_address;
+    uint64_t num_packets_received;
+    uint64_t num_syscalls;
+};
+
+static struct side_t sides[2];
+
+static int process_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    (void) packet_data;
+    (void) packet_bytes;
+    sides[id].num_packets_received++;
+    return 1;
+}
+
+static struct reliable_endpoint_t * create_endpoint( uint64_t id, void (*transmit_packet_function)(void*,uint64_t,uint16_t,uint8_t*,int) )
+{
+    struct reliable_config_t config;
+    reliable_default_config( &config );
+    config.id = id;
+    config.transmit_packet_function = transmit_packet_function;
+    config.process_packet_function = process_packet_function;
+    return reliable_endpoint_create( &config, 100.0 );
+}
+
+// ---------------------------------------------------------------
+
+static void plain_transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    struct side_t * side = sides + id;
+    sendto( side->socket, packet_data, packet_bytes, 0, (struct sockaddr*) &side->peer_sockaddr, sizeof( side->peer_sockaddr ) );
+    side->num_syscalls++;
+}
+
+static void plain_receive( struct side_t * side )
+{
+    uint8_t packet_data[MAX_PACKET_BYTES];
+    while ( 1 )
+    {
+        struct sockaddr_in from;
+        socklen_t from_bytes = sizeof( from );
+        int packet_bytes = (int) recvfrom( side->socket, packet_data, sizeof( packet_data ), 0, (struct sockaddr*) &from, &from_bytes );
+        side->num_syscalls++;
+        if ( packet_bytes <= 0 )
+            break;
+        reliable_endpoint_receive_packet( side->endpoint, packet_data, packet_bytes );
+    }
+}
+
+static int plain_create()
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        struct side_t * side = sides + i;
+        side->socket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+        int buffer_size = 4 * 1024 * 1024;
+        setsockopt( side->socket, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof( buffer_size ) );
+        setsockopt( side->socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof( buffer_size ) );
+        struct sockaddr_in address;
+        memset( &address, 0, sizeof( address ) );
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        if ( bind( side->socket, (struct sockaddr*) &address, sizeof( address ) ) < 0 )
+            return 0;
+        fcntl( side->socket, F_SETFL, fcntl( side->socket, F_GETFL, 0 ) | O_NONBLOCK );
+        side->endpoint = create_endpoint( (uint64_t) i, plain_transmit_packet_function );
+    }
+    for ( i = 0; i < 2; ++i )
+    {
+        socklen_t bytes = sizeof( sides[i].peer_sockaddr );
+        getsockname( sides[1-i].socket, (struct sockaddr*) &sides[i].peer_sockaddr, &bytes );
+    }
+    return 1;
+}
+
+static void plain_destroy()
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        close( sides[i].socket );
+        reliable_endpoint_destroy( sides[i].endpoint );
+    }
+}
+
+static void plain_flush( struct side_t * side )
+{
+    (void) side;
+}
+
+// ---------------------------------------------------------------
+
+static void io_uring_transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    struct side_t * side = sides + id;
+    reliable_udp_io_uring_send( side->io_uring, &side->peer_address, packet_data, packet_bytes );
+}
+
+static void io_uring_receive_function( void * context, RELIABLE_CONST struct reliable_udp_address_t * from, uint8_t * packet_data, int packet_bytes )
+{
+    (void) from;
+    struct side_t * side = (struct side_t*) context;
+    reliable_endpoint_receive_packet( side->endpoint, packet_data, packet_bytes );
+}
+
+static int io_uring_create()
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        struct reliable_udp_io_uring_config_t config;
+        reliable_udp_io_uring_default_config( &config );
+        reliable_udp_address_parse( &config.bind_address, "127.0.0.1" );
+        config.context = sides + i;
+        config.receive_function = io_uring_receive_function;
+        sides[i].io_uring = reliable_udp_io_uring_create( &config );
+        if ( !sides[i].io_uring )
+        {
+            if ( i == 1 )
+                reliable_udp_io_uring_destroy( sides[0].io_uring );
+            return 0;
+        }
+        sides[i].endpoint = create_endpoint( (uint64_t) i, io_uring_transmit_packet_function );
+    }
+    for ( i = 0; i < 2; ++i )
+    {
+        reliable_udp_io_uring_address( sides[1-i].io_uring, &sides[i].peer_address );
+    }
+    return 1;
+}
+
+static void io_uring_flush( struct side_t * side )
+{
+    reliable_udp_io_uring_flush( side->io_uring );
+}
+
+static void io_uring_receive( struct side_t * side )
+{
+    reliable_udp_io_uring_receive( side->io_uring );
+}
+
+static void io_uring_destroy()
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        sides[i].num_syscalls = reliable_udp_io_uring_counters( sides[i].io_uring )[RELIABLE_UDP_COUNTER_NUM_SYSCALLS];
+        reliable_udp_io_uring_destroy( sides[i].io_uring );
+        reliable_endpoint_destroy( sides[i].endpoint );
+    }
+}
+
+// ---------------------------------------------------------------
+
+// each side registers its endpoint under the peer's address, so the driver demultiplexes straight into it
+
+static void mmsg_transmit_packet_function( void * context, uint64_t id, uint16_t sequence, uint8_t * packet_data, int packet_bytes )
+{
+    (void) context;
+    (void) sequence;
+    struct side_t * side = sides + id;
+    reliable_udp_mmsg_send( side->mmsg, &side->peer_address, packet_data, packet_bytes );
+}
+
+static int mmsg_create()
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        struct reliable_udp_mmsg_config_t config;
+        reliable_udp_mmsg_default_config( &config );
+        reliable_udp_address_parse( &config.bind_address, "127.0.0.1" );
+        config.max_endpoints = 1;
+        sides[i].mmsg = reliable_udp_mmsg_create( &config );
+        if ( !sides[i].mmsg )
+        {
+            if ( i == 1 )
+                reliable_udp_mmsg_destroy( sides[0].mmsg );
+            return 0;
+        }
+        sides[i].endpoint = create_endpoint( (uint64_t) i, mmsg_transmit_packet_function );
+    }
+    for ( i = 0; i < 2; ++i )
+    {
+        reliable_udp_mmsg_address( sides[1-i].mmsg, &sides[i].peer_address );
+        reliable_udp_mmsg_add_endpoint( sides[i].mmsg, &sides[i].peer_address, sides[i].endpoint );
+    }
+    return 1;
+}
+
+static void mmsg_flush( struct side_t * side )
+{
+    reliable_udp_mmsg_flush( side->mmsg );
+}
+
+static void mmsg_receive( struct side_t * side )
+{
+    reliable_udp_mmsg_receive( side->mmsg );
+}
+
+static void mmsg_destroy()
+{
+    int i;
+    for ( i = 0; i < 2; ++i )
+    {
+        sides[i].num_syscalls = reliable_udp_mmsg_counters( sides[i].mmsg )[RELIABLE_UDP_COUNTER_NUM_SYSCALLS];
+        reliable_udp_mmsg_destroy( sides[i].mmsg );
+        reliable_endpoint_destroy( sides[i].endpoint );
+    }
+}
+
+// ---------------------------------------------------------------
+
+struct driver_t
+{
+    const char * name;
+    int (*create)();
+    void (*flush)( struct side_t * side );
+    void (*receive)( struct side_t * side );
+    void (*destroy)();
+};
+
+static const struct driver_t drivers[] =
+{
+    { "sendto/recvfrom", plain_create, plain_flush, plain_receive, plain_destroy },
+    { "sendmmsg/recvmmsg", mmsg_create, mmsg_flush, mmsg_receive, mmsg_destroy },
+    { "io_uring", io_uring_create, io_uring_flush, io_uring_receive, io_uring_destroy },
+};
+
+static int run( const struct driver_t * driver, int num_frames, int packets_per_frame, int payload_bytes )
+{
+    memset( sides, 0, sizeof( sides ) );
+
+    if ( !driver->create() )
+    {
+        printf( "%-18s not available on this kernel, skipped\n", driver->name );
+        return 1;
+    }
+
+    static uint8_t packet_data[MAX_PACKET_BYTES];
+    memset( packet_data, 0, sizeof( packet_data ) );
+
+    double time = 100.0;
+    double start_time = bench_time();
+
+    uint64_t num_packets_sent = 0;
+
+    int frame;
+    for ( frame = 0; frame < num_frames; ++frame )
+    {
+        int i, j;
+        for ( i = 0; i < 2; ++i )
+        {
+            for ( j = 0; j < packets_per_frame; ++j )
+                reliable_endpoint_send_packet( sides[i].endpoint, packet_data, payload_bytes );
+            driver->flush( sides + i );
+        }
+
+        num_packets_sent += 2 * packets_per_frame;
+
+        // localhost delivers during the send, but give a slow kernel a moment before calling it lost
+
+        int attempt;
+        for ( attempt = 0; attempt < 1000; ++attempt )
+        {
+            driver->receive( sides + 0 );
+            driver->receive( sides + 1 );
+            if ( sides[0].num_packets_received + sides[1].num_packets_received == num_packets_sent )
+                break;
+        }
+
+        time += 1.0 / 60.0;
+
+        for ( i = 0; i < 2; ++i )
+        {
+            reliable_endpoint_update( sides[i].endpoint, time );
+            reliable_endpoint_clear_acks( sides[i].endpoint );
+        }
+    }
+
+    double seconds = bench_time() - start_time;
+
+    uint64_t num_packets_received = sides[0].num_packets_received + sides[1].num_packets_received;
+
+    driver->destroy();
+
+    uint64_t num_syscalls = sides[0].num_syscalls + sides[1].num_syscalls;
+
+    printf( "%-18s %12.0f %10.0f %16.3f %9.0f%%\n",
+        driver->name,
+        num_packets_received / seconds,
+        seconds * 1000000000.0 / num_packets_received,
+        num_syscalls / (double) num_packets_received,
+        100.0 * num_packets_received / num_packets_sent );
+
+    if ( num_packets_received != num_packets_sent )
+    {
+        printf( "error: %d packets were lost on localhost\n", (int) ( num_packets_sent - num_packets_received ) );
+        return 0;
+    }
+
+    return 1;
+}
+
+int main( int argc, char ** argv )
+{
+    int num_frames = 2000;
+    int packets_per_frame = 64;
+    int payload_bytes = 100;
+
+    int i;
+    for ( i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--frames" ) == 0 && i + 1 < argc )
+            num_frames = atoi( argv[++i] );
+        else if ( strcmp( argv[i], "--packets" ) == 0 && i + 1 < argc )
+            packets_per_frame = atoi( argv[++i] );
+        else if ( strcmp( argv[i], "--bytes" ) == 0 && i + 1 < argc )
+            payload_bytes = atoi( argv[++i] );
+        else
+            num_frames = 0;
+    }
+
+    if ( num_frames <= 0 || packets_per_frame <= 0 || payload_bytes <= 0 || payload_bytes > 1024 )
+    {
+        printf( "usage: udp_bench [--frames N] [--packets N] [--bytes N]   (bytes <= 1024, so nothing fragments)\n" );
+        return 1;
+    }
+
+    reliable_init();
+
+    printf( "[udp_bench] localhost, %d frames, %d packets of %d bytes per frame each way\n\n", num_frames, packets_per_frame, payload_bytes );
+    printf( "%-18s %12s %10s %16s %10s\n", "driver", "packets/sec", "ns/packet", "syscalls/packet", "delivered" );
+
+    int result = 1;
+    int num_drivers = (int) ( sizeof( drivers ) / sizeof( drivers[0] ) );
+    for ( i = 0; i < num_drivers; ++i )
+    {
+        result &= run( drivers + i, num_frames, packets_per_frame, payload_bytes );
+    }
+
+    reliable_term();
+
+    return result ? 0 : 1;
+}